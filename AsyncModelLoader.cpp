@@ -0,0 +1,88 @@
+#include "AsyncModelLoader.h"
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+
+AsyncModelLoader::~AsyncModelLoader() {
+    Shutdown();
+}
+
+void AsyncModelLoader::Start(const std::string& path, const std::string& mtlPath, const ObjParseOptions& objOptions) {
+    Cancel();
+    reapCancelledJobs(false);
+
+    auto job = std::make_shared<Job>();
+    job->path = path;
+    job->mtlPath = mtlPath;
+    job->objOptions = objOptions;
+
+    // The job outlives its thread: it is only released after the thread has been joined
+    Job* worker = job.get();
+    job->thread = std::thread([worker]() {
+        try {
+            // The import is the first 80% of a load, the GL upload on the main thread is the rest
+            worker->data = Model::ImportModelData(worker->path, worker->mtlPath, [worker](float progress) {
+                worker->progress.store(progress * 0.8f, std::memory_order_relaxed);
+                }, &worker->cancelled, worker->objOptions);
+        }
+        catch (const std::exception& e) {
+            worker->error = e.what();
+        }
+        worker->finished.store(true, std::memory_order_release);
+        });
+
+    current = std::move(job);
+}
+
+void AsyncModelLoader::Cancel() {
+    if (!current) {
+        return;
+    }
+
+    std::cout << "Cancelled loading: " << current->path << std::endl;
+    current->cancelled.store(true, std::memory_order_relaxed);
+    cancelledJobs.push_back(std::move(current));
+    current.reset();
+}
+
+void AsyncModelLoader::Shutdown() {
+    Cancel();
+    reapCancelledJobs(true);
+}
+
+float AsyncModelLoader::GetProgress() const {
+    return current ? current->progress.load(std::memory_order_relaxed) : 0.0f;
+}
+
+const std::string& AsyncModelLoader::GetPath() const {
+    static const std::string none;
+    return current ? current->path : none;
+}
+
+Model* AsyncModelLoader::Poll() {
+    reapCancelledJobs(false);
+
+    if (!current || !current->finished.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+
+    std::shared_ptr<Job> job = std::move(current);
+    current.reset();
+    job->thread.join();
+
+    if (!job->error.empty()) {
+        throw std::runtime_error(job->error);
+    }
+
+    return new Model(job->path, job->mtlPath, std::move(job->data));
+}
+
+void AsyncModelLoader::reapCancelledJobs(bool wait) {
+    cancelledJobs.erase(std::remove_if(cancelledJobs.begin(), cancelledJobs.end(), [wait](const std::shared_ptr<Job>& job) {
+        if (!wait && !job->finished.load(std::memory_order_acquire)) {
+            return false;
+        }
+        job->thread.join();
+        return true;
+        }), cancelledJobs.end());
+}
\ No newline at end of file
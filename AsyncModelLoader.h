@@ -0,0 +1,53 @@
+#pragma once
+#include <string>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "Model.h"
+
+// Runs Model::ImportModelData on a background thread. When the import finishes, Poll() hands the
+// data to a new Model on the calling (GL) thread, which then uploads it through ContinueLoading.
+// Starting another load cancels the one in flight; a cancelled import is abandoned and its thread
+// joined once it notices the flag.
+class AsyncModelLoader {
+public:
+    AsyncModelLoader() = default;
+    ~AsyncModelLoader();
+
+    AsyncModelLoader(const AsyncModelLoader&) = delete;
+    AsyncModelLoader& operator=(const AsyncModelLoader&) = delete;
+
+    void Start(const std::string& path, const std::string& mtlPath = "", const ObjParseOptions& objOptions = ObjParseOptions());
+    void Cancel();
+
+    // Cancels everything and waits for the worker threads, call before the GL context goes away
+    void Shutdown();
+
+    // True while an import is running or its result has not been collected by Poll()
+    bool IsBusy() const { return current != nullptr; }
+    float GetProgress() const;
+    const std::string& GetPath() const;
+
+    // Returns the new model once its import is done, nullptr while it is still running.
+    // Throws std::runtime_error if the import failed.
+    Model* Poll();
+
+private:
+    struct Job {
+        std::string path;
+        std::string mtlPath;
+        ObjParseOptions objOptions;
+        std::thread thread;
+        std::atomic<bool> cancelled{ false };
+        std::atomic<bool> finished{ false };
+        std::atomic<float> progress{ 0.0f };
+        ModelData data;
+        std::string error;
+    };
+
+    std::shared_ptr<Job> current;
+    std::vector<std::shared_ptr<Job>> cancelledJobs;
+
+    void reapCancelledJobs(bool wait);
+};
\ No newline at end of file
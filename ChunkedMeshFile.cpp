@@ -0,0 +1,1283 @@
+#include "ChunkedMeshFile.h"
+#include "Model.h"
+#include "Objloader.h"
+#include "PlyLoader.h"
+#include "StlLoader.h"
+#include "MappedFile.h"
+#include "MeshProcessing.h"
+#include "ThreadPool.h"
+#include "TextureLoader.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ChunkedMeshFile {
+    namespace {
+        // Triangle centroids are counted into a grid over the whole model; chunks are cut from its cells
+        const uint32_t GRID_LEVELS = 7;
+        const uint32_t GRID_SIZE = 1u << GRID_LEVELS;
+        // A chunk is split into its subtree in memory, this bounds the memory of one build task
+        const uint64_t CHUNK_MAX_TRIANGLES = 512 * 1024;
+        const size_t CHUNK_CONCURRENCY = 2;
+        const size_t LEAF_MAX_TRIANGLES = 32 * 1024;
+        const uint32_t MAX_LEVEL = 24;
+        // Inner nodes merge their children's vertices per cell of a SIMPLIFY_GRID^3 grid over their cube
+        const uint32_t SIMPLIFY_GRID = 64;
+        // Triangles read from the intermediate files per step
+        const size_t READ_BLOCK_TRIANGLES = 1 << 16;
+        const size_t OBJ_STREAM_BYTES = 16 * 1024 * 1024;
+
+        struct FileStamp {
+            uint64_t size = 0;
+            int64_t time = 0;
+        };
+
+        FileStamp stampOf(const std::string& path) {
+            FileStamp stamp;
+            std::error_code ec;
+            uint64_t size = std::filesystem::file_size(path, ec);
+            if (ec) {
+                return stamp;
+            }
+            auto time = std::filesystem::last_write_time(path, ec);
+            if (ec) {
+                return stamp;
+            }
+
+            stamp.size = size;
+            stamp.time = static_cast<int64_t>(time.time_since_epoch().count());
+            return stamp;
+        }
+
+        // Source triangles are written to a temporary file with their corners expanded
+        struct Triangle {
+            Vertex corners[3];
+            uint32_t material;
+        };
+
+        glm::vec3 centroidOf(const Triangle& triangle) {
+            return (triangle.corners[0].Position + triangle.corners[1].Position + triangle.corners[2].Position) / 3.0f;
+        }
+
+        bool cancelled(const std::atomic<bool>* cancel) {
+            return cancel && cancel->load(std::memory_order_relaxed);
+        }
+
+        // Buffers the source triangles into the temporary file and tracks their bounds
+        class TriangleSink {
+        public:
+            bool Open(const std::string& path) {
+                out.open(path, std::ios::binary | std::ios::trunc);
+                buffer.reserve(READ_BLOCK_TRIANGLES);
+                return out.is_open();
+            }
+
+            // Triangles with non-finite corners are dropped
+            bool Add(const Vertex& a, const Vertex& b, const Vertex& c, uint32_t material) {
+                for (const Vertex* corner : { &a, &b, &c }) {
+                    const glm::vec3& p = corner->Position;
+                    if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z)) {
+                        return true;
+                    }
+                }
+                for (const Vertex* corner : { &a, &b, &c }) {
+                    minBounds = glm::min(minBounds, corner->Position);
+                    maxBounds = glm::max(maxBounds, corner->Position);
+                }
+
+                buffer.push_back({ { a, b, c }, material });
+                count++;
+                return buffer.size() < READ_BLOCK_TRIANGLES || Flush();
+            }
+
+            bool Flush() {
+                if (!buffer.empty()) {
+                    out.write(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(Triangle));
+                    buffer.clear();
+                }
+                return static_cast<bool>(out);
+            }
+
+            bool Close() {
+                bool ok = Flush();
+                out.close();
+                return ok && !out.fail();
+            }
+
+            // Drops everything written so far, for a source that is read again another way
+            bool Reset(const std::string& path) {
+                out.close();
+                buffer.clear();
+                count = 0;
+                minBounds = glm::vec3(FLT_MAX);
+                maxBounds = glm::vec3(-FLT_MAX);
+                materials.clear();
+                generateNormals = false;
+                generateTangents = false;
+                return Open(path);
+            }
+
+            uint64_t count = 0;
+            glm::vec3 minBounds = glm::vec3(FLT_MAX);
+            glm::vec3 maxBounds = glm::vec3(-FLT_MAX);
+            std::vector<Material> materials;
+            bool generateNormals = false;   // the source has no normals, leaves get smooth ones
+            bool generateTangents = false;  // the source has UVs but no tangents
+
+        private:
+            std::ofstream out;
+            std::vector<Triangle> buffer;
+        };
+
+        Vertex positionVertex(const glm::vec3& position) {
+            Vertex vertex;
+            vertex.Position = position;
+            vertex.Normal = glm::vec3(0.0f, 1.0f, 0.0f);
+            vertex.TexCoords = glm::vec2(0.0f);
+            vertex.Tangent = glm::vec3(1.0f, 0.0f, 0.0f);
+            vertex.Bitangent = glm::vec3(0.0f, 1.0f, 0.0f);
+            return vertex;
+        }
+
+        Material defaultMaterial() {
+            Material material;
+            material.properties.name = "default";
+            return material;
+        }
+
+        // Texture paths are resolved against the model once, embedded and missing textures are dropped
+        std::vector<TextureRef> resolveTextures(const std::vector<TextureRef>& refs, const std::string& directory) {
+            std::vector<TextureRef> resolved;
+            for (const TextureRef& ref : refs) {
+                if (ref.path.empty() || ref.path[0] == '*') {
+                    continue;
+                }
+                std::string filename = TextureLoader::ResolvePath(ref.path, directory);
+                if (filename.empty()) {
+                    std::cout << "Texture file not found: " << ref.path << std::endl;
+                    continue;
+                }
+                TextureRef texture;
+                texture.type = ref.type;
+                texture.path = filename;
+                resolved.push_back(texture);
+            }
+            return resolved;
+        }
+
+        bool readPly(const std::string& path, TriangleSink& sink, const std::function<void(float)>& report,
+            const std::atomic<bool>* cancel, std::string& error) {
+            MappedFile file;
+            if (!file.Open(path)) {
+                error = "Could not open " + path;
+                return false;
+            }
+
+            PlyLoader reader;
+            reader.SetCancelFlag(cancel);
+            const char* end = file.Data() + file.Size();
+            const char* cursor = nullptr;
+            if (!reader.ParseHeader(file.Data(), end, cursor)) {
+                error = reader.GetError();
+                return false;
+            }
+
+            const PlyLoader::Element* vertexElement = nullptr;
+            const char* vertexData = nullptr;
+            PlyLoader::VertexFormat format;
+            bool hasFaces = false;
+            bool writeFailed = false;
+            for (const PlyLoader::Element& element : reader.GetElements()) {
+                if (element.name == "vertex" && !vertexElement) {
+                    if (element.stride == 0) {
+                        error = "PLY vertices with list properties are not supported";
+                        return false;
+                    }
+                    if (static_cast<size_t>(end - cursor) / element.stride < element.count) {
+                        error = "PLY vertex data is truncated";
+                        return false;
+                    }
+                    if (!reader.FindVertexFormat(element, format)) {
+                        error = reader.GetError();
+                        return false;
+                    }
+                    vertexElement = &element;
+                    vertexData = cursor;
+                    cursor += element.count * element.stride;
+                }
+                else if (element.name == "face" && vertexElement && !hasFaces) {
+                    uint64_t emitted = 0;
+                    bool read = reader.ReadTriangles(element, cursor, end, vertexElement->count, [&](const unsigned int* indices, size_t count) {
+                        Vertex corners[3];
+                        for (size_t t = 0; t < count; t++) {
+                            for (int corner = 0; corner < 3; corner++) {
+                                PlyLoader::ReadVertex(*vertexElement, format, vertexData + size_t(indices[t * 3 + corner]) * vertexElement->stride, corners[corner]);
+                            }
+                            if (!sink.Add(corners[0], corners[1], corners[2], 0)) {
+                                writeFailed = true;
+                                return false;
+                            }
+                        }
+                        emitted += count;
+                        report((std::min)(1.0f, static_cast<float>(emitted) / static_cast<float>(element.count)));
+                        return !cancelled(cancel);
+                    });
+                    if (!read) {
+                        error = writeFailed ? "Failed to write chunked mesh triangles" : reader.GetError();
+                        return false;
+                    }
+                    hasFaces = true;
+                }
+                else if (!reader.SkipElement(element, cursor, end)) {
+                    error = "PLY element '" + element.name + "' is truncated";
+                    return false;
+                }
+            }
+            if (!hasFaces) {
+                error = "PLY file has no faces, open it as a point cloud instead";
+                return false;
+            }
+
+            sink.materials.push_back(defaultMaterial());
+            sink.generateNormals = !format.hasNormals;
+            return true;
+        }
+
+        bool readStl(const std::string& path, TriangleSink& sink, const std::function<void(float)>& report,
+            const std::atomic<bool>* cancel, std::string& error) {
+            StlLoader reader;
+            reader.SetCancelFlag(cancel);
+            reader.SetProgressCallback(report);
+            bool writeFailed = false;
+            bool read = reader.ReadTriangles(path, [&](const glm::vec3* corners, size_t count) {
+                for (size_t t = 0; t < count; t++) {
+                    if (!sink.Add(positionVertex(corners[t * 3]), positionVertex(corners[t * 3 + 1]), positionVertex(corners[t * 3 + 2]), 0)) {
+                        writeFailed = true;
+                        return false;
+                    }
+                }
+                return true;
+            });
+            if (!read) {
+                error = writeFailed ? "Failed to write chunked mesh triangles" : reader.GetError();
+                return false;
+            }
+
+            sink.materials.push_back(defaultMaterial());
+            sink.generateNormals = true;
+            return true;
+        }
+
+        // An OBJ face spilled during the first pass, as positions in the spilled vertex file
+        struct ObjFace {
+            uint64_t corners[3];
+            uint32_t material;
+        };
+
+        // Faces may refer to any vertex their material produced earlier in the file, so the OBJ is read
+        // in two passes: the stream's vertices and faces are spilled to part files, then the faces are
+        // expanded from the mapped vertex file. Neither list has to fit in memory.
+        bool readObj(const std::string& path, const std::string& mtlPath, const std::string& partDirectory, TriangleSink& sink,
+            const std::function<void(float)>& report, const std::atomic<bool>* cancel, std::string& error) {
+            FastObjLoader loader;
+            loader.SetCancelFlag(cancel);
+            if (!loader.BeginStream(path, mtlPath)) {
+                error = "Could not open " + path;
+                return false;
+            }
+
+            std::string vertexPath = partDirectory + "/obj_vertices.bin";
+            std::string facePath = partDirectory + "/obj_faces.bin";
+            std::ofstream vertexOut(vertexPath, std::ios::binary | std::ios::trunc);
+            std::ofstream faceOut(facePath, std::ios::binary | std::ios::trunc);
+            if (!vertexOut.is_open() || !faceOut.is_open()) {
+                error = "Failed to create chunked mesh part file: " + vertexPath;
+                return false;
+            }
+
+            // A material's vertices arrive in runs, one per batch; each run maps a range of the
+            // material's indices to where those vertices were written
+            struct VertexRun {
+                uint64_t first;
+                uint64_t fileOffset;
+            };
+            std::vector<std::vector<VertexRun>> materialRuns;
+            std::vector<uint64_t> materialVertexCount;
+            std::vector<uint32_t> sinkMaterial;
+            uint64_t vertexCount = 0;
+            uint64_t faceCount = 0;
+            std::vector<ObjFace> faces;
+            std::vector<ObjStreamBatch> batches;
+            bool more = true;
+            while (more) {
+                if (cancelled(cancel)) {
+                    error = "Cancelled";
+                    return false;
+                }
+
+                more = loader.StreamNext(OBJ_STREAM_BYTES, batches);
+                for (ObjStreamBatch& batch : batches) {
+                    if (batch.material >= materialRuns.size()) {
+                        materialRuns.resize(batch.material + 1);
+                        materialVertexCount.resize(batch.material + 1, 0);
+                        sinkMaterial.resize(batch.material + 1, NO_NODE);
+                    }
+                    if (sinkMaterial[batch.material] == NO_NODE) {
+                        Material material;
+                        material.properties.name = loader.GetStreamMaterialName(batch.material);
+                        material.textures = resolveTextures(loader.GetStreamTextureRefs(batch.material), "");
+                        sinkMaterial[batch.material] = static_cast<uint32_t>(sink.materials.size());
+                        sink.materials.push_back(std::move(material));
+                    }
+
+                    std::vector<VertexRun>& runs = materialRuns[batch.material];
+                    if (!batch.vertices.empty()) {
+                        runs.push_back({ materialVertexCount[batch.material], vertexCount });
+                        vertexOut.write(reinterpret_cast<const char*>(batch.vertices.data()), batch.vertices.size() * sizeof(Vertex));
+                        materialVertexCount[batch.material] += batch.vertices.size();
+                        vertexCount += batch.vertices.size();
+                    }
+
+                    faces.clear();
+                    for (size_t i = 0; i + 2 < batch.indices.size(); i += 3) {
+                        ObjFace face;
+                        for (int corner = 0; corner < 3; corner++) {
+                            uint64_t index = batch.indices[i + corner];
+                            auto run = std::upper_bound(runs.begin(), runs.end(), index,
+                                [](uint64_t value, const VertexRun& r) { return value < r.first; });
+                            face.corners[corner] = (run - 1)->fileOffset + (index - (run - 1)->first);
+                        }
+                        face.material = sinkMaterial[batch.material];
+                        faces.push_back(face);
+                    }
+                    faceOut.write(reinterpret_cast<const char*>(faces.data()), faces.size() * sizeof(ObjFace));
+                    faceCount += faces.size();
+                    if (!vertexOut || !faceOut) {
+                        error = "Failed to write chunked mesh part file: " + vertexPath;
+                        return false;
+                    }
+                }
+                report(0.8f * loader.GetStreamProgress());
+            }
+            loader.EndStream();
+            vertexOut.close();
+            faceOut.close();
+            if (vertexOut.fail() || faceOut.fail()) {
+                error = "Failed to write chunked mesh part file: " + vertexPath;
+                return false;
+            }
+
+            if (faceCount > 0) {
+                MappedFile vertexFile;
+                if (!vertexFile.Open(vertexPath) || vertexFile.Size() != vertexCount * sizeof(Vertex)) {
+                    error = "Failed to read chunked mesh part file: " + vertexPath;
+                    return false;
+                }
+                const Vertex* vertices = reinterpret_cast<const Vertex*>(vertexFile.Data());
+
+                std::ifstream faceIn(facePath, std::ios::binary);
+                faces.resize(READ_BLOCK_TRIANGLES);
+                for (uint64_t done = 0; done < faceCount;) {
+                    if (cancelled(cancel)) {
+                        error = "Cancelled";
+                        return false;
+                    }
+
+                    size_t count = static_cast<size_t>((std::min)(uint64_t(READ_BLOCK_TRIANGLES), faceCount - done));
+                    if (!faceIn.read(reinterpret_cast<char*>(faces.data()), count * sizeof(ObjFace))) {
+                        error = "Failed to read chunked mesh part file: " + facePath;
+                        return false;
+                    }
+                    for (size_t f = 0; f < count; f++) {
+                        const ObjFace& face = faces[f];
+                        if (!sink.Add(vertices[face.corners[0]], vertices[face.corners[1]], vertices[face.corners[2]], face.material)) {
+                            error = "Failed to write chunked mesh triangles";
+                            return false;
+                        }
+                    }
+                    done += count;
+                    report(0.8f + 0.2f * static_cast<float>(done) / static_cast<float>(faceCount));
+                }
+            }
+
+            std::error_code ec;
+            std::filesystem::remove(vertexPath, ec);
+            std::filesystem::remove(facePath, ec);
+            sink.generateTangents = true;
+            return true;
+        }
+
+        // Any other format goes through the regular importer, each mesh is released once it is written
+        bool readImported(const std::string& path, const std::string& mtlPath, TriangleSink& sink,
+            const std::function<void(float)>& report, const std::atomic<bool>* cancel, std::string& error) {
+            ModelData data;
+            try {
+                data = Model::ImportModelData(path, mtlPath, report, cancel);
+            }
+            catch (const std::exception& e) {
+                error = e.what();
+                return false;
+            }
+            data.images.clear();
+
+            std::string directory = path.substr(0, path.find_last_of('/'));
+            std::map<std::string, uint32_t> materialOfKey;
+            for (MeshData& mesh : data.meshes) {
+                // Meshes sharing a material and its textures share one material table entry
+                std::string key = mesh.materialProps.name;
+                for (const TextureRef& ref : mesh.textures) {
+                    key += '\n' + ref.type + '\n' + ref.path;
+                }
+                auto found = materialOfKey.find(key);
+                uint32_t material;
+                if (found != materialOfKey.end()) {
+                    material = found->second;
+                }
+                else {
+                    material = static_cast<uint32_t>(sink.materials.size());
+                    materialOfKey[key] = material;
+                    Material entry;
+                    entry.properties = mesh.materialProps;
+                    entry.textures = resolveTextures(mesh.textures, directory);
+                    sink.materials.push_back(std::move(entry));
+                }
+
+                for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+                    if (!sink.Add(mesh.vertices[mesh.indices[i]], mesh.vertices[mesh.indices[i + 1]], mesh.vertices[mesh.indices[i + 2]], material)) {
+                        error = "Failed to write chunked mesh triangles";
+                        return false;
+                    }
+                }
+                mesh = MeshData();
+            }
+            return true;
+        }
+
+        struct Cube {
+            float origin[3];
+            float size;
+        };
+
+        uint32_t cellOf(float value, float origin, float cellsPerUnit, uint32_t cells) {
+            float cell = (value - origin) * cellsPerUnit;
+            if (!(cell > 0.0f)) {
+                return 0;
+            }
+            return (std::min)(static_cast<uint32_t>(cell), cells - 1);
+        }
+
+        size_t gridIndex(uint32_t x, uint32_t y, uint32_t z, uint32_t cells) {
+            return (static_cast<size_t>(z) * cells + y) * cells + x;
+        }
+
+        Cube childCube(const Cube& cube, uint32_t octant) {
+            Cube child;
+            child.size = cube.size * 0.5f;
+            for (int axis = 0; axis < 3; axis++) {
+                child.origin[axis] = cube.origin[axis] + ((octant >> axis) & 1 ? child.size : 0.0f);
+            }
+            return child;
+        }
+
+        uint32_t octantOf(const glm::vec3& point, const Cube& cube) {
+            float half = cube.size * 0.5f;
+            return (point.x >= cube.origin[0] + half ? 1u : 0u)
+                | (point.y >= cube.origin[1] + half ? 2u : 0u)
+                | (point.z >= cube.origin[2] + half ? 4u : 0u);
+        }
+
+        // Geometry of one node, indices grouped into one range per material
+        struct NodeMesh {
+            std::vector<Range> ranges;
+            std::vector<Vertex> vertices;
+            std::vector<uint32_t> indices;
+            glm::vec3 minBounds = glm::vec3(FLT_MAX);
+            glm::vec3 maxBounds = glm::vec3(-FLT_MAX);
+            float error = 0.0f;
+        };
+
+        struct VertexHash {
+            size_t operator()(const Vertex& vertex) const {
+                uint32_t words[sizeof(Vertex) / sizeof(uint32_t)];
+                std::memcpy(words, &vertex, sizeof(words));
+                uint64_t h = 0xCBF29CE484222325ull;
+                for (uint32_t word : words) {
+                    h = (h ^ word) * 0x100000001B3ull;
+                }
+                return static_cast<size_t>(h ^ (h >> 32));
+            }
+        };
+
+        struct VertexEqual {
+            bool operator()(const Vertex& a, const Vertex& b) const {
+                return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+            }
+        };
+
+        struct TriangleKey {
+            uint32_t a, b, c;
+            bool operator==(const TriangleKey& other) const { return a == other.a && b == other.b && c == other.c; }
+        };
+
+        struct TriangleKeyHash {
+            size_t operator()(const TriangleKey& key) const {
+                uint64_t h = key.a * 0x9E3779B97F4A7C15ull;
+                h ^= key.b * 0xC2B2AE3D27D4EB4Full;
+                h ^= key.c * 0x165667B19E3779F9ull;
+                return static_cast<size_t>(h ^ (h >> 32));
+            }
+        };
+
+        void expandBounds(NodeMesh& mesh) {
+            for (const Vertex& vertex : mesh.vertices) {
+                mesh.minBounds = glm::min(mesh.minBounds, vertex.Position);
+                mesh.maxBounds = glm::max(mesh.maxBounds, vertex.Position);
+            }
+        }
+
+        // Welds the leaf's corners into an indexed mesh, one range per material
+        NodeMesh makeLeaf(Triangle* first, Triangle* last, bool generateNormals, bool generateTangents) {
+            std::stable_sort(first, last, [](const Triangle& a, const Triangle& b) { return a.material < b.material; });
+
+            NodeMesh mesh;
+            std::unordered_map<Vertex, uint32_t, VertexHash, VertexEqual> vertexIndex;
+            vertexIndex.reserve((last - first) * 2);
+            for (Triangle* triangle = first; triangle != last; ++triangle) {
+                if (mesh.ranges.empty() || mesh.ranges.back().material != triangle->material) {
+                    // Vertices are not shared between materials, so a range never needs another material's UVs
+                    vertexIndex.clear();
+                    mesh.ranges.push_back({ triangle->material, static_cast<uint32_t>(mesh.indices.size()), 0 });
+                }
+                for (const Vertex& corner : triangle->corners) {
+                    auto inserted = vertexIndex.emplace(corner, static_cast<uint32_t>(mesh.vertices.size()));
+                    if (inserted.second) {
+                        mesh.vertices.push_back(corner);
+                    }
+                    mesh.indices.push_back(inserted.first->second);
+                }
+                mesh.ranges.back().indexCount += 3;
+            }
+
+            if (generateNormals) {
+                MeshProcessing::GenerateNormals(mesh.vertices, mesh.indices);
+            }
+            if (generateTangents) {
+                MeshProcessing::GenerateTangents(mesh.vertices, mesh.indices);
+            }
+            expandBounds(mesh);
+            return mesh;
+        }
+
+        // Vertex clustering: the vertices of every material in a cell of the grid over the node's cube
+        // merge into one at their average position, triangles that collapse are dropped
+        NodeMesh simplify(const std::vector<const NodeMesh*>& parts, const Cube& cube) {
+            const uint32_t NONE = 0xFFFFFFFFu;
+            float cellsPerUnit = SIMPLIFY_GRID / cube.size;
+
+            NodeMesh mesh;
+            std::unordered_map<uint64_t, uint32_t> clusterOf;
+            std::vector<glm::vec3> positionSum;
+            std::vector<glm::vec3> normalSum;
+            std::vector<uint32_t> members;
+            std::map<uint32_t, std::vector<uint32_t>> materialIndices;
+            std::unordered_set<TriangleKey, TriangleKeyHash> triangles;
+            std::vector<uint32_t> remap;
+
+            for (const NodeMesh* part : parts) {
+                remap.assign(part->vertices.size(), NONE);
+                for (const Range& range : part->ranges) {
+                    std::vector<uint32_t>& indices = materialIndices[range.material];
+                    for (uint32_t i = range.firstIndex; i + 2 < range.firstIndex + range.indexCount; i += 3) {
+                        uint32_t corners[3];
+                        for (int corner = 0; corner < 3; corner++) {
+                            uint32_t index = part->indices[i + corner];
+                            if (remap[index] == NONE) {
+                                const Vertex& vertex = part->vertices[index];
+                                uint64_t cell = gridIndex(cellOf(vertex.Position.x, cube.origin[0], cellsPerUnit, SIMPLIFY_GRID),
+                                    cellOf(vertex.Position.y, cube.origin[1], cellsPerUnit, SIMPLIFY_GRID),
+                                    cellOf(vertex.Position.z, cube.origin[2], cellsPerUnit, SIMPLIFY_GRID), SIMPLIFY_GRID);
+                                auto inserted = clusterOf.emplace((uint64_t(range.material) << 32) | cell, static_cast<uint32_t>(mesh.vertices.size()));
+                                if (inserted.second) {
+                                    mesh.vertices.push_back(vertex);
+                                    positionSum.push_back(glm::vec3(0.0f));
+                                    normalSum.push_back(glm::vec3(0.0f));
+                                    members.push_back(0);
+                                }
+                                uint32_t cluster = inserted.first->second;
+                                positionSum[cluster] += vertex.Position;
+                                normalSum[cluster] += vertex.Normal;
+                                members[cluster]++;
+                                remap[index] = cluster;
+                            }
+                            corners[corner] = remap[index];
+                        }
+
+                        if (corners[0] == corners[1] || corners[1] == corners[2] || corners[0] == corners[2]) {
+                            continue;
+                        }
+                        // Rotated so the smallest index leads, which keeps the winding and finds duplicates
+                        int lead = corners[0] < corners[1] ? (corners[0] < corners[2] ? 0 : 2) : (corners[1] < corners[2] ? 1 : 2);
+                        TriangleKey key = { corners[lead], corners[(lead + 1) % 3], corners[(lead + 2) % 3] };
+                        if (triangles.insert(key).second) {
+                            indices.insert(indices.end(), { key.a, key.b, key.c });
+                        }
+                    }
+                }
+            }
+
+            for (size_t i = 0; i < mesh.vertices.size(); i++) {
+                mesh.vertices[i].Position = positionSum[i] / static_cast<float>(members[i]);
+                if (glm::length(normalSum[i]) > 0.0f) {
+                    mesh.vertices[i].Normal = glm::normalize(normalSum[i]);
+                }
+            }
+            for (auto& [material, indices] : materialIndices) {
+                if (!indices.empty()) {
+                    mesh.ranges.push_back({ material, static_cast<uint32_t>(mesh.indices.size()), static_cast<uint32_t>(indices.size()) });
+                    mesh.indices.insert(mesh.indices.end(), indices.begin(), indices.end());
+                }
+            }
+
+            // The node's bounds also cover its children, so culling a node never hides them
+            expandBounds(mesh);
+            for (const NodeMesh* part : parts) {
+                mesh.minBounds = glm::min(mesh.minBounds, part->minBounds);
+                mesh.maxBounds = glm::max(mesh.maxBounds, part->maxBounds);
+                mesh.error = (std::max)(mesh.error, part->error);
+            }
+            mesh.error += cube.size / SIMPLIFY_GRID * 1.7320508f;
+            return mesh;
+        }
+
+        // Subtree of one chunk
+        struct Subtree {
+            std::vector<Node> nodes;
+            std::vector<NodeMesh> meshes;
+        };
+
+        void fillNode(Node& node, const NodeMesh& mesh, uint32_t level, uint32_t parent) {
+            for (int axis = 0; axis < 3; axis++) {
+                node.minBounds[axis] = mesh.minBounds[axis];
+                node.maxBounds[axis] = mesh.maxBounds[axis];
+            }
+            node.error = mesh.error;
+            node.level = level;
+            node.offset = 0;
+            node.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+            node.indexCount = static_cast<uint32_t>(mesh.indices.size());
+            node.rangeCount = static_cast<uint32_t>(mesh.ranges.size());
+            node.parent = parent;
+        }
+
+        // Splits [first, last) by centroid octant until the leaves are small enough; inner nodes are
+        // simplified from their children once those are built
+        uint32_t buildNode(Subtree& tree, Triangle* first, Triangle* last, const Cube& cube, uint32_t level, uint32_t parent,
+            bool generateNormals, bool generateTangents, std::vector<Triangle>& scratch) {
+            uint32_t index = static_cast<uint32_t>(tree.nodes.size());
+            tree.nodes.emplace_back();
+            tree.meshes.emplace_back();
+            std::fill(std::begin(tree.nodes[index].children), std::end(tree.nodes[index].children), NO_NODE);
+
+            size_t count = last - first;
+            if (count <= LEAF_MAX_TRIANGLES || level >= MAX_LEVEL) {
+                tree.meshes[index] = makeLeaf(first, last, generateNormals, generateTangents);
+                fillNode(tree.nodes[index], tree.meshes[index], level, parent);
+                return index;
+            }
+
+            // Counting sort by octant
+            size_t octantStart[9] = {};
+            for (Triangle* triangle = first; triangle != last; ++triangle) {
+                octantStart[octantOf(centroidOf(*triangle), cube) + 1]++;
+            }
+            for (int octant = 0; octant < 8; octant++) {
+                octantStart[octant + 1] += octantStart[octant];
+            }
+            scratch.resize(count);
+            size_t cursor[8];
+            std::copy(octantStart, octantStart + 8, cursor);
+            for (Triangle* triangle = first; triangle != last; ++triangle) {
+                scratch[cursor[octantOf(centroidOf(*triangle), cube)]++] = *triangle;
+            }
+            std::copy(scratch.begin(), scratch.end(), first);
+
+            std::vector<uint32_t> children;
+            for (uint32_t octant = 0; octant < 8; octant++) {
+                if (octantStart[octant + 1] == octantStart[octant]) {
+                    continue;
+                }
+                uint32_t child = buildNode(tree, first + octantStart[octant], first + octantStart[octant + 1],
+                    childCube(cube, octant), level + 1, index, generateNormals, generateTangents, scratch);
+                tree.nodes[index].children[octant] = child;
+                children.push_back(child);
+            }
+
+            std::vector<const NodeMesh*> parts;
+            for (uint32_t child : children) {
+                parts.push_back(&tree.meshes[child]);
+            }
+            tree.meshes[index] = simplify(parts, cube);
+            fillNode(tree.nodes[index], tree.meshes[index], level, parent);
+            return index;
+        }
+
+        // A cell of the counting grid pyramid that holds too many triangles to be a chunk
+        struct UpperNode {
+            Cube cube;
+            uint32_t level = 0;
+            uint32_t parent = NO_NODE;
+            uint32_t children[8];
+            std::vector<const NodeMesh*> parts;
+            NodeMesh mesh;
+        };
+
+        struct Chunk {
+            Cube cube;
+            uint32_t level = 0;
+            uint32_t cellMin[3] = {};       // finest grid cells covered by the chunk
+            uint32_t cellCount = 0;
+            uint64_t triangleCount = 0;
+            uint32_t parent = NO_NODE;      // upper node, NO_NODE when the chunk is the whole model
+            uint32_t octant = 0;
+            std::string partPath;
+        };
+
+        bool writeBlob(std::ostream& out, const NodeMesh& mesh) {
+            out.write(reinterpret_cast<const char*>(mesh.ranges.data()), mesh.ranges.size() * sizeof(Range));
+            out.write(reinterpret_cast<const char*>(mesh.vertices.data()), mesh.vertices.size() * sizeof(Vertex));
+            out.write(reinterpret_cast<const char*>(mesh.indices.data()), mesh.indices.size() * sizeof(uint32_t));
+            return static_cast<bool>(out);
+        }
+
+        template<typename T>
+        void writeValue(std::ostream& out, const T& value) {
+            out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        template<typename T>
+        bool readValue(std::istream& in, T& value) {
+            return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+        }
+
+        void writeString(std::ostream& out, const std::string& text) {
+            writeValue(out, static_cast<uint32_t>(text.size()));
+            out.write(text.data(), text.size());
+        }
+
+        bool readString(std::istream& in, std::string& text) {
+            uint32_t length;
+            if (!readValue(in, length) || length > (1u << 20)) {
+                return false;
+            }
+            text.resize(length);
+            return static_cast<bool>(in.read(text.data(), length));
+        }
+
+        void writeMaterial(std::ostream& out, const Material& material) {
+            const MaterialProperties& p = material.properties;
+            writeString(out, p.name);
+            writeValue(out, p.ambient);
+            writeValue(out, p.diffuse);
+            writeValue(out, p.specular);
+            writeValue(out, p.emission);
+            writeValue(out, p.shininess);
+            writeValue(out, p.opacity);
+            writeValue(out, p.roughness);
+            writeValue(out, p.metallic);
+            writeValue(out, static_cast<uint32_t>(material.textures.size()));
+            for (const TextureRef& texture : material.textures) {
+                writeString(out, texture.type);
+                writeString(out, texture.path);
+            }
+        }
+
+        bool readMaterial(std::istream& in, Material& material) {
+            MaterialProperties& p = material.properties;
+            uint32_t textureCount;
+            if (!readString(in, p.name) || !readValue(in, p.ambient) || !readValue(in, p.diffuse) || !readValue(in, p.specular)
+                || !readValue(in, p.emission) || !readValue(in, p.shininess) || !readValue(in, p.opacity)
+                || !readValue(in, p.roughness) || !readValue(in, p.metallic) || !readValue(in, textureCount) || textureCount > 64) {
+                return false;
+            }
+            material.textures.resize(textureCount);
+            for (TextureRef& texture : material.textures) {
+                if (!readString(in, texture.type) || !readString(in, texture.path)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        std::string getFileExtension(const std::string& path) {
+            size_t dot = path.find_last_of('.');
+            if (dot == std::string::npos) {
+                return "";
+            }
+            std::string ext = path.substr(dot + 1);
+            std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+            return ext;
+        }
+    }
+
+    std::string GetPath(const std::string& modelPath) {
+        std::error_code ec;
+        std::string key = std::filesystem::absolute(modelPath, ec).lexically_normal().string();
+
+        std::ostringstream name;
+        name << std::hex << std::setw(16) << std::setfill('0') << static_cast<uint64_t>(std::hash<std::string>()(key)) << ".lxcm";
+        return (std::filesystem::path("cache/chunked") / name.str()).string();
+    }
+
+    bool IsUpToDate(const std::string& modelPath, const std::string& mtlPath, const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        Header header;
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+            return false;
+        }
+
+        FileStamp source = stampOf(modelPath);
+        FileStamp mtl = mtlPath.empty() ? FileStamp() : stampOf(mtlPath);
+        return std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.version == VERSION && header.vertexSize == sizeof(Vertex)
+            && header.sourceSize == source.size && header.sourceTime == source.time
+            && header.mtlSize == mtl.size && header.mtlTime == mtl.time;
+    }
+
+    bool Open(const std::string& path, Header& header, std::vector<Node>& nodes, std::vector<Material>& materials, std::string& error) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+            || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION
+            || header.vertexSize != sizeof(Vertex) || header.nodeCount == 0) {
+            error = "Invalid chunked mesh file: " + path;
+            return false;
+        }
+
+        nodes.resize(header.nodeCount);
+        file.seekg(static_cast<std::streamoff>(header.nodeTableOffset));
+        if (!file.read(reinterpret_cast<char*>(nodes.data()), nodes.size() * sizeof(Node))) {
+            error = "Chunked mesh file is truncated: " + path;
+            return false;
+        }
+
+        materials.resize(header.materialCount);
+        file.seekg(static_cast<std::streamoff>(header.materialTableOffset));
+        for (Material& material : materials) {
+            if (!readMaterial(file, material)) {
+                error = "Chunked mesh material table is corrupt: " + path;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool Build(const std::string& modelPath, const std::string& mtlPath, const std::string& path,
+        const std::function<void(float)>& onProgress, const std::atomic<bool>* cancel, std::string& error) {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        auto report = [&onProgress](float progress) {
+            if (onProgress) {
+                onProgress(progress);
+            }
+        };
+
+        std::error_code ec;
+        std::filesystem::path partDirectory = path + ".parts";
+        std::filesystem::remove_all(partDirectory, ec);
+        std::filesystem::create_directories(partDirectory, ec);
+        auto removeParts = [&partDirectory]() {
+            std::error_code removeError;
+            std::filesystem::remove_all(partDirectory, removeError);
+        };
+
+        // Pass 1: expand the source into a file of triangles and find its bounds
+        std::string soupPath = (partDirectory / "triangles.bin").string();
+        TriangleSink sink;
+        if (!sink.Open(soupPath)) {
+            removeParts();
+            error = "Failed to create chunked mesh part file: " + soupPath;
+            return false;
+        }
+
+        auto reportSource = [&report](float progress) { report(0.3f * progress); };
+        std::string ext = getFileExtension(modelPath);
+        bool read = false;
+        if (ext == "ply" || ext == "stl") {
+            read = ext == "ply" ? readPly(modelPath, sink, reportSource, cancel, error) : readStl(modelPath, sink, reportSource, cancel, error);
+            // ASCII and big-endian files are not read in place, the importer handles them
+            if (!read && !cancelled(cancel) && sink.count == 0) {
+                std::cout << "Chunked mesh source is not read in place (" << error << "), importing it instead" << std::endl;
+                error.clear();
+                read = sink.Reset(soupPath) && readImported(modelPath, mtlPath, sink, reportSource, cancel, error);
+            }
+        }
+        else if (ext == "obj") {
+            read = readObj(modelPath, mtlPath, partDirectory.string(), sink, reportSource, cancel, error);
+        }
+        else {
+            read = readImported(modelPath, mtlPath, sink, reportSource, cancel, error);
+        }
+        if (read && !sink.Close()) {
+            read = false;
+            error = "Failed to write chunked mesh part file: " + soupPath;
+        }
+        if (!read || cancelled(cancel)) {
+            sink.Close();
+            removeParts();
+            if (cancelled(cancel)) {
+                error = "Cancelled";
+            }
+            return false;
+        }
+        if (sink.count == 0) {
+            removeParts();
+            error = "Model has no triangles: " + modelPath;
+            return false;
+        }
+
+        // The octree is built over a cube around the bounds
+        Cube root;
+        float extent = (std::max)({ sink.maxBounds.x - sink.minBounds.x, sink.maxBounds.y - sink.minBounds.y, sink.maxBounds.z - sink.minBounds.z });
+        root.size = extent > 0.0f ? extent * 1.0001f : 1.0f;
+        for (int axis = 0; axis < 3; axis++) {
+            float center = (sink.minBounds[axis] + sink.maxBounds[axis]) * 0.5f;
+            root.origin[axis] = center - root.size * 0.5f;
+        }
+        float gridCellsPerUnit = GRID_SIZE / root.size;
+        auto finestCell = [&](const Triangle& triangle) {
+            glm::vec3 centroid = centroidOf(triangle);
+            return gridIndex(cellOf(centroid.x, root.origin[0], gridCellsPerUnit, GRID_SIZE),
+                cellOf(centroid.y, root.origin[1], gridCellsPerUnit, GRID_SIZE),
+                cellOf(centroid.z, root.origin[2], gridCellsPerUnit, GRID_SIZE), GRID_SIZE);
+        };
+
+        // Reads the triangle file block by block
+        uint64_t blockCount = (sink.count + READ_BLOCK_TRIANGLES - 1) / READ_BLOCK_TRIANGLES;
+        std::vector<Triangle> block(READ_BLOCK_TRIANGLES);
+        auto forEachBlock = [&](const std::function<bool(size_t, uint64_t)>& body) {
+            std::ifstream soup(soupPath, std::ios::binary);
+            for (uint64_t b = 0; b < blockCount; b++) {
+                size_t count = static_cast<size_t>((std::min)(uint64_t(READ_BLOCK_TRIANGLES), sink.count - b * READ_BLOCK_TRIANGLES));
+                if (cancelled(cancel)) {
+                    error = "Cancelled";
+                    return false;
+                }
+                if (!soup.read(reinterpret_cast<char*>(block.data()), count * sizeof(Triangle))) {
+                    error = "Failed to read chunked mesh part file: " + soupPath;
+                    return false;
+                }
+                if (!body(count, b)) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        // Pass 2: count the triangles in every cell of the finest grid
+        size_t gridCells = size_t(1) << (3 * GRID_LEVELS);
+        std::vector<uint64_t> cellCounts(gridCells, 0);
+        bool counted = forEachBlock([&](size_t count, uint64_t b) {
+            for (size_t i = 0; i < count; i++) {
+                cellCounts[finestCell(block[i])]++;
+            }
+            report(0.3f + 0.1f * (b + 1) / blockCount);
+            return true;
+        });
+        if (!counted) {
+            removeParts();
+            return false;
+        }
+
+        // Count pyramid, level 0 is the whole cube
+        std::vector<std::vector<uint64_t>> pyramid(GRID_LEVELS + 1);
+        pyramid[GRID_LEVELS] = std::move(cellCounts);
+        for (uint32_t level = GRID_LEVELS; level > 0; level--) {
+            uint32_t cells = 1u << (level - 1);
+            pyramid[level - 1].assign(size_t(cells) * cells * cells, 0);
+            for (uint32_t z = 0; z < cells * 2; z++) {
+                for (uint32_t y = 0; y < cells * 2; y++) {
+                    for (uint32_t x = 0; x < cells * 2; x++) {
+                        pyramid[level - 1][gridIndex(x / 2, y / 2, z / 2, cells)] += pyramid[level][gridIndex(x, y, z, cells * 2)];
+                    }
+                }
+            }
+        }
+
+        // Split cells top-down until they are small enough to build in memory
+        std::vector<UpperNode> upperNodes;
+        std::vector<Chunk> chunks;
+        struct Cell {
+            uint32_t level, x, y, z;
+            uint32_t parent, octant;
+        };
+        std::vector<Cell> pending = { { 0, 0, 0, 0, NO_NODE, 0 } };
+        while (!pending.empty()) {
+            Cell cell = pending.back();
+            pending.pop_back();
+
+            uint32_t cells = 1u << cell.level;
+            uint64_t count = pyramid[cell.level][gridIndex(cell.x, cell.y, cell.z, cells)];
+            Cube cube;
+            cube.size = root.size / cells;
+            cube.origin[0] = root.origin[0] + cell.x * cube.size;
+            cube.origin[1] = root.origin[1] + cell.y * cube.size;
+            cube.origin[2] = root.origin[2] + cell.z * cube.size;
+
+            if (count > CHUNK_MAX_TRIANGLES && cell.level < GRID_LEVELS) {
+                uint32_t index = static_cast<uint32_t>(upperNodes.size());
+                UpperNode node;
+                node.cube = cube;
+                node.level = cell.level;
+                node.parent = cell.parent;
+                std::fill(std::begin(node.children), std::end(node.children), NO_NODE);
+                upperNodes.push_back(std::move(node));
+                if (cell.parent != NO_NODE) {
+                    upperNodes[cell.parent].children[cell.octant] = index;
+                }
+
+                for (uint32_t octant = 0; octant < 8; octant++) {
+                    Cell child = { cell.level + 1, cell.x * 2 + (octant & 1), cell.y * 2 + ((octant >> 1) & 1), cell.z * 2 + ((octant >> 2) & 1), index, octant };
+                    if (pyramid[child.level][gridIndex(child.x, child.y, child.z, cells * 2)] > 0) {
+                        pending.push_back(child);
+                    }
+                }
+            }
+            else if (count > 0) {
+                Chunk chunk;
+                chunk.cube = cube;
+                chunk.level = cell.level;
+                chunk.cellCount = GRID_SIZE >> cell.level;
+                chunk.cellMin[0] = cell.x * chunk.cellCount;
+                chunk.cellMin[1] = cell.y * chunk.cellCount;
+                chunk.cellMin[2] = cell.z * chunk.cellCount;
+                chunk.triangleCount = count;
+                chunk.parent = cell.parent;
+                chunk.octant = cell.octant;
+                chunks.push_back(std::move(chunk));
+            }
+        }
+        pyramid.clear();
+
+        std::vector<uint32_t> chunkOfCell(gridCells, NO_NODE);
+        for (uint32_t c = 0; c < chunks.size(); c++) {
+            const Chunk& chunk = chunks[c];
+            for (uint32_t z = 0; z < chunk.cellCount; z++) {
+                for (uint32_t y = 0; y < chunk.cellCount; y++) {
+                    for (uint32_t x = 0; x < chunk.cellCount; x++) {
+                        chunkOfCell[gridIndex(chunk.cellMin[0] + x, chunk.cellMin[1] + y, chunk.cellMin[2] + z, GRID_SIZE)] = c;
+                    }
+                }
+            }
+        }
+        for (size_t c = 0; c < chunks.size(); c++) {
+            chunks[c].partPath = (partDirectory / ("chunk" + std::to_string(c) + ".bin")).string();
+        }
+
+        // Pass 3: scatter the triangles into one part file per chunk
+        {
+            std::vector<Triangle> sorted(READ_BLOCK_TRIANGLES);
+            std::vector<uint32_t> triangleChunk(READ_BLOCK_TRIANGLES);
+            std::vector<size_t> chunkStart(chunks.size() + 1);
+            bool scattered = forEachBlock([&](size_t count, uint64_t b) {
+                std::fill(chunkStart.begin(), chunkStart.end(), 0);
+                for (size_t i = 0; i < count; i++) {
+                    triangleChunk[i] = chunkOfCell[finestCell(block[i])];
+                    chunkStart[triangleChunk[i] + 1]++;
+                }
+                for (size_t c = 0; c < chunks.size(); c++) {
+                    chunkStart[c + 1] += chunkStart[c];
+                }
+                std::vector<size_t> chunkCursor(chunkStart.begin(), chunkStart.end() - 1);
+                for (size_t i = 0; i < count; i++) {
+                    sorted[chunkCursor[triangleChunk[i]]++] = block[i];
+                }
+
+                for (size_t c = 0; c < chunks.size(); c++) {
+                    size_t chunkTriangles = chunkStart[c + 1] - chunkStart[c];
+                    if (chunkTriangles == 0) {
+                        continue;
+                    }
+                    std::ofstream part(chunks[c].partPath, std::ios::binary | std::ios::app);
+                    if (!part.write(reinterpret_cast<const char*>(sorted.data() + chunkStart[c]), chunkTriangles * sizeof(Triangle))) {
+                        error = "Failed to write chunked mesh part file: " + chunks[c].partPath;
+                        return false;
+                    }
+                }
+                report(0.4f + 0.15f * (b + 1) / blockCount);
+                return true;
+            });
+            if (!scattered) {
+                removeParts();
+                return false;
+            }
+        }
+        std::filesystem::remove(soupPath, ec);
+        block = std::vector<Triangle>();
+        chunkOfCell = std::vector<uint32_t>();
+
+        std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+        std::string tempPath = path + ".tmp";
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        Header header = {};
+        if (!out.write(reinterpret_cast<const char*>(&header), sizeof(header))) {
+            removeParts();
+            error = "Failed to create chunked mesh file: " + tempPath;
+            return false;
+        }
+
+        // Pass 4: build the chunk subtrees in parallel, appending each to the output as it completes.
+        // The chunk roots stay in memory for the upper nodes.
+        std::vector<Node> nodes(upperNodes.size());
+        std::vector<uint32_t> chunkRoot(chunks.size(), NO_NODE);
+        std::vector<NodeMesh> chunkRootMesh(chunks.size());
+        uint64_t dataEnd = sizeof(Header);
+        uint64_t trianglesDone = 0;
+        std::atomic<bool> writeFailed{ false };
+        std::mutex outputMutex;
+
+        // Largest chunks first, so one big chunk does not finish alone at the end
+        std::vector<size_t> chunkOrder(chunks.size());
+        for (size_t c = 0; c < chunks.size(); c++) {
+            chunkOrder[c] = c;
+        }
+        std::sort(chunkOrder.begin(), chunkOrder.end(), [&chunks](size_t a, size_t b) {
+            return chunks[a].triangleCount > chunks[b].triangleCount;
+        });
+
+        ThreadPool::Shared().ParallelFor(chunks.size(), [&](size_t order) {
+            if (cancelled(cancel) || writeFailed) {
+                return;
+            }
+
+            size_t c = chunkOrder[order];
+            const Chunk& chunk = chunks[c];
+            std::vector<Triangle> triangles(chunk.triangleCount);
+            {
+                std::ifstream part(chunk.partPath, std::ios::binary);
+                if (!part.read(reinterpret_cast<char*>(triangles.data()), triangles.size() * sizeof(Triangle))) {
+                    writeFailed = true;
+                    return;
+                }
+            }
+
+            Subtree tree;
+            std::vector<Triangle> scratch;
+            buildNode(tree, triangles.data(), triangles.data() + triangles.size(), chunk.cube, chunk.level, NO_NODE, sink.generateNormals, sink.generateTangents, scratch);
+            triangles = std::vector<Triangle>();
+
+            std::lock_guard<std::mutex> lock(outputMutex);
+            uint32_t base = static_cast<uint32_t>(nodes.size());
+            for (size_t i = 0; i < tree.nodes.size(); i++) {
+                if (!writeBlob(out, tree.meshes[i])) {
+                    writeFailed = true;
+                    return;
+                }
+                Node node = tree.nodes[i];
+                node.offset = dataEnd;
+                node.parent = node.parent == NO_NODE ? chunk.parent : node.parent + base;
+                for (uint32_t& child : node.children) {
+                    if (child != NO_NODE) {
+                        child += base;
+                    }
+                }
+                nodes.push_back(node);
+                dataEnd += BlobSize(node);
+            }
+            chunkRoot[c] = base;
+            chunkRootMesh[c] = std::move(tree.meshes[0]);
+
+            trianglesDone += chunk.triangleCount;
+            report(0.55f + 0.4f * trianglesDone / sink.count);
+            }, CHUNK_CONCURRENCY);
+
+        removeParts();
+        if (cancelled(cancel) || writeFailed) {
+            out.close();
+            std::filesystem::remove(tempPath, ec);
+            error = writeFailed ? "Failed to write chunked mesh file: " + tempPath : "Cancelled";
+            return false;
+        }
+
+        // Upper nodes, children before parents, simplified from their children's geometry
+        for (size_t c = 0; c < chunks.size(); c++) {
+            if (chunks[c].parent != NO_NODE) {
+                upperNodes[chunks[c].parent].children[chunks[c].octant] = chunkRoot[c];
+                upperNodes[chunks[c].parent].parts.push_back(&chunkRootMesh[c]);
+            }
+        }
+        for (size_t u = upperNodes.size(); u-- > 0;) {
+            UpperNode& upper = upperNodes[u];
+            for (uint32_t child : upper.children) {
+                if (child != NO_NODE && child < upperNodes.size()) {
+                    upper.parts.push_back(&upperNodes[child].mesh);
+                }
+            }
+            upper.mesh = simplify(upper.parts, upper.cube);
+        }
+
+        for (size_t u = 0; u < upperNodes.size(); u++) {
+            const UpperNode& upper = upperNodes[u];
+            Node& node = nodes[u];
+            fillNode(node, upper.mesh, upper.level, upper.parent);
+            std::copy(std::begin(upper.children), std::end(upper.children), node.children);
+            node.offset = dataEnd;
+            writeBlob(out, upper.mesh);
+            dataEnd += BlobSize(node);
+        }
+
+        header.materialTableOffset = dataEnd;
+        for (const Material& material : sink.materials) {
+            writeMaterial(out, material);
+        }
+        header.nodeTableOffset = static_cast<uint64_t>(out.tellp());
+
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.vertexSize = sizeof(Vertex);
+        FileStamp source = stampOf(modelPath);
+        FileStamp mtl = mtlPath.empty() ? FileStamp() : stampOf(mtlPath);
+        header.sourceSize = source.size;
+        header.sourceTime = source.time;
+        header.mtlSize = mtl.size;
+        header.mtlTime = mtl.time;
+        header.triangleCount = sink.count;
+        header.materialCount = static_cast<uint32_t>(sink.materials.size());
+        header.nodeCount = static_cast<uint32_t>(nodes.size());
+        for (int axis = 0; axis < 3; axis++) {
+            header.minBounds[axis] = sink.minBounds[axis];
+            header.maxBounds[axis] = sink.maxBounds[axis];
+        }
+
+        out.write(reinterpret_cast<const char*>(nodes.data()), nodes.size() * sizeof(Node));
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.close();
+        if (!out) {
+            std::filesystem::remove(tempPath, ec);
+            error = "Failed to write chunked mesh file: " + tempPath;
+            return false;
+        }
+
+        std::filesystem::rename(tempPath, path, ec);
+        if (ec) {
+            std::filesystem::remove(tempPath, ec);
+            error = "Failed to replace chunked mesh file: " + path;
+            return false;
+        }
+        report(1.0f);
+
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - startTime);
+        std::cout << "Built chunked mesh in " << duration.count() << "ms: " << sink.count << " triangles, "
+            << nodes.size() << " nodes, " << chunks.size() << " chunk(s)" << std::endl;
+        return true;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <atomic>
+#include "Mesh.h"
+
+// On-disk cluster octree for triangle models too large to hold in memory. The file holds a header,
+// one blob per node (draw ranges, vertices, indices), a material table and a node table at the end.
+// Leaves hold the source triangles whose centroids fall inside them; inner nodes hold a simplified
+// copy of their children, so a node replaces its children when drawn rather than adding to them.
+namespace ChunkedMeshFile {
+    const char MAGIC[8] = { 'L', 'X', 'C', 'M', 'S', 'H', '\0', '\0' };
+    const uint32_t VERSION = 3;
+    const uint32_t NO_NODE = 0xFFFFFFFFu;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t vertexSize;            // sizeof(Vertex) of the build, vertices are stored byte for byte
+        uint64_t sourceSize;
+        int64_t sourceTime;
+        uint64_t mtlSize;
+        int64_t mtlTime;
+        uint64_t triangleCount;         // source triangles, the sum over the leaves
+        uint64_t materialTableOffset;
+        uint64_t nodeTableOffset;
+        uint32_t materialCount;
+        uint32_t nodeCount;
+        float minBounds[3];
+        float maxBounds[3];
+    };
+
+    struct Node {
+        float minBounds[3];             // tight bounds of the node's own geometry
+        float maxBounds[3];
+        float error;                    // how far the geometry may be from the source, in model units; 0 for leaves
+        uint32_t level;
+        uint64_t offset;                // byte offset of the node's blob
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t rangeCount;
+        uint32_t parent;
+        uint32_t children[8];           // NO_NODE for empty octants
+    };
+
+    // Indices of one material within a node; the blob starts with rangeCount of these
+    struct Range {
+        uint32_t material;
+        uint32_t firstIndex;
+        uint32_t indexCount;
+    };
+
+    // Material table entry, texture paths are resolved to files at build time
+    struct Material {
+        MaterialProperties properties;
+        std::vector<TextureRef> textures;
+    };
+
+    // Bytes of a node's blob
+    inline uint64_t BlobSize(const Node& node) {
+        return uint64_t(node.rangeCount) * sizeof(Range) + uint64_t(node.vertexCount) * sizeof(Vertex)
+            + uint64_t(node.indexCount) * sizeof(uint32_t);
+    }
+
+    // Chunked file for a model, under cache/chunked and named after a hash of its absolute path
+    std::string GetPath(const std::string& modelPath);
+
+    // True if path exists, has the current version and was built from the current model and MTL
+    bool IsUpToDate(const std::string& modelPath, const std::string& mtlPath, const std::string& path);
+
+    // Builds the cluster octree. Binary PLY and STL are read in place and OBJ is parsed as a stream,
+    // so their triangles never need to fit in memory at once; other formats are imported whole first.
+    // onProgress receives 0..1; returns false with error set on failure or cancellation.
+    bool Build(const std::string& modelPath, const std::string& mtlPath, const std::string& path,
+        const std::function<void(float)>& onProgress, const std::atomic<bool>* cancel, std::string& error);
+
+    // Reads the header, node table and material table of a built file
+    bool Open(const std::string& path, Header& header, std::vector<Node>& nodes, std::vector<Material>& materials, std::string& error);
+}
\ No newline at end of file
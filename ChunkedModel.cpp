@@ -0,0 +1,447 @@
+#include <glad/glad.h>
+#include "ChunkedModel.h"
+#include "Frustum.h"
+#include "TextureCompression.h"
+#include "TextureStreamer.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+    // Requests handed to the loader per frame, the rest wait for the next selection
+    const size_t MAX_QUEUED_LOADS = 32;
+}
+
+ChunkedModel::ChunkedModel(const std::string& path, const std::string& mtlPath)
+    : path(path), mtlPath(mtlPath), filePath(ChunkedMeshFile::GetPath(path)) {
+    buildThread = std::thread([this]() {
+        if (ChunkedMeshFile::IsUpToDate(this->path, this->mtlPath, filePath)) {
+            std::cout << "Using chunked mesh: " << filePath << std::endl;
+        }
+        else {
+            std::cout << "Building chunked mesh: " << filePath << std::endl;
+            ChunkedMeshFile::Build(this->path, this->mtlPath, filePath, [this](float progress) {
+                buildProgress.store(progress, std::memory_order_relaxed);
+                }, &cancelled, buildError);
+        }
+        if (buildError.empty() && !openFile()) {
+            buildError = error;
+        }
+        buildFinished.store(true, std::memory_order_release);
+        });
+}
+
+ChunkedModel::~ChunkedModel() {
+    cancelled.store(true, std::memory_order_relaxed);
+    if (buildThread.joinable()) {
+        buildThread.join();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(loaderMutex);
+        stopLoader = true;
+    }
+    loaderCondition.notify_all();
+    if (loaderThread.joinable()) {
+        loaderThread.join();
+    }
+}
+
+// Runs on the build thread: reads the tables and lists every texture file once, however many materials share it
+bool ChunkedModel::openFile() {
+    std::vector<ChunkedMeshFile::Material> table;
+    if (!ChunkedMeshFile::Open(filePath, header, nodes, table, error)) {
+        return false;
+    }
+    states.resize(nodes.size());
+
+    std::unordered_map<std::string, size_t> fileForPath;
+    materials.resize(table.size());
+    for (size_t m = 0; m < table.size(); m++) {
+        materials[m].properties = table[m].properties;
+        for (TextureRef& ref : table[m].textures) {
+            auto found = fileForPath.find(ref.path);
+            if (found == fileForPath.end()) {
+                found = fileForPath.emplace(ref.path, textureFiles.size()).first;
+                textureFiles.push_back({ ref.path, TextureCompression::RoleForType(ref.type) });
+            }
+            ref.image = found->second;
+            materials[m].refs.push_back(ref);
+        }
+    }
+
+    glm::vec3 minBounds(header.minBounds[0], header.minBounds[1], header.minBounds[2]);
+    glm::vec3 maxBounds(header.maxBounds[0], header.maxBounds[1], header.maxBounds[2]);
+    modelCenter = (minBounds + maxBounds) * 0.5f;
+    modelSize = maxBounds - minBounds;
+    float maxDimension = (std::max)({ modelSize.x, modelSize.y, modelSize.z });
+    recommendedScale = maxDimension > 0.0f ? 2.0f / maxDimension : 1.0f;
+
+    std::cout << "Opened chunked mesh: " << header.triangleCount << " triangles in " << nodes.size() << " nodes, "
+        << materials.size() << " material(s)" << std::endl;
+    return true;
+}
+
+// Textures arrive in file order, each is handed to the materials using it as soon as it is on the GPU
+void ChunkedModel::uploadTextures() {
+    for (TextureUploadQueue::Upload& upload : textureQueue.Process(uploadBudget)) {
+        size_t image = textureHandles.size();
+        if (!upload.texture) {
+            std::cout << "Failed to decode texture: " << upload.filename << std::endl;
+        }
+        else {
+            for (MaterialSlot& material : materials) {
+                for (const TextureRef& ref : material.refs) {
+                    if (ref.image == image) {
+                        material.textures.push_back({ upload.texture->Get(), ref.type, ref.path });
+                    }
+                }
+            }
+        }
+        textureHandles.push_back(std::move(upload.texture));
+    }
+}
+
+void ChunkedModel::loaderLoop() {
+    std::ifstream file(filePath, std::ios::binary);
+
+    while (true) {
+        uint32_t index;
+        {
+            std::unique_lock<std::mutex> lock(loaderMutex);
+            loaderCondition.wait(lock, [this]() { return stopLoader || !loadQueue.empty(); });
+            if (stopLoader) {
+                return;
+            }
+            index = loadQueue.front();
+            loadQueue.pop_front();
+        }
+
+        const ChunkedMeshFile::Node& node = nodes[index];
+        LoadedNode loaded;
+        loaded.node = index;
+        loaded.blob.resize(ChunkedMeshFile::BlobSize(node));
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(node.offset));
+        if (!file.read(loaded.blob.data(), loaded.blob.size())) {
+            std::cerr << "Failed to read chunked mesh node " << index << " from " << filePath << std::endl;
+            loaded.blob.clear();
+        }
+
+        std::lock_guard<std::mutex> lock(loaderMutex);
+        loadedNodes.push_back(std::move(loaded));
+    }
+}
+
+void ChunkedModel::Update(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, int viewportHeight) {
+    if (!ready) {
+        if (failed || !buildFinished.load(std::memory_order_acquire)) {
+            return;
+        }
+        buildThread.join();
+
+        if (!buildError.empty()) {
+            error = buildError;
+            failed = true;
+            std::cerr << "Chunked model failed: " << error << std::endl;
+            return;
+        }
+        for (const TextureFile& file : textureFiles) {
+            textureQueue.Enqueue(file.path, file.role);
+        }
+        loaderThread = std::thread([this]() { loaderLoop(); });
+        ready = true;
+    }
+
+    frame++;
+    uploadTextures();
+    receiveLoadedNodes();
+    selectNodes(model, view, projection, viewportHeight);
+    evictToBudgets();
+    uploadWantedNodes();
+    requestWantedNodes();
+}
+
+void ChunkedModel::receiveLoadedNodes() {
+    std::deque<LoadedNode> received;
+    {
+        std::lock_guard<std::mutex> lock(loaderMutex);
+        received.swap(loadedNodes);
+    }
+
+    // A node that could not be read stays requested, so it is not asked for again
+    for (LoadedNode& loaded : received) {
+        if (loaded.blob.empty()) {
+            continue;
+        }
+        NodeState& state = states[loaded.node];
+        state.requested = false;
+        cpuBytes += loaded.blob.size();
+        state.blob = std::move(loaded.blob);
+    }
+}
+
+// Walks the octree from the root. A node is drawn once its screen-space error is within the threshold;
+// a coarser node is refined only when all of its visible children are on the GPU, otherwise it is
+// drawn in their place while they load.
+void ChunkedModel::selectNodes(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, int viewportHeight) {
+    glm::mat4 modelView = view * model;
+    Frustum frustum(projection * modelView);
+    glm::vec3 cameraPosition = glm::vec3(glm::inverse(modelView)[3]);
+    // The model matrix only scales uniformly, which distance and error share, so both stay in model units
+    float pixelsPerUnit = viewportHeight * 0.5f * projection[1][1];
+
+    auto bounds = [this](uint32_t index, glm::vec3& minBounds, glm::vec3& maxBounds) {
+        const ChunkedMeshFile::Node& node = nodes[index];
+        minBounds = glm::vec3(node.minBounds[0], node.minBounds[1], node.minBounds[2]);
+        maxBounds = glm::vec3(node.maxBounds[0], node.maxBounds[1], node.maxBounds[2]);
+    };
+    auto visible = [&](uint32_t index) {
+        glm::vec3 minBounds, maxBounds;
+        bounds(index, minBounds, maxBounds);
+        return frustum.IntersectsBox(minBounds, maxBounds);
+    };
+    auto screenError = [&](uint32_t index) {
+        glm::vec3 minBounds, maxBounds;
+        bounds(index, minBounds, maxBounds);
+        float distance = glm::length(glm::clamp(cameraPosition, minBounds, maxBounds) - cameraPosition);
+        return distance > 0.0f ? nodes[index].error / distance * pixelsPerUnit : FLT_MAX;
+    };
+
+    std::vector<std::pair<float, uint32_t>> requests;
+    auto want = [&](uint32_t index, float priority) {
+        states[index].lastWantedFrame = frame;
+        if (!states[index].resident) {
+            requests.push_back({ priority, index });
+        }
+    };
+    // Materials span the whole model, so their textures are sized by the model's extent at the distance
+    // of the nearest chunk drawn with them
+    glm::vec3 rootMin, rootMax;
+    bounds(0, rootMin, rootMax);
+    float modelExtent = glm::length(rootMax - rootMin);
+    auto draw = [&](uint32_t index) {
+        if (states[index].resident) {
+            states[index].lastUsedFrame = frame;
+            drawList.push_back(index);
+            drawnTriangles += nodes[index].indexCount / 3;
+
+            glm::vec3 minBounds, maxBounds;
+            bounds(index, minBounds, maxBounds);
+            float distance = glm::length(glm::clamp(cameraPosition, minBounds, maxBounds) - cameraPosition);
+            float screenSize = distance > 0.0f ? modelExtent / distance * pixelsPerUnit : FLT_MAX;
+            for (const ChunkedMeshFile::Range& range : states[index].ranges) {
+                if (range.material < materials.size()) {
+                    for (const Texture& texture : materials[range.material].textures) {
+                        TextureStreamer::Request(texture.id, screenSize);
+                    }
+                }
+            }
+        }
+    };
+
+    drawList.clear();
+    drawnTriangles = 0;
+    std::vector<uint32_t> stack;
+    if (visible(0)) {
+        stack.push_back(0);
+    }
+    while (!stack.empty()) {
+        uint32_t index = stack.back();
+        stack.pop_back();
+
+        const ChunkedMeshFile::Node& node = nodes[index];
+        float error = screenError(index);
+        bool leaf = std::all_of(std::begin(node.children), std::end(node.children),
+            [](uint32_t child) { return child == ChunkedMeshFile::NO_NODE; });
+        if (leaf || error <= maxScreenError) {
+            want(index, error);
+            draw(index);
+            continue;
+        }
+
+        std::vector<uint32_t> children;
+        bool childrenResident = true;
+        for (uint32_t child : node.children) {
+            if (child != ChunkedMeshFile::NO_NODE && visible(child)) {
+                children.push_back(child);
+                if (!states[child].resident) {
+                    childrenResident = false;
+                    want(child, error);
+                }
+            }
+        }
+
+        if (childrenResident) {
+            // Kept as long as anything below it is used, zooming out then finds it still resident
+            states[index].lastUsedFrame = frame;
+            stack.insert(stack.end(), children.begin(), children.end());
+        }
+        else {
+            want(index, error);
+            draw(index);
+        }
+    }
+
+    // Largest screen error first
+    std::sort(requests.begin(), requests.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    wanted.clear();
+    for (const auto& request : requests) {
+        wanted.push_back(request.second);
+    }
+}
+
+void ChunkedModel::uploadWantedNodes() {
+    size_t uploaded = 0;
+    for (uint32_t index : wanted) {
+        NodeState& state = states[index];
+        if (state.resident || state.blob.empty()) {
+            continue;
+        }
+
+        size_t bytes = state.blob.size();
+        if ((uploaded > 0 && uploaded + bytes > uploadBudget) || gpuBytes + bytes > gpuBudget) {
+            break;
+        }
+        uploadNode(index);
+        uploaded += bytes;
+    }
+}
+
+// Replaces the queued requests with this frame's, most important first; nodes already being read stay
+// requested. Nothing new is read while the CPU cache is full of nodes this frame still needs.
+void ChunkedModel::requestWantedNodes() {
+    std::lock_guard<std::mutex> lock(loaderMutex);
+    for (uint32_t index : loadQueue) {
+        states[index].requested = false;
+    }
+    loadQueue.clear();
+    for (uint32_t index : wanted) {
+        if (loadQueue.size() >= MAX_QUEUED_LOADS || cpuBytes >= cpuBudget) {
+            break;
+        }
+        NodeState& state = states[index];
+        if (!state.resident && !state.requested && state.blob.empty()) {
+            state.requested = true;
+            loadQueue.push_back(index);
+        }
+    }
+    if (!loadQueue.empty()) {
+        loaderCondition.notify_one();
+    }
+}
+
+void ChunkedModel::uploadNode(uint32_t index) {
+    const ChunkedMeshFile::Node& node = nodes[index];
+    NodeState& state = states[index];
+    const char* data = state.blob.data();
+    const char* vertices = data + node.rangeCount * sizeof(ChunkedMeshFile::Range);
+    const char* indices = vertices + node.vertexCount * sizeof(Vertex);
+
+    state.ranges.resize(node.rangeCount);
+    std::memcpy(state.ranges.data(), data, node.rangeCount * sizeof(ChunkedMeshFile::Range));
+
+    state.VAO = GLVertexArray::Create();
+    state.VBO = GLBuffer::Create();
+    state.EBO = GLBuffer::Create();
+    glBindVertexArray(state.VAO.Get());
+
+    glBindBuffer(GL_ARRAY_BUFFER, state.VBO.Get());
+    glBufferData(GL_ARRAY_BUFFER, node.vertexCount * sizeof(Vertex), vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, state.EBO.Get());
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, node.indexCount * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+
+    glBindVertexArray(0);
+
+    state.resident = true;
+    state.lastUsedFrame = frame;
+    gpuBytes += node.vertexCount * sizeof(Vertex) + node.indexCount * sizeof(unsigned int);
+}
+
+void ChunkedModel::evictNode(uint32_t index) {
+    const ChunkedMeshFile::Node& node = nodes[index];
+    NodeState& state = states[index];
+    state.VBO.Reset();
+    state.EBO.Reset();
+    state.VAO.Reset();
+    state.ranges.clear();
+    state.resident = false;
+    gpuBytes -= node.vertexCount * sizeof(Vertex) + node.indexCount * sizeof(unsigned int);
+}
+
+// Least recently used first; nothing used or wanted this frame is evicted, so a budget smaller than
+// the current selection is exceeded rather than making the view flicker
+void ChunkedModel::evictToBudgets() {
+    if (gpuBytes > gpuBudget) {
+        std::vector<uint32_t> candidates;
+        for (uint32_t i = 0; i < states.size(); i++) {
+            if (states[i].resident && states[i].lastUsedFrame != frame) {
+                candidates.push_back(i);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [this](uint32_t a, uint32_t b) {
+            return states[a].lastUsedFrame < states[b].lastUsedFrame;
+        });
+        for (uint32_t index : candidates) {
+            if (gpuBytes <= gpuBudget) {
+                break;
+            }
+            evictNode(index);
+        }
+    }
+
+    if (cpuBytes > cpuBudget) {
+        std::vector<uint32_t> candidates;
+        for (uint32_t i = 0; i < states.size(); i++) {
+            if (!states[i].blob.empty() && states[i].lastWantedFrame != frame) {
+                candidates.push_back(i);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [this](uint32_t a, uint32_t b) {
+            return (std::max)(states[a].lastUsedFrame, states[a].lastWantedFrame) < (std::max)(states[b].lastUsedFrame, states[b].lastWantedFrame);
+        });
+        for (uint32_t index : candidates) {
+            if (cpuBytes <= cpuBudget) {
+                break;
+            }
+            cpuBytes -= states[index].blob.size();
+            states[index].blob = std::vector<char>();
+        }
+    }
+}
+
+void ChunkedModel::Draw(unsigned int shaderProgram) {
+    if (!ready) {
+        return;
+    }
+
+    uint32_t boundMaterial = ChunkedMeshFile::NO_NODE;
+    for (uint32_t index : drawList) {
+        glBindVertexArray(states[index].VAO.Get());
+        for (const ChunkedMeshFile::Range& range : states[index].ranges) {
+            if (range.material != boundMaterial && range.material < materials.size()) {
+                Mesh::BindMaterial(shaderProgram, materials[range.material].properties, materials[range.material].textures);
+                boundMaterial = range.material;
+            }
+            glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(range.indexCount), GL_UNSIGNED_INT,
+                (void*)(static_cast<size_t>(range.firstIndex) * sizeof(unsigned int)));
+        }
+    }
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE0);
+}
\ No newline at end of file
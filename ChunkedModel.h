@@ -0,0 +1,142 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <glm/glm.hpp>
+#include "ChunkedMeshFile.h"
+#include "TextureUploadQueue.h"
+
+// Out-of-core triangle model. The source is converted once into a cluster octree file on a background
+// thread (reused while the model is unchanged); afterwards every frame Update walks the octree, culls
+// nodes against the view frustum and picks the coarsest nodes whose screen-space error is small enough.
+// A loader thread reads missing nodes into a CPU cache and a limited number of bytes is uploaded per
+// frame. A node is only replaced by its children once all of them are on the GPU, so the surface never
+// has holes. Nodes unused for the longest time are evicted from the GPU and the CPU cache when either
+// exceeds its budget.
+class ChunkedModel {
+public:
+    ChunkedModel(const std::string& path, const std::string& mtlPath = "");
+    ~ChunkedModel();
+
+    ChunkedModel(const ChunkedModel&) = delete;
+    ChunkedModel& operator=(const ChunkedModel&) = delete;
+
+    // True until the chunked file is built (or found up to date) and opened
+    bool IsLoading() const { return !ready && !failed; }
+    bool HasFailed() const { return failed; }
+    float GetLoadingProgress() const { return buildProgress.load(std::memory_order_relaxed); }
+    const std::string& GetError() const { return error; }
+
+    // Selects the nodes for the coming frame, uploads cached ones, queues missing ones for loading
+    // and evicts over budget; call once per frame on the GL thread before Draw
+    void Update(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, int viewportHeight);
+    // Draws the nodes selected by the last Update with their materials, like Mesh::Draw
+    void Draw(unsigned int shaderProgram);
+
+    // Budgets in bytes, except the error threshold in pixels
+    void SetGpuBudget(size_t bytes) { gpuBudget = bytes; }
+    void SetCpuBudget(size_t bytes) { cpuBudget = bytes; }
+    void SetUploadBudget(size_t bytes) { uploadBudget = bytes; }
+    void SetMaxScreenError(float pixels) { maxScreenError = pixels; }
+
+    glm::vec3 GetModelCenter() const { return modelCenter; }
+    glm::vec3 GetModelSize() const { return modelSize; }
+    float GetRecommendedScale() const { return recommendedScale; }
+
+    size_t GetDrawnNodeCount() const { return drawList.size(); }
+    size_t GetDrawnTriangleCount() const { return drawnTriangles; }
+    size_t GetGpuBytes() const { return gpuBytes; }
+    size_t GetCpuBytes() const { return cpuBytes; }
+    size_t GetNodeCount() const { return nodes.size(); }
+    uint64_t GetTriangleCount() const { return header.triangleCount; }
+
+private:
+    struct NodeState {
+        GLVertexArray VAO;
+        GLBuffer VBO;
+        GLBuffer EBO;
+        bool resident = false;          // on the GPU
+        bool requested = false;         // queued or being read by the loader thread
+        std::vector<ChunkedMeshFile::Range> ranges;     // kept while resident, the blob may be evicted
+        std::vector<char> blob;         // CPU cache, empty when not cached
+        uint64_t lastUsedFrame = 0;     // traversed or drawn
+        uint64_t lastWantedFrame = 0;   // needed on the GPU
+    };
+
+    struct LoadedNode {
+        uint32_t node;
+        std::vector<char> blob;
+    };
+
+    // A texture is loaded for the role of the first material slot using it
+    struct TextureFile {
+        std::string path;
+        TextureRole role;
+    };
+
+    struct MaterialSlot {
+        MaterialProperties properties;
+        std::vector<TextureRef> refs;   // image indexes into textureFiles
+        std::vector<Texture> textures;
+    };
+
+    std::string path;
+    std::string mtlPath;
+    std::string filePath;
+
+    // File build and open, runs once when the model is created
+    std::thread buildThread;
+    std::atomic<bool> buildFinished{ false };
+    std::atomic<bool> cancelled{ false };
+    std::atomic<float> buildProgress{ 0.0f };
+    std::string buildError;
+    bool ready = false;
+    bool failed = false;
+    std::string error;
+
+    ChunkedMeshFile::Header header = {};
+    std::vector<ChunkedMeshFile::Node> nodes;
+    std::vector<NodeState> states;
+    std::vector<MaterialSlot> materials;
+    std::vector<TextureFile> textureFiles;          // decoded on workers and uploaded a budget per frame once open
+    TextureUploadQueue textureQueue;
+    std::vector<TextureCache::Handle> textureHandles;   // one per texture file uploaded so far
+
+    // Node reads, requests are replaced every frame in priority order
+    std::thread loaderThread;
+    std::mutex loaderMutex;
+    std::condition_variable loaderCondition;
+    std::deque<uint32_t> loadQueue;
+    std::deque<LoadedNode> loadedNodes;
+    bool stopLoader = false;
+
+    std::vector<uint32_t> drawList;
+    std::vector<uint32_t> wanted;       // nodes the selection needs on the GPU, most important first
+    uint64_t frame = 0;
+    size_t gpuBudget = size_t(1024) * 1024 * 1024;
+    size_t cpuBudget = size_t(2048) * 1024 * 1024;
+    size_t uploadBudget = size_t(32) * 1024 * 1024;
+    float maxScreenError = 2.0f;
+    size_t drawnTriangles = 0;
+    size_t gpuBytes = 0;
+    size_t cpuBytes = 0;
+
+    glm::vec3 modelCenter = glm::vec3(0.0f);
+    glm::vec3 modelSize = glm::vec3(0.0f);
+    float recommendedScale = 1.0f;
+
+    bool openFile();
+    void uploadTextures();
+    void loaderLoop();
+    void receiveLoadedNodes();
+    void selectNodes(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, int viewportHeight);
+    void uploadWantedNodes();
+    void requestWantedNodes();
+    void uploadNode(uint32_t index);
+    void evictNode(uint32_t index);
+    void evictToBudgets();
+};
\ No newline at end of file
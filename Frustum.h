@@ -0,0 +1,39 @@
+#pragma once
+#include <glm/glm.hpp>
+
+// View frustum planes taken from a combined projection * view (* model) matrix, so boxes are tested
+// in whatever space the last matrix maps from
+class Frustum {
+public:
+    Frustum() = default;
+
+    explicit Frustum(const glm::mat4& matrix) {
+        // Rows of the matrix, glm stores columns
+        glm::vec4 rows[4];
+        for (int row = 0; row < 4; row++) {
+            rows[row] = glm::vec4(matrix[0][row], matrix[1][row], matrix[2][row], matrix[3][row]);
+        }
+
+        for (int axis = 0; axis < 3; axis++) {
+            planes[axis * 2] = rows[3] + rows[axis];
+            planes[axis * 2 + 1] = rows[3] - rows[axis];
+        }
+    }
+
+    // False only if the box lies completely outside one of the planes
+    bool IntersectsBox(const glm::vec3& minBounds, const glm::vec3& maxBounds) const {
+        for (const glm::vec4& plane : planes) {
+            // Corner furthest along the plane normal
+            glm::vec3 corner(plane.x >= 0.0f ? maxBounds.x : minBounds.x,
+                plane.y >= 0.0f ? maxBounds.y : minBounds.y,
+                plane.z >= 0.0f ? maxBounds.z : minBounds.z);
+            if (plane.x * corner.x + plane.y * corner.y + plane.z * corner.z + plane.w < 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    glm::vec4 planes[6];
+};
\ No newline at end of file
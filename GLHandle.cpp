@@ -0,0 +1,34 @@
+#include <glad/glad.h>
+#include "GLHandle.h"
+
+namespace GLObjects {
+    unsigned int Generate(GLObjectType type) {
+        unsigned int id = 0;
+        switch (type) {
+        case GLObjectType::Buffer:
+            glGenBuffers(1, &id);
+            break;
+        case GLObjectType::VertexArray:
+            glGenVertexArrays(1, &id);
+            break;
+        case GLObjectType::Texture:
+            glGenTextures(1, &id);
+            break;
+        }
+        return id;
+    }
+
+    void Delete(GLObjectType type, unsigned int id) {
+        switch (type) {
+        case GLObjectType::Buffer:
+            glDeleteBuffers(1, &id);
+            break;
+        case GLObjectType::VertexArray:
+            glDeleteVertexArrays(1, &id);
+            break;
+        case GLObjectType::Texture:
+            glDeleteTextures(1, &id);
+            break;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <atomic>
+
+enum class GLObjectType {
+    Buffer,
+    VertexArray,
+    Texture
+};
+
+namespace GLObjects {
+    // glGen*/glDelete* for one object of the given type; need the GL context thread
+    unsigned int Generate(GLObjectType type);
+    void Delete(GLObjectType type, unsigned int id);
+}
+
+// Move-only owner of one GL object name, deleted when the handle is destroyed, reset or assigned over.
+// Owned objects are counted per type, so a leak shows up as a live count that never returns to its
+// baseline after a model is unloaded.
+template<GLObjectType Type>
+class GLHandle {
+public:
+    GLHandle() = default;
+    // Takes ownership of an existing name; 0 stays empty
+    explicit GLHandle(unsigned int id) : id(id) {
+        if (id != 0) {
+            liveCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    ~GLHandle() { Reset(); }
+
+    GLHandle(GLHandle&& other) noexcept : id(other.id) { other.id = 0; }
+    GLHandle& operator=(GLHandle&& other) noexcept {
+        if (this != &other) {
+            Reset();
+            id = other.id;
+            other.id = 0;
+        }
+        return *this;
+    }
+    GLHandle(const GLHandle&) = delete;
+    GLHandle& operator=(const GLHandle&) = delete;
+
+    static GLHandle Create() { return GLHandle(GLObjects::Generate(Type)); }
+
+    unsigned int Get() const { return id; }
+    explicit operator bool() const { return id != 0; }
+
+    void Reset() {
+        if (id != 0) {
+            GLObjects::Delete(Type, id);
+            id = 0;
+            liveCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    static size_t LiveCount() { return liveCount.load(std::memory_order_relaxed); }
+
+private:
+    unsigned int id = 0;
+    static inline std::atomic<size_t> liveCount{ 0 };
+};
+
+using GLBuffer = GLHandle<GLObjectType::Buffer>;
+using GLVertexArray = GLHandle<GLObjectType::VertexArray>;
+using GLTexture = GLHandle<GLObjectType::Texture>;
\ No newline at end of file
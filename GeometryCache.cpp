@@ -0,0 +1,508 @@
+#include "GeometryCache.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <type_traits>
+
+namespace GeometryCache {
+    namespace {
+        const char CACHE_MAGIC[8] = { 'L', 'X', 'G', 'E', 'O', 'M', '\0', '\0' };
+        const uint32_t CACHE_VERSION = 5;
+        const size_t BLOB_ALIGNMENT = 16;
+        const size_t HASH_BLOCK_BYTES = 4 * 1024 * 1024;
+        // Fixed fields of each entry, which bound the counts a damaged file can claim: a mesh's counts and
+        // material, a texture's two string lengths, an embedded image's size and byte count
+        const size_t MESH_MIN_BYTES = 2 * sizeof(uint64_t) + 2 * sizeof(uint32_t) + 4 * sizeof(glm::vec3) + 4 * sizeof(float);
+        const size_t TEXTURE_MIN_BYTES = 2 * sizeof(uint32_t);
+        const size_t EMBEDDED_MIN_BYTES = 2 * sizeof(int) + sizeof(uint64_t);
+
+        std::atomic<bool> enabled{ true };
+
+        static_assert(std::is_trivially_copyable_v<Vertex>, "vertex blobs are copied byte for byte");
+
+        struct CacheHeader {
+            char magic[8];
+            uint32_t version;
+            uint32_t vertexSize;        // sizeof(Vertex) when written, catches layout changes
+            uint64_t sourceSize;
+            int64_t sourceTime;
+            uint64_t sourceHash;
+            uint64_t mtlSize;
+            int64_t mtlTime;
+            uint64_t mtlHash;
+            uint32_t meshCount;
+            uint32_t hasMtlFile;
+            float minBounds[3];
+            float maxBounds[3];
+        };
+
+        // Size and modification time of a file, all zero if it does not exist
+        struct FileStamp {
+            uint64_t size = 0;
+            int64_t time = 0;
+        };
+
+        FileStamp stampOf(const std::string& path) {
+            FileStamp stamp;
+            if (path.empty()) {
+                return stamp;
+            }
+
+            std::error_code ec;
+            uint64_t size = std::filesystem::file_size(path, ec);
+            if (ec) {
+                return stamp;
+            }
+            auto time = std::filesystem::last_write_time(path, ec);
+            if (ec) {
+                return stamp;
+            }
+
+            stamp.size = size;
+            stamp.time = static_cast<int64_t>(time.time_since_epoch().count());
+            return stamp;
+        }
+
+        uint64_t mix(uint64_t h, uint64_t value) {
+            h ^= value * 0x9E3779B97F4A7C15ull;
+            h = (h << 31) | (h >> 33);
+            return h * 0xC2B2AE3D27D4EB4Full;
+        }
+
+        uint64_t finalize(uint64_t h) {
+            h ^= h >> 33;
+            h *= 0xFF51AFD7ED558CCDull;
+            h ^= h >> 33;
+            h *= 0xC4CEB9FE1A85EC53ull;
+            h ^= h >> 33;
+            return h;
+        }
+
+        uint64_t hashBytes(const char* data, size_t size, uint64_t seed) {
+            uint64_t h = seed ^ size;
+            size_t i = 0;
+            for (; i + 8 <= size; i += 8) {
+                uint64_t word;
+                std::memcpy(&word, data + i, 8);
+                h = mix(h, word);
+            }
+            uint64_t tail = 0;
+            std::memcpy(&tail, data + i, size - i);
+            return finalize(mix(h, tail));
+        }
+
+        // Entry file for a model, named after a hash of its absolute path and MTL path
+        std::string entryPath(const std::string& sourcePath, const std::string& mtlPath) {
+            std::error_code ec;
+            std::string key = std::filesystem::absolute(sourcePath, ec).lexically_normal().string();
+            if (ec) {
+                key = sourcePath;
+            }
+            key += '\n';
+            key += mtlPath.empty() ? std::string() : std::filesystem::absolute(mtlPath, ec).lexically_normal().string();
+
+            std::ostringstream name;
+            name << std::hex << std::setw(16) << std::setfill('0') << hashBytes(key.data(), key.size(), 0) << ".geo";
+            return (std::filesystem::path(GetDirectory()) / name.str()).string();
+        }
+
+        class CacheWriter {
+        public:
+            explicit CacheWriter(std::ofstream& out) : out(out) {}
+
+            template<typename T>
+            void Write(const T& value) {
+                static_assert(std::is_trivially_copyable_v<T>, "only plain values are written directly");
+                Bytes(&value, sizeof(T));
+            }
+
+            void Write(const std::string& value) {
+                Write(static_cast<uint32_t>(value.size()));
+                Bytes(value.data(), value.size());
+            }
+
+            void Bytes(const void* data, size_t size) {
+                out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+                offset += size;
+            }
+
+            // Pads so the next blob can be read in place from the mapping
+            void Align() {
+                const char zeros[BLOB_ALIGNMENT] = {};
+                size_t padding = (BLOB_ALIGNMENT - offset % BLOB_ALIGNMENT) % BLOB_ALIGNMENT;
+                Bytes(zeros, padding);
+            }
+
+        private:
+            std::ofstream& out;
+            size_t offset = 0;
+        };
+
+        // Bounds-checked reads from the mapped entry; any overrun marks the entry as corrupt
+        class CacheReader {
+        public:
+            CacheReader(const char* data, size_t size) : begin(data), cursor(data), end(data + size) {}
+
+            template<typename T>
+            bool Read(T& value) {
+                static_assert(std::is_trivially_copyable_v<T>, "only plain values are read directly");
+                if (static_cast<size_t>(end - cursor) < sizeof(T)) {
+                    return false;
+                }
+                std::memcpy(&value, cursor, sizeof(T));
+                cursor += sizeof(T);
+                return true;
+            }
+
+            bool Read(std::string& value) {
+                uint32_t length;
+                if (!Read(length) || static_cast<size_t>(end - cursor) < length) {
+                    return false;
+                }
+                value.assign(cursor, length);
+                cursor += length;
+                return true;
+            }
+
+            // Whether count entries of at least entryBytes each can still follow
+            bool Fits(uint64_t count, size_t entryBytes) const {
+                return count <= static_cast<size_t>(end - cursor) / entryBytes;
+            }
+
+            template<typename T>
+            bool ReadBlob(std::vector<T>& values, uint64_t count) {
+                size_t padding = (BLOB_ALIGNMENT - static_cast<size_t>(cursor - begin) % BLOB_ALIGNMENT) % BLOB_ALIGNMENT;
+                if (static_cast<size_t>(end - cursor) < padding) {
+                    return false;
+                }
+                cursor += padding;
+                if (count > static_cast<size_t>(end - cursor) / sizeof(T)) {
+                    return false;
+                }
+                const T* first = reinterpret_cast<const T*>(cursor);
+                values.assign(first, first + count);
+                cursor += count * sizeof(T);
+                return true;
+            }
+
+        private:
+            const char* begin;
+            const char* cursor;
+            const char* end;
+        };
+
+        void writeMaterial(CacheWriter& writer, const MaterialProperties& props) {
+            writer.Write(props.name);
+            writer.Write(props.ambient);
+            writer.Write(props.diffuse);
+            writer.Write(props.specular);
+            writer.Write(props.emission);
+            writer.Write(props.shininess);
+            writer.Write(props.opacity);
+            writer.Write(props.roughness);
+            writer.Write(props.metallic);
+        }
+
+        bool readMaterial(CacheReader& reader, MaterialProperties& props) {
+            return reader.Read(props.name) &&
+                reader.Read(props.ambient) &&
+                reader.Read(props.diffuse) &&
+                reader.Read(props.specular) &&
+                reader.Read(props.emission) &&
+                reader.Read(props.shininess) &&
+                reader.Read(props.opacity) &&
+                reader.Read(props.roughness) &&
+                reader.Read(props.metallic);
+        }
+
+        // A stamp mismatch only invalidates the entry if the contents changed too
+        bool sameContents(const std::string& path, const FileStamp& stamp, uint64_t cachedSize, int64_t cachedTime, uint64_t cachedHash, bool& restamp) {
+            if (stamp.size != cachedSize) {
+                return false;
+            }
+            if (stamp.time == cachedTime) {
+                return true;
+            }
+            if (path.empty() || HashFile(path) != cachedHash) {
+                return false;
+            }
+            restamp = true;
+            return true;
+        }
+    }
+
+    uint64_t HashFile(const std::string& path) {
+        MappedFile file;
+        if (!file.Open(path)) {
+            return 0;
+        }
+
+        const size_t blockCount = (file.Size() + HASH_BLOCK_BYTES - 1) / HASH_BLOCK_BYTES;
+        std::vector<uint64_t> blockHashes(blockCount);
+
+        ThreadPool::Shared().ParallelFor(blockCount, [&](size_t i) {
+            size_t first = i * HASH_BLOCK_BYTES;
+            size_t size = std::min(HASH_BLOCK_BYTES, file.Size() - first);
+            blockHashes[i] = hashBytes(file.Data() + first, size, i);
+        });
+
+        return hashBytes(reinterpret_cast<const char*>(blockHashes.data()), blockHashes.size() * sizeof(uint64_t), file.Size());
+    }
+
+    bool Load(const std::string& sourcePath, const std::string& mtlPath, ModelData& data) {
+        if (!IsEnabled()) {
+            return false;
+        }
+
+        std::string cachePath = entryPath(sourcePath, mtlPath);
+        std::error_code ec;
+        if (!std::filesystem::exists(cachePath, ec)) {
+            return false;
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        FileStamp sourceStamp = stampOf(sourcePath);
+        FileStamp mtlStamp = stampOf(mtlPath);
+
+        CacheHeader header;
+        bool restamp = false;
+        {
+            MappedFile file;
+            if (!file.Open(cachePath)) {
+                return false;
+            }
+
+            CacheReader reader(file.Data(), file.Size());
+            if (!reader.Read(header) ||
+                std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+                header.version != CACHE_VERSION ||
+                header.vertexSize != sizeof(Vertex)) {
+                std::cout << "Ignoring incompatible geometry cache entry: " << cachePath << std::endl;
+                return false;
+            }
+
+            if (!sameContents(sourcePath, sourceStamp, header.sourceSize, header.sourceTime, header.sourceHash, restamp) ||
+                !sameContents(mtlPath, mtlStamp, header.mtlSize, header.mtlTime, header.mtlHash, restamp)) {
+                std::cout << "Geometry cache entry is stale: " << sourcePath << std::endl;
+                return false;
+            }
+
+            if (!reader.Fits(header.meshCount, MESH_MIN_BYTES)) {
+                std::cerr << "Corrupt geometry cache entry: " << cachePath << std::endl;
+                return false;
+            }
+            std::vector<MeshData> meshes(header.meshCount);
+            for (auto& mesh : meshes) {
+                uint64_t vertexCount, indexCount;
+                uint32_t textureCount;
+                if (!reader.Read(vertexCount) || !reader.Read(indexCount) ||
+                    !readMaterial(reader, mesh.materialProps) || !reader.Read(textureCount) ||
+                    !reader.Fits(textureCount, TEXTURE_MIN_BYTES)) {
+                    std::cerr << "Corrupt geometry cache entry: " << cachePath << std::endl;
+                    return false;
+                }
+
+                mesh.textures.resize(textureCount);
+                for (auto& texture : mesh.textures) {
+                    if (!reader.Read(texture.type) || !reader.Read(texture.path)) {
+                        std::cerr << "Corrupt geometry cache entry: " << cachePath << std::endl;
+                        return false;
+                    }
+                }
+
+                if (!reader.ReadBlob(mesh.vertices, vertexCount) || !reader.ReadBlob(mesh.indices, indexCount)) {
+                    std::cerr << "Corrupt geometry cache entry: " << cachePath << std::endl;
+                    return false;
+                }
+            }
+
+            uint32_t embeddedCount;
+            if (!reader.Read(embeddedCount) || !reader.Fits(embeddedCount, EMBEDDED_MIN_BYTES)) {
+                std::cerr << "Corrupt geometry cache entry: " << cachePath << std::endl;
+                return false;
+            }
+            std::vector<EmbeddedImage> embeddedImages(embeddedCount);
+            for (auto& image : embeddedImages) {
+                uint64_t size;
+                if (!reader.Read(image.width) || !reader.Read(image.height) || !reader.Read(size) ||
+                    !reader.ReadBlob(image.data, size)) {
+                    std::cerr << "Corrupt geometry cache entry: " << cachePath << std::endl;
+                    return false;
+                }
+            }
+
+            data.meshes = std::move(meshes);
+            data.embeddedImages = std::move(embeddedImages);
+            data.hasMtlFile = header.hasMtlFile != 0;
+            data.hasBounds = true;
+            data.minBounds = glm::vec3(header.minBounds[0], header.minBounds[1], header.minBounds[2]);
+            data.maxBounds = glm::vec3(header.maxBounds[0], header.maxBounds[1], header.maxBounds[2]);
+        }
+
+        // Same contents under a new timestamp, remember the new one so the next open skips the hash
+        if (restamp) {
+            header.sourceTime = sourceStamp.time;
+            header.mtlTime = mtlStamp.time;
+            std::fstream out(cachePath, std::ios::in | std::ios::out | std::ios::binary);
+            if (out) {
+                out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            }
+        }
+
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+        std::cout << "Loaded " << data.meshes.size() << " mesh(es) from geometry cache in " << duration.count() << "ms" << std::endl;
+        return true;
+    }
+
+    bool Store(const std::string& sourcePath, const std::string& mtlPath, const ModelData& data) {
+        if (!IsEnabled() || data.meshes.empty()) {
+            return false;
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        CacheHeader header = {};
+        std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        header.version = CACHE_VERSION;
+        header.vertexSize = sizeof(Vertex);
+
+        FileStamp sourceStamp = stampOf(sourcePath);
+        FileStamp mtlStamp = stampOf(mtlPath);
+        header.sourceSize = sourceStamp.size;
+        header.sourceTime = sourceStamp.time;
+        header.sourceHash = HashFile(sourcePath);
+        header.mtlSize = mtlStamp.size;
+        header.mtlTime = mtlStamp.time;
+        header.mtlHash = mtlPath.empty() ? 0 : HashFile(mtlPath);
+        header.meshCount = static_cast<uint32_t>(data.meshes.size());
+        header.hasMtlFile = data.hasMtlFile ? 1 : 0;
+
+        glm::vec3 minBounds = data.minBounds;
+        glm::vec3 maxBounds = data.maxBounds;
+        if (!data.hasBounds) {
+            minBounds = glm::vec3(FLT_MAX);
+            maxBounds = glm::vec3(-FLT_MAX);
+            for (const auto& mesh : data.meshes) {
+                for (const auto& vertex : mesh.vertices) {
+                    minBounds = glm::min(minBounds, vertex.Position);
+                    maxBounds = glm::max(maxBounds, vertex.Position);
+                }
+            }
+        }
+        for (int i = 0; i < 3; i++) {
+            header.minBounds[i] = minBounds[i];
+            header.maxBounds[i] = maxBounds[i];
+        }
+
+        std::error_code ec;
+        std::filesystem::create_directories(GetDirectory(), ec);
+
+        // Written under a private name and renamed into place, so readers never see a partial entry
+        std::string cachePath = entryPath(sourcePath, mtlPath);
+        std::ostringstream tempName;
+        tempName << cachePath << '.' << std::hash<std::thread::id>()(std::this_thread::get_id()) << ".tmp";
+        std::string tempPath = tempName.str();
+
+        {
+            std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+            if (!out) {
+                std::cerr << "Failed to create geometry cache entry: " << tempPath << std::endl;
+                return false;
+            }
+
+            CacheWriter writer(out);
+            writer.Write(header);
+
+            for (const auto& mesh : data.meshes) {
+                writer.Write(static_cast<uint64_t>(mesh.vertices.size()));
+                writer.Write(static_cast<uint64_t>(mesh.indices.size()));
+                writeMaterial(writer, mesh.materialProps);
+                writer.Write(static_cast<uint32_t>(mesh.textures.size()));
+                for (const auto& texture : mesh.textures) {
+                    writer.Write(texture.type);
+                    writer.Write(texture.path);
+                }
+
+                writer.Align();
+                writer.Bytes(mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+                writer.Align();
+                writer.Bytes(mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+            }
+
+            // Images embedded in the model file, still encoded, so a cached GLB is not read again
+            writer.Write(static_cast<uint32_t>(data.embeddedImages.size()));
+            for (const auto& image : data.embeddedImages) {
+                writer.Write(static_cast<int32_t>(image.width));
+                writer.Write(static_cast<int32_t>(image.height));
+                writer.Write(static_cast<uint64_t>(image.data.size()));
+                writer.Align();
+                writer.Bytes(image.data.data(), image.data.size());
+            }
+
+            if (!out) {
+                std::cerr << "Failed to write geometry cache entry: " << tempPath << std::endl;
+                out.close();
+                std::filesystem::remove(tempPath, ec);
+                return false;
+            }
+        }
+
+        std::filesystem::rename(tempPath, cachePath, ec);
+        if (ec) {
+            std::cerr << "Failed to replace geometry cache entry: " << cachePath << " (" << ec.message() << ")" << std::endl;
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+        std::cout << "Stored geometry cache entry in " << duration.count() << "ms: " << cachePath << std::endl;
+        return true;
+    }
+
+    void SetEnabled(bool value) {
+        enabled.store(value);
+    }
+
+    bool IsEnabled() {
+        return enabled.load();
+    }
+
+    size_t Clear() {
+        size_t removed = 0;
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(GetDirectory(), ec)) {
+            if (entry.is_regular_file(ec) && entry.path().extension() == ".geo" && std::filesystem::remove(entry.path(), ec)) {
+                removed++;
+            }
+        }
+        std::cout << "Removed " << removed << " geometry cache entries" << std::endl;
+        return removed;
+    }
+
+    size_t GetDiskUsage() {
+        size_t bytes = 0;
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(GetDirectory(), ec)) {
+            if (entry.is_regular_file(ec) && entry.path().extension() == ".geo") {
+                bytes += static_cast<size_t>(entry.file_size(ec));
+            }
+        }
+        return bytes;
+    }
+
+    const std::string& GetDirectory() {
+        static const std::string directory = "cache/geometry";
+        return directory;
+    }
+}
\ No newline at end of file
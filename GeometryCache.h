@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include "Model.h"
+
+// On-disk cache of fully processed meshes (vertex/index blobs, material properties, texture
+// references, bounds and the still-encoded images embedded in the model), so reopening a model skips the OBJ parse or Assimp import.
+// Entries are keyed by the source path and validated against the size and modification time of
+// the model and its MTL file. When only the time differs (a copy, a touch) the file contents are
+// hashed and compared with the hash stored in the entry.
+namespace GeometryCache {
+    // Fills data.meshes, embeddedImages, hasMtlFile and bounds from a valid entry; texture files are not cached
+    bool Load(const std::string& sourcePath, const std::string& mtlPath, ModelData& data);
+
+    // Writes the geometry of freshly imported data, replacing any previous entry
+    bool Store(const std::string& sourcePath, const std::string& mtlPath, const ModelData& data);
+
+    void SetEnabled(bool enabled);
+    bool IsEnabled();
+
+    // Removes every cache entry, returns how many files were deleted
+    size_t Clear();
+    size_t GetDiskUsage();
+    const std::string& GetDirectory();
+
+    // 64-bit hash of a file's contents, hashed in parallel blocks; 0 if the file cannot be read
+    uint64_t HashFile(const std::string& path);
+}
\ No newline at end of file
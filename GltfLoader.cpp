@@ -0,0 +1,789 @@
+#include "GltfLoader.h"
+#include "MeshProcessing.h"
+#include "ThreadPool.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    const uint32_t GLB_MAGIC = 0x46546C67;          // "glTF"
+    const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;     // "JSON"
+    const uint32_t GLB_CHUNK_BIN = 0x004E4942;      // "BIN\0"
+
+    const int COMPONENT_BYTE = 5120;
+    const int COMPONENT_UNSIGNED_BYTE = 5121;
+    const int COMPONENT_SHORT = 5122;
+    const int COMPONENT_UNSIGNED_SHORT = 5123;
+    const int COMPONENT_UNSIGNED_INT = 5125;
+    const int COMPONENT_FLOAT = 5126;
+
+    const int MODE_TRIANGLES = 4;
+    const int MODE_TRIANGLE_STRIP = 5;
+    const int MODE_TRIANGLE_FAN = 6;
+
+    const size_t VERTEX_BLOCK = 65536;
+
+    size_t componentSize(int componentType) {
+        switch (componentType) {
+        case COMPONENT_BYTE:
+        case COMPONENT_UNSIGNED_BYTE:
+            return 1;
+        case COMPONENT_SHORT:
+        case COMPONENT_UNSIGNED_SHORT:
+            return 2;
+        case COMPONENT_UNSIGNED_INT:
+        case COMPONENT_FLOAT:
+            return 4;
+        default:
+            return 0;
+        }
+    }
+
+    int componentCount(const std::string& type) {
+        if (type == "SCALAR") return 1;
+        if (type == "VEC2") return 2;
+        if (type == "VEC3") return 3;
+        if (type == "VEC4") return 4;
+        if (type == "MAT2") return 4;
+        if (type == "MAT3") return 9;
+        if (type == "MAT4") return 16;
+        return 0;
+    }
+
+    template<typename T>
+    T readUnaligned(const char* data) {
+        T value;
+        std::memcpy(&value, data, sizeof(T));
+        return value;
+    }
+
+    float readComponent(const char* data, int componentType, bool normalized) {
+        switch (componentType) {
+        case COMPONENT_FLOAT:
+            return readUnaligned<float>(data);
+        case COMPONENT_BYTE: {
+            float value = static_cast<float>(readUnaligned<int8_t>(data));
+            return normalized ? std::max(value / 127.0f, -1.0f) : value;
+        }
+        case COMPONENT_UNSIGNED_BYTE: {
+            float value = static_cast<float>(readUnaligned<uint8_t>(data));
+            return normalized ? value / 255.0f : value;
+        }
+        case COMPONENT_SHORT: {
+            float value = static_cast<float>(readUnaligned<int16_t>(data));
+            return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+        }
+        case COMPONENT_UNSIGNED_SHORT: {
+            float value = static_cast<float>(readUnaligned<uint16_t>(data));
+            return normalized ? value / 65535.0f : value;
+        }
+        case COMPONENT_UNSIGNED_INT: {
+            float value = static_cast<float>(readUnaligned<uint32_t>(data));
+            return normalized ? value / 4294967295.0f : value;
+        }
+        default:
+            return 0.0f;
+        }
+    }
+
+    uint32_t readIndex(const char* data, int componentType) {
+        switch (componentType) {
+        case COMPONENT_UNSIGNED_BYTE:
+            return readUnaligned<uint8_t>(data);
+        case COMPONENT_UNSIGNED_SHORT:
+            return readUnaligned<uint16_t>(data);
+        default:
+            return readUnaligned<uint32_t>(data);
+        }
+    }
+
+    bool decodeBase64(const char* begin, const char* end, std::vector<char>& out) {
+        static const auto table = [] {
+            std::vector<int> values(256, -1);
+            const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+            for (int i = 0; i < 64; i++) {
+                values[static_cast<unsigned char>(alphabet[i])] = i;
+            }
+            return values;
+        }();
+
+        out.clear();
+        out.reserve((end - begin) / 4 * 3);
+        uint32_t accumulator = 0;
+        int bits = 0;
+        for (const char* p = begin; p < end && *p != '='; p++) {
+            int value = table[static_cast<unsigned char>(*p)];
+            if (value < 0) {
+                return false;
+            }
+            accumulator = (accumulator << 6) | static_cast<uint32_t>(value);
+            bits += 6;
+            if (bits >= 8) {
+                bits -= 8;
+                out.push_back(static_cast<char>((accumulator >> bits) & 0xFF));
+            }
+        }
+        return true;
+    }
+
+    // URIs in glTF are percent-encoded ("my%20texture.png")
+    std::string decodeUri(const std::string& uri) {
+        std::string decoded;
+        decoded.reserve(uri.size());
+        for (size_t i = 0; i < uri.size(); i++) {
+            if (uri[i] == '%' && i + 2 < uri.size() && std::isxdigit(static_cast<unsigned char>(uri[i + 1])) && std::isxdigit(static_cast<unsigned char>(uri[i + 2]))) {
+                decoded += static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16));
+                i += 2;
+            }
+            else {
+                decoded += uri[i];
+            }
+        }
+        return decoded;
+    }
+
+    bool isDataUri(const std::string& uri) {
+        return uri.compare(0, 5, "data:") == 0;
+    }
+
+    glm::vec3 vec3Of(const JsonValue& value, const glm::vec3& fallback) {
+        if (!value.IsArray() || value.Size() < 3) {
+            return fallback;
+        }
+        return glm::vec3(value[0].AsNumber(), value[1].AsNumber(), value[2].AsNumber());
+    }
+
+    glm::mat4 localTransform(const JsonValue& node) {
+        const JsonValue& matrix = node["matrix"];
+        if (matrix.IsArray() && matrix.Size() == 16) {
+            float values[16];
+            for (size_t i = 0; i < 16; i++) {
+                values[i] = static_cast<float>(matrix[i].AsNumber());
+            }
+            return glm::make_mat4(values);   // column-major, like glTF
+        }
+
+        glm::mat4 transform(1.0f);
+        if (node.Has("translation")) {
+            transform = glm::translate(transform, vec3Of(node["translation"], glm::vec3(0.0f)));
+        }
+        const JsonValue& rotation = node["rotation"];
+        if (rotation.IsArray() && rotation.Size() == 4) {
+            // glTF stores x, y, z, w; glm::quat takes w first
+            glm::quat q(static_cast<float>(rotation[3].AsNumber()), static_cast<float>(rotation[0].AsNumber()),
+                static_cast<float>(rotation[1].AsNumber()), static_cast<float>(rotation[2].AsNumber()));
+            transform = transform * glm::mat4_cast(glm::normalize(q));
+        }
+        if (node.Has("scale")) {
+            transform = glm::scale(transform, vec3Of(node["scale"], glm::vec3(1.0f)));
+        }
+        return transform;
+    }
+
+    bool isIdentity(const glm::mat4& m) {
+        return m == glm::mat4(1.0f);
+    }
+}
+
+void GltfLoader::SetProgressCallback(std::function<void(float)> callback) {
+    progressCallback = callback;
+}
+
+void GltfLoader::SetCancelFlag(const std::atomic<bool>* flag) {
+    cancelFlag = flag;
+}
+
+bool GltfLoader::fail(const std::string& message) {
+    if (error.empty()) {
+        error = message;
+    }
+    return false;
+}
+
+bool GltfLoader::Load(const std::string& path, std::vector<MeshData>& meshes) {
+    error.clear();
+    document = JsonValue();
+    bufferFiles.clear();
+    decodedBuffers.clear();
+    buffers.clear();
+    embeddedImages.clear();
+    primitivesTotal = 0;
+    primitivesDone = 0;
+
+    size_t slash = path.find_last_of("/\\");
+    directory = slash == std::string::npos ? std::string(".") : path.substr(0, slash);
+
+    if (!file.Open(path)) {
+        return fail("Could not open " + path);
+    }
+
+    BufferRange glbBinary;
+    if (file.Size() >= 12 && readUnaligned<uint32_t>(file.Data()) == GLB_MAGIC) {
+        if (!parseGlb(path)) {
+            return false;
+        }
+        // The BIN chunk, if any, follows the JSON chunk
+        uint32_t jsonLength = readUnaligned<uint32_t>(file.Data() + 12);
+        size_t binOffset = 20 + static_cast<size_t>(jsonLength);
+        if (binOffset + 8 <= file.Size() && readUnaligned<uint32_t>(file.Data() + binOffset + 4) == GLB_CHUNK_BIN) {
+            uint32_t binLength = readUnaligned<uint32_t>(file.Data() + binOffset);
+            if (binLength > file.Size() - binOffset - 8) {
+                return fail("GLB binary chunk overruns the file");
+            }
+            glbBinary.data = file.Data() + binOffset + 8;
+            glbBinary.size = binLength;
+        }
+    }
+    else {
+        const char* begin = file.Data();
+        const char* end = begin + file.Size();
+        if (end - begin >= 3 && std::memcmp(begin, "\xEF\xBB\xBF", 3) == 0) {
+            begin += 3;
+        }
+        if (!parseJson(begin, end)) {
+            return false;
+        }
+    }
+
+    if (!checkExtensions() || !loadBuffers(glbBinary)) {
+        return false;
+    }
+
+    const JsonValue& nodes = document["nodes"];
+    const JsonValue& meshList = document["meshes"];
+    for (size_t i = 0; i < meshList.Size(); i++) {
+        primitivesTotal += meshList[i]["primitives"].Size();
+    }
+
+    // Root nodes of the default scene, or every node nobody lists as a child if there are no scenes
+    std::vector<size_t> roots;
+    const JsonValue& scenes = document["scenes"];
+    if (scenes.Size() > 0) {
+        const JsonValue& scene = scenes[document["scene"].AsSize(0)];
+        for (size_t i = 0; i < scene["nodes"].Size(); i++) {
+            roots.push_back(scene["nodes"][i].AsSize(SIZE_MAX));
+        }
+    }
+    else {
+        std::vector<bool> isChild(nodes.Size(), false);
+        for (size_t i = 0; i < nodes.Size(); i++) {
+            const JsonValue& children = nodes[i]["children"];
+            for (size_t c = 0; c < children.Size(); c++) {
+                size_t child = children[c].AsSize(SIZE_MAX);
+                if (child < isChild.size()) {
+                    isChild[child] = true;
+                }
+            }
+        }
+        for (size_t i = 0; i < nodes.Size(); i++) {
+            if (!isChild[i]) {
+                roots.push_back(i);
+            }
+        }
+    }
+
+    std::vector<MeshData> loaded;
+    for (size_t root : roots) {
+        if (!loadNode(root, glm::mat4(1.0f), 0, loaded)) {
+            return false;
+        }
+    }
+
+    if (loaded.empty()) {
+        return fail("No triangle primitives in " + path);
+    }
+
+    // Copied out before the mapping is released, so the images decode without reading the file again
+    readEmbeddedImages();
+
+    meshes = std::move(loaded);
+    file.Close();
+    bufferFiles.clear();
+    decodedBuffers.clear();
+    buffers.clear();
+    return true;
+}
+
+bool GltfLoader::parseGlb(const std::string& path) {
+    uint32_t version = readUnaligned<uint32_t>(file.Data() + 4);
+    uint32_t length = readUnaligned<uint32_t>(file.Data() + 8);
+    if (version != 2) {
+        return fail("Unsupported GLB version " + std::to_string(version) + " in " + path);
+    }
+    if (length > file.Size() || file.Size() < 20) {
+        return fail("Truncated GLB file: " + path);
+    }
+
+    uint32_t jsonLength = readUnaligned<uint32_t>(file.Data() + 12);
+    uint32_t jsonType = readUnaligned<uint32_t>(file.Data() + 16);
+    if (jsonType != GLB_CHUNK_JSON || jsonLength > file.Size() - 20) {
+        return fail("GLB file does not start with a JSON chunk: " + path);
+    }
+
+    // The JSON chunk is padded with spaces, which the parser skips as whitespace
+    return parseJson(file.Data() + 20, file.Data() + 20 + jsonLength);
+}
+
+bool GltfLoader::parseJson(const char* begin, const char* end) {
+    std::string parseError;
+    if (!JsonValue::Parse(begin, end, document, parseError)) {
+        return fail("Invalid glTF JSON: " + parseError);
+    }
+
+    const std::string& version = document["asset"]["version"].AsString();
+    if (version.empty() || version[0] != '2') {
+        return fail("Unsupported glTF version '" + version + "'");
+    }
+    return true;
+}
+
+bool GltfLoader::checkExtensions() {
+    // Extensions that change how buffers or accessors must be read cannot be ignored. Material
+    // extensions only refine the core material, which is still meaningful on its own.
+    const JsonValue& required = document["extensionsRequired"];
+    for (size_t i = 0; i < required.Size(); i++) {
+        const std::string& name = required[i].AsString();
+        if (name != "KHR_mesh_quantization" && name.compare(0, 14, "KHR_materials_") != 0) {
+            return fail("Unsupported required glTF extension " + name);
+        }
+    }
+    return true;
+}
+
+bool GltfLoader::loadBuffers(const BufferRange& glbBinary) {
+    const JsonValue& bufferList = document["buffers"];
+    buffers.resize(bufferList.Size());
+    bufferFiles.reserve(bufferList.Size());
+    decodedBuffers.reserve(bufferList.Size());
+
+    for (size_t i = 0; i < bufferList.Size(); i++) {
+        const JsonValue& buffer = bufferList[i];
+        size_t byteLength = buffer["byteLength"].AsSize(0);
+        const std::string& uri = buffer["uri"].AsString();
+
+        BufferRange range;
+        if (uri.empty()) {
+            if (i != 0 || !glbBinary.data) {
+                return fail("glTF buffer " + std::to_string(i) + " has no data");
+            }
+            range = glbBinary;
+        }
+        else if (isDataUri(uri)) {
+            size_t comma = uri.find(',');
+            if (comma == std::string::npos || uri.rfind(";base64", comma) == std::string::npos) {
+                return fail("glTF buffer " + std::to_string(i) + " uses an unsupported data URI");
+            }
+            decodedBuffers.emplace_back();
+            if (!decodeBase64(uri.data() + comma + 1, uri.data() + uri.size(), decodedBuffers.back())) {
+                return fail("glTF buffer " + std::to_string(i) + " has invalid base64 data");
+            }
+            range.data = decodedBuffers.back().data();
+            range.size = decodedBuffers.back().size();
+        }
+        else {
+            std::string bufferPath = directory + "/" + decodeUri(uri);
+            bufferFiles.emplace_back();
+            if (!bufferFiles.back().Open(bufferPath)) {
+                return fail("Could not open glTF buffer " + bufferPath);
+            }
+            range.data = bufferFiles.back().Data();
+            range.size = bufferFiles.back().Size();
+        }
+
+        if (range.size < byteLength) {
+            return fail("glTF buffer " + std::to_string(i) + " is shorter than its byteLength");
+        }
+        buffers[i] = range;
+    }
+    return true;
+}
+
+bool GltfLoader::accessorView(const JsonValue& index, AccessorView& view, int expectedComponents) {
+    const JsonValue& accessor = document["accessors"][index.AsSize(SIZE_MAX)];
+    if (!accessor.IsObject()) {
+        return false;
+    }
+
+    view.componentType = accessor["componentType"].AsInt();
+    view.components = componentCount(accessor["type"].AsString());
+    view.count = accessor["count"].AsSize(0);
+    view.normalized = accessor["normalized"].AsBool();
+
+    size_t elementBytes = componentSize(view.componentType) * view.components;
+    if (elementBytes == 0 || view.components < expectedComponents) {
+        return false;
+    }
+
+    if (accessor.Has("sparse")) {
+        return fail("Sparse glTF accessors are not supported");
+    }
+
+    view.stride = elementBytes;
+    if (!accessor.Has("bufferView")) {
+        view.data = nullptr;
+        return true;
+    }
+
+    const JsonValue& bufferView = document["bufferViews"][accessor["bufferView"].AsSize(SIZE_MAX)];
+    size_t bufferIndex = bufferView["buffer"].AsSize(SIZE_MAX);
+    if (!bufferView.IsObject() || bufferIndex >= buffers.size()) {
+        return false;
+    }
+
+    const BufferRange& buffer = buffers[bufferIndex];
+    size_t viewOffset = bufferView["byteOffset"].AsSize(0);
+    size_t viewLength = bufferView["byteLength"].AsSize(0);
+    size_t accessorOffset = accessor["byteOffset"].AsSize(0);
+    if (viewOffset > buffer.size || viewLength > buffer.size - viewOffset) {
+        return false;
+    }
+
+    view.stride = bufferView["byteStride"].AsSize(0);
+    if (view.stride == 0) {
+        view.stride = elementBytes;
+    }
+
+    // The last element has to end inside the view
+    if (view.count > 0) {
+        if (accessorOffset > viewLength || elementBytes > viewLength - accessorOffset) {
+            return false;
+        }
+        size_t room = viewLength - accessorOffset - elementBytes;
+        if (view.count - 1 > room / view.stride) {
+            return false;
+        }
+    }
+
+    view.data = buffer.data + viewOffset + accessorOffset;
+    return true;
+}
+
+bool GltfLoader::loadNode(size_t node, const glm::mat4& parent, size_t depth, std::vector<MeshData>& meshes) {
+    const JsonValue& nodes = document["nodes"];
+    if (node >= nodes.Size()) {
+        return fail("glTF scene refers to missing node " + std::to_string(node));
+    }
+    if (depth > nodes.Size()) {
+        return fail("glTF node hierarchy contains a cycle");
+    }
+
+    const JsonValue& entry = nodes[node];
+    glm::mat4 world = parent * localTransform(entry);
+
+    if (entry.Has("mesh")) {
+        const JsonValue& primitives = document["meshes"][entry["mesh"].AsSize(SIZE_MAX)]["primitives"];
+        for (size_t i = 0; i < primitives.Size(); i++) {
+            if (isCancelled()) {
+                return fail("Cancelled");
+            }
+
+            MeshData mesh;
+            if (!loadPrimitive(primitives[i], world, mesh)) {
+                return false;
+            }
+            if (!mesh.indices.empty()) {
+                meshes.push_back(std::move(mesh));
+            }
+
+            primitivesDone++;
+            if (progressCallback && primitivesTotal > 0) {
+                progressCallback(std::min(1.0f, (float)primitivesDone / (float)primitivesTotal));
+            }
+        }
+    }
+
+    const JsonValue& children = entry["children"];
+    for (size_t i = 0; i < children.Size(); i++) {
+        if (!loadNode(children[i].AsSize(SIZE_MAX), world, depth + 1, meshes)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool GltfLoader::loadPrimitive(const JsonValue& primitive, const glm::mat4& world, MeshData& mesh) {
+    int mode = primitive["mode"].AsInt(MODE_TRIANGLES);
+    const JsonValue& attributes = primitive["attributes"];
+    if (mode < MODE_TRIANGLES || mode > MODE_TRIANGLE_FAN || !attributes.Has("POSITION")) {
+        // Points and lines have nothing to shade
+        return true;
+    }
+
+    AccessorView positions, normals, texCoords, tangents;
+    if (!accessorView(attributes["POSITION"], positions, 3)) {
+        return fail("Invalid POSITION accessor");
+    }
+    bool hasNormals = attributes.Has("NORMAL");
+    bool hasTexCoords = attributes.Has("TEXCOORD_0");
+    bool hasTangents = attributes.Has("TANGENT");
+    if ((hasNormals && !accessorView(attributes["NORMAL"], normals, 3)) ||
+        (hasTexCoords && !accessorView(attributes["TEXCOORD_0"], texCoords, 2)) ||
+        (hasTangents && !accessorView(attributes["TANGENT"], tangents, 4))) {
+        return fail("Invalid vertex attribute accessor");
+    }
+
+    const size_t vertexCount = positions.count;
+    if ((hasNormals && normals.count != vertexCount) ||
+        (hasTexCoords && texCoords.count != vertexCount) ||
+        (hasTangents && tangents.count != vertexCount)) {
+        return fail("Vertex attribute counts differ within a primitive");
+    }
+    if (vertexCount == 0) {
+        return true;
+    }
+
+    // Indices: a tightly packed 32-bit view is already the layout the EBO wants
+    std::vector<unsigned int> indices;
+    if (primitive.Has("indices")) {
+        AccessorView view;
+        if (!accessorView(primitive["indices"], view, 1) || view.components != 1 ||
+            (view.componentType != COMPONENT_UNSIGNED_BYTE && view.componentType != COMPONENT_UNSIGNED_SHORT && view.componentType != COMPONENT_UNSIGNED_INT)) {
+            return fail("Invalid index accessor");
+        }
+
+        indices.resize(view.count);
+        if (!view.data) {
+            std::fill(indices.begin(), indices.end(), 0u);
+        }
+        else if (view.componentType == COMPONENT_UNSIGNED_INT && view.stride == sizeof(uint32_t)) {
+            std::memcpy(indices.data(), view.data, view.count * sizeof(uint32_t));
+        }
+        else {
+            for (size_t i = 0; i < view.count; i++) {
+                indices[i] = readIndex(view.data + i * view.stride, view.componentType);
+            }
+        }
+
+        for (unsigned int index : indices) {
+            if (index >= vertexCount) {
+                return fail("Index out of range in glTF primitive");
+            }
+        }
+    }
+    else {
+        indices.resize(vertexCount);
+        for (size_t i = 0; i < vertexCount; i++) {
+            indices[i] = static_cast<unsigned int>(i);
+        }
+    }
+
+    if (mode == MODE_TRIANGLE_STRIP || mode == MODE_TRIANGLE_FAN) {
+        std::vector<unsigned int> triangles;
+        for (size_t i = 0; i + 2 < indices.size(); i++) {
+            if (mode == MODE_TRIANGLE_FAN) {
+                triangles.insert(triangles.end(), { indices[0], indices[i + 1], indices[i + 2] });
+            }
+            else if (i % 2 == 0) {
+                triangles.insert(triangles.end(), { indices[i], indices[i + 1], indices[i + 2] });
+            }
+            else {
+                triangles.insert(triangles.end(), { indices[i + 1], indices[i], indices[i + 2] });
+            }
+        }
+        indices = std::move(triangles);
+    }
+    else {
+        indices.resize(indices.size() - indices.size() % 3);
+    }
+
+    // A mirroring transform turns the faces inside out unless the winding is reversed too
+    const bool bake = !isIdentity(world);
+    const glm::mat3 linear(world);
+    const glm::mat3 normalMatrix = glm::transpose(glm::inverse(linear));
+    if (bake && glm::determinant(linear) < 0.0f) {
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            std::swap(indices[i + 1], indices[i + 2]);
+        }
+    }
+
+    // One pass over the attribute streams builds the interleaved vertices, in parallel blocks
+    std::vector<Vertex> vertices(vertexCount);
+    const size_t blockCount = (vertexCount + VERTEX_BLOCK - 1) / VERTEX_BLOCK;
+    auto readElement = [](const AccessorView& view, size_t index, float* out, int components) {
+        if (!view.data) {
+            std::fill(out, out + components, 0.0f);
+            return;
+        }
+        const char* element = view.data + index * view.stride;
+        if (view.componentType == COMPONENT_FLOAT && view.components >= components) {
+            std::memcpy(out, element, components * sizeof(float));
+            return;
+        }
+        const size_t componentBytes = componentSize(view.componentType);
+        for (int c = 0; c < components; c++) {
+            out[c] = readComponent(element + c * componentBytes, view.componentType, view.normalized);
+        }
+    };
+
+    ThreadPool::Shared().ParallelFor(blockCount, [&](size_t block) {
+        size_t first = block * VERTEX_BLOCK;
+        size_t last = std::min(first + VERTEX_BLOCK, vertexCount);
+        float values[4];
+
+        for (size_t i = first; i < last; i++) {
+            Vertex& vertex = vertices[i];
+
+            readElement(positions, i, values, 3);
+            vertex.Position = glm::vec3(values[0], values[1], values[2]);
+
+            if (hasNormals) {
+                readElement(normals, i, values, 3);
+                vertex.Normal = glm::vec3(values[0], values[1], values[2]);
+            }
+            else {
+                vertex.Normal = glm::vec3(0.0f, 1.0f, 0.0f);
+            }
+
+            if (hasTexCoords) {
+                readElement(texCoords, i, values, 2);
+                vertex.TexCoords = glm::vec2(values[0], values[1]);
+            }
+            else {
+                vertex.TexCoords = glm::vec2(0.0f);
+            }
+
+            if (hasTangents) {
+                readElement(tangents, i, values, 4);
+                vertex.Tangent = glm::vec3(values[0], values[1], values[2]);
+                float handedness = values[3] < 0.0f ? -1.0f : 1.0f;
+                vertex.Bitangent = glm::cross(vertex.Normal, vertex.Tangent) * handedness;
+            }
+            else {
+                vertex.Tangent = glm::vec3(1.0f, 0.0f, 0.0f);
+                vertex.Bitangent = glm::vec3(0.0f, 1.0f, 0.0f);
+            }
+
+            if (bake) {
+                vertex.Position = glm::vec3(world * glm::vec4(vertex.Position, 1.0f));
+                if (hasNormals) {
+                    vertex.Normal = glm::normalize(normalMatrix * vertex.Normal);
+                }
+                if (hasTangents) {
+                    vertex.Tangent = glm::normalize(linear * vertex.Tangent);
+                    vertex.Bitangent = glm::normalize(linear * vertex.Bitangent);
+                }
+            }
+        }
+    });
+
+    if (!hasNormals) {
+        MeshProcessing::GenerateNormals(vertices, indices);
+    }
+    if (!hasTangents) {
+        MeshProcessing::GenerateTangents(vertices, indices);
+    }
+
+    mesh.vertices = std::move(vertices);
+    mesh.indices = std::move(indices);
+
+    if (primitive.Has("material")) {
+        loadMaterial(document["materials"][primitive["material"].AsSize(SIZE_MAX)], mesh);
+    }
+    return true;
+}
+
+void GltfLoader::loadMaterial(const JsonValue& material, MeshData& mesh) const {
+    MaterialProperties& props = mesh.materialProps;
+    props.name = material["name"].AsString();
+
+    const JsonValue& pbr = material["pbrMetallicRoughness"];
+    const JsonValue& baseColor = pbr["baseColorFactor"];
+    if (baseColor.IsArray() && baseColor.Size() == 4) {
+        props.diffuse = vec3Of(baseColor, props.diffuse);
+        props.opacity = static_cast<float>(baseColor[3].AsNumber(1.0));
+    }
+    else {
+        props.diffuse = glm::vec3(1.0f);
+    }
+    // metallicRoughnessTexture is left out: it packs roughness in G and metallic in B, while the
+    // shader samples both maps from R. The factors scale that texture, so on their own (metallic
+    // defaults to 1) they would render textured materials as bare metal; keep the defaults then
+    if (!pbr["metallicRoughnessTexture"].IsObject()) {
+        props.metallic = static_cast<float>(pbr["metallicFactor"].AsNumber(1.0));
+        props.roughness = static_cast<float>(pbr["roughnessFactor"].AsNumber(1.0));
+    }
+    props.emission = vec3Of(material["emissiveFactor"], glm::vec3(0.0f));
+
+    struct Slot {
+        const JsonValue& info;
+        const char* type;
+    };
+    const Slot slots[] = {
+        { pbr["baseColorTexture"], "texture_diffuse" },
+        { material["normalTexture"], "texture_normal" },
+        { material["occlusionTexture"], "texture_ao" },
+        { material["emissiveTexture"], "texture_emission" },
+    };
+
+    for (const Slot& slot : slots) {
+        std::string path = texturePath(slot.info);
+        if (!path.empty()) {
+            TextureRef ref;
+            ref.type = slot.type;
+            ref.path = path;
+            mesh.textures.push_back(ref);
+        }
+    }
+}
+
+std::string GltfLoader::texturePath(const JsonValue& textureInfo) const {
+    if (!textureInfo.IsObject()) {
+        return std::string();
+    }
+
+    const JsonValue& texture = document["textures"][textureInfo["index"].AsSize(SIZE_MAX)];
+    size_t source = texture["source"].AsSize(SIZE_MAX);
+    const JsonValue& image = document["images"][source];
+    if (!image.IsObject()) {
+        return std::string();
+    }
+
+    const std::string& uri = image["uri"].AsString();
+    if (uri.empty() || isDataUri(uri)) {
+        // Stored inside the file, named the way Assimp names embedded textures
+        return "*" + std::to_string(source);
+    }
+    return decodeUri(uri);
+}
+
+void GltfLoader::readEmbeddedImages() {
+    const JsonValue& imageList = document["images"];
+    embeddedImages.assign(imageList.Size(), EmbeddedImage());
+
+    for (size_t i = 0; i < imageList.Size(); i++) {
+        const JsonValue& image = imageList[i];
+        const std::string& uri = image["uri"].AsString();
+        std::vector<unsigned char>& data = embeddedImages[i].data;
+
+        if (isDataUri(uri)) {
+            size_t comma = uri.find(',');
+            std::vector<char> decoded;
+            if (comma != std::string::npos && uri.rfind(";base64", comma) != std::string::npos &&
+                decodeBase64(uri.data() + comma + 1, uri.data() + uri.size(), decoded)) {
+                data.assign(decoded.begin(), decoded.end());
+            }
+        }
+        else if (uri.empty()) {
+            const JsonValue& bufferView = document["bufferViews"][image["bufferView"].AsSize(SIZE_MAX)];
+            size_t bufferIndex = bufferView["buffer"].AsSize(SIZE_MAX);
+            size_t offset = bufferView["byteOffset"].AsSize(0);
+            size_t length = bufferView["byteLength"].AsSize(0);
+            if (bufferIndex < buffers.size() && offset <= buffers[bufferIndex].size &&
+                length <= buffers[bufferIndex].size - offset) {
+                const unsigned char* begin = reinterpret_cast<const unsigned char*>(buffers[bufferIndex].data + offset);
+                data.assign(begin, begin + length);
+            }
+        }
+        else {
+            continue;
+        }
+
+        if (data.empty()) {
+            std::cout << "glTF image " << i << " has no readable embedded data" << std::endl;
+        }
+    }
+}
\ No newline at end of file
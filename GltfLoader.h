@@ -0,0 +1,81 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <functional>
+#include <atomic>
+#include <glm/glm.hpp>
+#include "Mesh.h"
+#include "MappedFile.h"
+#include "Json.h"
+#include "TextureLoader.h"
+
+// Reads glTF 2.0 (.gltf with external or data: buffers, and binary .glb) without going through Assimp.
+// The GLB and any .bin buffers are memory-mapped and accessors are read straight out of the mapping:
+// tightly packed 32-bit index views are copied in one block, everything else is converted while the
+// vertices are interleaved into Vertex, which glTF's one-accessor-per-attribute layout never matches.
+// Node transforms are baked into the vertices, one MeshData per primitive per node instance.
+class GltfLoader {
+public:
+    GltfLoader() = default;
+    GltfLoader(const GltfLoader&) = delete;
+    GltfLoader& operator=(const GltfLoader&) = delete;
+
+    // False if the file is unreadable or needs something this loader does not support (Draco,
+    // meshopt, ...); GetError() says why and the caller can fall back to Assimp.
+    // Texture paths are relative to the model's directory, embedded images are named "*<image index>".
+    bool Load(const std::string& path, std::vector<MeshData>& meshes);
+
+    // After a successful Load: the bytes of every image stored in the file (buffer view or data: URI),
+    // indexed like the "*<image index>" paths. Images with an external URI are left empty.
+    std::vector<EmbeddedImage> TakeEmbeddedImages() { return std::move(embeddedImages); }
+
+    const std::string& GetError() const { return error; }
+
+    void SetProgressCallback(std::function<void(float)> callback);
+    void SetCancelFlag(const std::atomic<bool>* flag);
+
+private:
+    struct BufferRange {
+        const char* data = nullptr;
+        size_t size = 0;
+    };
+
+    // A validated accessor: element i starts at data + i * stride
+    struct AccessorView {
+        const char* data = nullptr;     // null for accessors without a bufferView, which read as zeros
+        size_t count = 0;
+        size_t stride = 0;
+        int componentType = 0;
+        int components = 0;
+        bool normalized = false;
+    };
+
+    JsonValue document;
+    MappedFile file;
+    std::vector<MappedFile> bufferFiles;
+    std::vector<std::vector<char>> decodedBuffers;    // base64 data: URIs
+    std::vector<BufferRange> buffers;
+    std::vector<EmbeddedImage> embeddedImages;
+    std::string directory;
+    std::string error;
+    std::function<void(float)> progressCallback;
+    const std::atomic<bool>* cancelFlag = nullptr;
+    size_t primitivesTotal = 0;
+    size_t primitivesDone = 0;
+
+    bool fail(const std::string& message);
+    bool isCancelled() const { return cancelFlag && cancelFlag->load(std::memory_order_relaxed); }
+
+    bool parseGlb(const std::string& path);
+    bool parseJson(const char* begin, const char* end);
+    bool checkExtensions();
+    bool loadBuffers(const BufferRange& glbBinary);
+    // Fails the load for sparse accessors, so they are left to Assimp rather than read without their substitutions
+    bool accessorView(const JsonValue& index, AccessorView& view, int expectedComponents);
+
+    bool loadNode(size_t node, const glm::mat4& parent, size_t depth, std::vector<MeshData>& meshes);
+    bool loadPrimitive(const JsonValue& primitive, const glm::mat4& world, MeshData& mesh);
+    void loadMaterial(const JsonValue& material, MeshData& mesh) const;
+    std::string texturePath(const JsonValue& textureInfo) const;
+    void readEmbeddedImages();
+};
\ No newline at end of file
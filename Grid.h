@@ -2,17 +2,18 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <vector>
+#include "GLHandle.h"
 
 class Grid {
 public:
     Grid();
-    ~Grid();
     void Draw(unsigned int shaderProgram, glm::mat4 view, glm::mat4 projection);
 
 private:
     void setupMesh();
 
-    unsigned int VAO, VBO, EBO;
+    GLVertexArray VAO;
+    GLBuffer VBO, EBO;
     std::vector<glm::vec3> vertices;
     std::vector<unsigned int> indices;
 };
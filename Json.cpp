@@ -0,0 +1,295 @@
+#include "Json.h"
+#include <charconv>
+#include <cstring>
+
+class JsonParser {
+public:
+    JsonParser(const char* begin, const char* end) : cursor(begin), begin(begin), end(end) {}
+
+    bool ParseDocument(JsonValue& root, std::string& error) {
+        skipWhitespace();
+        if (!parseValue(root, 0)) {
+            error = message;
+            return false;
+        }
+        skipWhitespace();
+        if (cursor != end) {
+            fail("unexpected data after the document");
+            error = message;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    // Deep enough for any real glTF, shallow enough that hostile input cannot exhaust the stack
+    static const int MAX_DEPTH = 256;
+
+    const char* cursor;
+    const char* begin;
+    const char* end;
+    std::string message;
+
+    bool fail(const char* what) {
+        if (message.empty()) {
+            message = std::string(what) + " at offset " + std::to_string(cursor - begin);
+        }
+        return false;
+    }
+
+    void skipWhitespace() {
+        while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r')) {
+            cursor++;
+        }
+    }
+
+    bool consumeLiteral(const char* literal) {
+        size_t length = std::strlen(literal);
+        if (static_cast<size_t>(end - cursor) < length || std::memcmp(cursor, literal, length) != 0) {
+            return fail("invalid literal");
+        }
+        cursor += length;
+        return true;
+    }
+
+    bool parseValue(JsonValue& value, int depth) {
+        if (depth > MAX_DEPTH) {
+            return fail("document nested too deeply");
+        }
+        if (cursor >= end) {
+            return fail("unexpected end of document");
+        }
+
+        switch (*cursor) {
+        case '{':
+            return parseObject(value, depth);
+        case '[':
+            return parseArray(value, depth);
+        case '"':
+            value.type = JsonValue::Type::String;
+            return parseString(value.text);
+        case 't':
+            value.type = JsonValue::Type::Bool;
+            value.boolean = true;
+            return consumeLiteral("true");
+        case 'f':
+            value.type = JsonValue::Type::Bool;
+            value.boolean = false;
+            return consumeLiteral("false");
+        case 'n':
+            value.type = JsonValue::Type::Null;
+            return consumeLiteral("null");
+        default:
+            return parseNumber(value);
+        }
+    }
+
+    bool parseNumber(JsonValue& value) {
+        auto result = std::from_chars(cursor, end, value.number);
+        if (result.ec != std::errc() || result.ptr == cursor) {
+            return fail("invalid number");
+        }
+        value.type = JsonValue::Type::Number;
+        cursor = result.ptr;
+        return true;
+    }
+
+    static void appendUtf8(std::string& out, unsigned int codepoint) {
+        if (codepoint < 0x80) {
+            out += static_cast<char>(codepoint);
+        }
+        else if (codepoint < 0x800) {
+            out += static_cast<char>(0xC0 | (codepoint >> 6));
+            out += static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
+        else if (codepoint < 0x10000) {
+            out += static_cast<char>(0xE0 | (codepoint >> 12));
+            out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
+        else {
+            out += static_cast<char>(0xF0 | (codepoint >> 18));
+            out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
+    }
+
+    bool parseHex4(unsigned int& codepoint) {
+        if (end - cursor < 4) {
+            return fail("truncated unicode escape");
+        }
+        auto result = std::from_chars(cursor, cursor + 4, codepoint, 16);
+        if (result.ec != std::errc() || result.ptr != cursor + 4) {
+            return fail("invalid unicode escape");
+        }
+        cursor += 4;
+        return true;
+    }
+
+    bool parseString(std::string& out) {
+        cursor++;   // opening quote
+        out.clear();
+
+        while (cursor < end) {
+            // Copy runs without escapes in one go
+            const char* run = cursor;
+            while (cursor < end && *cursor != '"' && *cursor != '\\') {
+                cursor++;
+            }
+            out.append(run, cursor - run);
+
+            if (cursor >= end) {
+                break;
+            }
+            if (*cursor == '"') {
+                cursor++;
+                return true;
+            }
+
+            cursor++;   // backslash
+            if (cursor >= end) {
+                break;
+            }
+            char escape = *cursor++;
+            switch (escape) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                unsigned int codepoint;
+                if (!parseHex4(codepoint)) {
+                    return false;
+                }
+                // Surrogate pair
+                if (codepoint >= 0xD800 && codepoint <= 0xDBFF && end - cursor >= 6 && cursor[0] == '\\' && cursor[1] == 'u') {
+                    cursor += 2;
+                    unsigned int low;
+                    if (!parseHex4(low)) {
+                        return false;
+                    }
+                    codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                }
+                appendUtf8(out, codepoint);
+                break;
+            }
+            default:
+                return fail("invalid escape sequence");
+            }
+        }
+
+        return fail("unterminated string");
+    }
+
+    bool parseArray(JsonValue& value, int depth) {
+        value.type = JsonValue::Type::Array;
+        cursor++;
+        skipWhitespace();
+        if (cursor < end && *cursor == ']') {
+            cursor++;
+            return true;
+        }
+
+        while (true) {
+            value.items.emplace_back();
+            if (!parseValue(value.items.back(), depth + 1)) {
+                return false;
+            }
+            skipWhitespace();
+            if (cursor >= end) {
+                return fail("unterminated array");
+            }
+            if (*cursor == ']') {
+                cursor++;
+                return true;
+            }
+            if (*cursor != ',') {
+                return fail("expected ',' or ']'");
+            }
+            cursor++;
+            skipWhitespace();
+        }
+    }
+
+    bool parseObject(JsonValue& value, int depth) {
+        value.type = JsonValue::Type::Object;
+        cursor++;
+        skipWhitespace();
+        if (cursor < end && *cursor == '}') {
+            cursor++;
+            return true;
+        }
+
+        while (true) {
+            if (cursor >= end || *cursor != '"') {
+                return fail("expected member name");
+            }
+            value.members.emplace_back();
+            if (!parseString(value.members.back().first)) {
+                return false;
+            }
+            skipWhitespace();
+            if (cursor >= end || *cursor != ':') {
+                return fail("expected ':'");
+            }
+            cursor++;
+            skipWhitespace();
+            if (!parseValue(value.members.back().second, depth + 1)) {
+                return false;
+            }
+            skipWhitespace();
+            if (cursor >= end) {
+                return fail("unterminated object");
+            }
+            if (*cursor == '}') {
+                cursor++;
+                return true;
+            }
+            if (*cursor != ',') {
+                return fail("expected ',' or '}'");
+            }
+            cursor++;
+            skipWhitespace();
+        }
+    }
+};
+
+namespace {
+    const JsonValue& nullValue() {
+        static const JsonValue value;
+        return value;
+    }
+}
+
+bool JsonValue::Parse(const char* begin, const char* end, JsonValue& root, std::string& error) {
+    root = JsonValue();
+    JsonParser parser(begin, end);
+    return parser.ParseDocument(root, error);
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const {
+    if (type != Type::Array || index >= items.size()) {
+        return nullValue();
+    }
+    return items[index];
+}
+
+const JsonValue& JsonValue::operator[](const char* key) const {
+    if (type == Type::Object) {
+        for (const auto& member : members) {
+            if (member.first == key) {
+                return member.second;
+            }
+        }
+    }
+    return nullValue();
+}
+
+bool JsonValue::Has(const char* key) const {
+    return !(*this)[key].IsNull();
+}
\ No newline at end of file
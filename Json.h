@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <utility>
+
+// Minimal read-only JSON document, enough for glTF headers. Lookups of missing members or
+// out-of-range elements return a shared null value, so chains like doc["a"][0]["b"] never throw.
+class JsonValue {
+public:
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    // Parses a complete document; on failure returns false and describes the problem in error
+    static bool Parse(const char* begin, const char* end, JsonValue& root, std::string& error);
+
+    Type GetType() const { return type; }
+    bool IsNull() const { return type == Type::Null; }
+    bool IsNumber() const { return type == Type::Number; }
+    bool IsString() const { return type == Type::String; }
+    bool IsArray() const { return type == Type::Array; }
+    bool IsObject() const { return type == Type::Object; }
+
+    double AsNumber(double fallback = 0.0) const { return type == Type::Number ? number : fallback; }
+    int AsInt(int fallback = 0) const { return type == Type::Number ? static_cast<int>(number) : fallback; }
+    size_t AsSize(size_t fallback = 0) const { return type == Type::Number && number >= 0.0 ? static_cast<size_t>(number) : fallback; }
+    bool AsBool(bool fallback = false) const { return type == Type::Bool ? boolean : fallback; }
+    const std::string& AsString() const { return text; }
+
+    // Elements of an array or members of an object
+    size_t Size() const { return type == Type::Array ? items.size() : members.size(); }
+    const JsonValue& operator[](size_t index) const;
+    const JsonValue& operator[](int index) const { return (*this)[static_cast<size_t>(index)]; }
+    const JsonValue& operator[](const char* key) const;
+    bool Has(const char* key) const;
+    const std::vector<std::pair<std::string, JsonValue>>& Members() const { return members; }
+
+private:
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string text;
+    std::vector<JsonValue> items;
+    std::vector<std::pair<std::string, JsonValue>> members;
+
+    friend class JsonParser;
+};
\ No newline at end of file
@@ -1,25 +1,115 @@
 #include <glad/glad.h>
 #include "mesh.h"
 #include <iostream>
+#include <algorithm>
 #include "materialprop.h" 
+#include "TextureArrays.h"
+#include <unordered_map>
 
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, MaterialProperties matProps)
-    : vertices(vertices), indices(indices), textures(textures), materialProps(matProps) {
-    setupMesh();
+namespace {
+    struct SlotUniforms {
+        const char* has;
+        const char* sampler;
+        const char* array;
+        const char* layer;
+    };
+
+    // Uniforms of each material slot, in TextureArrays slot order
+    const SlotUniforms SLOT_UNIFORMS[TextureArrays::SLOT_COUNT] = {
+        { "material.hasDiffuse", "material.texture_diffuse1", "material.array_diffuse", "material.layer_diffuse" },
+        { "material.hasSpecular", "material.texture_specular1", "material.array_specular", "material.layer_specular" },
+        { "material.hasNormal", "material.texture_normal1", "material.array_normal", "material.layer_normal" },
+        { "material.hasHeight", "material.texture_height1", "material.array_height", "material.layer_height" },
+        { "material.hasEmission", "material.texture_emission1", "material.array_emission", "material.layer_emission" },
+        { "material.hasRoughness", "material.texture_roughness1", "material.array_roughness", "material.layer_roughness" },
+        { "material.hasMetallic", "material.texture_metallic1", "material.array_metallic", "material.layer_metallic" },
+        { "material.hasAO", "material.texture_ao1", "material.array_ao", "material.layer_ao" },
+    };
+
+    struct SlotLocations {
+        GLint has;
+        GLint layer;
+    };
+
+    // Locations of the uniforms BindMaterial sets on every draw
+    struct MaterialLocations {
+        GLint ambient;
+        GLint diffuse;
+        GLint specular;
+        GLint emission;
+        GLint shininess;
+        GLint opacity;
+        GLint roughness;
+        GLint metallic;
+        SlotLocations slots[TextureArrays::SLOT_COUNT];
+    };
+
+    // Looked up once per shader program, which must be in use. The sampler units never change, so they
+    // are set here rather than per draw. Programs are only deleted at shutdown, so a name is never reused.
+    const MaterialLocations& materialLocations(unsigned int shaderProgram) {
+        static std::unordered_map<unsigned int, MaterialLocations> programs;
+        auto found = programs.find(shaderProgram);
+        if (found != programs.end()) {
+            return found->second;
+        }
+
+        MaterialLocations locations;
+        locations.ambient = glGetUniformLocation(shaderProgram, "material.ambient");
+        locations.diffuse = glGetUniformLocation(shaderProgram, "material.diffuse");
+        locations.specular = glGetUniformLocation(shaderProgram, "material.specular");
+        locations.emission = glGetUniformLocation(shaderProgram, "material.emission");
+        locations.shininess = glGetUniformLocation(shaderProgram, "material.shininess");
+        locations.opacity = glGetUniformLocation(shaderProgram, "material.opacity");
+        locations.roughness = glGetUniformLocation(shaderProgram, "material.roughness");
+        locations.metallic = glGetUniformLocation(shaderProgram, "material.metallic");
+        for (int slot = 0; slot < TextureArrays::SLOT_COUNT; slot++) {
+            const SlotUniforms& uniforms = SLOT_UNIFORMS[slot];
+            locations.slots[slot].has = glGetUniformLocation(shaderProgram, uniforms.has);
+            locations.slots[slot].layer = glGetUniformLocation(shaderProgram, uniforms.layer);
+            glUniform1i(glGetUniformLocation(shaderProgram, uniforms.sampler), slot);
+            glUniform1i(glGetUniformLocation(shaderProgram, uniforms.array), TextureArrays::ARRAY_UNIT + slot);
+        }
+        return programs.emplace(shaderProgram, locations).first->second;
+    }
+}
+
+Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, MaterialProperties matProps, bool upload)
+    : vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures)), materialProps(std::move(matProps)) {
+    vertexCount = this->vertices.size();
+    indexCount = this->indices.size();
+    if (upload) {
+        setupMesh();
+    }
+    else {
+        createBuffers(false);
+    }
 }
 
 void Mesh::setupMesh() {
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+    createBuffers(true);
+    expandBounds(0, vertices.size());
+    uploadedVertices = vertices.size();
+    uploadedIndices = indices.size();
+}
+
+// Allocates buffers for the whole geometry, filled right away or left for UploadSlice
+void Mesh::createBuffers(bool fill) {
+    GLenum usage = fill ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW;
 
-    glBindVertexArray(VAO);
+    // Assigning over existing handles deletes the old objects
+    VAO = GLVertexArray::Create();
+    VBO = GLBuffer::Create();
+    EBO = GLBuffer::Create();
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+    glBindVertexArray(VAO.Get());
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO.Get());
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), fill ? vertices.data() : nullptr, usage);
+    vertexCapacity = vertices.size();
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO.Get());
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), fill ? indices.data() : nullptr, usage);
+    indexCapacity = indices.size();
 
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
@@ -38,82 +128,165 @@ void Mesh::setupMesh() {
 
     glBindVertexArray(0);
 }
-void Mesh::Draw(unsigned int shaderProgram) {
-    glUniform3fv(glGetUniformLocation(shaderProgram, "material.ambient"), 1, &materialProps.ambient[0]);
-    glUniform3fv(glGetUniformLocation(shaderProgram, "material.diffuse"), 1, &materialProps.diffuse[0]);
-    glUniform3fv(glGetUniformLocation(shaderProgram, "material.specular"), 1, &materialProps.specular[0]);
-    glUniform3fv(glGetUniformLocation(shaderProgram, "material.emission"), 1, &materialProps.emission[0]);
-    glUniform1f(glGetUniformLocation(shaderProgram, "material.shininess"), materialProps.shininess);
-    glUniform1f(glGetUniformLocation(shaderProgram, "material.opacity"), materialProps.opacity);
-    glUniform1f(glGetUniformLocation(shaderProgram, "material.roughness"), materialProps.roughness);
-    glUniform1f(glGetUniformLocation(shaderProgram, "material.metallic"), materialProps.metallic);
-
-    glUniform1i(glGetUniformLocation(shaderProgram, "material.hasDiffuse"), false);
-    glUniform1i(glGetUniformLocation(shaderProgram, "material.hasSpecular"), false);
-    glUniform1i(glGetUniformLocation(shaderProgram, "material.hasNormal"), false);
-    glUniform1i(glGetUniformLocation(shaderProgram, "material.hasHeight"), false);
-    glUniform1i(glGetUniformLocation(shaderProgram, "material.hasEmission"), false);
-    glUniform1i(glGetUniformLocation(shaderProgram, "material.hasRoughness"), false);
-    glUniform1i(glGetUniformLocation(shaderProgram, "material.hasMetallic"), false);
-    glUniform1i(glGetUniformLocation(shaderProgram, "material.hasAO"), false);
-
-    unsigned int diffuseNr = 1;
-    unsigned int specularNr = 1;
-    unsigned int normalNr = 1;
-    unsigned int heightNr = 1;
-    unsigned int emissionNr = 1;
-    unsigned int roughnessNr = 1;
-    unsigned int metallicNr = 1;
-    unsigned int aoNr = 1;
-
-    for (unsigned int i = 0; i < textures.size(); i++) {
-        glActiveTexture(GL_TEXTURE0 + i);
-
-        std::string number;
-        std::string name = textures[i].type;
-
-        if (name == "texture_diffuse") {
-            number = std::to_string(diffuseNr++);
-            glUniform1i(glGetUniformLocation(shaderProgram, "material.hasDiffuse"), true);
-        }
-        else if (name == "texture_specular") {
-            number = std::to_string(specularNr++);
-            glUniform1i(glGetUniformLocation(shaderProgram, "material.hasSpecular"), true);
-        }
-        else if (name == "texture_normal") {
-            number = std::to_string(normalNr++);
-            glUniform1i(glGetUniformLocation(shaderProgram, "material.hasNormal"), true);
-        }
-        else if (name == "texture_height") {
-            number = std::to_string(heightNr++);
-            glUniform1i(glGetUniformLocation(shaderProgram, "material.hasHeight"), true);
-        }
-        else if (name == "texture_emission") {
-            number = std::to_string(emissionNr++);
-            glUniform1i(glGetUniformLocation(shaderProgram, "material.hasEmission"), true);
-        }
-        else if (name == "texture_roughness") {
-            number = std::to_string(roughnessNr++);
-            glUniform1i(glGetUniformLocation(shaderProgram, "material.hasRoughness"), true);
-        }
-        else if (name == "texture_metallic") {
-            number = std::to_string(metallicNr++);
-            glUniform1i(glGetUniformLocation(shaderProgram, "material.hasMetallic"), true);
-        }
-        else if (name == "texture_ao") {
-            number = std::to_string(aoNr++);
-            glUniform1i(glGetUniformLocation(shaderProgram, "material.hasAO"), true);
-        }
+void Mesh::AppendGeometry(const std::vector<Vertex>& newVertices, const std::vector<unsigned int>& newIndices) {
+    AppendGeometry(newVertices.data(), newVertices.size(), newIndices.data(), newIndices.size());
+}
+
+void Mesh::AppendGeometry(const Vertex* newVertices, size_t newVertexCount, const unsigned int* newIndices, size_t newIndexCount) {
+    size_t firstVertex = vertices.size();
+    size_t firstIndex = indices.size();
+
+    vertices.insert(vertices.end(), newVertices, newVertices + newVertexCount);
+    indices.insert(indices.end(), newIndices, newIndices + newIndexCount);
+
+    // The element buffer binding is VAO state, bind the VAO before touching it
+    glBindVertexArray(VAO.Get());
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO.Get());
+    if (vertices.size() > vertexCapacity) {
+        // Re-specifying storage keeps the buffer name, so the VAO attribute bindings stay valid
+        vertexCapacity = std::max(vertices.size(), vertexCapacity * 2);
+        glBufferData(GL_ARRAY_BUFFER, vertexCapacity * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+        firstVertex = 0;
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, firstVertex * sizeof(Vertex), (vertices.size() - firstVertex) * sizeof(Vertex), vertices.data() + firstVertex);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO.Get());
+    if (indices.size() > indexCapacity) {
+        indexCapacity = std::max(indices.size(), indexCapacity * 2);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCapacity * sizeof(unsigned int), nullptr, GL_DYNAMIC_DRAW);
+        firstIndex = 0;
+    }
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, firstIndex * sizeof(unsigned int), (indices.size() - firstIndex) * sizeof(unsigned int), indices.data() + firstIndex);
+
+    glBindVertexArray(0);
+    expandBounds(uploadedVertices, vertices.size() - uploadedVertices);
+    vertexCount = uploadedVertices = vertices.size();
+    indexCount = uploadedIndices = indices.size();
+}
 
-        std::string uniformName = "material." + name + number;
-        glUniform1i(glGetUniformLocation(shaderProgram, uniformName.c_str()), i);
+void Mesh::UploadSlice(size_t maxVertices, size_t maxIndices) {
+    if (uploadedVertices < vertices.size()) {
+        size_t count = std::min(maxVertices, vertices.size() - uploadedVertices);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO.Get());
+        glBufferSubData(GL_ARRAY_BUFFER, uploadedVertices * sizeof(Vertex), count * sizeof(Vertex), vertices.data() + uploadedVertices);
+        expandBounds(uploadedVertices, count);
+        uploadedVertices += count;
+    }
+    else if (uploadedIndices < indices.size()) {
+        size_t count = std::min(maxIndices, indices.size() - uploadedIndices);
+        glBindVertexArray(VAO.Get());
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO.Get());
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, uploadedIndices * sizeof(unsigned int), count * sizeof(unsigned int), indices.data() + uploadedIndices);
+        glBindVertexArray(0);
+        uploadedIndices += count;
+    }
+}
+
+void Mesh::expandBounds(size_t firstVertex, size_t count) {
+    for (size_t i = firstVertex; i < firstVertex + count; i++) {
+        minBounds = glm::min(minBounds, vertices[i].Position);
+        maxBounds = glm::max(maxBounds, vertices[i].Position);
+    }
+}
+
+void Mesh::ReleaseCpuGeometry() {
+    if (!cpuGeometry || !IsUploaded()) {
+        return;
+    }
+    std::vector<Vertex>().swap(vertices);
+    std::vector<unsigned int>().swap(indices);
+    cpuGeometry = false;
+}
 
-        glBindTexture(GL_TEXTURE_2D, textures[i].id);
+void Mesh::RestoreCpuGeometry() {
+    if (cpuGeometry) {
+        return;
     }
+    vertices.resize(vertexCount);
+    indices.resize(indexCount);
 
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
+    glBindVertexArray(VAO.Get());
+    glBindBuffer(GL_ARRAY_BUFFER, VBO.Get());
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, vertexCount * sizeof(Vertex), vertices.data());
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO.Get());
+    glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indexCount * sizeof(unsigned int), indices.data());
+    glBindVertexArray(0);
+    cpuGeometry = true;
+}
+
+void Mesh::UpdateVertexBuffer() {
+    glBindBuffer(GL_ARRAY_BUFFER, VBO.Get());
+    glBufferSubData(GL_ARRAY_BUFFER, 0, uploadedVertices * sizeof(Vertex), vertices.data());
+}
+
+void Mesh::ReserveGeometry(size_t totalVertices, size_t totalIndices) {
+    vertices.reserve(totalVertices);
+    indices.reserve(totalIndices);
+
+    glBindVertexArray(VAO.Get());
+
+    if (totalVertices > vertexCapacity) {
+        vertexCapacity = totalVertices;
+        glBindBuffer(GL_ARRAY_BUFFER, VBO.Get());
+        glBufferData(GL_ARRAY_BUFFER, vertexCapacity * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(Vertex), vertices.data());
+    }
+
+    if (totalIndices > indexCapacity) {
+        indexCapacity = totalIndices;
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO.Get());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCapacity * sizeof(unsigned int), nullptr, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * sizeof(unsigned int), indices.data());
+    }
+
+    glBindVertexArray(0);
+}
+
+void Mesh::Draw(unsigned int shaderProgram) {
+    BindMaterial(shaderProgram, materialProps, textures);
+
+    glBindVertexArray(VAO.Get());
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(uploadedIndices), GL_UNSIGNED_INT, 0);
     glBindVertexArray(0);
 
     glActiveTexture(GL_TEXTURE0);
+}
+
+void Mesh::BindMaterial(unsigned int shaderProgram, const MaterialProperties& materialProps, const std::vector<Texture>& textures) {
+    const MaterialLocations& locations = materialLocations(shaderProgram);
+    glUniform3fv(locations.ambient, 1, &materialProps.ambient[0]);
+    glUniform3fv(locations.diffuse, 1, &materialProps.diffuse[0]);
+    glUniform3fv(locations.specular, 1, &materialProps.specular[0]);
+    glUniform3fv(locations.emission, 1, &materialProps.emission[0]);
+    glUniform1f(locations.shininess, materialProps.shininess);
+    glUniform1f(locations.opacity, materialProps.opacity);
+    glUniform1f(locations.roughness, materialProps.roughness);
+    glUniform1f(locations.metallic, materialProps.metallic);
+
+    // Each slot has its own 2D and array units, reset every time since meshes may switch between them.
+    // Only the first texture of a slot is sampled, so later ones are not bound.
+    for (int slot = 0; slot < TextureArrays::SLOT_COUNT; slot++) {
+        glUniform1i(locations.slots[slot].has, false);
+        glUniform1i(locations.slots[slot].layer, -1);
+    }
+
+    bool bound[TextureArrays::SLOT_COUNT] = {};
+    for (const Texture& texture : textures) {
+        int slot = TextureArrays::SlotForType(texture.type);
+        if (slot < 0 || bound[slot]) {
+            continue;
+        }
+        bound[slot] = true;
+
+        glUniform1i(locations.slots[slot].has, true);
+        if (texture.layer >= 0) {
+            TextureArrays::Bind(slot, texture.id);
+            glUniform1i(locations.slots[slot].layer, texture.layer);
+        }
+        else {
+            glActiveTexture(GL_TEXTURE0 + slot);
+            glBindTexture(GL_TEXTURE_2D, texture.id);
+        }
+    }
 }
\ No newline at end of file
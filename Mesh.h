@@ -2,7 +2,10 @@
 #include <glm/glm.hpp>
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <cfloat>
 #include "materialprop.h"
+#include "GLHandle.h"
 
 struct Vertex {
     glm::vec3 Position;
@@ -12,10 +15,33 @@ struct Vertex {
     glm::vec3 Bitangent;
 };
 
+// id is not owned, whoever uploaded the texture keeps its GLTexture alive for as long as meshes use it
 struct Texture {
     unsigned int id;
     std::string type;
     std::string path;
+    int layer = -1;                 // layer in the GL_TEXTURE_2D_ARRAY named by id, -1 for a 2D texture
+};
+
+// A texture a mesh refers to before any GL object exists for it
+struct TextureRef {
+    std::string type;
+    std::string path;               // as written in the material, also the texture cache key
+    size_t image = SIZE_MAX;        // index into the loader's decoded images, SIZE_MAX if it could not be decoded
+};
+
+// CPU-side mesh produced by the importers; turned into a Mesh on the GL thread
+struct MeshData {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<TextureRef> textures;
+    MaterialProperties materialProps;
+};
+
+// Whether a mesh keeps its geometry in RAM once it is on the GPU
+enum class GeometryResidency {
+    KeepCpuCopy,
+    GpuOnly         // vertices and indices are freed after upload and read back from the GPU when needed
 };
 
 class Mesh {
@@ -25,12 +51,63 @@ public:
     std::vector<Texture> textures;
     MaterialProperties materialProps;
 
-    unsigned int VAO;
+    // Takes ownership of the geometry, pass it with std::move to avoid a copy. With upload false the GPU
+    // buffers are only sized; UploadSlice then fills them and Draw uses the indices uploaded so far.
+    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures,
+        MaterialProperties matProps = MaterialProperties{}, bool upload = true);
+
+    // Geometry is moved, never copied
+    Mesh(Mesh&&) = default;
+    Mesh& operator=(Mesh&&) = default;
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
 
-    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, MaterialProperties matProps = MaterialProperties{});
     void Draw(unsigned int shaderProgram);
+    // Sets the material uniforms and binds the textures Draw uses, for geometry drawn outside a Mesh
+    static void BindMaterial(unsigned int shaderProgram, const MaterialProperties& materialProps, const std::vector<Texture>& textures);
     void setupMesh(); 
 
+    // Appends geometry to the mesh and its GPU buffers; new indices address the whole vertex list.
+    // Buffers grow geometrically, so a mesh built batch by batch uploads each byte O(1) times.
+    void AppendGeometry(const std::vector<Vertex>& newVertices, const std::vector<unsigned int>& newIndices);
+    // Same from raw ranges, so a slice of a larger array is uploaded without a temporary copy
+    void AppendGeometry(const Vertex* newVertices, size_t newVertexCount, const unsigned int* newIndices, size_t newIndexCount);
+    // Sizes the GPU buffers for the final geometry up front, so appending up to that size never re-uploads
+    void ReserveGeometry(size_t totalVertices, size_t totalIndices);
+
+    // Uploads up to maxVertices of the vertices not yet on the GPU, or once they all are, up to maxIndices
+    // indices; vertices go first so the part drawn meanwhile never references missing ones
+    void UploadSlice(size_t maxVertices, size_t maxIndices);
+    bool IsUploaded() const { return uploadedVertices == vertexCount && uploadedIndices == indexCount; }
+    size_t GetUploadedVertexCount() const { return uploadedVertices; }
+
+    // Frees the CPU copy of an uploaded mesh; counts and bounds stay available
+    void ReleaseCpuGeometry();
+    // Reads a released CPU copy back from the GPU buffers
+    void RestoreCpuGeometry();
+    bool HasCpuGeometry() const { return cpuGeometry; }
+    // Re-uploads the vertices after they were edited in place
+    void UpdateVertexBuffer();
+
+    size_t GetVertexCount() const { return vertexCount; }
+    size_t GetIndexCount() const { return indexCount; }
+    // Bounds of the vertices uploaded so far
+    glm::vec3 GetMinBounds() const { return minBounds; }
+    glm::vec3 GetMaxBounds() const { return maxBounds; }
+
 private:
-    unsigned int VBO, EBO;
+    GLVertexArray VAO;
+    GLBuffer VBO, EBO;
+    size_t vertexCapacity = 0;
+    size_t indexCapacity = 0;
+    size_t uploadedVertices = 0;
+    size_t uploadedIndices = 0;
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    bool cpuGeometry = true;
+    glm::vec3 minBounds = glm::vec3(FLT_MAX);
+    glm::vec3 maxBounds = glm::vec3(-FLT_MAX);
+
+    void createBuffers(bool fill);
+    void expandBounds(size_t firstVertex, size_t count);
 };
\ No newline at end of file
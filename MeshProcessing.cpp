@@ -0,0 +1,290 @@
+#include "MeshProcessing.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace MeshProcessing {
+    namespace {
+        // Triangles or vertices per pool task
+        const size_t BLOCK_SIZE = 16384;
+
+        glm::vec3 anyPerpendicular(const glm::vec3& normal) {
+            glm::vec3 axis = std::abs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+            return glm::normalize(glm::cross(axis, normal));
+        }
+
+        // body(begin, end) over consecutive blocks of [0, count); small inputs stay on the calling thread
+        void parallelBlocks(size_t count, const std::function<void(size_t, size_t)>& body) {
+            size_t blocks = (count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+            if (blocks <= 1) {
+                if (count > 0) {
+                    body(0, count);
+                }
+                return;
+            }
+            ThreadPool::Shared().ParallelFor(blocks, [&](size_t block) {
+                body(block * BLOCK_SIZE, (std::min)(count, (block + 1) * BLOCK_SIZE));
+            });
+        }
+
+        bool validTriangle(const std::vector<unsigned int>& indices, size_t triangle, size_t vertexCount) {
+            return indices[triangle * 3] < vertexCount && indices[triangle * 3 + 1] < vertexCount && indices[triangle * 3 + 2] < vertexCount;
+        }
+
+        // Corners (index positions) grouped by the vertex they refer to, corners of vertex v are
+        // corners[offsets[v]..offsets[v + 1])
+        struct VertexCorners {
+            std::vector<uint32_t> offsets;
+            std::vector<uint32_t> corners;
+        };
+
+        VertexCorners gatherCorners(size_t vertexCount, const std::vector<unsigned int>& indices) {
+            VertexCorners result;
+            size_t cornerCount = indices.size() / 3 * 3;
+
+            result.offsets.assign(vertexCount + 1, 0);
+            for (size_t i = 0; i < cornerCount; i++) {
+                if (indices[i] < vertexCount) {
+                    result.offsets[indices[i] + 1]++;
+                }
+            }
+            for (size_t v = 0; v < vertexCount; v++) {
+                result.offsets[v + 1] += result.offsets[v];
+            }
+
+            result.corners.resize(result.offsets[vertexCount]);
+            std::vector<uint32_t> cursor(result.offsets.begin(), result.offsets.end() - 1);
+            for (size_t i = 0; i < cornerCount; i++) {
+                if (indices[i] < vertexCount) {
+                    result.corners[cursor[indices[i]]++] = static_cast<uint32_t>(i);
+                }
+            }
+            return result;
+        }
+
+        uint32_t positionBits(float value) {
+            // -0 and +0 are the same position
+            value = value == 0.0f ? 0.0f : value;
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        }
+
+        uint64_t hashPosition(const glm::vec3& p) {
+            uint64_t h = positionBits(p.x) * 0x9E3779B97F4A7C15ull;
+            h ^= positionBits(p.y) * 0xC2B2AE3D27D4EB4Full;
+            h ^= positionBits(p.z) * 0x165667B19E3779F9ull;
+            h ^= h >> 29;
+            h *= 0xBF58476D1CE4E5B9ull;
+            return h ^ (h >> 32);
+        }
+
+        bool samePosition(const glm::vec3& a, const glm::vec3& b) {
+            return positionBits(a.x) == positionBits(b.x) && positionBits(a.y) == positionBits(b.y) && positionBits(a.z) == positionBits(b.z);
+        }
+
+        // For every vertex, the first vertex with the same position. Vertices split only for their UVs
+        // or other attributes share a position, and through it their normal.
+        std::vector<uint32_t> firstAtPosition(const std::vector<Vertex>& vertices) {
+            const uint32_t EMPTY = 0xFFFFFFFFu;
+            size_t capacity = 64;
+            while (capacity < vertices.size() * 2) {
+                capacity *= 2;
+            }
+            std::vector<uint32_t> table(capacity, EMPTY);
+            std::vector<uint32_t> first(vertices.size());
+            for (size_t v = 0; v < vertices.size(); v++) {
+                const glm::vec3& position = vertices[v].Position;
+                size_t slot = hashPosition(position) & (capacity - 1);
+                while (table[slot] != EMPTY && !samePosition(vertices[table[slot]].Position, position)) {
+                    slot = (slot + 1) & (capacity - 1);
+                }
+                if (table[slot] == EMPTY) {
+                    table[slot] = static_cast<uint32_t>(v);
+                }
+                first[v] = table[slot];
+            }
+            return first;
+        }
+
+        // Angle of a triangle at one of its corners, measured in the plane of the corner's normal
+        float cornerAngle(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, size_t corner, const glm::vec3& normal) {
+            size_t first = corner - corner % 3;
+            const glm::vec3& position = vertices[indices[corner]].Position;
+            glm::vec3 toNext = vertices[indices[first + (corner - first + 1) % 3]].Position - position;
+            glm::vec3 toPrevious = vertices[indices[first + (corner - first + 2) % 3]].Position - position;
+            toNext -= normal * glm::dot(normal, toNext);
+            toPrevious -= normal * glm::dot(normal, toPrevious);
+
+            float lengths = glm::length(toNext) * glm::length(toPrevious);
+            if (!(lengths > 0.0f)) {
+                return 0.0f;
+            }
+            return std::acos(std::clamp(glm::dot(toNext, toPrevious) / lengths, -1.0f, 1.0f));
+        }
+
+        void setFrame(Vertex& vertex, const glm::vec3& tangentSum, float handedness) {
+            const glm::vec3& normal = vertex.Normal;
+
+            // Gram-Schmidt against the normal
+            glm::vec3 tangent = tangentSum - normal * glm::dot(normal, tangentSum);
+            float length = glm::length(tangent);
+            tangent = length > 1e-8f ? tangent / length : anyPerpendicular(normal);
+
+            vertex.Tangent = tangent;
+            vertex.Bitangent = glm::cross(normal, tangent) * handedness;
+        }
+    }
+
+    void GenerateNormals(std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices) {
+        const size_t vertexCount = vertices.size();
+        const size_t triangleCount = indices.size() / 3;
+
+        // The unnormalized cross product weights each face by its area
+        std::vector<glm::vec3> faceNormals(triangleCount);
+        parallelBlocks(triangleCount, [&](size_t begin, size_t end) {
+            for (size_t t = begin; t < end; t++) {
+                if (!validTriangle(indices, t, vertexCount)) {
+                    faceNormals[t] = glm::vec3(0.0f);
+                    continue;
+                }
+                const glm::vec3& a = vertices[indices[t * 3]].Position;
+                const glm::vec3& b = vertices[indices[t * 3 + 1]].Position;
+                const glm::vec3& c = vertices[indices[t * 3 + 2]].Position;
+                faceNormals[t] = glm::cross(b - a, c - a);
+            }
+        });
+
+        VertexCorners corners = gatherCorners(vertexCount, indices);
+        std::vector<glm::vec3> vertexNormals(vertexCount);
+        parallelBlocks(vertexCount, [&](size_t begin, size_t end) {
+            for (size_t v = begin; v < end; v++) {
+                glm::vec3 normal(0.0f);
+                for (uint32_t i = corners.offsets[v]; i < corners.offsets[v + 1]; i++) {
+                    normal += faceNormals[corners.corners[i] / 3];
+                }
+                vertexNormals[v] = normal;
+            }
+        });
+
+        // Vertices at one position add up into the first of them, in vertex order so the sum does not
+        // depend on the thread count, and all of them take that normal
+        std::vector<uint32_t> first = firstAtPosition(vertices);
+        for (size_t v = 0; v < vertexCount; v++) {
+            if (first[v] != v) {
+                vertexNormals[first[v]] += vertexNormals[v];
+            }
+        }
+        parallelBlocks(vertexCount, [&](size_t begin, size_t end) {
+            for (size_t v = begin; v < end; v++) {
+                const glm::vec3& normal = vertexNormals[first[v]];
+                float length = glm::length(normal);
+                vertices[v].Normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+            }
+        });
+    }
+
+    void GenerateTangents(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+        const size_t vertexCount = vertices.size();
+        const size_t triangleCount = indices.size() / 3;
+
+        // UV direction of each triangle and its handedness, 0 for triangles without usable UVs. Only the
+        // direction matters, every corner normalizes it after projecting it.
+        std::vector<glm::vec3> faceTangents(triangleCount);
+        std::vector<int8_t> faceHandedness(triangleCount);
+        parallelBlocks(triangleCount, [&](size_t begin, size_t end) {
+            for (size_t t = begin; t < end; t++) {
+                faceHandedness[t] = 0;
+                if (!validTriangle(indices, t, vertexCount)) {
+                    continue;
+                }
+                const Vertex& a = vertices[indices[t * 3]];
+                const Vertex& b = vertices[indices[t * 3 + 1]];
+                const Vertex& c = vertices[indices[t * 3 + 2]];
+
+                glm::vec3 edge1 = b.Position - a.Position;
+                glm::vec3 edge2 = c.Position - a.Position;
+                glm::vec2 deltaUV1 = b.TexCoords - a.TexCoords;
+                glm::vec2 deltaUV2 = c.TexCoords - a.TexCoords;
+
+                float determinant = deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y;
+                if (std::abs(determinant) < 1e-12f) {
+                    continue;
+                }
+                float sign = determinant > 0.0f ? 1.0f : -1.0f;
+                faceTangents[t] = (edge1 * deltaUV2.y - edge2 * deltaUV1.y) * sign;
+                faceHandedness[t] = determinant > 0.0f ? 1 : -1;
+            }
+        });
+
+        // Each vertex sums its corners per handedness; one used by both keeps the right-handed frame
+        // and gets a mirrored copy for its left-handed triangles
+        VertexCorners corners = gatherCorners(vertexCount, indices);
+        std::vector<glm::vec3> mirroredTangents(vertexCount);
+        std::vector<char> split(vertexCount, 0);
+        parallelBlocks(vertexCount, [&](size_t begin, size_t end) {
+            for (size_t v = begin; v < end; v++) {
+                const glm::vec3 normal = vertices[v].Normal;
+                glm::vec3 sums[2] = { glm::vec3(0.0f), glm::vec3(0.0f) };
+                bool used[2] = { false, false };
+
+                for (uint32_t i = corners.offsets[v]; i < corners.offsets[v + 1]; i++) {
+                    uint32_t corner = corners.corners[i];
+                    size_t t = corner / 3;
+                    if (faceHandedness[t] == 0) {
+                        continue;
+                    }
+                    glm::vec3 tangent = faceTangents[t] - normal * glm::dot(normal, faceTangents[t]);
+                    float length = glm::length(tangent);
+                    if (!(length > 0.0f)) {
+                        continue;
+                    }
+                    int side = faceHandedness[t] < 0 ? 1 : 0;
+                    sums[side] += tangent * (cornerAngle(vertices, indices, corner, normal) / length);
+                    used[side] = true;
+                }
+
+                if (used[0] && used[1]) {
+                    split[v] = 1;
+                    mirroredTangents[v] = sums[1];
+                }
+                if (used[1] && !used[0]) {
+                    setFrame(vertices[v], sums[1], -1.0f);
+                }
+                else {
+                    setFrame(vertices[v], sums[0], 1.0f);
+                }
+            }
+        });
+
+        std::vector<unsigned int> mirrored(vertexCount, 0);
+        bool anySplit = false;
+        for (size_t v = 0; v < vertexCount; v++) {
+            if (split[v]) {
+                Vertex copy = vertices[v];
+                setFrame(copy, mirroredTangents[v], -1.0f);
+                mirrored[v] = static_cast<unsigned int>(vertices.size());
+                vertices.push_back(copy);
+                anySplit = true;
+            }
+        }
+        if (!anySplit) {
+            return;
+        }
+
+        parallelBlocks(triangleCount, [&](size_t begin, size_t end) {
+            for (size_t t = begin; t < end; t++) {
+                if (faceHandedness[t] >= 0) {
+                    continue;
+                }
+                for (size_t i = t * 3; i < t * 3 + 3; i++) {
+                    if (split[indices[i]]) {
+                        indices[i] = mirrored[indices[i]];
+                    }
+                }
+            }
+        });
+    }
+}
\ No newline at end of file
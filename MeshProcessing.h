@@ -0,0 +1,21 @@
+#pragma once
+#include <vector>
+#include "Mesh.h"
+
+// Derived vertex attributes for importers whose source data leaves them out. Both passes run on the
+// shared thread pool: per-triangle values first, then every vertex gathers its own triangles, so no
+// two tasks write the same vertex and the result does not depend on the thread count.
+namespace MeshProcessing {
+    // Area-weighted smooth normals from the triangle list, replacing whatever Normal held. Vertices at
+    // the same position get the same normal, so UV seams do not show up in the lighting.
+    void GenerateNormals(std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices);
+
+    // Per-vertex Tangent and Bitangent from the UV layout, an approximation of MikkTSpace rather than a
+    // port of it: each triangle's UV direction is projected into the plane of the vertex normal and
+    // weighted by the corner angle, and Bitangent = cross(Normal, Tangent) times the UV handedness.
+    // Vertices shared by triangles of opposite handedness (mirrored UV seams) are split, appending
+    // vertices and updating indices. Unlike MikkTSpace, vertices are not welded by position and
+    // diverging tangents are not split, so normal maps baked against it can differ slightly.
+    // Vertices without usable UVs get an arbitrary frame around their normal.
+    void GenerateTangents(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+}
\ No newline at end of file
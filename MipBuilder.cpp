@@ -0,0 +1,318 @@
+#include "MipBuilder.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIPBUILDER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace MipBuilder {
+    namespace {
+        // Source texels weighted on each side of an output texel's centre, and the Kaiser window's shape
+        const int KAISER_TAPS = 4;
+        const double KAISER_ALPHA = 4.0;
+        // Output rows per task; a band decodes and filters the source rows it needs once
+        const int BAND_ROWS = 16;
+        // Smaller levels are filtered on the calling thread
+        const size_t PARALLEL_TEXELS = 128 * 128;
+        const int SRGB_ENCODE_STEPS = 16384;
+
+        std::atomic<bool> enabled{ true };
+        std::atomic<int> filter{ static_cast<int>(Filter::Kaiser) };
+        // Indexed by TextureRole
+        std::atomic<int> maxSizes[3] = { 4096, 4096, 2048 };
+
+        // One texel being filtered; channels past the image's components stay 0
+        struct alignas(16) Texel {
+            float channel[4];
+        };
+
+        // Half of a symmetric kernel, nearest source texel first, summing to 1/2
+        struct Kernel {
+            int taps = 0;
+            float weights[KAISER_TAPS] = {};
+        };
+
+        // How the channels of an image are read and written
+        struct Layout {
+            int components = 0;
+            int srgbChannels = 0;       // leading channels stored sRGB-encoded
+            bool normal = false;        // renormalise XYZ after filtering
+        };
+
+        struct SRGBTables {
+            float decode[256];
+            unsigned char encode[SRGB_ENCODE_STEPS + 1];
+
+            SRGBTables() {
+                for (int i = 0; i < 256; i++) {
+                    double value = i / 255.0;
+                    decode[i] = static_cast<float>(value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4));
+                }
+                for (int i = 0; i <= SRGB_ENCODE_STEPS; i++) {
+                    double value = double(i) / SRGB_ENCODE_STEPS;
+                    value = value <= 0.0031308 ? value * 12.92 : 1.055 * std::pow(value, 1.0 / 2.4) - 0.055;
+                    encode[i] = static_cast<unsigned char>(std::lround(std::clamp(value, 0.0, 1.0) * 255.0));
+                }
+            }
+        };
+
+        const SRGBTables& srgbTables() {
+            static const SRGBTables tables;
+            return tables;
+        }
+
+        double besselI0(double x) {
+            double sum = 1.0;
+            double term = 1.0;
+            for (int k = 1; k < 32; k++) {
+                term *= (x / (2.0 * k)) * (x / (2.0 * k));
+                sum += term;
+            }
+            return sum;
+        }
+
+        Kernel makeKernel(Filter type) {
+            Kernel kernel;
+            if (type == Filter::Box) {
+                kernel.taps = 1;
+                kernel.weights[0] = 0.5f;
+                return kernel;
+            }
+
+            // Sinc cut off at the output's Nyquist frequency, windowed over KAISER_TAPS source texels a side
+            const double pi = 3.14159265358979323846;
+            double sum = 0.0;
+            double weights[KAISER_TAPS];
+            for (int tap = 0; tap < KAISER_TAPS; tap++) {
+                double distance = tap + 0.5;
+                double x = pi * distance / 2.0;
+                double ratio = distance / KAISER_TAPS;
+                double window = besselI0(KAISER_ALPHA * std::sqrt(1.0 - ratio * ratio)) / besselI0(KAISER_ALPHA);
+                weights[tap] = std::sin(x) / x * window;
+                sum += weights[tap];
+            }
+            kernel.taps = KAISER_TAPS;
+            for (int tap = 0; tap < KAISER_TAPS; tap++) {
+                kernel.weights[tap] = static_cast<float>(weights[tap] / (2.0 * sum));
+            }
+            return kernel;
+        }
+
+        Layout layoutOf(const ImageData& image) {
+            Layout layout;
+            layout.components = image.components;
+            if (image.role == TextureRole::Color) {
+                // Grey plus alpha has one colour channel; alpha is always linear
+                layout.srgbChannels = image.components == 2 ? 1 : (std::min)(image.components, 3);
+            }
+            layout.normal = image.role == TextureRole::Normal && image.components >= 3;
+            return layout;
+        }
+
+        // sum += (a + b) * weight for all four channels
+        inline void accumulate(Texel& sum, const Texel& a, const Texel& b, float weight) {
+#if defined(MIPBUILDER_SSE2)
+            __m128 pair = _mm_add_ps(_mm_load_ps(a.channel), _mm_load_ps(b.channel));
+            _mm_store_ps(sum.channel, _mm_add_ps(_mm_load_ps(sum.channel), _mm_mul_ps(pair, _mm_set1_ps(weight))));
+#else
+            for (int c = 0; c < 4; c++) {
+                sum.channel[c] += (a.channel[c] + b.channel[c]) * weight;
+            }
+#endif
+        }
+
+        void decodeRow(const unsigned char* source, int width, const Layout& layout, Texel* out) {
+            const float* decode = srgbTables().decode;
+            for (int x = 0; x < width; x++) {
+                const unsigned char* texel = source + size_t(x) * layout.components;
+                Texel& value = out[x];
+                for (int c = 0; c < 4; c++) {
+                    value.channel[c] = c >= layout.components ? 0.0f
+                        : c < layout.srgbChannels ? decode[texel[c]] : texel[c] * (1.0f / 255.0f);
+                }
+            }
+        }
+
+        void encodeRow(Texel* row, int width, const Layout& layout, unsigned char* out) {
+            const unsigned char* encode = srgbTables().encode;
+            for (int x = 0; x < width; x++) {
+                float* value = row[x].channel;
+                if (layout.normal) {
+                    float n[3] = { value[0] * 2.0f - 1.0f, value[1] * 2.0f - 1.0f, value[2] * 2.0f - 1.0f };
+                    float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                    if (length > 1e-6f) {
+                        for (int c = 0; c < 3; c++) {
+                            value[c] = n[c] / length * 0.5f + 0.5f;
+                        }
+                    }
+                }
+                unsigned char* texel = out + size_t(x) * layout.components;
+                for (int c = 0; c < layout.components; c++) {
+                    float clamped = std::clamp(value[c], 0.0f, 1.0f);
+                    texel[c] = c < layout.srgbChannels ? encode[static_cast<int>(clamped * SRGB_ENCODE_STEPS + 0.5f)]
+                        : static_cast<unsigned char>(clamped * 255.0f + 0.5f);
+                }
+            }
+        }
+
+        // Output texel x sits between source texels 2x and 2x + 1; texels past the edges repeat the edge
+        void filterRow(const Texel* source, int width, const Kernel& kernel, Texel* out, int outWidth) {
+            for (int x = 0; x < outWidth; x++) {
+                Texel sum = {};
+                for (int tap = 0; tap < kernel.taps; tap++) {
+                    int left = (std::max)(2 * x - tap, 0);
+                    int right = (std::min)(2 * x + 1 + tap, width - 1);
+                    accumulate(sum, source[left], source[right], kernel.weights[tap]);
+                }
+                out[x] = sum;
+            }
+        }
+
+        // Writes the next level of a width x height level into out
+        void halve(const unsigned char* source, int width, int height, const Layout& layout, const Kernel& kernel, unsigned char* out) {
+            int outWidth = (std::max)(width / 2, 1);
+            int outHeight = (std::max)(height / 2, 1);
+            size_t sourceStride = size_t(width) * layout.components;
+            size_t outStride = size_t(outWidth) * layout.components;
+
+            auto filterBand = [&](size_t band) {
+                int y0 = static_cast<int>(band) * BAND_ROWS;
+                int y1 = (std::min)(y0 + BAND_ROWS, outHeight);
+                int firstRow = (std::max)(2 * y0 - (kernel.taps - 1), 0);
+                int lastRow = (std::min)(2 * (y1 - 1) + kernel.taps, height - 1);
+
+                // Source rows filtered horizontally, then combined vertically per output row
+                std::vector<Texel> decoded(width);
+                std::vector<Texel> rows(size_t(lastRow - firstRow + 1) * outWidth);
+                for (int row = firstRow; row <= lastRow; row++) {
+                    decodeRow(source + row * sourceStride, width, layout, decoded.data());
+                    filterRow(decoded.data(), width, kernel, &rows[size_t(row - firstRow) * outWidth], outWidth);
+                }
+
+                std::vector<Texel> sum(outWidth);
+                for (int y = y0; y < y1; y++) {
+                    std::fill(sum.begin(), sum.end(), Texel{});
+                    for (int tap = 0; tap < kernel.taps; tap++) {
+                        const Texel* above = &rows[size_t((std::max)(2 * y - tap, 0) - firstRow) * outWidth];
+                        const Texel* below = &rows[size_t((std::min)(2 * y + 1 + tap, height - 1) - firstRow) * outWidth];
+                        for (int x = 0; x < outWidth; x++) {
+                            accumulate(sum[x], above[x], below[x], kernel.weights[tap]);
+                        }
+                    }
+                    encodeRow(sum.data(), outWidth, layout, out + y * outStride);
+                }
+            };
+
+            size_t bands = (outHeight + BAND_ROWS - 1) / BAND_ROWS;
+            if (size_t(outWidth) * outHeight >= PARALLEL_TEXELS) {
+                ThreadPool::Shared().ParallelFor(bands, filterBand);
+            }
+            else {
+                for (size_t band = 0; band < bands; band++) {
+                    filterBand(band);
+                }
+            }
+        }
+    }
+
+    bool Build(ImageData& image) {
+        if (!image.pixels || image.width <= 0 || image.height <= 0 || image.components < 1 || image.components > 4) {
+            return false;
+        }
+
+        Layout layout = layoutOf(image);
+        Kernel kernel = makeKernel(GetFilter());
+        int maxSize = GetMaxSize(image.role);
+        int width = image.width;
+        int height = image.height;
+
+        // Levels above the maximum size only feed the next one
+        const unsigned char* top = image.pixels.get();
+        std::vector<unsigned char> reduced;
+        while ((std::max)(width, height) > maxSize && (width > 1 || height > 1)) {
+            int outWidth = (std::max)(width / 2, 1);
+            int outHeight = (std::max)(height / 2, 1);
+            std::vector<unsigned char> next(size_t(outWidth) * outHeight * layout.components);
+            halve(top, width, height, layout, kernel, next.data());
+            reduced = std::move(next);
+            top = reduced.data();
+            width = outWidth;
+            height = outHeight;
+        }
+
+        // Level offsets first, so every level is written in place from the one before it
+        std::vector<size_t> offsets;
+        size_t total = 0;
+        for (int w = width, h = height;; w = (std::max)(w / 2, 1), h = (std::max)(h / 2, 1)) {
+            offsets.push_back(total);
+            total += size_t(w) * h * layout.components;
+            if (w == 1 && h == 1) {
+                break;
+            }
+        }
+
+        std::vector<unsigned char> levels(total);
+        std::memcpy(levels.data(), top, size_t(width) * height * layout.components);
+        for (size_t level = 1; level < offsets.size(); level++) {
+            int levelWidth = (std::max)(width >> (level - 1), 1);
+            int levelHeight = (std::max)(height >> (level - 1), 1);
+            halve(levels.data() + offsets[level - 1], levelWidth, levelHeight, layout, kernel, levels.data() + offsets[level]);
+        }
+
+        image.pixels.reset();
+        image.width = width;
+        image.height = height;
+        image.format = BlockFormat::None;
+        image.levels = static_cast<int>(offsets.size());
+        image.levelData = std::move(levels);
+        return true;
+    }
+
+    void Fit(ImageData& image) {
+        int maxSize = GetMaxSize(image.role);
+        int dropped = 0;
+        size_t droppedBytes = 0;
+        while (dropped < image.levels - 1 && (std::max)(image.width >> dropped, image.height >> dropped) > maxSize) {
+            droppedBytes += TextureLoader::GetLevelSize(image, dropped);
+            dropped++;
+        }
+        if (dropped == 0 || droppedBytes > image.levelData.size()) {
+            return;
+        }
+
+        image.levelData.erase(image.levelData.begin(), image.levelData.begin() + droppedBytes);
+        image.width = (std::max)(image.width >> dropped, 1);
+        image.height = (std::max)(image.height >> dropped, 1);
+        image.levels -= dropped;
+    }
+
+    void SetEnabled(bool value) {
+        enabled.store(value);
+    }
+
+    bool IsEnabled() {
+        return enabled.load();
+    }
+
+    void SetFilter(Filter value) {
+        filter.store(static_cast<int>(value));
+    }
+
+    Filter GetFilter() {
+        return static_cast<Filter>(filter.load());
+    }
+
+    void SetMaxSize(TextureRole role, int size) {
+        maxSizes[static_cast<int>(role)].store((std::max)(size, 1));
+    }
+
+    int GetMaxSize(TextureRole role) {
+        return maxSizes[static_cast<int>(role)].load();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+#include "TextureLoader.h"
+
+// CPU mip chains for decoded textures, so mipmaps do not depend on the driver's glGenerateMipmap and are
+// built on the loader threads instead of the GL thread. Each level is a 2x reduction of the previous one
+// with a separable Kaiser-windowed sinc (or box) filter, four channels at a time with SSE2 where the build
+// targets it, in bands of rows spread over the shared thread pool. Colour maps are filtered in linear
+// light and normal maps are renormalised. Levels above the maximum size of the texture's role are only
+// filtered through, never kept.
+namespace MipBuilder {
+    enum class Filter {
+        Box,
+        Kaiser
+    };
+
+    // Replaces the pixels with a complete uncompressed mip chain in levelData, its top level no larger
+    // than the role's maximum size. False (image untouched) if there are no pixels.
+    bool Build(ImageData& image);
+
+    // Drops the levels of a stored mip chain above the role's maximum size, keeping at least one
+    void Fit(ImageData& image);
+
+    // Whether uncompressed textures get a CPU chain; when off they are mipmapped by the driver on upload
+    void SetEnabled(bool enabled);
+    bool IsEnabled();
+    void SetFilter(Filter filter);
+    Filter GetFilter();
+    // Largest width or height kept for a role
+    void SetMaxSize(TextureRole role, int size);
+    int GetMaxSize(TextureRole role);
+}
\ No newline at end of file
@@ -2,31 +2,112 @@
 #include <glad/glad.h>  
 #include "model.h"
 #include "Objloader.h"
+#include "GeometryCache.h"
+#include "GltfLoader.h"
+#include "StlLoader.h"
+#include "PlyLoader.h"
+#include "ThreadPool.h"
+#include "MeshProcessing.h"
+#include "TextureCompression.h"
+#include "TextureStreamer.h"
+#include "TextureArrays.h"
+#include "Frustum.h"
 #include "stb_image.h"
 #include <iostream>
 #include <filesystem>
 #include "materialprop.h"
 #include <algorithm>
+#include <cstring>
+#include <cstdlib>
 #include <fstream>
 #include <ios>
+#include <iterator>
 #include <chrono>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp> 
 #include <glm/gtc/type_ptr.hpp>  
 #include <assimp/Importer.hpp>     
+#include <assimp/ProgressHandler.hpp>
+#include <limits>
+#include <cmath>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+    // Forwards Assimp's read progress and aborts the import once the cancel flag is set.
+    // The importer takes ownership of the handler.
+    class ImportProgressHandler : public Assimp::ProgressHandler {
+    public:
+        ImportProgressHandler(const std::function<void(float)>& onProgress, const std::atomic<bool>* cancel)
+            : onProgress(onProgress), cancel(cancel) {
+        }
+
+        bool Update(float percentage) override {
+            if (onProgress && percentage >= 0.0f) {
+                onProgress(0.1f + percentage * 0.4f);
+            }
+            return !(cancel && cancel->load(std::memory_order_relaxed));
+        }
+
+    private:
+        std::function<void(float)> onProgress;
+        const std::atomic<bool>* cancel;
+    };
+
+    void throwIfCancelled(const std::atomic<bool>* cancel) {
+        if (cancel && cancel->load(std::memory_order_relaxed)) {
+            throw std::runtime_error("Model loading cancelled");
+        }
+    }
+
+    // Only glTF stores images inside the model file
+    template<typename Loader>
+    void takeEmbeddedImages(Loader&, ModelData&) {
+    }
+
+    void takeEmbeddedImages(GltfLoader& loader, ModelData& data) {
+        data.embeddedImages = loader.TakeEmbeddedImages();
+    }
+
+    template<typename Loader>
+    bool runNativeLoader(const char* format, const std::string& path, ModelData& data,
+        const std::function<void(float)>& onProgress, const std::atomic<bool>* cancel) {
+        std::cout << "Using native " << format << " loader for: " << path << std::endl;
+
+        auto start = std::chrono::high_resolution_clock::now();
 
-std::vector<Texture> Model::textures_loaded;
+        Loader loader;
+        loader.SetCancelFlag(cancel);
+        loader.SetProgressCallback([&onProgress](float progress) {
+            if (onProgress) {
+                onProgress(progress * 0.8f);
+            }
+            });
 
-Model::Model(const std::string& path, const std::string& mtlPath)
-    : modelPath(path), isObjFile(false), hasMtlFile(false), isLoading(true), loadingProgress(0.0f), uvFlipped(false),
+        if (!loader.Load(path, data.meshes)) {
+            std::cout << "Native " << format << " loader could not load the file: " << loader.GetError() << std::endl;
+            return false;
+        }
+        takeEmbeddedImages(loader, data);
+
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+        std::cout << "Native " << format << " loading completed in " << duration.count() << "ms" << std::endl;
+        return true;
+    }
+}
+
+Model::Model(const std::string& path, const std::string& mtlPath, bool streamObj)
+    : modelPath(path), isObjFile(false), hasMtlFile(false), isLoading(true), streaming(false), loadingProgress(0.0f), uvFlipped(false),
     minBounds(FLT_MAX), maxBounds(-FLT_MAX), modelCenter(0.0f), modelSize(0.0f), recommendedScale(1.0f) {
     isObjFile = isObjFormat(path);
 
     try {
+        if (streamObj && isObjFile) {
+            beginStream(path, mtlPath);
+            return;
+        }
+
         loadModel(path, mtlPath);
-        CalculateModelBounds();
-        isLoading = false;
-        loadingProgress = 1.0f;
     }
     catch (const std::exception& e) {
         std::cerr << "Failed to load model: " << e.what() << std::endl;
@@ -36,6 +117,265 @@ Model::Model(const std::string& path, const std::string& mtlPath)
     }
 }
 
+Model::Model(const std::string& path, const std::string& mtlPath, ModelData data)
+    : modelPath(path), isObjFile(false), hasMtlFile(false), isLoading(true), streaming(false), loadingProgress(0.8f), uvFlipped(false),
+    minBounds(FLT_MAX), maxBounds(-FLT_MAX), modelCenter(0.0f), modelSize(0.0f), recommendedScale(1.0f) {
+    isObjFile = isObjFormat(path);
+    directory = path.substr(0, path.find_last_of('/'));
+    hasMtlFile = data.hasMtlFile || !mtlPath.empty();
+
+    beginUploading(std::move(data));
+}
+
+Model::~Model() = default;
+
+void Model::ContinueLoading(double timeBudgetMs) {
+    if (streaming) {
+        continueStreaming(timeBudgetMs);
+    }
+    else if (uploading) {
+        continueUploading(timeBudgetMs);
+    }
+}
+
+void Model::beginUploading(ModelData data) {
+    if (data.hasBounds) {
+        minBounds = data.minBounds;
+        maxBounds = data.maxBounds;
+        updateBoundsMetrics();
+    }
+
+    pendingData = std::move(data);
+    pendingTextureIds.clear();
+    pendingTextureIds.reserve(pendingData.images.size());
+    imageQueue.Clear();
+    for (ImageData& image : pendingData.images) {
+        imageQueue.Enqueue(std::move(image));
+    }
+    pendingMesh = 0;
+    pendingMeshCreated = false;
+    uploading = true;
+    isLoading = true;
+}
+
+void Model::continueUploading(double timeBudgetMs) {
+    // Large meshes go up in slices of this size so a single buffer upload never blows the frame budget
+    const size_t bytesPerSlice = 4 * 1024 * 1024;
+    const size_t verticesPerSlice = bytesPerSlice / sizeof(Vertex);
+    const size_t indicesPerSlice = bytesPerSlice / sizeof(unsigned int);
+    const size_t textureBytesPerCall = 32 * 1024 * 1024;
+
+    auto start = std::chrono::steady_clock::now();
+    auto outOfTime = [&]() {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() >= timeBudgetMs;
+    };
+    auto reportProgress = [&]() {
+        size_t steps = pendingData.images.size() + pendingData.meshes.size();
+        size_t done = pendingTextureIds.size() + pendingMesh;
+        loadingProgress = 0.8f + 0.2f * (steps > 0 ? (float)done / (float)steps : 1.0f);
+    };
+
+    // Textures go up first, one byte budget per call; a load without a time limit takes them all at once
+    if (pendingTextureIds.size() < pendingData.images.size()) {
+        size_t byteBudget = std::isinf(timeBudgetMs) ? SIZE_MAX : textureBytesPerCall;
+        for (TextureUploadQueue::Upload& upload : imageQueue.Process(byteBudget)) {
+            pendingTextureIds.push_back(registerTexture(upload));
+        }
+        if (pendingTextureIds.size() < pendingData.images.size() || outOfTime()) {
+            reportProgress();
+            return;
+        }
+    }
+
+    while (pendingMesh < pendingData.meshes.size()) {
+        MeshData& data = pendingData.meshes[pendingMesh];
+
+        // The geometry moves into the Mesh; a large one is then uploaded from there in slices
+        if (!pendingMeshCreated) {
+            std::vector<Texture> textures;
+            for (const auto& ref : data.textures) {
+                if (ref.image < pendingTextureIds.size() && pendingTextureIds[ref.image] != 0) {
+                    textures.push_back({ pendingTextureIds[ref.image], ref.type, ref.path });
+                }
+            }
+
+            size_t bytes = data.vertices.size() * sizeof(Vertex) + data.indices.size() * sizeof(unsigned int);
+            meshes.emplace_back(std::move(data.vertices), std::move(data.indices), std::move(textures),
+                std::move(data.materialProps), bytes <= bytesPerSlice);
+            expandModelBounds(meshes.back());
+            data = MeshData();
+            pendingMeshCreated = true;
+        }
+
+        Mesh& mesh = meshes.back();
+        while (!mesh.IsUploaded() && !outOfTime()) {
+            mesh.UploadSlice(verticesPerSlice, indicesPerSlice);
+            expandModelBounds(mesh);
+        }
+
+        if (mesh.IsUploaded()) {
+            pendingMesh++;
+            pendingMeshCreated = false;
+        }
+
+        if (outOfTime()) {
+            reportProgress();
+            return;
+        }
+    }
+
+    finishUploading();
+}
+
+void Model::finishUploading() {
+    pendingData = ModelData();
+    pendingTextureIds.clear();
+    uploading = false;
+    isLoading = false;
+    loadingProgress = 1.0f;
+
+    std::cout << "Uploaded " << meshes.size() << " mesh(es) to the GPU" << std::endl;
+    applyGeometryResidency();
+    packTextures();
+
+    // Bounds were grown mesh by mesh during the upload
+    if (!meshes.empty()) {
+        printModelBounds();
+    }
+}
+
+void Model::beginStream(const std::string& path, const std::string& mtlPath) {
+    directory = path.substr(0, path.find_last_of('/'));
+    hasMtlFile = !mtlPath.empty();
+
+    std::cout << "Using streaming OBJ loader for: " << path << std::endl;
+
+    streamLoader = std::make_unique<FastObjLoader>();
+    if (!streamLoader->BeginStream(path, mtlPath)) {
+        streamLoader.reset();
+        throw std::runtime_error("Failed to open OBJ file for streaming");
+    }
+
+    streaming = true;
+    streamStartTime = std::chrono::steady_clock::now();
+}
+
+void Model::continueStreaming(double timeBudgetMs) {
+    // Small enough that one batch never blows the frame budget on its own
+    const size_t bytesPerBatch = 1024 * 1024;
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<ObjStreamBatch> batches;
+    bool more = true;
+    do {
+        more = streamLoader->StreamNext(bytesPerBatch, batches);
+
+        for (auto& batch : batches) {
+            if (batch.material >= streamMeshForMaterial.size()) {
+                streamMeshForMaterial.resize(batch.material + 1, -1);
+            }
+            if (streamMeshForMaterial[batch.material] < 0) {
+                streamMeshForMaterial[batch.material] = static_cast<int>(meshes.size());
+                streamMeshMaterials.push_back(batch.material);
+                // Textures are uploaded here rather than by the loader so they outlive the stream
+                std::vector<Texture> textures;
+                for (const TextureRef& ref : streamLoader->GetStreamTextureRefs(batch.material)) {
+                    unsigned int id = TextureFromFile(ref.path.c_str(), "", TextureCompression::RoleForType(ref.type));
+                    if (id != 0) {
+                        textures.push_back({ id, ref.type, ref.path });
+                    }
+                }
+                meshes.emplace_back(std::vector<Vertex>(), std::vector<unsigned int>(), std::move(textures));
+            }
+
+            Mesh& mesh = meshes[streamMeshForMaterial[batch.material]];
+            mesh.AppendGeometry(batch.vertices, batch.indices);
+            expandModelBounds(mesh);
+        }
+    } while (more && std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() < timeBudgetMs);
+
+    loadingProgress = streamLoader->GetStreamProgress();
+
+    if (!more) {
+        finishStream();
+    }
+}
+
+void Model::finishStream() {
+    // Same mesh order and filtering as a blocking load: material-name order, no empty meshes
+    std::vector<size_t> order(meshes.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return streamLoader->GetStreamMaterialName(streamMeshMaterials[a]) < streamLoader->GetStreamMaterialName(streamMeshMaterials[b]);
+    });
+
+    std::vector<Mesh> ordered;
+    ordered.reserve(meshes.size());
+    for (size_t i : order) {
+        if (meshes[i].GetVertexCount() > 0 && meshes[i].GetIndexCount() > 0) {
+            std::cout << "Created mesh for material '" << streamLoader->GetStreamMaterialName(streamMeshMaterials[i])
+                << "' with " << meshes[i].GetVertexCount() << " vertices" << std::endl;
+            ordered.push_back(std::move(meshes[i]));
+        }
+    }
+    meshes.swap(ordered);
+
+    // Batches carry placeholder frames; derive them the way a blocking load does, then upload them again
+    bool generateNormals = !streamLoader->StreamHasNormals();
+    bool generateTangents = streamLoader->StreamHasTexCoords();
+    if (generateNormals || generateTangents) {
+        ThreadPool::Shared().ParallelFor(meshes.size(), [&](size_t i) {
+            if (generateNormals) {
+                MeshProcessing::GenerateNormals(meshes[i].vertices, meshes[i].indices);
+            }
+            if (generateTangents) {
+                MeshProcessing::GenerateTangents(meshes[i].vertices, meshes[i].indices);
+            }
+        });
+        for (Mesh& mesh : meshes) {
+            if (mesh.vertices.size() == mesh.GetVertexCount()) {
+                mesh.UpdateVertexBuffer();
+            }
+            else {
+                // Mirrored UV seams were split, so the index buffer changed as well
+                mesh = Mesh(std::move(mesh.vertices), std::move(mesh.indices), std::move(mesh.textures), mesh.materialProps);
+            }
+        }
+    }
+
+    streamLoader.reset();
+    streamMeshMaterials.clear();
+    streamMeshForMaterial.clear();
+    streaming = false;
+    packTextures();
+    isLoading = false;
+    loadingProgress = 1.0f;
+
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - streamStartTime);
+    std::cout << "Streaming OBJ loading completed in " << duration.count() << "ms" << std::endl;
+    std::cout << "Created " << meshes.size() << " mesh(es)" << std::endl;
+
+    if (meshes.empty()) {
+        std::cerr << "No meshes loaded from OBJ file" << std::endl;
+        return;
+    }
+
+    CalculateModelBounds();
+    applyGeometryResidency();
+}
+
+// Meshes track the bounds of what they have uploaded, so this costs nothing per vertex
+void Model::expandModelBounds(const Mesh& mesh) {
+    if (mesh.GetUploadedVertexCount() == 0) {
+        return;
+    }
+
+    minBounds = glm::min(minBounds, mesh.GetMinBounds());
+    maxBounds = glm::max(maxBounds, mesh.GetMaxBounds());
+    updateBoundsMetrics();
+}
 
 void Model::CalculateModelBounds() {
     if (meshes.empty()) {
@@ -46,19 +386,57 @@ void Model::CalculateModelBounds() {
     minBounds = glm::vec3(FLT_MAX);
     maxBounds = glm::vec3(-FLT_MAX);
 
-    // Calculate bounds across all meshes
+    // Calculate bounds across all meshes, from their metadata so GPU-only meshes count too
     for (const auto& mesh : meshes) {
-        for (const auto& vertex : mesh.vertices) {
-            minBounds.x = std::min(minBounds.x, vertex.Position.x);
-            minBounds.y = std::min(minBounds.y, vertex.Position.y);
-            minBounds.z = std::min(minBounds.z, vertex.Position.z);
+        if (mesh.GetUploadedVertexCount() > 0) {
+            minBounds = glm::min(minBounds, mesh.GetMinBounds());
+            maxBounds = glm::max(maxBounds, mesh.GetMaxBounds());
+        }
+    }
+
+    updateBoundsMetrics();
+    printModelBounds();
+}
+
+void Model::printModelBounds() const {
+    std::cout << "Model bounds calculated:" << std::endl;
+    std::cout << "  Min: (" << minBounds.x << ", " << minBounds.y << ", " << minBounds.z << ")" << std::endl;
+    std::cout << "  Max: (" << maxBounds.x << ", " << maxBounds.y << ", " << maxBounds.z << ")" << std::endl;
+    std::cout << "  Center: (" << modelCenter.x << ", " << modelCenter.y << ", " << modelCenter.z << ")" << std::endl;
+    std::cout << "  Size: (" << modelSize.x << ", " << modelSize.y << ", " << modelSize.z << ")" << std::endl;
+    std::cout << "  Recommended scale: " << recommendedScale << std::endl;
+}
+
+void Model::SetGeometryResidency(GeometryResidency residency) {
+    if (residency == geometryResidency) {
+        return;
+    }
+    geometryResidency = residency;
+    if (!isLoading) {
+        applyGeometryResidency();
+    }
+}
 
-            maxBounds.x = std::max(maxBounds.x, vertex.Position.x);
-            maxBounds.y = std::max(maxBounds.y, vertex.Position.y);
-            maxBounds.z = std::max(maxBounds.z, vertex.Position.z);
+// Runs once the model is complete; meshes still loading need their CPU copy for the remaining slices
+void Model::applyGeometryResidency() {
+    size_t released = 0;
+    for (auto& mesh : meshes) {
+        if (geometryResidency == GeometryResidency::GpuOnly) {
+            if (mesh.HasCpuGeometry()) {
+                released += mesh.GetVertexCount() * sizeof(Vertex) + mesh.GetIndexCount() * sizeof(unsigned int);
+            }
+            mesh.ReleaseCpuGeometry();
         }
+        else {
+            mesh.RestoreCpuGeometry();
+        }
+    }
+    if (released > 0) {
+        std::cout << "Released " << released / (1024 * 1024) << " MB of CPU geometry, meshes are GPU-only" << std::endl;
     }
+}
 
+void Model::updateBoundsMetrics() {
     // Calculate center and size
     modelCenter = (minBounds + maxBounds) * 0.5f;
     modelSize = maxBounds - minBounds;
@@ -75,20 +453,40 @@ void Model::CalculateModelBounds() {
     else {
         recommendedScale = 1.0f;
     }
-
-    std::cout << "Model bounds calculated:" << std::endl;
-    std::cout << "  Min: (" << minBounds.x << ", " << minBounds.y << ", " << minBounds.z << ")" << std::endl;
-    std::cout << "  Max: (" << maxBounds.x << ", " << maxBounds.y << ", " << maxBounds.z << ")" << std::endl;
-    std::cout << "  Center: (" << modelCenter.x << ", " << modelCenter.y << ", " << modelCenter.z << ")" << std::endl;
-    std::cout << "  Size: (" << modelSize.x << ", " << modelSize.y << ", " << modelSize.z << ")" << std::endl;
-    std::cout << "  Recommended scale: " << recommendedScale << std::endl;
 }
 
 void Model::Draw(unsigned int shaderProgram) {
+    // Packing was switched in the UI since the textures were last packed
+    if (!isLoading && packingEnabled != TextureArrays::IsEnabled()) {
+        packTextures();
+    }
+    TextureArrays::ResetBindings();
     for (unsigned int i = 0; i < meshes.size(); i++)
         meshes[i].Draw(shaderProgram);
 }
 
+void Model::UpdateTextureStreaming(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, int viewportHeight) {
+    glm::mat4 modelView = view * model;
+    Frustum frustum(projection * modelView);
+    glm::vec3 cameraPosition = glm::vec3(glm::inverse(modelView)[3]);
+    // The model matrix only scales uniformly, which distance and size share, so both stay in model units
+    float pixelsPerUnit = viewportHeight * 0.5f * projection[1][1];
+
+    for (const auto& mesh : meshes) {
+        glm::vec3 minBounds = mesh.GetMinBounds();
+        glm::vec3 maxBounds = mesh.GetMaxBounds();
+        if (mesh.textures.empty() || minBounds.x > maxBounds.x || !frustum.IntersectsBox(minBounds, maxBounds)) {
+            continue;
+        }
+
+        float distance = glm::length(glm::clamp(cameraPosition, minBounds, maxBounds) - cameraPosition);
+        float screenSize = distance > 0.0f ? glm::length(maxBounds - minBounds) / distance * pixelsPerUnit : FLT_MAX;
+        for (const auto& texture : mesh.textures) {
+            TextureStreamer::Request(texture.id, screenSize);
+        }
+    }
+}
+
 bool Model::isObjFormat(const std::string& path) {
     std::string ext = getFileExtension(path);
     std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
@@ -109,7 +507,7 @@ bool Model::isImageFile(const std::string& filename) {
 
     return ext == "png" || ext == "jpg" || ext == "jpeg" ||
         ext == "tga" || ext == "bmp" || ext == "hdr" ||
-        ext == "dds" || ext == "tiff" || ext == "exr";
+        ext == "dds" || ext == "ktx" || ext == "tiff" || ext == "exr";
 }
 
 std::string Model::getTextureTypeFromFilename(const std::string& filename) {
@@ -189,9 +587,14 @@ void Model::LoadMaterialFile(const std::string& mtlPath) {
         return;
     }
 
-    // Reload the model with the MTL file
+    // Reload the model with the MTL file; the old textures stay referenced until it is done,
+    // so the ones the new materials still use come from the cache
+    std::vector<TextureCache::Handle> previousTextures = std::move(textureHandles);
+    textureHandles.clear();
     meshes.clear();
-    textures_loaded.clear();
+    textureArrays.clear();
+    unpackedTextures.clear();
+    TextureArrays::ResetBindings();
     ClearCustomTextures();
 
     hasMtlFile = true;
@@ -203,6 +606,9 @@ void Model::LoadMaterialFile(const std::string& mtlPath) {
 void Model::LoadTexturesFromFolder(const std::string& folderPath) {
     try {
         ClearCustomTextures();
+        folderQueue.Clear();
+        folderTextureTypes.clear();
+        folderTexturesLoaded = 0;
 
         if (!std::filesystem::exists(folderPath) || !std::filesystem::is_directory(folderPath)) {
             std::cerr << "Invalid folder path: " << folderPath << std::endl;
@@ -211,72 +617,88 @@ void Model::LoadTexturesFromFolder(const std::string& folderPath) {
 
         std::cout << "Scanning folder for textures: " << folderPath << std::endl;
 
-        int texturesFound = 0;
+        // Every image starts decoding on a worker now; ContinueTextureLoading uploads them as they finish
         for (const auto& entry : std::filesystem::directory_iterator(folderPath)) {
             if (entry.is_regular_file()) {
                 std::string filename = entry.path().filename().string();
-                std::string fullPath = entry.path().string();
 
                 if (isImageFile(filename)) {
                     std::string textureType = getTextureTypeFromFilename(filename);
-
-                    // Load the texture
-                    Texture texture;
-                    texture.id = TextureFromFile(fullPath.c_str(), "", false);
-                    texture.type = textureType;
-                    texture.path = fullPath;
-
-                    if (texture.id != 0) {  // Only add if texture loaded successfully
-                        // Add to appropriate category
-                        if (textureType == "texture_diffuse") {
-                            customTextures.diffuse.push_back(texture);
-                            customTextures.baseColor.push_back(texture);  // Also add as baseColor
-                        }
-                        else if (textureType == "texture_specular") {
-                            customTextures.specular.push_back(texture);
-                        }
-                        else if (textureType == "texture_normal") {
-                            customTextures.normal.push_back(texture);
-                        }
-                        else if (textureType == "texture_height") {
-                            customTextures.height.push_back(texture);
-                        }
-                        else if (textureType == "texture_emission") {
-                            customTextures.emission.push_back(texture);
-                        }
-                        else if (textureType == "texture_roughness") {
-                            customTextures.roughness.push_back(texture);
-                        }
-                        else if (textureType == "texture_metallic") {
-                            customTextures.metallic.push_back(texture);
-                        }
-                        else if (textureType == "texture_ao") {
-                            customTextures.ao.push_back(texture);
-                        }
-
-                        // Apply to all meshes
-                        for (auto& mesh : meshes) {
-                            mesh.textures.push_back(texture);
-                        }
-
-                        texturesFound++;
-                        std::cout << "Loaded " << textureType << ": " << filename << std::endl;
-                    }
+                    folderTextureTypes.push_back(textureType);
+                    folderQueue.Enqueue(entry.path().string(), TextureCompression::RoleForType(textureType));
                 }
             }
         }
 
-        std::cout << "Auto-loaded " << texturesFound << " textures from folder." << std::endl;
-
+        std::cout << "Decoding " << folderTextureTypes.size() << " textures from folder." << std::endl;
     }
     catch (const std::exception& e) {
         std::cerr << "Error loading textures from folder: " << e.what() << std::endl;
     }
 }
 
+void Model::ContinueTextureLoading(size_t byteBudget) {
+    if (folderQueue.IsEmpty()) {
+        return;
+    }
+
+    for (TextureUploadQueue::Upload& upload : folderQueue.Process(byteBudget)) {
+        std::string textureType = std::move(folderTextureTypes.front());
+        folderTextureTypes.pop_front();
+
+        Texture texture;
+        texture.id = registerTexture(upload);
+        texture.type = textureType;
+        texture.path = upload.filename;
+        if (texture.id == 0) {
+            continue;
+        }
+
+        // Add to appropriate category
+        if (textureType == "texture_diffuse") {
+            customTextures.diffuse.push_back(texture);
+            customTextures.baseColor.push_back(texture);  // Also add as baseColor
+        }
+        else if (textureType == "texture_specular") {
+            customTextures.specular.push_back(texture);
+        }
+        else if (textureType == "texture_normal") {
+            customTextures.normal.push_back(texture);
+        }
+        else if (textureType == "texture_height") {
+            customTextures.height.push_back(texture);
+        }
+        else if (textureType == "texture_emission") {
+            customTextures.emission.push_back(texture);
+        }
+        else if (textureType == "texture_roughness") {
+            customTextures.roughness.push_back(texture);
+        }
+        else if (textureType == "texture_metallic") {
+            customTextures.metallic.push_back(texture);
+        }
+        else if (textureType == "texture_ao") {
+            customTextures.ao.push_back(texture);
+        }
+
+        // Apply to all meshes
+        for (auto& mesh : meshes) {
+            mesh.textures.push_back(texture);
+        }
+
+        folderTexturesLoaded++;
+        std::cout << "Loaded " << textureType << ": " << upload.filename << std::endl;
+    }
+
+    if (folderQueue.IsEmpty()) {
+        std::cout << "Auto-loaded " << folderTexturesLoaded << " textures from folder." << std::endl;
+        packTextures();
+    }
+}
+
 void Model::AddCustomTexture(const std::string& texturePath, const std::string& type) {
     Texture texture;
-    texture.id = TextureFromFile(texturePath.c_str(), "", false);
+    texture.id = TextureFromFile(texturePath.c_str(), "", TextureCompression::RoleForType(type));
     texture.type = type;
     texture.path = texturePath;
 
@@ -317,6 +739,49 @@ void Model::AddCustomTexture(const std::string& texturePath, const std::string&
         // Add the new texture
         mesh.textures.push_back(texture);
     }
+    packTextures();
+}
+
+void Model::packTextures() {
+    packingEnabled = TextureArrays::IsEnabled();
+    if (meshes.empty()) {
+        return;
+    }
+    if (!packingEnabled) {
+        // The 2D textures were let go when they were packed, so the layers are copied out before the arrays go
+        if (!textureArrays.empty()) {
+            std::vector<GLTexture> copies = TextureArrays::Unpack(meshes);
+            unpackedTextures.insert(unpackedTextures.end(), std::make_move_iterator(copies.begin()), std::make_move_iterator(copies.end()));
+            textureArrays.clear();
+            TextureArrays::ResetBindings();
+        }
+        return;
+    }
+    textureArrays = TextureArrays::Pack(meshes);
+    TextureArrays::ResetBindings();
+
+    // Packed textures are only kept while the UI still shows them
+    std::unordered_set<unsigned int> sampled;
+    for (const Mesh& mesh : meshes) {
+        for (const Texture& texture : mesh.textures) {
+            if (texture.layer < 0) {
+                sampled.insert(texture.id);
+            }
+        }
+    }
+    for (const auto* textures : { &customTextures.diffuse, &customTextures.specular, &customTextures.normal,
+        &customTextures.height, &customTextures.emission, &customTextures.roughness, &customTextures.metallic,
+        &customTextures.ao, &customTextures.baseColor }) {
+        for (const Texture& texture : *textures) {
+            sampled.insert(texture.id);
+        }
+    }
+    textureHandles.erase(std::remove_if(textureHandles.begin(), textureHandles.end(),
+        [&](const TextureCache::Handle& handle) { return sampled.count(handle->Get()) == 0; }),
+        textureHandles.end());
+    unpackedTextures.erase(std::remove_if(unpackedTextures.begin(), unpackedTextures.end(),
+        [&](const GLTexture& texture) { return sampled.count(texture.Get()) == 0; }),
+        unpackedTextures.end());
 }
 
 void Model::ClearCustomTextures() {
@@ -334,41 +799,70 @@ void Model::ClearCustomTextures() {
 void Model::loadModel(const std::string& path, const std::string& mtlPath) {
     directory = path.substr(0, path.find_last_of('/'));
 
-    if (isObjFile) {
+    ModelData data = ImportModelData(path, mtlPath, [this](float progress) {
+        this->loadingProgress = progress * 0.8f;
+        });
+    hasMtlFile = data.hasMtlFile;
+
+    beginUploading(std::move(data));
+    continueUploading(std::numeric_limits<double>::infinity());
+}
+
+ModelData Model::ImportModelData(const std::string& path, const std::string& mtlPath,
+    const std::function<void(float)>& onProgress, const std::atomic<bool>* cancel, const ObjParseOptions& objOptions) {
+    ModelData data;
+    std::string directory = path.substr(0, path.find_last_of('/'));
+
+    bool cached = GeometryCache::Load(path, mtlPath, data);
+    if (cached) {
+        std::cout << "Using cached geometry for: " << path << std::endl;
+    }
+    else if (isObjFormat(path)) {
         // Use fast OBJ loader
         std::cout << "Using Fast OBJ Loader for: " << path << std::endl;
 
-        FastObjLoader::SetProgressCallback([this](float progress) {
-            this->loadingProgress = progress;
-            });
-
-        try {
-            meshes = FastObjLoader::LoadOBJ(path, mtlPath);
+        auto start = std::chrono::high_resolution_clock::now();
 
-            if (!mtlPath.empty()) {
-                hasMtlFile = true;
-            }
-            else {
-                hasMtlFile = false;
+        FastObjLoader loader;
+        loader.SetCancelFlag(cancel);
+        loader.SetParseMode(objOptions.mode);
+        loader.SetThreadCount(objOptions.threadCount);
+        loader.SetProgressCallback([&onProgress](float progress) {
+            if (onProgress) {
+                onProgress(progress * 0.8f);
             }
+            });
 
-            if (meshes.empty()) {
-                throw std::runtime_error("No meshes loaded from OBJ file");
-            }
+        if (!loader.Parse(path, mtlPath)) {
+            throwIfCancelled(cancel);
+            std::cerr << "Fast OBJ loader failed: could not read " << path << std::endl;
+            throw std::runtime_error("Failed to read OBJ file: " + path);
         }
-        catch (const std::exception& e) {
-            std::cerr << "Fast OBJ loader failed: " << e.what() << std::endl;
-            throw;
+
+        data.meshes = loader.TakeMeshData();
+        data.hasMtlFile = !mtlPath.empty();
+
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+        std::cout << "Fast OBJ loading completed in " << duration.count() << "ms" << std::endl;
+
+        if (data.meshes.empty()) {
+            std::cerr << "Fast OBJ loader failed: No meshes loaded from OBJ file" << std::endl;
+            throw std::runtime_error("No meshes loaded from OBJ file");
         }
     }
+    else if (importNative(path, data, onProgress, cancel)) {
+        std::cout << "Successfully loaded " << data.meshes.size() << " meshes with a native loader" << std::endl;
+    }
     else {
-        // Use Assimp for other formats (including GLB/GLTF)
+        // Use Assimp for other formats, and for files the native loaders do not support
+        throwIfCancelled(cancel);
         std::cout << "Using Assimp for: " << path << std::endl;
 
         Assimp::Importer importer;
+        importer.SetProgressHandler(new ImportProgressHandler(onProgress, cancel));
 
-        // Base flags for all formats
-        unsigned int flags = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace;
+        // Base flags for all formats; normals and tangents are generated by processMeshGeometry where missing
+        unsigned int flags = aiProcess_Triangulate;
 
         // Detect file format and apply appropriate flags
         std::string ext = getFileExtension(path);
@@ -402,49 +896,283 @@ void Model::loadModel(const std::string& path, const std::string& mtlPath) {
 
         flags |= aiProcess_JoinIdenticalVertices | aiProcess_OptimizeMeshes | aiProcess_RemoveRedundantMaterials;
 
-        loadingProgress = 0.1f;
+        if (onProgress) {
+            onProgress(0.1f);
+        }
         const aiScene* scene = importer.ReadFile(path, flags);
 
+        throwIfCancelled(cancel);
         if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
             std::cerr << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
             throw std::runtime_error("Failed to load model with Assimp: " + std::string(importer.GetErrorString()));
         }
 
-        loadingProgress = 0.3f;
-
         if (scene->mNumTextures > 0) {
             std::cout << "Found " << scene->mNumTextures << " embedded textures" << std::endl;
         }
 
-        loadingProgress = 0.5f;
-        processNode(scene->mRootNode, scene);
+        if (onProgress) {
+            onProgress(0.5f);
+        }
+        processMeshes(scene, data, onProgress, cancel);
+        processEmbeddedTextures(scene, data);
+
+        std::cout << "Successfully loaded " << data.meshes.size() << " meshes with proper UV coordinates" << std::endl;
+    }
+
+    throwIfCancelled(cancel);
+
+    if (!cached) {
+        GeometryCache::Store(path, mtlPath, data);
+    }
+
+    // Embedded images are cached and shared under their model's path
+    for (size_t i = 0; i < data.embeddedImages.size(); i++) {
+        data.embeddedImages[i].name = path + "*" + std::to_string(i);
+    }
+
+    // OBJ texture paths already include the model directory
+    if (isObjFormat(path)) {
+        directory.clear();
+    }
+
+    decodeImages(data, directory, onProgress, cancel);
+
+    if (onProgress) {
+        onProgress(1.0f);
+    }
+    return data;
+}
+
+bool Model::importNative(const std::string& path, ModelData& data,
+    const std::function<void(float)>& onProgress, const std::atomic<bool>* cancel) {
+    std::string ext = getFileExtension(path);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
 
-        std::cout << "Successfully loaded " << meshes.size() << " meshes with proper UV coordinates" << std::endl;
+    if (ext == "gltf" || ext == "glb") {
+        return runNativeLoader<GltfLoader>("glTF", path, data, onProgress, cancel);
     }
+    if (ext == "stl") {
+        return runNativeLoader<StlLoader>("STL", path, data, onProgress, cancel);
+    }
+    if (ext == "ply") {
+        return runNativeLoader<PlyLoader>("PLY", path, data, onProgress, cancel);
+    }
+    return false;
 }
 
+// Walks the node hierarchy in the same order the meshes were always emitted in
+void Model::collectMeshes(const aiNode* node, std::vector<unsigned int>& meshIndices) {
+    meshIndices.insert(meshIndices.end(), node->mMeshes, node->mMeshes + node->mNumMeshes);
+    for (unsigned int i = 0; i < node->mNumChildren; i++) {
+        collectMeshes(node->mChildren[i], meshIndices);
+    }
+}
+
+// Materials are resolved once each on the calling thread (their texture lookups log in order),
+// then the geometry of every mesh is copied in parallel, each task writing only its own MeshData.
+// Nothing here touches GL; the meshes are uploaded later by Model on the main thread.
+void Model::processMeshes(const aiScene* scene, ModelData& data,
+    const std::function<void(float)>& onProgress, const std::atomic<bool>* cancel) {
+    std::vector<unsigned int> meshIndices;
+    collectMeshes(scene->mRootNode, meshIndices);
+
+    std::vector<char> materialDone(scene->mNumMaterials, 0);
+    std::vector<MeshData> materials(scene->mNumMaterials);
+    for (unsigned int meshIndex : meshIndices) {
+        unsigned int materialIndex = scene->mMeshes[meshIndex]->mMaterialIndex;
+        if (materialIndex < scene->mNumMaterials && !materialDone[materialIndex]) {
+            processMaterial(scene->mMaterials[materialIndex], materials[materialIndex]);
+            materialDone[materialIndex] = 1;
+        }
+    }
 
+    // Batches keep progress and cancellation responsive without a lock around the callback
+    const size_t BATCH_SIZE = 64;
+    data.meshes.resize(meshIndices.size());
+    std::vector<char> failed(meshIndices.size(), 0);
+    for (size_t first = 0; first < meshIndices.size(); first += BATCH_SIZE) {
+        throwIfCancelled(cancel);
+        if (onProgress) {
+            onProgress(0.5f + 0.3f * (float)first / (float)meshIndices.size());
+        }
 
-void Model::processNode(aiNode* node, const aiScene* scene) {
-    for (unsigned int i = 0; i < node->mNumMeshes; i++) {
-        aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+        size_t count = (std::min)(BATCH_SIZE, meshIndices.size() - first);
+        ThreadPool::Shared().ParallelFor(count, [&](size_t i) {
+            size_t slot = first + i;
+            const aiMesh* mesh = scene->mMeshes[meshIndices[slot]];
+            MeshData& meshData = data.meshes[slot];
+            try {
+                processMeshGeometry(mesh, meshData);
+                if (mesh->mMaterialIndex < scene->mNumMaterials) {
+                    meshData.textures = materials[mesh->mMaterialIndex].textures;
+                    meshData.materialProps = materials[mesh->mMaterialIndex].materialProps;
+                }
+            }
+            catch (const std::bad_alloc& e) {
+                std::cerr << "Memory allocation failed for mesh " << meshIndices[slot] << ": " << e.what() << std::endl;
+                meshData = MeshData();
+                failed[slot] = 1;
+            }
+            });
+    }
+    throwIfCancelled(cancel);
 
-        loadingProgress = (float)meshes.size() / (float)scene->mNumMeshes;
+    size_t kept = 0;
+    for (size_t i = 0; i < data.meshes.size(); i++) {
+        if (!failed[i]) {
+            if (kept != i) {
+                data.meshes[kept] = std::move(data.meshes[i]);
+            }
+            kept++;
+        }
+    }
+    data.meshes.resize(kept);
+}
 
-        try {
-            meshes.push_back(processMesh(mesh, scene));
+void Model::processEmbeddedTextures(const aiScene* scene, ModelData& data) {
+    data.embeddedImages.resize(scene->mNumTextures);
+    for (unsigned int i = 0; i < scene->mNumTextures; i++) {
+        const aiTexture* texture = scene->mTextures[i];
+        EmbeddedImage& image = data.embeddedImages[i];
+        if (!texture->pcData) {
+            continue;
         }
-        catch (const std::bad_alloc& e) {
-            std::cerr << "Memory allocation failed for mesh " << i << ": " << e.what() << std::endl;
+
+        // mHeight 0: mWidth bytes of an encoded file (png, jpg, dds, ...)
+        if (texture->mHeight == 0) {
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(texture->pcData);
+            image.data.assign(bytes, bytes + texture->mWidth);
             continue;
         }
+
+        // Raw BGRA texels, stored as RGBA
+        size_t texels = (size_t)texture->mWidth * texture->mHeight;
+        image.width = (int)texture->mWidth;
+        image.height = (int)texture->mHeight;
+        image.data.resize(texels * 4);
+        for (size_t t = 0; t < texels; t++) {
+            const aiTexel& texel = texture->pcData[t];
+            image.data[t * 4 + 0] = texel.r;
+            image.data[t * 4 + 1] = texel.g;
+            image.data[t * 4 + 2] = texel.b;
+            image.data[t * 4 + 3] = texel.a;
+        }
     }
 
-    for (unsigned int i = 0; i < node->mNumChildren; i++) {
-        processNode(node->mChildren[i], scene);
+    if (scene->mNumTextures == 0) {
+        return;
+    }
+    for (auto& mesh : data.meshes) {
+        for (auto& ref : mesh.textures) {
+            if (ref.path.empty() || ref.path[0] == '*') {
+                continue;
+            }
+            auto [texture, index] = scene->GetEmbeddedTextureAndIndex(ref.path.c_str());
+            if (texture && index >= 0) {
+                ref.path = "*" + std::to_string(index);
+            }
+        }
     }
 }
 
+// Paths are resolved once each on the calling thread (their lookups log in order), then the distinct
+// files are decoded in parallel, each task writing only its own image
+void Model::decodeImages(ModelData& data, const std::string& directory,
+    const std::function<void(float)>& onProgress, const std::atomic<bool>* cancel) {
+    // Every texture path is decoded once, however many meshes share it, for the role of its first use
+    std::unordered_map<std::string, size_t> fileForPath;
+    std::vector<std::string> files;
+    std::vector<TextureRole> roles;
+    std::vector<size_t> embedded;       // index into data.embeddedImages, SIZE_MAX for a file on disk
+    std::vector<std::pair<TextureRef*, size_t>> refFiles;
+    for (auto& mesh : data.meshes) {
+        for (auto& ref : mesh.textures) {
+            auto found = fileForPath.find(ref.path);
+            if (found == fileForPath.end()) {
+                size_t file = SIZE_MAX;
+                if (!ref.path.empty() && ref.path[0] == '*') {
+                    size_t index = std::strtoul(ref.path.c_str() + 1, nullptr, 10);
+                    if (index < data.embeddedImages.size() && !data.embeddedImages[index].data.empty()) {
+                        file = files.size();
+                        files.push_back(data.embeddedImages[index].name);
+                        roles.push_back(TextureCompression::RoleForType(ref.type));
+                        embedded.push_back(index);
+                    }
+                    else {
+                        std::cout << "Embedded texture not found: " << ref.path << std::endl;
+                    }
+                }
+                else {
+                    std::string filename = TextureLoader::ResolvePath(ref.path, directory);
+                    if (filename.empty()) {
+                        std::cout << "Texture file not found: " << ref.path << std::endl;
+                    }
+                    else {
+                        file = files.size();
+                        files.push_back(filename);
+                        roles.push_back(TextureCompression::RoleForType(ref.type));
+                        embedded.push_back(SIZE_MAX);
+                    }
+                }
+                found = fileForPath.emplace(ref.path, file).first;
+            }
+            refFiles.push_back({ &ref, found->second });
+        }
+    }
+
+    // A texture some model already has on the GPU is not decoded again. Embedded images are decoded
+    // straight from the bytes copied out of the model file.
+    // One image per thread per batch, so progress and cancellation are checked between batches.
+    std::vector<ImageData> images(files.size());
+    std::vector<std::string> errors(files.size());
+    const size_t batchSize = ThreadPool::Shared().GetThreadCount() + 1;
+    for (size_t first = 0; first < files.size(); first += batchSize) {
+        throwIfCancelled(cancel);
+        if (onProgress) {
+            onProgress(0.8f + 0.2f * (float)first / (float)files.size());
+        }
+
+        size_t count = (std::min)(batchSize, files.size() - first);
+        ThreadPool::Shared().ParallelFor(count, [&](size_t i) {
+            size_t file = first + i;
+            bool loaded = true;
+            if (TextureCache::Contains(files[file], roles[file])) {
+                images[file].path = files[file];
+                images[file].role = roles[file];
+            }
+            else if (embedded[file] != SIZE_MAX) {
+                loaded = TextureLoader::LoadEmbedded(data.embeddedImages[embedded[file]], roles[file], images[file]);
+            }
+            else {
+                loaded = TextureLoader::Load(files[file], roles[file], images[file]);
+            }
+            if (!loaded) {
+                const char* reason = stbi_failure_reason();
+                errors[file] = reason ? reason : "unknown";
+            }
+        });
+    }
+    data.embeddedImages.clear();
+    data.embeddedImages.shrink_to_fit();
+
+    std::vector<size_t> imageForFile(files.size(), SIZE_MAX);
+    for (size_t file = 0; file < files.size(); file++) {
+        if (!errors[file].empty()) {
+            std::cout << "Texture failed to load at path: " << files[file] << std::endl;
+            std::cout << "STB Error: " << errors[file] << std::endl;
+            continue;
+        }
+        imageForFile[file] = data.images.size();
+        data.images.push_back(std::move(images[file]));
+    }
+    for (auto& [ref, file] : refFiles) {
+        ref->image = file != SIZE_MAX ? imageForFile[file] : SIZE_MAX;
+    }
+
+    std::cout << "Decoded " << data.images.size() << " texture(s)" << std::endl;
+}
+
 MaterialProperties Model::extractMaterialProperties(aiMaterial* mat) {
     MaterialProperties props;
 
@@ -512,148 +1240,141 @@ MaterialProperties Model::extractMaterialProperties(aiMaterial* mat) {
 
     return props;
 }
-Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene) {
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
-    std::vector<Texture> textures;
-    MaterialProperties matProps;
+void Model::processMeshGeometry(const aiMesh* mesh, MeshData& data) {
+    static_assert(sizeof(aiVector3D) == sizeof(glm::vec3), "Assimp must be built with single precision ai_real");
 
-    vertices.reserve(mesh->mNumVertices);
+    // One attribute at a time, each a sequential pass over one Assimp array
+    const unsigned int vertexCount = mesh->mNumVertices;
+    data.vertices.resize(vertexCount);
+    Vertex* vertices = data.vertices.data();
 
-    // Estimate indices count (triangulated mesh = 3 indices per face)
-    unsigned int estimatedIndices = 0;
-    for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
-        estimatedIndices += mesh->mFaces[i].mNumIndices;
+    for (unsigned int i = 0; i < vertexCount; i++) {
+        std::memcpy(&vertices[i].Position, &mesh->mVertices[i], sizeof(glm::vec3));
     }
-    indices.reserve(estimatedIndices);
-
-    // Process vertices
-    for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-        Vertex vertex;
 
-        glm::vec3 vector;
-        vector.x = mesh->mVertices[i].x;
-        vector.y = mesh->mVertices[i].y;
-        vector.z = mesh->mVertices[i].z;
-        vertex.Position = vector;
-
-        if (mesh->HasNormals()) {
-            vector.x = mesh->mNormals[i].x;
-            vector.y = mesh->mNormals[i].y;
-            vector.z = mesh->mNormals[i].z;
-            vertex.Normal = vector;
+    if (mesh->HasNormals()) {
+        for (unsigned int i = 0; i < vertexCount; i++) {
+            std::memcpy(&vertices[i].Normal, &mesh->mNormals[i], sizeof(glm::vec3));
         }
-        else {
-            vertex.Normal = glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+    else {
+        for (unsigned int i = 0; i < vertexCount; i++) {
+            vertices[i].Normal = glm::vec3(0.0f, 1.0f, 0.0f);
         }
+    }
 
-        if (mesh->mTextureCoords[0]) {
-            glm::vec2 vec;
-            vec.x = mesh->mTextureCoords[0][i].x;
-            vec.y = mesh->mTextureCoords[0][i].y;
-
-            vertex.TexCoords = vec;
+    if (mesh->mTextureCoords[0]) {
+        for (unsigned int i = 0; i < vertexCount; i++) {
+            std::memcpy(&vertices[i].TexCoords, &mesh->mTextureCoords[0][i], sizeof(glm::vec2));
         }
-        else {
-            vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+    }
+    else {
+        for (unsigned int i = 0; i < vertexCount; i++) {
+            vertices[i].TexCoords = glm::vec2(0.0f, 0.0f);
         }
+    }
 
-        if (mesh->HasTangentsAndBitangents()) {
-            vector.x = mesh->mTangents[i].x;
-            vector.y = mesh->mTangents[i].y;
-            vector.z = mesh->mTangents[i].z;
-            vertex.Tangent = vector;
-
-            vector.x = mesh->mBitangents[i].x;
-            vector.y = mesh->mBitangents[i].y;
-            vector.z = mesh->mBitangents[i].z;
-            vertex.Bitangent = vector;
+    if (mesh->HasTangentsAndBitangents()) {
+        for (unsigned int i = 0; i < vertexCount; i++) {
+            std::memcpy(&vertices[i].Tangent, &mesh->mTangents[i], sizeof(glm::vec3));
+            std::memcpy(&vertices[i].Bitangent, &mesh->mBitangents[i], sizeof(glm::vec3));
         }
-        else {
-            vertex.Tangent = glm::vec3(1.0f, 0.0f, 0.0f);
-            vertex.Bitangent = glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+    else {
+        for (unsigned int i = 0; i < vertexCount; i++) {
+            vertices[i].Tangent = glm::vec3(1.0f, 0.0f, 0.0f);
+            vertices[i].Bitangent = glm::vec3(0.0f, 1.0f, 0.0f);
         }
-
-        vertices.push_back(vertex);
     }
 
+    size_t indexCount = 0;
     for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
-        aiFace face = mesh->mFaces[i];
-        for (unsigned int j = 0; j < face.mNumIndices; j++)
-            indices.push_back(face.mIndices[j]);
+        indexCount += mesh->mFaces[i].mNumIndices;
+    }
+    data.indices.resize(indexCount);
+    unsigned int* indices = data.indices.data();
+    for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+        const aiFace& face = mesh->mFaces[i];
+        std::memcpy(indices, face.mIndices, face.mNumIndices * sizeof(unsigned int));
+        indices += face.mNumIndices;
     }
 
-    // Process material
-    if (mesh->mMaterialIndex >= 0) {
-        aiMaterial* mat = scene->mMaterials[mesh->mMaterialIndex];
-        matProps = extractMaterialProperties(mat);
-
-
-        // 1. DIFFUSE/BASE COLOR 
-        std::vector<Texture> diffuseMaps;
-
-        // Try GLTF base color first
-        diffuseMaps = loadMaterialTextures(mat, aiTextureType_BASE_COLOR, "texture_diffuse");
-        if (diffuseMaps.empty()) {
-            // Try standard diffuse
-            diffuseMaps = loadMaterialTextures(mat, aiTextureType_DIFFUSE, "texture_diffuse");
+    // Lines and points left by Triangulate have no surface to derive a frame from
+    if (mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE) {
+        if (!mesh->HasNormals()) {
+            MeshProcessing::GenerateNormals(data.vertices, data.indices);
         }
-        if (diffuseMaps.empty()) {
-            // Try alternative diffuse types for other formats
-            diffuseMaps = loadMaterialTextures(mat, aiTextureType_UNKNOWN, "texture_diffuse");
+        if (!mesh->HasTangentsAndBitangents() && mesh->HasTextureCoords(0)) {
+            MeshProcessing::GenerateTangents(data.vertices, data.indices);
         }
-        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+    }
+}
 
-        // 2. NORMAL MAPS
-        std::vector<Texture> normalMaps = loadMaterialTextures(mat, aiTextureType_NORMALS, "texture_normal");
-        if (normalMaps.empty()) {
-            normalMaps = loadMaterialTextures(mat, aiTextureType_HEIGHT, "texture_normal");
-        }
-        if (normalMaps.empty()) {
-            normalMaps = loadMaterialTextures(mat, aiTextureType_DISPLACEMENT, "texture_normal");
-        }
-        textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+void Model::processMaterial(aiMaterial* mat, MeshData& data) {
+    data.materialProps = extractMaterialProperties(mat);
 
-        // 3. SPECULAR MAPS
-        std::vector<Texture> specularMaps = loadMaterialTextures(mat, aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+    // 1. DIFFUSE/BASE COLOR 
+    std::vector<TextureRef> diffuseMaps;
 
-        // 4. PBR TEXTURES
+    // Try GLTF base color first
+    diffuseMaps = loadMaterialTextures(mat, aiTextureType_BASE_COLOR, "texture_diffuse");
+    if (diffuseMaps.empty()) {
+        // Try standard diffuse
+        diffuseMaps = loadMaterialTextures(mat, aiTextureType_DIFFUSE, "texture_diffuse");
+    }
+    if (diffuseMaps.empty()) {
+        // Try alternative diffuse types for other formats
+        diffuseMaps = loadMaterialTextures(mat, aiTextureType_UNKNOWN, "texture_diffuse");
+    }
+    data.textures.insert(data.textures.end(), diffuseMaps.begin(), diffuseMaps.end());
 
-        // Roughness
-        std::vector<Texture> roughnessMaps = loadMaterialTextures(mat, aiTextureType_DIFFUSE_ROUGHNESS, "texture_roughness");
-        if (roughnessMaps.empty()) {
-            roughnessMaps = loadMaterialTextures(mat, aiTextureType_SHININESS, "texture_roughness");
-        }
-        textures.insert(textures.end(), roughnessMaps.begin(), roughnessMaps.end());
+    // 2. NORMAL MAPS
+    std::vector<TextureRef> normalMaps = loadMaterialTextures(mat, aiTextureType_NORMALS, "texture_normal");
+    if (normalMaps.empty()) {
+        normalMaps = loadMaterialTextures(mat, aiTextureType_HEIGHT, "texture_normal");
+    }
+    if (normalMaps.empty()) {
+        normalMaps = loadMaterialTextures(mat, aiTextureType_DISPLACEMENT, "texture_normal");
+    }
+    data.textures.insert(data.textures.end(), normalMaps.begin(), normalMaps.end());
 
-        // Metallic
-        std::vector<Texture> metallicMaps = loadMaterialTextures(mat, aiTextureType_METALNESS, "texture_metallic");
-        if (metallicMaps.empty()) {
-            metallicMaps = loadMaterialTextures(mat, aiTextureType_REFLECTION, "texture_metallic");
-        }
-        textures.insert(textures.end(), metallicMaps.begin(), metallicMaps.end());
+    // 3. SPECULAR MAPS
+    std::vector<TextureRef> specularMaps = loadMaterialTextures(mat, aiTextureType_SPECULAR, "texture_specular");
+    data.textures.insert(data.textures.end(), specularMaps.begin(), specularMaps.end());
 
-        // Emission
-        std::vector<Texture> emissionMaps = loadMaterialTextures(mat, aiTextureType_EMISSIVE, "texture_emission");
-        if (emissionMaps.empty()) {
-            emissionMaps = loadMaterialTextures(mat, aiTextureType_UNKNOWN, "texture_emission");
-        }
-        textures.insert(textures.end(), emissionMaps.begin(), emissionMaps.end());
+    // 4. PBR TEXTURES
 
-        // Ambient Occlusion
-        std::vector<Texture> aoMaps = loadMaterialTextures(mat, aiTextureType_AMBIENT_OCCLUSION, "texture_ao");
-        if (aoMaps.empty()) {
-            aoMaps = loadMaterialTextures(mat, aiTextureType_LIGHTMAP, "texture_ao");
-        }
-        textures.insert(textures.end(), aoMaps.begin(), aoMaps.end());
+    // Roughness
+    std::vector<TextureRef> roughnessMaps = loadMaterialTextures(mat, aiTextureType_DIFFUSE_ROUGHNESS, "texture_roughness");
+    if (roughnessMaps.empty()) {
+        roughnessMaps = loadMaterialTextures(mat, aiTextureType_SHININESS, "texture_roughness");
+    }
+    data.textures.insert(data.textures.end(), roughnessMaps.begin(), roughnessMaps.end());
+
+    // Metallic
+    std::vector<TextureRef> metallicMaps = loadMaterialTextures(mat, aiTextureType_METALNESS, "texture_metallic");
+    if (metallicMaps.empty()) {
+        metallicMaps = loadMaterialTextures(mat, aiTextureType_REFLECTION, "texture_metallic");
+    }
+    data.textures.insert(data.textures.end(), metallicMaps.begin(), metallicMaps.end());
+
+    // Emission
+    std::vector<TextureRef> emissionMaps = loadMaterialTextures(mat, aiTextureType_EMISSIVE, "texture_emission");
+    if (emissionMaps.empty()) {
+        emissionMaps = loadMaterialTextures(mat, aiTextureType_UNKNOWN, "texture_emission");
     }
+    data.textures.insert(data.textures.end(), emissionMaps.begin(), emissionMaps.end());
 
-    return Mesh(vertices, indices, textures, matProps);
+    // Ambient Occlusion
+    std::vector<TextureRef> aoMaps = loadMaterialTextures(mat, aiTextureType_AMBIENT_OCCLUSION, "texture_ao");
+    if (aoMaps.empty()) {
+        aoMaps = loadMaterialTextures(mat, aiTextureType_LIGHTMAP, "texture_ao");
+    }
+    data.textures.insert(data.textures.end(), aoMaps.begin(), aoMaps.end());
 }
 
-std::vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName) {
-    std::vector<Texture> textures;
+std::vector<TextureRef> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName) {
+    std::vector<TextureRef> textures;
 
     std::cout << "Loading textures of type: " << typeName << " (aiTextureType: " << type << ")" << std::endl;
     std::cout << "Texture count for this type: " << mat->GetTextureCount(type) << std::endl;
@@ -664,143 +1385,69 @@ std::vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType
 
         std::cout << "Found texture path: " << str.C_Str() << std::endl;
 
-        bool skip = false;
-        for (unsigned int j = 0; j < textures_loaded.size(); j++) {
-            if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0) {
-                textures.push_back(textures_loaded[j]);
-                skip = true;
-                std::cout << "Using cached texture: " << str.C_Str() << std::endl;
-                break;
-            }
-        }
-
-        if (!skip) {
-            Texture texture;
-            texture.id = TextureFromFile(str.C_Str(), this->directory);
-            texture.type = typeName;
-            texture.path = str.C_Str();
-
-            if (texture.id != 0) {
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);
-                std::cout << "Successfully loaded new texture: " << str.C_Str() << " with ID: " << texture.id << std::endl;
-            }
-            else {
-                std::cout << "Failed to load texture: " << str.C_Str() << std::endl;
-            }
-        }
+        TextureRef texture;
+        texture.type = typeName;
+        texture.path = str.C_Str();
+        textures.push_back(texture);
     }
 
-    std::cout << "Total textures loaded for type " << typeName << ": " << textures.size() << std::endl;
     return textures;
 }
 
-unsigned int Model::TextureFromFile(const char* path, const std::string& directory, bool gamma) {
+unsigned int Model::TextureFromFile(const char* path, const std::string& directory, TextureRole role, bool gamma) {
     std::string filename = std::string(path);
 
     if (filename[0] == '*') {
-        int textureIndex = std::stoi(filename.substr(1));
-        std::cout << "Loading embedded texture index: " << textureIndex << std::endl;
+        // Decoded by decodeImages with the rest of the import; the model file is not read again here
+        std::cout << "Embedded texture " << filename << " is only available while importing its model" << std::endl;
         return 0;
     }
 
-    if (!directory.empty()) {
-        filename = directory + '/' + filename;
-    }
-
-    std::cout << "Attempting to load texture from: " << filename << std::endl;
+    std::cout << "Attempting to load texture from: " << (directory.empty() ? filename : directory + '/' + filename) << std::endl;
 
-    // Check if file exists
-    std::ifstream file(filename);
-    if (!file.good()) {
+    std::string resolved = TextureLoader::ResolvePath(filename, directory);
+    if (resolved.empty()) {
         std::cout << "Texture file not found: " << filename << std::endl;
-
-        // Try different extensions for missing textures
-        std::vector<std::string> extensions = { ".png", ".jpg", ".jpeg", ".tga", ".bmp" };
-        std::string baseName = filename.substr(0, filename.find_last_of('.'));
-
-        for (const auto& ext : extensions) {
-            std::string altPath = baseName + ext;
-            std::ifstream altFile(altPath);
-            if (altFile.good()) {
-                altFile.close();
-                filename = altPath;
-                std::cout << "Found alternative texture: " << filename << std::endl;
-                break;
-            }
-            altFile.close();
-        }
-
-        file.close();
-
-        std::ifstream finalCheck(filename);
-        if (!finalCheck.good()) {
-            finalCheck.close();
-            return 0;
-        }
-        finalCheck.close();
+        return 0;
     }
-    file.close();
-
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-
-    // Force 4 components for better compatibility
-    unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data) {
-        std::cout << "Texture loaded successfully: " << filename << std::endl;
-        std::cout << "  Dimensions: " << width << "x" << height << std::endl;
-        std::cout << "  Components: " << nrComponents << std::endl;
-
-        GLenum format;
-        GLenum internalFormat;
-
-        if (nrComponents == 1) {
-            format = GL_RED;
-            internalFormat = GL_RED;
-        }
-        else if (nrComponents == 3) {
-            format = GL_RGB;
-            internalFormat = gamma ? GL_SRGB : GL_RGB;
-        }
-        else if (nrComponents == 4) {
-            format = GL_RGBA;
-            internalFormat = gamma ? GL_SRGB_ALPHA : GL_RGBA;
-        }
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
+    TextureCache::Handle texture = TextureCache::Acquire(resolved, role, gamma);
+    if (!texture) {
+        std::cout << "Texture failed to load at path: " << resolved << std::endl;
+        std::cout << "STB Error: " << stbi_failure_reason() << std::endl;
+        return 0;
+    }
 
-        stbi_image_free(data);
+    textureHandles.push_back(texture);
+    std::cout << "Texture ready: " << resolved << " (ID " << texture->Get() << ")" << std::endl;
+    return texture->Get();
+}
 
-        std::cout << "Texture bound with ID: " << textureID << std::endl;
-    }
-    else {
-        std::cout << "Texture failed to load at path: " << filename << std::endl;
-        std::cout << "STB Error: " << stbi_failure_reason() << std::endl;
-        stbi_image_free(data);
+unsigned int Model::registerTexture(const TextureUploadQueue::Upload& upload) {
+    if (!upload.texture) {
+        std::cout << "Texture failed to load at path: " << upload.filename << std::endl;
         return 0;
     }
 
-    return textureID;
+    textureHandles.push_back(upload.texture);
+    std::cout << "Texture ready: " << upload.filename << " (ID " << upload.texture->Get() << ")" << std::endl;
+    return upload.texture->Get();
 }
 
 void Model::FlipUVCoordinates() {
     for (auto& mesh : meshes) {
+        // A GPU-only mesh is read back for the edit and released again
+        bool gpuOnly = !mesh.HasCpuGeometry();
+        mesh.RestoreCpuGeometry();
+
         for (auto& vertex : mesh.vertices) {
             vertex.TexCoords.y = 1.0f - vertex.TexCoords.y;
         }
+        mesh.UpdateVertexBuffer();
 
-        mesh.setupMesh();
+        if (gpuOnly) {
+            mesh.ReleaseCpuGeometry();
+        }
     }
     uvFlipped = !uvFlipped;
 
@@ -3,12 +3,32 @@
 #include <string>
 #include <map>
 #include <functional>
+#include <chrono>
+#include <memory>
+#include <atomic>
+#include <deque>
 #include <glm/glm.hpp>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 #include "materialprop.h" 
 #include "Mesh.h"
+#include "TextureLoader.h"
+#include "TextureUploadQueue.h"
+#include "Objloader.h"
+
+class FastObjLoader;
+
+// Everything an import produces before the GL thread gets involved
+struct ModelData {
+    std::vector<MeshData> meshes;
+    std::vector<ImageData> images;      // decoded material textures, referenced by TextureRef::image; no pixels if already cached
+    std::vector<EmbeddedImage> embeddedImages;  // images stored in the model file, referenced as "*<index>"
+    bool hasMtlFile = false;
+    bool hasBounds = false;             // bounds known up front (geometry cache), the model is auto-sized from the first frame
+    glm::vec3 minBounds = glm::vec3(0.0f);
+    glm::vec3 maxBounds = glm::vec3(0.0f);
+};
 
 struct MaterialTextures {
     std::vector<Texture> diffuse;
@@ -24,13 +44,36 @@ struct MaterialTextures {
 
 class Model {
 public:
-    Model(const std::string& path, const std::string& mtlPath = "");
+    // streamObj: OBJ files are parsed progressively by ContinueLoading instead of inside the constructor
+    Model(const std::string& path, const std::string& mtlPath = "", bool streamObj = false);
+    // Takes over data imported by ImportModelData; GPU buffers and textures are created by ContinueLoading
+    Model(const std::string& path, const std::string& mtlPath, ModelData data);
+    ~Model();
     void Draw(unsigned int shaderProgram);
+    // Asks TextureStreamer for the mip levels the visible meshes need at their size on screen; call
+    // once per frame before TextureStreamer::Update
+    void UpdateTextureStreaming(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, int viewportHeight);
+
+    // Reads a model file and decodes its textures without any GL calls, so it can run on a loader thread.
+    // onProgress receives 0..1; throws std::runtime_error on failure or once cancel is set. objOptions
+    // configure the OBJ parser and are ignored for other formats.
+    static ModelData ImportModelData(const std::string& path, const std::string& mtlPath,
+        const std::function<void(float)>& onProgress = nullptr, const std::atomic<bool>* cancel = nullptr,
+        const ObjParseOptions& objOptions = ObjParseOptions());
+
+    // Progressive loading while IsLoading(): each call parses (streaming OBJ) or uploads (imported data)
+    // for roughly timeBudgetMs
+    bool IsStreaming() const { return streaming; }
+    void ContinueLoading(double timeBudgetMs);
 
     // Texture management
     void AddCustomTexture(const std::string& texturePath, const std::string& type);
     void ClearCustomTextures();
+    // Starts decoding every image in the folder on worker threads; they are uploaded and applied by
+    // ContinueTextureLoading, at most byteBudget bytes per call
     void LoadTexturesFromFolder(const std::string& folderPath);
+    bool IsLoadingTextures() const { return !folderQueue.IsEmpty(); }
+    void ContinueTextureLoading(size_t byteBudget);
     MaterialTextures GetMaterialTextures() const { return customTextures; }
 
     // MTL file handling
@@ -42,6 +85,10 @@ public:
     bool IsLoading() const { return isLoading; }
     float GetLoadingProgress() const { return loadingProgress; }
 
+    // GpuOnly frees every mesh's vertices and indices once the model is on the GPU; switching back reads them back
+    void SetGeometryResidency(GeometryResidency residency);
+    GeometryResidency GetGeometryResidency() const { return geometryResidency; }
+
     // UV debugging
     void FlipUVCoordinates();
     void SetUVFlipped(bool flipped) { uvFlipped = flipped; }
@@ -60,9 +107,14 @@ private:
     bool isObjFile;
     bool hasMtlFile;
     bool isLoading;
+    bool streaming;
     bool uvFlipped;
     float loadingProgress;
-    static std::vector<Texture> textures_loaded;
+    GeometryResidency geometryResidency = GeometryResidency::KeepCpuCopy;
+    std::vector<TextureCache::Handle> textureHandles;   // keeps every texture the meshes use alive
+    std::vector<GLTexture> textureArrays;               // the material textures packed by TextureArrays
+    std::vector<GLTexture> unpackedTextures;            // 2D copies of array layers, made when packing is turned off
+    bool packingEnabled = false;                        // TextureArrays::IsEnabled() when packTextures last ran
     MaterialTextures customTextures;
 
     // Model bounds for auto-sizing
@@ -72,18 +124,64 @@ private:
     glm::vec3 modelSize;
     float recommendedScale;
 
+    // Streaming state, material slot of every mesh created so far
+    std::unique_ptr<FastObjLoader> streamLoader;
+    std::vector<size_t> streamMeshMaterials;
+    std::vector<int> streamMeshForMaterial;
+    std::chrono::steady_clock::time_point streamStartTime;
+
+    // Upload state for imported data, images go first so every mesh finds its textures
+    ModelData pendingData;
+    std::vector<unsigned int> pendingTextureIds;
+    size_t pendingMesh = 0;
+    bool pendingMeshCreated = false;    // the current mesh exists, a large one is still being uploaded in slices
+    bool uploading = false;
+    TextureUploadQueue imageQueue;
+
+    // Textures from LoadTexturesFromFolder, types in queue order
+    TextureUploadQueue folderQueue;
+    std::deque<std::string> folderTextureTypes;
+    size_t folderTexturesLoaded = 0;
+
     void loadModel(const std::string& path, const std::string& mtlPath = "");
-    void processNode(aiNode* node, const aiScene* scene);
-    Mesh processMesh(aiMesh* mesh, const aiScene* scene);
-    std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName);
-    unsigned int TextureFromFile(const char* path, const std::string& directory, bool gamma = false);
+    static void collectMeshes(const aiNode* node, std::vector<unsigned int>& meshIndices);
+    static void processMeshes(const aiScene* scene, ModelData& data,
+        const std::function<void(float)>& onProgress, const std::atomic<bool>* cancel);
+    static void processMeshGeometry(const aiMesh* mesh, MeshData& data);
+    // Properties and texture references of a material, stored in data
+    static void processMaterial(aiMaterial* mat, MeshData& data);
+    static std::vector<TextureRef> loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName);
+    // Copies scene->mTextures into data and points references to them (FBX names them by file) at "*<index>"
+    static void processEmbeddedTextures(const aiScene* scene, ModelData& data);
+    // Native glTF/GLB, binary STL and binary PLY import; false (with the reason logged) when Assimp should handle the file instead
+    static bool importNative(const std::string& path, ModelData& data,
+        const std::function<void(float)>& onProgress, const std::atomic<bool>* cancel);
+    static void decodeImages(ModelData& data, const std::string& directory,
+        const std::function<void(float)>& onProgress, const std::atomic<bool>* cancel);
+    unsigned int TextureFromFile(const char* path, const std::string& directory, TextureRole role = TextureRole::Color, bool gamma = false);
+    // Keeps an uploaded texture alive for the model's meshes, returns its id or 0 if it failed
+    unsigned int registerTexture(const TextureUploadQueue::Upload& upload);
 
     // Helper functions
     std::string getTextureTypeFromFilename(const std::string& filename);
     bool isImageFile(const std::string& filename);
-    bool isObjFormat(const std::string& path);
-    std::string getFileExtension(const std::string& path);
+    static bool isObjFormat(const std::string& path);
+    static std::string getFileExtension(const std::string& path);
+
+    void beginStream(const std::string& path, const std::string& mtlPath);
+    void continueStreaming(double timeBudgetMs);
+    void finishStream();
+    void beginUploading(ModelData data);
+    void continueUploading(double timeBudgetMs);
+    void finishUploading();
+    // Packs the meshes' textures into arrays and lets go of the 2D textures nothing samples anymore.
+    // With packing turned off, arrays packed earlier are copied back into 2D textures instead.
+    void packTextures();
+    void expandModelBounds(const Mesh& mesh);
+    void applyGeometryResidency();
+    void updateBoundsMetrics();
+    void printModelBounds() const;
 
     //materail prop
-    MaterialProperties extractMaterialProperties(aiMaterial* mat);
+    static MaterialProperties extractMaterialProperties(aiMaterial* mat);
 };
\ No newline at end of file
@@ -0,0 +1,363 @@
+#include "NumberParser.h"
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cfloat>
+#include <climits>
+#include <charconv>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <bit>
+#include <iostream>
+
+#if defined(__AVX2__)
+#define NUMBERPARSER_AVX2 1
+#endif
+#if defined(__SSE4_1__) || defined(__AVX__) || defined(__AVX2__)
+#define NUMBERPARSER_SSE41 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NUMBERPARSER_SSE2 1
+#endif
+
+#if defined(NUMBERPARSER_AVX2)
+#include <immintrin.h>
+#elif defined(NUMBERPARSER_SSE41)
+#include <smmintrin.h>
+#elif defined(NUMBERPARSER_SSE2)
+#include <emmintrin.h>
+#endif
+
+namespace {
+    inline bool isDigit(char c) {
+        return static_cast<unsigned char>(c - '0') <= 9;
+    }
+
+    // Length of the run of ASCII digits starting at p
+    inline size_t countDigits(const char* p, const char* end) {
+        size_t count = 0;
+        size_t available = static_cast<size_t>(end - p);
+
+#if defined(NUMBERPARSER_AVX2)
+        // c - ('0' + 128) puts '0'..'9' at the bottom of the signed range, so one compare finds the first non-digit
+        const __m256i bias32 = _mm256_set1_epi8(static_cast<char>('0' + 128));
+        const __m256i limit32 = _mm256_set1_epi8(static_cast<char>(-128 + 9));
+        while (available - count >= 32) {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + count));
+            __m256i nonDigit = _mm256_cmpgt_epi8(_mm256_sub_epi8(chunk, bias32), limit32);
+            uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(nonDigit));
+            if (mask) {
+                return count + std::countr_zero(mask);
+            }
+            count += 32;
+        }
+#endif
+#if defined(NUMBERPARSER_SSE2)
+        const __m128i bias = _mm_set1_epi8(static_cast<char>('0' + 128));
+        const __m128i limit = _mm_set1_epi8(static_cast<char>(-128 + 9));
+        while (available - count >= 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + count));
+            __m128i nonDigit = _mm_cmpgt_epi8(_mm_sub_epi8(chunk, bias), limit);
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(nonDigit));
+            if (mask) {
+                return count + std::countr_zero(mask);
+            }
+            count += 16;
+        }
+#endif
+        while (count < available && isDigit(p[count])) {
+            count++;
+        }
+        return count;
+    }
+
+    // Converts exactly 8 ASCII digits to their value
+    inline uint32_t parseEightDigits(const char* p) {
+#if defined(NUMBERPARSER_SSE41)
+        __m128i digits = _mm_sub_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)), _mm_set1_epi8('0'));
+        __m128i pairs = _mm_maddubs_epi16(digits, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 0, 0, 0, 0, 0, 0, 0, 0));
+        __m128i quads = _mm_madd_epi16(pairs, _mm_setr_epi16(100, 1, 100, 1, 0, 0, 0, 0));
+        __m128i packed = _mm_packus_epi32(quads, quads);
+        __m128i eight = _mm_madd_epi16(packed, _mm_setr_epi16(10000, 1, 0, 0, 0, 0, 0, 0));
+        return static_cast<uint32_t>(_mm_cvtsi128_si32(eight));
+#else
+        // SWAR on one little-endian 64-bit word
+        uint64_t value;
+        std::memcpy(&value, p, sizeof(value));
+        value -= 0x3030303030303030ull;
+        value = (value * 10) + (value >> 8);
+        value = (((value & 0x000000FF000000FFull) * (100 + (1000000ull << 32))) +
+            (((value >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32;
+        return static_cast<uint32_t>(value);
+#endif
+    }
+
+    inline uint64_t appendDigits(uint64_t value, const char* p, size_t count) {
+        while (count >= 8) {
+            value = value * 100000000ull + parseEightDigits(p);
+            p += 8;
+            count -= 8;
+        }
+        while (count > 0) {
+            value = value * 10 + static_cast<uint64_t>(*p - '0');
+            ++p;
+            --count;
+        }
+        return value;
+    }
+
+    // Powers of ten that are exact in a double
+    const double exactPowersOfTen[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    bool parseFloatSlow(const char*& p, const char* end, float& value) {
+        const char* start = p;
+        bool negative = false;
+        if (start < end && (*start == '-' || *start == '+')) {
+            negative = (*start == '-');
+            ++start;
+        }
+        float parsed;
+        auto result = std::from_chars(start, end, parsed);
+        if (result.ec != std::errc()) {
+            return false;
+        }
+        value = negative ? -parsed : parsed;
+        p = result.ptr;
+        return true;
+    }
+}
+
+namespace NumberParser {
+    bool ParseFloat(const char*& p, const char* end, float& value) {
+        const char* s = p;
+        bool negative = false;
+        if (s < end && (*s == '-' || *s == '+')) {
+            negative = (*s == '-');
+            ++s;
+        }
+
+        // Integer part, leading zeros carry no precision
+        const char* integerStart = s;
+        while (s < end && *s == '0') ++s;
+        size_t integerDigits = countDigits(s, end);
+        uint64_t mantissa = appendDigits(0, s, integerDigits);
+        size_t significantDigits = integerDigits;
+        s += integerDigits;
+        bool anyDigits = s != integerStart;
+
+        int exponent = 0;
+        if (s < end && *s == '.') {
+            ++s;
+            const char* fractionStart = s;
+            if (mantissa == 0) {
+                while (s < end && *s == '0') ++s;
+            }
+            size_t fractionDigits = countDigits(s, end);
+            if (significantDigits + fractionDigits <= 19) {
+                mantissa = appendDigits(mantissa, s, fractionDigits);
+            }
+            significantDigits += fractionDigits;
+            s += fractionDigits;
+            exponent = -static_cast<int>(s - fractionStart);
+            anyDigits = anyDigits || s != fractionStart;
+        }
+
+        if (!anyDigits) {
+            // "inf", "nan" and anything else unusual
+            return parseFloatSlow(p, end, value);
+        }
+
+        // An exponent marker only counts when digits follow it
+        if (s < end && (*s == 'e' || *s == 'E')) {
+            const char* e = s + 1;
+            bool negativeExponent = false;
+            if (e < end && (*e == '-' || *e == '+')) {
+                negativeExponent = (*e == '-');
+                ++e;
+            }
+            size_t exponentDigits = countDigits(e, end);
+            if (exponentDigits > 0) {
+                if (exponentDigits > 6) {
+                    return parseFloatSlow(p, end, value);
+                }
+                int explicitExponent = static_cast<int>(appendDigits(0, e, exponentDigits));
+                exponent += negativeExponent ? -explicitExponent : explicitExponent;
+                s = e + exponentDigits;
+            }
+        }
+
+        // Clinger's fast path: an exact mantissa times an exact power of ten is one correctly rounded operation
+        if (significantDigits > 19 || mantissa > (1ull << 53) || exponent < -22 || exponent > 22) {
+            return parseFloatSlow(p, end, value);
+        }
+
+        double result = static_cast<double>(mantissa);
+        if (mantissa != 0) {
+            result = exponent < 0 ? result / exactPowersOfTen[-exponent] : result * exactPowersOfTen[exponent];
+
+            // Narrowing to float rounds a second time; it can only go wrong when the double sits exactly on a
+            // float halfway point, or in the float subnormal/overflow range
+            uint64_t bits = std::bit_cast<uint64_t>(result);
+            if ((bits & 0x1FFFFFFFull) == 0x10000000ull || result < FLT_MIN || result > FLT_MAX) {
+                return parseFloatSlow(p, end, value);
+            }
+        }
+
+        float narrowed = static_cast<float>(result);
+        value = negative ? -narrowed : narrowed;
+        p = s;
+        return true;
+    }
+
+    bool ParseInt(const char*& p, const char* end, int& value) {
+        const char* s = p;
+        bool negative = false;
+        if (s < end && (*s == '-' || *s == '+')) {
+            negative = (*s == '-');
+            ++s;
+        }
+
+        size_t digits = countDigits(s, end);
+        if (digits == 0) {
+            return false;
+        }
+
+        const char* first = s;
+        while (digits > 1 && *first == '0') {
+            ++first;
+            --digits;
+        }
+
+        int64_t magnitude = digits > 10 ? INT64_MAX : static_cast<int64_t>(appendDigits(0, first, digits));
+        int64_t signedValue = negative ? -magnitude : magnitude;
+        if (signedValue > INT_MAX) signedValue = INT_MAX;
+        if (signedValue < INT_MIN) signedValue = INT_MIN;
+
+        value = static_cast<int>(signedValue);
+        p = first + digits;
+        return true;
+    }
+
+    size_t ParseFloats(const char* p, const char* end, float* values, size_t count) {
+        size_t parsed = 0;
+        while (parsed < count) {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+            if (!ParseFloat(p, end, values[parsed])) {
+                break;
+            }
+            parsed++;
+        }
+        return parsed;
+    }
+
+    const char* GetInstructionSet() {
+#if defined(NUMBERPARSER_AVX2)
+        return "AVX2";
+#elif defined(NUMBERPARSER_SSE41)
+        return "SSE4.1";
+#elif defined(NUMBERPARSER_SSE2)
+        return "SSE2";
+#else
+        return "Scalar";
+#endif
+    }
+
+    BenchmarkResult RunBenchmark(size_t numberCount) {
+        BenchmarkResult result;
+        result.numbers = numberCount;
+
+        // Tokens are stored back to back, NUL terminated so the sscanf_s path can read them too
+        std::string buffer;
+        std::vector<size_t> offsets;
+        std::vector<float> roundTripSources;
+        buffer.reserve(numberCount * 14);
+        offsets.reserve(numberCount);
+
+        std::mt19937 rng(12345);
+        std::uniform_real_distribution<float> coordinate(-1000.0f, 1000.0f);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::uniform_int_distribution<int> index(1, 2000000);
+        std::uniform_int_distribution<uint32_t> anyBits;
+
+        char token[64];
+        for (size_t i = 0; i < numberCount; i++) {
+            switch (i % 6) {
+            case 0: std::snprintf(token, sizeof(token), "%.6f", coordinate(rng)); break;  // typical v / vn
+            case 1: std::snprintf(token, sizeof(token), "%.4f", unit(rng)); break;        // typical vt
+            case 2: std::snprintf(token, sizeof(token), "%g", coordinate(rng)); break;
+            case 3: std::snprintf(token, sizeof(token), "%e", coordinate(rng) * 1e-5f); break;
+            case 4: std::snprintf(token, sizeof(token), "%d", index(rng)); break;
+            default: {
+                float source;
+                do {
+                    source = std::bit_cast<float>(anyBits(rng));
+                } while (!(source == source) || source - source != 0.0f);
+                roundTripSources.push_back(source);
+                std::snprintf(token, sizeof(token), "%.9g", source);
+                break;
+            }
+            }
+            offsets.push_back(buffer.size());
+            buffer.append(token);
+            buffer.push_back('\0');
+        }
+
+        auto tokenEnd = [&](size_t i) {
+            return buffer.data() + (i + 1 < offsets.size() ? offsets[i + 1] - 1 : buffer.size() - 1);
+        };
+
+        std::vector<float> kernelValues(numberCount), referenceValues(numberCount);
+        volatile float sink = 0.0f;
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < numberCount; i++) {
+            const char* p = buffer.data() + offsets[i];
+            ParseFloat(p, tokenEnd(i), kernelValues[i]);
+        }
+        auto kernelTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < numberCount; i++) {
+            const char* p = buffer.data() + offsets[i];
+            parseFloatSlow(p, tokenEnd(i), referenceValues[i]);
+        }
+        auto fromCharsTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < numberCount; i++) {
+            float parsed = 0.0f;
+            sscanf_s(buffer.data() + offsets[i], "%f", &parsed);
+            sink = sink + parsed;
+        }
+        auto sscanfTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        result.kernelPerSecond = kernelTime > 0.0 ? numberCount / kernelTime : 0.0;
+        result.fromCharsPerSecond = fromCharsTime > 0.0 ? numberCount / fromCharsTime : 0.0;
+        result.sscanfPerSecond = sscanfTime > 0.0 ? numberCount / sscanfTime : 0.0;
+
+        result.matchesFromChars = std::memcmp(kernelValues.data(), referenceValues.data(), numberCount * sizeof(float)) == 0;
+
+        result.roundTripExact = true;
+        for (size_t i = 5, r = 0; i < numberCount; i += 6, r++) {
+            if (std::bit_cast<uint32_t>(kernelValues[i]) != std::bit_cast<uint32_t>(roundTripSources[r])) {
+                result.roundTripExact = false;
+                break;
+            }
+        }
+
+        std::cout << "Number parser benchmark (" << GetInstructionSet() << ", " << numberCount << " numbers): "
+            << (result.kernelPerSecond / 1e6) << " M/s kernel, "
+            << (result.fromCharsPerSecond / 1e6) << " M/s from_chars, "
+            << (result.sscanfPerSecond / 1e6) << " M/s sscanf_s, "
+            << (result.kernelPerSecond / (result.sscanfPerSecond > 0.0 ? result.sscanfPerSecond : 1.0)) << "x vs sscanf_s" << std::endl;
+        std::cout << "Number parser check: " << (result.matchesFromChars ? "matches from_chars" : "MISMATCH with from_chars")
+            << ", round trip " << (result.roundTripExact ? "exact" : "NOT exact") << std::endl;
+
+        return result;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+
+// Locale-independent number parsing shared by the OBJ and MTL loaders.
+// Digit runs are scanned and converted 8 at a time with SSE2/SSE4.1/AVX2 when the build targets
+// them, with a portable SWAR fallback. Floats are correctly rounded, bit-identical to std::from_chars.
+namespace NumberParser {
+    // Parses a decimal float at p ("-1", "+.5", "3.", "1e-7", "2.5E+03", "inf", "nan") and advances p past it.
+    // Returns false and leaves p untouched if there is no number at p.
+    bool ParseFloat(const char*& p, const char* end, float& value);
+
+    // Parses an optionally signed decimal integer at p and leaves p on the first non-digit.
+    // Values outside the int range saturate. Returns false and leaves p untouched if there are no digits.
+    bool ParseInt(const char*& p, const char* end, int& value);
+
+    // Parses up to 'count' blank-separated floats starting at p, returns how many were read
+    size_t ParseFloats(const char* p, const char* end, float* values, size_t count);
+
+    struct BenchmarkResult {
+        size_t numbers = 0;
+        double kernelPerSecond = 0.0;
+        double fromCharsPerSecond = 0.0;
+        double sscanfPerSecond = 0.0;
+        bool matchesFromChars = false;  // every token parsed to the same bits as std::from_chars
+        bool roundTripExact = false;    // every random float printed with %.9g parsed back to itself
+    };
+
+    // Times the kernel against std::from_chars and the sscanf_s path on a mix of typical OBJ number forms
+    BenchmarkResult RunBenchmark(size_t numberCount = 1000000);
+
+    // Name of the vector path compiled into this build
+    const char* GetInstructionSet();
+}
\ No newline at end of file
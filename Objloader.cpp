@@ -5,28 +5,121 @@
 #include <iostream>
 #include <unordered_map>
 #include <algorithm>
-#include <glad/glad.h>
-#include "stb_image.h"
 #include <map>
-
-// Static member definitions
-std::vector<glm::vec3> FastObjLoader::positions;
-std::vector<glm::vec2> FastObjLoader::texCoords;
-std::vector<glm::vec3> FastObjLoader::normals;
-std::vector<Vertex> FastObjLoader::vertices;
-std::vector<unsigned int> FastObjLoader::indices;
-std::vector<ObjMaterial> FastObjLoader::materials;
-std::function<void(float)> FastObjLoader::progressCallback;
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include "ThreadPool.h"
+#include "NumberParser.h"
+#include "MeshProcessing.h"
+#include "TextureCompression.h"
 
 void FastObjLoader::SetProgressCallback(std::function<void(float)> callback) {
     progressCallback = callback;
 }
 
-std::vector<Texture> FastObjLoader::loadTexturesForMaterial(const std::string& materialName, const std::string& directory) {
-    std::vector<Texture> textures;
+void FastObjLoader::SetCancelFlag(const std::atomic<bool>* flag) {
+    cancelFlag = flag;
+}
+
+void FastObjLoader::SetParseMode(ObjParseMode mode) {
+    parseMode = mode;
+}
+
+ObjParseMode FastObjLoader::GetParseMode() const {
+    return parseMode;
+}
+
+void FastObjLoader::SetThreadCount(unsigned int count) {
+    threadCount = count;
+}
+
+unsigned int FastObjLoader::GetThreadCount() const {
+    return threadCount;
+}
+
+namespace {
+    inline bool isBlank(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    inline const char* skipBlanks(const char* p, const char* end) {
+        while (p < end && isBlank(*p)) ++p;
+        return p;
+    }
+
+    inline const char* skipToken(const char* p, const char* end) {
+        while (p < end && !isBlank(*p)) ++p;
+        return p;
+    }
+
+    // Parses one whitespace-delimited float straight from the mapped bytes
+    inline bool parseFloatToken(const char*& p, const char* end, float& out) {
+        p = skipBlanks(p, end);
+        return NumberParser::ParseFloat(p, end, out);
+    }
+
+    // Parses a signed decimal OBJ index, 0 if there is none
+    inline int parseIndexToken(const char*& p, const char* end) {
+        int value = 0;
+        NumberParser::ParseInt(p, end, value);
+        return value;
+    }
+
+    inline bool startsWithKeyword(const char* p, const char* end, const char* keyword, size_t length) {
+        return static_cast<size_t>(end - p) > length && std::memcmp(p, keyword, length) == 0 && isBlank(p[length]);
+    }
+
+    // Raw face corner as written in the file, 0 = index not present
+    struct ObjCorner {
+        int position;
+        int texCoord;
+        int normal;
+    };
+
+    // Parses one "p", "p/t", "p//n" or "p/t/n" corner and leaves p after it
+    inline ObjCorner parseCorner(const char*& p, const char* end) {
+        ObjCorner corner = { 0, 0, 0 };
+        corner.position = parseIndexToken(p, end);
+        if (p < end && *p == '/') {
+            ++p;
+            if (p < end && *p != '/') {
+                corner.texCoord = parseIndexToken(p, end);
+            }
+            if (p < end && *p == '/') {
+                ++p;
+                corner.normal = parseIndexToken(p, end);
+            }
+        }
+        return corner;
+    }
+
+    // Folder of the OBJ file, textures referenced by the MTL are resolved against it
+    std::string directoryOf(const std::string& objPath) {
+        std::string directory = objPath.substr(0, objPath.find_last_of('/'));
+        if (directory == objPath) directory = objPath.substr(0, objPath.find_last_of('\\'));
+        if (directory == objPath) directory = "";
+        return directory;
+    }
+
+    // Maps a usemtl name to its slot in the flat per-material geometry array, creating it on first use
+    size_t resolveMaterial(std::string_view name, std::vector<ObjMaterialGeometry>& geometry,
+        std::unordered_map<std::string, size_t>& materialSlots) {
+        std::string key = name.empty() ? "default" : std::string(name);
+        auto inserted = materialSlots.emplace(key, geometry.size());
+        if (inserted.second) {
+            geometry.emplace_back();
+            geometry.back().name = key;
+        }
+        return inserted.first->second;
+    }
+}
+
+std::vector<TextureRef> FastObjLoader::textureRefsForMaterial(const std::string& materialName) const {
+    std::vector<TextureRef> refs;
 
     // Find the material
-    ObjMaterial* mat = nullptr;
+    const ObjMaterial* mat = nullptr;
     for (auto& material : materials) {
         if (material.name == materialName) {
             mat = &material;
@@ -35,42 +128,38 @@ std::vector<Texture> FastObjLoader::loadTexturesForMaterial(const std::string& m
     }
 
     if (!mat) {
-        return textures; // Return empty if material not found
+        return refs; // Return empty if material not found
     }
 
-    // Load diffuse texture
-    if (!mat->diffuseTexture.empty()) {
-        Texture texture;
-        texture.id = TextureFromFile(mat->diffuseTexture, directory);
-        texture.type = "texture_diffuse";
-        texture.path = mat->diffuseTexture;
-        if (texture.id != 0) {
-            textures.push_back(texture);
-            std::cout << "Loaded diffuse texture: " << mat->diffuseTexture << std::endl;
+    auto addRef = [&](const std::string& file, const char* type) {
+        if (!file.empty()) {
+            TextureRef ref;
+            ref.type = type;
+            ref.path = directory.empty() ? file : directory + "/" + file;
+            refs.push_back(ref);
         }
-    }
+    };
 
-    // Load normal texture
-    if (!mat->normalTexture.empty()) {
-        Texture texture;
-        texture.id = TextureFromFile(mat->normalTexture, directory);
-        texture.type = "texture_normal";
-        texture.path = mat->normalTexture;
-        if (texture.id != 0) {
-            textures.push_back(texture);
-            std::cout << "Loaded normal texture: " << mat->normalTexture << std::endl;
-        }
-    }
+    addRef(mat->diffuseTexture, "texture_diffuse");
+    addRef(mat->normalTexture, "texture_normal");
+    addRef(mat->specularTexture, "texture_specular");
+
+    return refs;
+}
+
+std::vector<Texture> FastObjLoader::loadTexturesForMaterial(const std::string& materialName) {
+    return uploadTextures(textureRefsForMaterial(materialName));
+}
 
-    // Load specular texture
-    if (!mat->specularTexture.empty()) {
-        Texture texture;
-        texture.id = TextureFromFile(mat->specularTexture, directory);
-        texture.type = "texture_specular";
-        texture.path = mat->specularTexture;
-        if (texture.id != 0) {
-            textures.push_back(texture);
-            std::cout << "Loaded specular texture: " << mat->specularTexture << std::endl;
+std::vector<Texture> FastObjLoader::uploadTextures(const std::vector<TextureRef>& refs) {
+    std::vector<Texture> textures;
+
+    for (const auto& ref : refs) {
+        TextureCache::Handle texture = TextureFromFile(ref.path, "", TextureCompression::RoleForType(ref.type));
+        if (texture) {
+            textures.push_back({ texture->Get(), ref.type, ref.path });
+            textureHandles.push_back(std::move(texture));
+            std::cout << "Loaded " << ref.type << ": " << ref.path << std::endl;
         }
     }
 
@@ -80,6 +169,27 @@ std::vector<Texture> FastObjLoader::loadTexturesForMaterial(const std::string& m
 std::vector<Mesh> FastObjLoader::LoadOBJ(const std::string& objPath, const std::string& mtlPath) {
     auto start = std::chrono::high_resolution_clock::now();
 
+    if (!Parse(objPath, mtlPath)) {
+        return {};
+    }
+
+    std::vector<Mesh> meshes = CreateMeshes();
+
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+    std::cout << "Fast OBJ loading completed in " << duration.count() << "ms" << std::endl;
+    std::cout << "Created " << meshes.size() << " mesh(es)" << std::endl;
+
+    if (progressCallback) {
+        progressCallback(1.0f);
+    }
+
+    return meshes;
+}
+
+bool FastObjLoader::Parse(const std::string& objPath, const std::string& mtlPath) {
+    EndStream();
     clear();
 
     // Load materials if MTL file is provided
@@ -88,10 +198,126 @@ std::vector<Mesh> FastObjLoader::LoadOBJ(const std::string& objPath, const std::
         std::cout << "Loaded " << materials.size() << " materials from MTL file" << std::endl;
     }
 
+    directory = directoryOf(objPath);
+
+    bool parsed = false;
+    if (parseMode != ObjParseMode::Buffered) {
+        MappedFile file;
+        if (file.Open(objPath)) {
+            if (parseMode == ObjParseMode::Parallel) {
+                parseParallel(file, objPath);
+            }
+            else {
+                parseMapped(file, objPath);
+            }
+            parsed = true;
+        }
+        else {
+            std::cout << "Memory mapping unavailable, falling back to buffered OBJ parsing" << std::endl;
+        }
+    }
+
+    if (!parsed && !parseBuffered(objPath)) {
+        clear();
+        return false;
+    }
+
+    if (isCancelled()) {
+        std::cout << "OBJ parsing cancelled: " << objPath << std::endl;
+        clear();
+        return false;
+    }
+
+    generateVertexFrames();
+
+    // Vertices are built, the attribute arrays and dedup tables are no longer needed
+    positions.clear();
+    texCoords.clear();
+    normals.clear();
+    for (auto& geometry : materialGeometry) {
+        geometry.vertexCache.Release();
+    }
+
+    if (progressCallback) {
+        progressCallback(0.9f);
+    }
+    return true;
+}
+
+// OBJ has no tangents, so every material with UVs gets them; normals are generated only when the file has none
+void FastObjLoader::generateVertexFrames() {
+    bool generateNormals = normals.empty();
+    bool generateTangents = !texCoords.empty();
+    if (!generateNormals && !generateTangents) {
+        return;
+    }
+
+    ThreadPool::Shared().ParallelFor(materialGeometry.size(), [&](size_t i) {
+        ObjMaterialGeometry& geometry = materialGeometry[i];
+        if (generateNormals) {
+            MeshProcessing::GenerateNormals(geometry.vertices, geometry.indices);
+        }
+        if (generateTangents) {
+            MeshProcessing::GenerateTangents(geometry.vertices, geometry.indices);
+        }
+    });
+}
+
+std::vector<Mesh> FastObjLoader::CreateMeshes() {
+    std::vector<Mesh> meshes;
+
+    std::vector<MeshData> meshData = TakeMeshData();
+    meshes.reserve(meshData.size());
+
+    for (auto& data : meshData) {
+        // The geometry moves into the mesh, which keeps it as its CPU copy
+        meshes.emplace_back(std::move(data.vertices), std::move(data.indices), uploadTextures(data.textures), std::move(data.materialProps));
+        data = MeshData();
+    }
+
+    return meshes;
+}
+
+std::vector<MeshData> FastObjLoader::TakeMeshData() {
+    std::vector<MeshData> meshData;
+
+    // Meshes are emitted in material-name order
+    std::vector<size_t> meshOrder(materialGeometry.size());
+    for (size_t i = 0; i < meshOrder.size(); i++) {
+        meshOrder[i] = i;
+    }
+    std::sort(meshOrder.begin(), meshOrder.end(), [&](size_t a, size_t b) {
+        return materialGeometry[a].name < materialGeometry[b].name;
+    });
+
+    for (size_t slot : meshOrder) {
+        ObjMaterialGeometry& geometry = materialGeometry[slot];
+
+        if (!geometry.vertices.empty() && !geometry.indices.empty()) {
+            MeshData data;
+            data.vertices.swap(geometry.vertices);
+            data.indices.swap(geometry.indices);
+            data.textures = textureRefsForMaterial(geometry.name);
+            data.materialProps.name = geometry.name;
+            std::cout << "Created mesh for material '" << geometry.name << "' with " << data.vertices.size() << " vertices" << std::endl;
+            meshData.push_back(std::move(data));
+        }
+        else {
+            std::vector<Vertex>().swap(geometry.vertices);
+            std::vector<unsigned int>().swap(geometry.indices);
+        }
+    }
+
+    clear();
+    return meshData;
+}
+
+bool FastObjLoader::parseBuffered(const std::string& objPath) {
+
     std::ifstream file(objPath);
     if (!file.is_open()) {
         std::cerr << "Failed to open OBJ file: " << objPath << std::endl;
-        return {};
+        return false;
     }
 
     // Get file size for progress tracking
@@ -103,8 +329,6 @@ std::vector<Mesh> FastObjLoader::LoadOBJ(const std::string& objPath, const std::
     positions.reserve(fileSize / 50);
     texCoords.reserve(fileSize / 60);
     normals.reserve(fileSize / 50);
-    vertices.reserve(fileSize / 40);
-    indices.reserve(fileSize / 15);
 
     std::cout << "Loading OBJ file: " << objPath << " (" << (fileSize / (1024 * 1024)) << " MB)" << std::endl;
 
@@ -112,12 +336,10 @@ std::vector<Mesh> FastObjLoader::LoadOBJ(const std::string& objPath, const std::
     size_t lineNumber = 0;
     size_t processedBytes = 0;
     std::string currentMaterial = "";
-    std::vector<Mesh> meshes;
 
-    // Track per-material geometry
-    std::map<std::string, std::vector<Vertex>> materialVertices;
-    std::map<std::string, std::vector<unsigned int>> materialIndices;
-    std::map<std::string, std::unordered_map<std::string, unsigned int>> materialVertexCache;
+    std::unordered_map<std::string, size_t> materialSlots;
+    size_t currentSlot = SIZE_MAX;
+    std::vector<unsigned int> faceIndices;
 
     while (std::getline(file, line)) {
         lineNumber++;
@@ -125,6 +347,9 @@ std::vector<Mesh> FastObjLoader::LoadOBJ(const std::string& objPath, const std::
 
         // Update progress every 10000 lines
         if (lineNumber % 10000 == 0) {
+            if (isCancelled()) {
+                return false;
+            }
             float progress = (float)processedBytes / (float)fileSize;
             if (progressCallback) {
                 progressCallback(progress * 0.8f);
@@ -138,173 +363,625 @@ std::vector<Mesh> FastObjLoader::LoadOBJ(const std::string& objPath, const std::
             std::istringstream iss(line);
             std::string command;
             iss >> command >> currentMaterial;
+            currentSlot = SIZE_MAX;
             std::cout << "Using material: " << currentMaterial << std::endl;
             continue;
         }
 
         // Parse geometry with current material context
         if (line[0] == 'f' && line[1] == ' ') {
-            parseFaceWithMaterial(line, currentMaterial, materialVertices, materialIndices, materialVertexCache);
+            if (currentSlot == SIZE_MAX) {
+                currentSlot = resolveMaterial(currentMaterial, materialGeometry, materialSlots);
+            }
+            parseFaceWithMaterial(line.data() + 2, line.data() + line.size(), materialGeometry[currentSlot], faceIndices);
         }
         else {
-            parseLine(line, lineNumber, fileSize);
+            parseLine(line);
         }
     }
 
     file.close();
+    return true;
+}
 
-    if (progressCallback) {
-        progressCallback(0.9f);
+
+void FastObjLoader::parseMapped(const MappedFile& file, const std::string& objPath) {
+
+    const char* data = file.Data();
+    const size_t fileSize = file.Size();
+    const char* end = data + fileSize;
+
+    // Reserve memory (rough estimates)
+    positions.reserve(fileSize / 50);
+    texCoords.reserve(fileSize / 60);
+    normals.reserve(fileSize / 50);
+
+    std::cout << "Loading OBJ file (memory-mapped): " << objPath << " (" << (fileSize / (1024 * 1024)) << " MB)" << std::endl;
+
+    ObjMappedParseState state;
+    state.begin = data;
+    state.cursor = data;
+    state.end = end;
+
+    parseMappedLines(state, end);
+}
+
+// Parses whole lines until the cursor reaches stopAt (or the end of the file) and records where it stopped
+bool FastObjLoader::parseMappedLines(ObjMappedParseState& state, const char* stopAt) {
+    const char* cursor = state.cursor;
+    const char* end = state.end;
+    const size_t fileSize = static_cast<size_t>(state.end - state.begin);
+
+    while (cursor < end && cursor < stopAt) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+
+        state.lineNumber++;
+
+        // Update progress every 10000 lines
+        if (state.lineNumber % 10000 == 0) {
+            if (isCancelled()) {
+                break;
+            }
+            if (progressCallback) {
+                float progress = (float)(cursor - state.begin) / (float)fileSize;
+                progressCallback(progress * 0.8f);
+            }
+        }
+
+        const char* p = skipBlanks(cursor, lineEnd);
+        cursor = lineEnd + 1;
+
+        if (p >= lineEnd || *p == '#') continue;
+
+        switch (*p) {
+        case 'v':
+            if (p + 1 < lineEnd && isBlank(p[1])) {
+                // Vertex position
+                float x, y, z;
+                p += 2;
+                if (parseFloatToken(p, lineEnd, x) && parseFloatToken(p, lineEnd, y) && parseFloatToken(p, lineEnd, z)) {
+                    positions.emplace_back(x, y, z);
+                }
+            }
+            else if (p + 2 < lineEnd && p[1] == 't' && isBlank(p[2])) {
+                // Texture coordinate
+                float u, v;
+                p += 3;
+                if (parseFloatToken(p, lineEnd, u) && parseFloatToken(p, lineEnd, v)) {
+                    texCoords.emplace_back(u, 1.0f - v);
+                }
+            }
+            else if (p + 2 < lineEnd && p[1] == 'n' && isBlank(p[2])) {
+                // Normal
+                float x, y, z;
+                p += 3;
+                if (parseFloatToken(p, lineEnd, x) && parseFloatToken(p, lineEnd, y) && parseFloatToken(p, lineEnd, z)) {
+                    normals.emplace_back(x, y, z);
+                }
+            }
+            break;
+
+        case 'f':
+            if (p + 1 < lineEnd && isBlank(p[1])) {
+                if (state.currentSlot == SIZE_MAX) {
+                    state.currentSlot = resolveMaterial(state.currentMaterial, materialGeometry, state.materialSlots);
+                }
+                parseFaceWithMaterial(p + 2, lineEnd, materialGeometry[state.currentSlot], state.faceIndices);
+            }
+            break;
+
+        case 'u':
+            if (startsWithKeyword(p, lineEnd, "usemtl", 6)) {
+                const char* nameStart = skipBlanks(p + 6, lineEnd);
+                state.currentMaterial = std::string_view(nameStart, skipToken(nameStart, lineEnd) - nameStart);
+                state.currentSlot = SIZE_MAX;
+                std::cout << "Using material: " << state.currentMaterial << std::endl;
+            }
+            break;
+        }
     }
 
-    // Create meshes for each material
-    std::string directory = objPath.substr(0, objPath.find_last_of('/'));
-    if (directory == objPath) directory = objPath.substr(0, objPath.find_last_of('\\'));
-    if (directory == objPath) directory = "";
+    state.cursor = cursor;
+    return cursor < end;
+}
 
-    for (const auto& materialPair : materialVertices) {
-        const std::string& matName = materialPair.first;
-        const std::vector<Vertex>& verts = materialPair.second;
-        const auto& indicesIt = materialIndices.find(matName);
+namespace {
+    struct ObjMaterialSwitch {
+        size_t firstFace;
+        std::string_view name;
+    };
+
+    // Distinct corner of a chunk, one vertex per corner per material
+    struct ObjLocalVertex {
+        unsigned int material;
+        ObjCorner corner;
+    };
+
+    // Everything one worker extracts from its slice of the file, plus its share of the merge state
+    struct ObjChunk {
+        const char* begin = nullptr;
+        const char* end = nullptr;
+
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec2> texCoords;
+        std::vector<glm::vec3> normals;
+        std::vector<ObjCorner> corners;
+        std::vector<unsigned int> faceSizes;
+        std::vector<ObjMaterialSwitch> materialSwitches;
+
+        std::vector<unsigned int> faceMaterials;    // material id of every face
+        std::vector<unsigned int> cornerVertices;   // chunk-local, later material-local, vertex of every corner
+        std::vector<ObjLocalVertex> localVertices;  // distinct corners of this chunk in first-use order
+        std::vector<unsigned int> localToGlobal;
+        std::vector<size_t> triangleCounts;         // per material
+        std::vector<size_t> triangleOffsets;        // per material, into the merged index array
+    };
+
+    void parseObjChunk(ObjChunk& chunk, std::atomic<size_t>& parsedBytes, const std::function<void()>& onProgress) {
+        const char* cursor = chunk.begin;
+        const char* lastReported = cursor;
+        size_t lineNumber = 0;
+
+        while (cursor < chunk.end) {
+            const char* lineEnd = static_cast<const char*>(std::memchr(cursor, '\n', chunk.end - cursor));
+            if (!lineEnd) {
+                lineEnd = chunk.end;
+            }
 
-        if (indicesIt != materialIndices.end()) {
-            const std::vector<unsigned int>& inds = indicesIt->second;
+            if (++lineNumber % 10000 == 0) {
+                parsedBytes += static_cast<size_t>(cursor - lastReported);
+                lastReported = cursor;
+                onProgress();
+            }
 
-            if (!verts.empty() && !inds.empty()) {
-                std::vector<Texture> textures = loadTexturesForMaterial(matName, directory);
-                meshes.emplace_back(verts, inds, textures);
-                std::cout << "Created mesh for material '" << matName << "' with " << verts.size() << " vertices" << std::endl;
+            const char* p = skipBlanks(cursor, lineEnd);
+            cursor = lineEnd + 1;
+
+            if (p >= lineEnd || *p == '#') continue;
+
+            switch (*p) {
+            case 'v':
+                if (p + 1 < lineEnd && isBlank(p[1])) {
+                    float x, y, z;
+                    p += 2;
+                    if (parseFloatToken(p, lineEnd, x) && parseFloatToken(p, lineEnd, y) && parseFloatToken(p, lineEnd, z)) {
+                        chunk.positions.emplace_back(x, y, z);
+                    }
+                }
+                else if (p + 2 < lineEnd && p[1] == 't' && isBlank(p[2])) {
+                    float u, v;
+                    p += 3;
+                    if (parseFloatToken(p, lineEnd, u) && parseFloatToken(p, lineEnd, v)) {
+                        chunk.texCoords.emplace_back(u, 1.0f - v);
+                    }
+                }
+                else if (p + 2 < lineEnd && p[1] == 'n' && isBlank(p[2])) {
+                    float x, y, z;
+                    p += 3;
+                    if (parseFloatToken(p, lineEnd, x) && parseFloatToken(p, lineEnd, y) && parseFloatToken(p, lineEnd, z)) {
+                        chunk.normals.emplace_back(x, y, z);
+                    }
+                }
+                break;
+
+            case 'f':
+                if (p + 1 < lineEnd && isBlank(p[1])) {
+                    unsigned int cornerCount = 0;
+                    p += 2;
+                    while (true) {
+                        p = skipBlanks(p, lineEnd);
+                        if (p >= lineEnd) break;
+
+                        chunk.corners.push_back(parseCorner(p, lineEnd));
+                        p = skipToken(p, lineEnd);
+
+                        cornerCount++;
+                    }
+                    chunk.faceSizes.push_back(cornerCount);
+                }
+                break;
+
+            case 'u':
+                if (startsWithKeyword(p, lineEnd, "usemtl", 6)) {
+                    const char* nameStart = skipBlanks(p + 6, lineEnd);
+                    std::string_view name(nameStart, skipToken(nameStart, lineEnd) - nameStart);
+                    chunk.materialSwitches.push_back({ chunk.faceSizes.size(), name });
+                }
+                break;
             }
         }
+
+        parsedBytes += static_cast<size_t>(chunk.end - lastReported);
     }
+}
+
+void FastObjLoader::parseParallel(const MappedFile& file, const std::string& objPath) {
+
+    const size_t workerCount = ThreadPool::ResolveThreadCount(threadCount);
+    const size_t minChunkBytes = 4 * 1024 * 1024;
 
-    // If no materials were used, create a single mesh with all geometry
-    if (materialVertices.empty() && !vertices.empty() && !indices.empty()) {
-        std::vector<Texture> textures;
-        meshes.emplace_back(vertices, indices, textures);
-        std::cout << "Created single mesh without materials" << std::endl;
+    // Small files or a single worker gain nothing from the split/merge
+    if (workerCount <= 1 || file.Size() < 2 * minChunkBytes) {
+        parseMapped(file, objPath);
+        return;
     }
 
-    auto end = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    const char* data = file.Data();
+    const size_t fileSize = file.Size();
+    const char* fileEnd = data + fileSize;
 
-    std::cout << "Fast OBJ loading completed in " << duration.count() << "ms" << std::endl;
-    std::cout << "Created " << meshes.size() << " mesh(es)" << std::endl;
+    std::cout << "Loading OBJ file (parallel, " << workerCount << " threads): " << objPath
+        << " (" << (fileSize / (1024 * 1024)) << " MB)" << std::endl;
+
+    // Several chunks per worker so uneven line density still balances out
+    size_t chunkCount = std::min(workerCount * 4, std::max<size_t>(1, fileSize / minChunkBytes));
+    std::vector<ObjChunk> chunks(chunkCount);
+
+    const char* chunkStart = data;
+    for (size_t i = 0; i < chunkCount; i++) {
+        const char* chunkEnd = (i + 1 == chunkCount) ? fileEnd : data + fileSize / chunkCount * (i + 1);
+        if (chunkEnd < chunkStart) {
+            chunkEnd = chunkStart;
+        }
+        // Align every boundary to the start of a line
+        if (chunkEnd < fileEnd) {
+            const char* newline = static_cast<const char*>(std::memchr(chunkEnd, '\n', fileEnd - chunkEnd));
+            chunkEnd = newline ? newline + 1 : fileEnd;
+        }
+        chunks[i].begin = chunkStart;
+        chunks[i].end = chunkEnd;
+        chunkStart = chunkEnd;
+    }
+
+    ThreadPool& pool = ThreadPool::Shared();
+    const std::thread::id callerThread = std::this_thread::get_id();
+
+    // Parse: each worker fills its own chunk buffers, only the calling thread reports progress
+    std::atomic<size_t> parsedBytes{ 0 };
+    std::function<void()> reportProgress = [&]() {
+        if (progressCallback && std::this_thread::get_id() == callerThread) {
+            progressCallback((float)parsedBytes.load() / (float)fileSize * 0.6f);
+        }
+    };
+
+    pool.ParallelFor(chunkCount, [&](size_t i) {
+        if (!isCancelled()) {
+            parseObjChunk(chunks[i], parsedBytes, reportProgress);
+        }
+    }, workerCount);
+
+    if (isCancelled()) {
+        return;
+    }
+
+    // Rebuild the global attribute index spaces in file order
+    size_t totalPositions = 0, totalTexCoords = 0, totalNormals = 0;
+    std::vector<size_t> positionOffsets(chunkCount), texCoordOffsets(chunkCount), normalOffsets(chunkCount);
+    for (size_t i = 0; i < chunkCount; i++) {
+        positionOffsets[i] = totalPositions;
+        texCoordOffsets[i] = totalTexCoords;
+        normalOffsets[i] = totalNormals;
+        totalPositions += chunks[i].positions.size();
+        totalTexCoords += chunks[i].texCoords.size();
+        totalNormals += chunks[i].normals.size();
+    }
+
+    positions.resize(totalPositions);
+    texCoords.resize(totalTexCoords);
+    normals.resize(totalNormals);
+
+    pool.ParallelFor(chunkCount, [&](size_t i) {
+        ObjChunk& chunk = chunks[i];
+        std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + positionOffsets[i]);
+        std::copy(chunk.texCoords.begin(), chunk.texCoords.end(), texCoords.begin() + texCoordOffsets[i]);
+        std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + normalOffsets[i]);
+        std::vector<glm::vec3>().swap(chunk.positions);
+        std::vector<glm::vec2>().swap(chunk.texCoords);
+        std::vector<glm::vec3>().swap(chunk.normals);
+    }, workerCount);
+
+    // Resolve usemtl across chunk boundaries; ids are handed out in order of first face, like the serial path
+    std::unordered_map<std::string, size_t> materialSlots;
+    std::string currentMaterial;
+
+    for (auto& chunk : chunks) {
+        chunk.faceMaterials.resize(chunk.faceSizes.size());
+
+        size_t face = 0;
+        size_t nextSwitch = 0;
+        while (face < chunk.faceSizes.size() || nextSwitch < chunk.materialSwitches.size()) {
+            while (nextSwitch < chunk.materialSwitches.size() && chunk.materialSwitches[nextSwitch].firstFace == face) {
+                currentMaterial = std::string(chunk.materialSwitches[nextSwitch].name);
+                std::cout << "Using material: " << currentMaterial << std::endl;
+                nextSwitch++;
+            }
+
+            size_t runEnd = nextSwitch < chunk.materialSwitches.size() ? chunk.materialSwitches[nextSwitch].firstFace : chunk.faceSizes.size();
+            if (face < runEnd) {
+                unsigned int material = static_cast<unsigned int>(resolveMaterial(currentMaterial, materialGeometry, materialSlots));
+                std::fill(chunk.faceMaterials.begin() + face, chunk.faceMaterials.begin() + runEnd, material);
+                face = runEnd;
+            }
+        }
+    }
+
+    const size_t materialCount = materialGeometry.size();
 
     if (progressCallback) {
-        progressCallback(1.0f);
+        progressCallback(0.65f);
     }
 
-    return meshes;
+    // Dedup inside each chunk first, in parallel, keeping first-use order
+    pool.ParallelFor(chunkCount, [&](size_t i) {
+        ObjChunk& chunk = chunks[i];
+        std::vector<VertexCache> localCaches(materialCount);
+        chunk.cornerVertices.resize(chunk.corners.size());
+
+        size_t corner = 0;
+        for (size_t f = 0; f < chunk.faceSizes.size(); f++) {
+            unsigned int material = chunk.faceMaterials[f];
+            VertexCache& localCache = localCaches[material];
+            for (unsigned int c = 0; c < chunk.faceSizes[f]; c++, corner++) {
+                const ObjCorner& key = chunk.corners[corner];
+                unsigned int candidate = static_cast<unsigned int>(chunk.localVertices.size());
+                unsigned int index = localCache.FindOrInsert(key.position, key.texCoord, key.normal, candidate);
+                if (index == candidate) {
+                    chunk.localVertices.push_back({ material, key });
+                }
+                chunk.cornerVertices[corner] = index;
+            }
+        }
+        std::vector<ObjCorner>().swap(chunk.corners);
+    }, workerCount);
+
+    // Serial pass over the (much smaller) per-chunk distinct sets fixes the global vertex order
+    std::vector<std::vector<ObjCorner>> materialCorners(materialCount);
+
+    for (auto& chunk : chunks) {
+        chunk.localToGlobal.resize(chunk.localVertices.size());
+        for (size_t j = 0; j < chunk.localVertices.size(); j++) {
+            const ObjLocalVertex& local = chunk.localVertices[j];
+            auto& corners = materialCorners[local.material];
+            unsigned int candidate = static_cast<unsigned int>(corners.size());
+            unsigned int index = materialGeometry[local.material].vertexCache.FindOrInsert(
+                local.corner.position, local.corner.texCoord, local.corner.normal, candidate);
+            if (index == candidate) {
+                corners.push_back(local.corner);
+            }
+            chunk.localToGlobal[j] = index;
+        }
+        std::vector<ObjLocalVertex>().swap(chunk.localVertices);
+    }
+    for (auto& geometry : materialGeometry) {
+        geometry.vertexCache.Release();
+    }
+
+    if (progressCallback) {
+        progressCallback(0.75f);
+    }
+
+    // Remap corners and count triangles per material
+    pool.ParallelFor(chunkCount, [&](size_t i) {
+        ObjChunk& chunk = chunks[i];
+        for (auto& vertex : chunk.cornerVertices) {
+            vertex = chunk.localToGlobal[vertex];
+        }
+        std::vector<unsigned int>().swap(chunk.localToGlobal);
+
+        chunk.triangleCounts.assign(materialCount, 0);
+        for (size_t f = 0; f < chunk.faceSizes.size(); f++) {
+            if (chunk.faceSizes[f] >= 3) {
+                chunk.triangleCounts[chunk.faceMaterials[f]] += chunk.faceSizes[f] - 2;
+            }
+        }
+    }, workerCount);
+
+    std::vector<size_t> materialTriangles(materialCount, 0);
+    for (auto& chunk : chunks) {
+        chunk.triangleOffsets.resize(materialCount);
+        for (size_t m = 0; m < materialCount; m++) {
+            chunk.triangleOffsets[m] = materialTriangles[m];
+            materialTriangles[m] += chunk.triangleCounts[m];
+        }
+    }
+
+    for (size_t m = 0; m < materialCount; m++) {
+        materialGeometry[m].indices.resize(materialTriangles[m] * 3);
+        materialGeometry[m].vertices.resize(materialCorners[m].size());
+    }
+
+    // Fan-triangulate every chunk straight into its slice of the per-material index arrays
+    pool.ParallelFor(chunkCount, [&](size_t i) {
+        ObjChunk& chunk = chunks[i];
+        std::vector<size_t> cursor = chunk.triangleOffsets;
+        size_t corner = 0;
+        for (size_t f = 0; f < chunk.faceSizes.size(); f++) {
+            unsigned int size = chunk.faceSizes[f];
+            unsigned int material = chunk.faceMaterials[f];
+            unsigned int* out = materialGeometry[material].indices.data();
+            for (unsigned int c = 1; c + 1 < size; c++) {
+                size_t t = cursor[material]++ * 3;
+                out[t] = chunk.cornerVertices[corner];
+                out[t + 1] = chunk.cornerVertices[corner + c];
+                out[t + 2] = chunk.cornerVertices[corner + c + 1];
+            }
+            corner += size;
+        }
+    }, workerCount);
+    chunks.clear();
+
+    // Build the final vertices from the merged attribute arrays
+    const size_t vertexBlock = 65536;
+    for (size_t m = 0; m < materialCount; m++) {
+        const auto& corners = materialCorners[m];
+        Vertex* out = materialGeometry[m].vertices.data();
+        size_t blocks = (corners.size() + vertexBlock - 1) / vertexBlock;
+        pool.ParallelFor(blocks, [&](size_t b) {
+            size_t first = b * vertexBlock;
+            size_t last = std::min(first + vertexBlock, corners.size());
+            for (size_t v = first; v < last; v++) {
+                out[v] = buildVertex(corners[v].position, corners[v].texCoord, corners[v].normal);
+            }
+        }, workerCount);
+    }
+
+    if (progressCallback) {
+        progressCallback(0.8f);
+    }
+}
+
+bool FastObjLoader::BeginStream(const std::string& objPath, const std::string& mtlPath) {
+    EndStream();
+    clear();
+
+    if (!mtlPath.empty()) {
+        materials = LoadMTL(mtlPath);
+        std::cout << "Loaded " << materials.size() << " materials from MTL file" << std::endl;
+    }
+
+    if (!streamFile.Open(objPath)) {
+        std::cerr << "Failed to open OBJ file for streaming: " << objPath << std::endl;
+        return false;
+    }
+
+    streamState.begin = streamFile.Data();
+    streamState.cursor = streamFile.Data();
+    streamState.end = streamFile.Data() + streamFile.Size();
+    directory = directoryOf(objPath);
+
+    positions.reserve(streamFile.Size() / 50);
+    texCoords.reserve(streamFile.Size() / 60);
+    normals.reserve(streamFile.Size() / 50);
+
+    std::cout << "Streaming OBJ file: " << objPath << " (" << (streamFile.Size() / (1024 * 1024)) << " MB)" << std::endl;
+    return true;
 }
 
-void FastObjLoader::parseLine(const std::string& line, size_t lineNumber, size_t totalLines) {
+bool FastObjLoader::StreamNext(size_t byteBudget, std::vector<ObjStreamBatch>& batches) {
+    batches.clear();
+    if (!streamFile.IsOpen()) {
+        return false;
+    }
+
+    size_t remaining = static_cast<size_t>(streamState.end - streamState.cursor);
+    const char* stopAt = streamState.cursor + std::min(byteBudget, remaining);
+    bool more = parseMappedLines(streamState, stopAt);
+
+    // Hand out everything produced since the last call; vertexBase keeps the cache indices valid
+    for (size_t slot = 0; slot < materialGeometry.size(); slot++) {
+        ObjMaterialGeometry& geometry = materialGeometry[slot];
+        if (geometry.vertices.empty() && geometry.indices.empty()) {
+            continue;
+        }
+
+        ObjStreamBatch batch;
+        batch.material = slot;
+        batch.vertices.swap(geometry.vertices);
+        batch.indices.swap(geometry.indices);
+        geometry.vertexBase += static_cast<unsigned int>(batch.vertices.size());
+        batches.push_back(std::move(batch));
+    }
+
+    if (!more) {
+        for (auto& geometry : materialGeometry) {
+            geometry.vertexCache.Release();
+        }
+    }
+    return more;
+}
+
+const std::string& FastObjLoader::GetStreamMaterialName(size_t material) const {
+    return materialGeometry[material].name;
+}
+
+std::vector<Texture> FastObjLoader::LoadStreamTextures(size_t material) {
+    return loadTexturesForMaterial(materialGeometry[material].name);
+}
+
+std::vector<TextureRef> FastObjLoader::GetStreamTextureRefs(size_t material) const {
+    return textureRefsForMaterial(materialGeometry[material].name);
+}
+
+float FastObjLoader::GetStreamProgress() const {
+    if (!streamFile.IsOpen() || streamState.end == streamState.begin) {
+        return 1.0f;
+    }
+    return (float)(streamState.cursor - streamState.begin) / (float)(streamState.end - streamState.begin);
+}
+
+void FastObjLoader::EndStream() {
+    if (!streamFile.IsOpen()) {
+        return;
+    }
+    streamFile.Close();
+    streamState = ObjMappedParseState();
+    clear();
+}
+
+void FastObjLoader::parseLine(const std::string& line) {
     if (line.length() < 2) return;
 
     const char* data = line.c_str();
+    const char* end = data + line.length();
+    float values[3];
 
     switch (data[0]) {
     case 'v':
         if (data[1] == ' ') {
             // Vertex position
-            float x, y, z;
-            if (sscanf_s(data + 2, "%f %f %f", &x, &y, &z) == 3) {
-                positions.emplace_back(x, y, z);
+            if (NumberParser::ParseFloats(data + 2, end, values, 3) == 3) {
+                positions.emplace_back(values[0], values[1], values[2]);
             }
         }
         else if (data[1] == 't' && data[2] == ' ') {
             // Texture coordinate
-            float u, v;
-            if (sscanf_s(data + 3, "%f %f", &u, &v) >= 2) {
-                texCoords.emplace_back(u, 1.0f - v);
+            if (NumberParser::ParseFloats(data + 3, end, values, 2) == 2) {
+                texCoords.emplace_back(values[0], 1.0f - values[1]);
             }
         }
         else if (data[1] == 'n' && data[2] == ' ') {
             // Normal
-            float x, y, z;
-            if (sscanf_s(data + 3, "%f %f %f", &x, &y, &z) == 3) {
-                normals.emplace_back(x, y, z);
+            if (NumberParser::ParseFloats(data + 3, end, values, 3) == 3) {
+                normals.emplace_back(values[0], values[1], values[2]);
             }
         }
         break;
-
-    case 'f':
-        if (data[1] == ' ') {
-            parseFace(line);
-        }
-        break;
     }
 }
 
-void FastObjLoader::parseFace(const std::string& line) {
-    static std::unordered_map<std::string, unsigned int> vertexCache;
+void FastObjLoader::parseFaceWithMaterial(const char* cursor, const char* lineEnd,
+    ObjMaterialGeometry& geometry, std::vector<unsigned int>& faceIndices) {
 
-    std::istringstream iss(line.substr(2)); // Skip "f "
-    std::string vertexStr;
-    std::vector<unsigned int> faceIndices;
+    faceIndices.clear();
 
-    while (iss >> vertexStr) {
-        // Check cache first
-        auto it = vertexCache.find(vertexStr);
-        if (it != vertexCache.end()) {
-            faceIndices.push_back(it->second);
-        }
-        else {
-            // Create new vertex
-            Vertex vertex = getVertex(vertexStr);
-            unsigned int index = vertices.size();
-            vertices.push_back(vertex);
-            vertexCache[vertexStr] = index;
-            faceIndices.push_back(index);
-        }
-    }
+    while (true) {
+        cursor = skipBlanks(cursor, lineEnd);
+        if (cursor >= lineEnd) break;
 
-    for (size_t i = 1; i < faceIndices.size() - 1; i++) {
-        indices.push_back(faceIndices[0]);
-        indices.push_back(faceIndices[i]);
-        indices.push_back(faceIndices[i + 1]);
-    }
-}
-
-void FastObjLoader::parseFaceWithMaterial(const std::string& line, const std::string& material,
-    std::map<std::string, std::vector<Vertex>>& materialVertices,
-    std::map<std::string, std::vector<unsigned int>>& materialIndices,
-    std::map<std::string, std::unordered_map<std::string, unsigned int>>& materialVertexCache) {
-
-    std::string matKey = material.empty() ? "default" : material;
-    auto& vertexCache = materialVertexCache[matKey];
-    auto& verts = materialVertices[matKey];
-    auto& inds = materialIndices[matKey];
-
-    std::istringstream iss(line.substr(2)); 
-    std::string vertexStr;
-    std::vector<unsigned int> faceIndices;
+        ObjCorner corner = parseCorner(cursor, lineEnd);
+        cursor = skipToken(cursor, lineEnd);
 
-    while (iss >> vertexStr) {
-        // Check cache first
-        auto it = vertexCache.find(vertexStr);
-        if (it != vertexCache.end()) {
-            faceIndices.push_back(it->second);
-        }
-        else {
-            // Create new vertex
-            Vertex vertex = getVertex(vertexStr);
-            unsigned int index = static_cast<unsigned int>(verts.size());
-            verts.push_back(vertex);
-            vertexCache[vertexStr] = index;
-            faceIndices.push_back(index);
+        // Cache hit returns the existing vertex, a miss claims the next index
+        unsigned int candidate = geometry.vertexBase + static_cast<unsigned int>(geometry.vertices.size());
+        unsigned int index = geometry.vertexCache.FindOrInsert(corner.position, corner.texCoord, corner.normal, candidate);
+        if (index == candidate) {
+            geometry.vertices.push_back(buildVertex(corner.position, corner.texCoord, corner.normal));
         }
+        faceIndices.push_back(index);
     }
 
     // Triangulate face
-    for (size_t i = 1; i < faceIndices.size() - 1; i++) {
-        inds.push_back(faceIndices[0]);
-        inds.push_back(faceIndices[i]);
-        inds.push_back(faceIndices[i + 1]);
+    for (size_t i = 1; i + 1 < faceIndices.size(); i++) {
+        geometry.indices.push_back(faceIndices[0]);
+        geometry.indices.push_back(faceIndices[i]);
+        geometry.indices.push_back(faceIndices[i + 1]);
     }
 }
 
-Vertex FastObjLoader::getVertex(const std::string& vertexStr) {
+Vertex FastObjLoader::buildVertex(int posIndex, int texIndex, int normIndex) const {
     Vertex vertex;
 
     // Initialize defaults
@@ -314,38 +991,15 @@ Vertex FastObjLoader::getVertex(const std::string& vertexStr) {
     vertex.Tangent = glm::vec3(1.0f, 0.0f, 0.0f);
     vertex.Bitangent = glm::vec3(0.0f, 1.0f, 0.0f);
 
-    // Parse vertex string
-    int posIndex = -1, texIndex = -1, normIndex = -1;
-
-    const char* str = vertexStr.c_str();
-    char* endptr;
-
-    // Parse position index
-    posIndex = strtol(str, &endptr, 10);
+    // Indices are 1-based, anything out of range keeps the default
     if (posIndex > 0 && posIndex <= (int)positions.size()) {
         vertex.Position = positions[posIndex - 1];
     }
-
-    if (*endptr == '/') {
-        str = endptr + 1;
-
-        // Parse texture coordinate index
-        if (*str != '/') {
-            texIndex = strtol(str, &endptr, 10);
-            if (texIndex > 0 && texIndex <= (int)texCoords.size()) {
-                vertex.TexCoords = texCoords[texIndex - 1];
-            }
-        }
-
-        if (*endptr == '/') {
-            str = endptr + 1;
-
-            // Parse normal index
-            normIndex = strtol(str, &endptr, 10);
-            if (normIndex > 0 && normIndex <= (int)normals.size()) {
-                vertex.Normal = normals[normIndex - 1];
-            }
-        }
+    if (texIndex > 0 && texIndex <= (int)texCoords.size()) {
+        vertex.TexCoords = texCoords[texIndex - 1];
+    }
+    if (normIndex > 0 && normIndex <= (int)normals.size()) {
+        vertex.Normal = normals[normIndex - 1];
     }
 
     return vertex;
@@ -373,6 +1027,11 @@ std::vector<ObjMaterial> FastObjLoader::LoadMTL(const std::string& mtlPath) {
         std::string command;
         iss >> command;
 
+        // Numeric values go through the shared locale-independent parser
+        std::streamoff afterCommand = iss.tellg();
+        const char* values = afterCommand < 0 ? line.data() + line.size() : line.data() + afterCommand;
+        const char* lineEnd = line.data() + line.size();
+
         if (command == "newmtl") {
             if (hasMaterial) {
                 materials.push_back(currentMaterial);
@@ -385,32 +1044,32 @@ std::vector<ObjMaterial> FastObjLoader::LoadMTL(const std::string& mtlPath) {
         }
         // Standard MTL properties
         else if (command == "Ka") { // Ambient
-            iss >> currentMaterial.ambient.x >> currentMaterial.ambient.y >> currentMaterial.ambient.z;
+            NumberParser::ParseFloats(values, lineEnd, &currentMaterial.ambient[0], 3);
         }
         else if (command == "Kd") { // Diffuse
-            iss >> currentMaterial.diffuse.x >> currentMaterial.diffuse.y >> currentMaterial.diffuse.z;
+            NumberParser::ParseFloats(values, lineEnd, &currentMaterial.diffuse[0], 3);
         }
         else if (command == "Ks") { // Specular
-            iss >> currentMaterial.specular.x >> currentMaterial.specular.y >> currentMaterial.specular.z;
+            NumberParser::ParseFloats(values, lineEnd, &currentMaterial.specular[0], 3);
         }
         else if (command == "Ke") { // Emission
-            iss >> currentMaterial.emission.x >> currentMaterial.emission.y >> currentMaterial.emission.z;
+            NumberParser::ParseFloats(values, lineEnd, &currentMaterial.emission[0], 3);
         }
         else if (command == "Ns") { // Shininess
-            iss >> currentMaterial.shininess;
+            NumberParser::ParseFloats(values, lineEnd, &currentMaterial.shininess, 1);
         }
         else if (command == "d" || command == "Tr") { // Opacity
-            iss >> currentMaterial.opacity;
+            NumberParser::ParseFloats(values, lineEnd, &currentMaterial.opacity, 1);
         }
         else if (command == "Ni") { // Refraction index
-            iss >> currentMaterial.refraction;
+            NumberParser::ParseFloats(values, lineEnd, &currentMaterial.refraction, 1);
         }
         // PBR Extensions
         else if (command == "Pr") { // Roughness
-            iss >> currentMaterial.roughness;
+            NumberParser::ParseFloats(values, lineEnd, &currentMaterial.roughness, 1);
         }
         else if (command == "Pm") { // Metallic
-            iss >> currentMaterial.metallic;
+            NumberParser::ParseFloats(values, lineEnd, &currentMaterial.metallic, 1);
         }
         // Texture maps
         else if (command == "map_Kd") {
@@ -460,47 +1119,43 @@ std::vector<ObjMaterial> FastObjLoader::LoadMTL(const std::string& mtlPath) {
     return materials;
 }
 
-unsigned int FastObjLoader::TextureFromFile(const std::string& path, const std::string& directory) {
+TextureCache::Handle FastObjLoader::TextureFromFile(const std::string& path, const std::string& directory, TextureRole role) {
     std::string filename = directory.empty() ? path : directory + "/" + path;
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data) {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else {
+    TextureCache::Handle texture = TextureCache::Acquire(filename, role);
+    if (!texture) {
         std::cerr << "Texture failed to load at path: " << filename << std::endl;
-        stbi_image_free(data);
     }
-
-    return textureID;
+    return texture;
 }
 
 void FastObjLoader::clear() {
     positions.clear();
     texCoords.clear();
     normals.clear();
-    vertices.clear();
-    indices.clear();
     materials.clear();
+    materialGeometry.clear();
+    directory.clear();
+}
+
+void FastObjLoader::Release() {
+    EndStream();
+    clear();
+
+    std::vector<glm::vec3>().swap(positions);
+    std::vector<glm::vec2>().swap(texCoords);
+    std::vector<glm::vec3>().swap(normals);
+    std::vector<ObjMaterialGeometry>().swap(materialGeometry);
+}
+
+size_t FastObjLoader::GetScratchMemoryUsage() const {
+    size_t bytes = positions.capacity() * sizeof(glm::vec3) +
+        texCoords.capacity() * sizeof(glm::vec2) +
+        normals.capacity() * sizeof(glm::vec3);
+    for (const auto& geometry : materialGeometry) {
+        bytes += geometry.vertices.capacity() * sizeof(Vertex) +
+            geometry.indices.capacity() * sizeof(unsigned int) +
+            geometry.vertexCache.MemoryUsage();
+    }
+    return bytes;
 }
\ No newline at end of file
@@ -3,8 +3,14 @@
 #include <string>
 #include <glm/glm.hpp>
 #include "Mesh.h"
+#include "MappedFile.h"
+#include "VertexCache.h"
+#include "TextureCache.h"
 #include <functional>
-#include <map>
+#include <unordered_map>
+#include <string_view>
+#include <cstdint>
+#include <atomic>
 
 struct ObjMaterial {
     std::string name;
@@ -34,31 +40,129 @@ struct ObjMaterial {
     std::string opacityTexture;               // map_d
 };
 
+enum class ObjParseMode {
+    Buffered,       // std::getline over an ifstream, one std::string per line
+    MemoryMapped,   // zero-copy tokenizer over a read-only mapping of the file
+    Parallel        // mapped file split into line-aligned chunks, parsed on worker threads and merged in file order
+};
+
+// Parser settings an import applies before Parse()
+struct ObjParseOptions {
+    ObjParseMode mode = ObjParseMode::Parallel;
+    unsigned int threadCount = 0;   // ObjParseMode::Parallel workers, 0 = all hardware threads
+};
+
+// Geometry collected for one usemtl material while parsing; materials are kept in a flat
+// array indexed by id so the hot face loop never touches the material name
+struct ObjMaterialGeometry {
+    std::string name;
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    VertexCache vertexCache;
+    unsigned int vertexBase = 0;    // vertices already handed out by a stream, 'vertices' holds the rest
+};
+
+// Resumable position of the memory-mapped parser, so a file can be consumed across several calls
+struct ObjMappedParseState {
+    const char* begin = nullptr;
+    const char* cursor = nullptr;
+    const char* end = nullptr;
+    size_t lineNumber = 0;
+    std::unordered_map<std::string, size_t> materialSlots;
+    std::string_view currentMaterial;
+    size_t currentSlot = SIZE_MAX;
+    std::vector<unsigned int> faceIndices;
+};
+
+// Geometry one material gained during a streaming step. Indices address the material's whole
+// vertex list, so appending both to the previous batches reproduces a normal load exactly.
+struct ObjStreamBatch {
+    size_t material;    // material slot, in order of first use
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+};
+
+// One OBJ import. All scratch memory (attribute arrays, dedup tables, per-material geometry) is owned
+// by the instance, so separate loaders can run at the same time. Parse() touches no GL state and may
+// run on a worker thread, as may TakeMeshData(); CreateMeshes() and the streaming texture calls need the GL context.
+// The loader holds a reference to every texture those calls hand out for as long as it lives.
 class FastObjLoader {
 public:
-    static std::vector<Mesh> LoadOBJ(const std::string& objPath, const std::string& mtlPath = "");
+    FastObjLoader() = default;
+    FastObjLoader(const FastObjLoader&) = delete;
+    FastObjLoader& operator=(const FastObjLoader&) = delete;
+
+    // Parse() followed by CreateMeshes()
+    std::vector<Mesh> LoadOBJ(const std::string& objPath, const std::string& mtlPath = "");
     static std::vector<ObjMaterial> LoadMTL(const std::string& mtlPath);
 
+    // Reads the OBJ (and MTL) into per-material geometry, false if the file cannot be read
+    bool Parse(const std::string& objPath, const std::string& mtlPath = "");
+    // Uploads the parsed geometry as meshes in material-name order and frees it as it goes
+    std::vector<Mesh> CreateMeshes();
+    // Moves the parsed geometry out in material-name order without touching GL; texture paths include the OBJ directory
+    std::vector<MeshData> TakeMeshData();
+
     // Progress callback
-    static void SetProgressCallback(std::function<void(float)> callback);
+    void SetProgressCallback(std::function<void(float)> callback);
+
+    // Parse() polls the flag and gives up (returning false) soon after it is set
+    void SetCancelFlag(const std::atomic<bool>* flag);
+
+    // Parsing strategy, MemoryMapped falls back to Buffered if the file cannot be mapped
+    void SetParseMode(ObjParseMode mode);
+    ObjParseMode GetParseMode() const;
+
+    // Worker threads used by ObjParseMode::Parallel, 0 = all hardware threads
+    void SetThreadCount(unsigned int count);
+    unsigned int GetThreadCount() const;
+
+    // Streaming: the file is parsed a fixed number of bytes at a time so geometry can be drawn while loading continues
+    bool BeginStream(const std::string& objPath, const std::string& mtlPath = "");
+    bool StreamNext(size_t byteBudget, std::vector<ObjStreamBatch>& batches);    // false once the file is exhausted
+    const std::string& GetStreamMaterialName(size_t material) const;
+    std::vector<Texture> LoadStreamTextures(size_t material);
+    std::vector<TextureRef> GetStreamTextureRefs(size_t material) const;
+    float GetStreamProgress() const;
+    // Whether the streamed file had vn and vt data; without normals the batches carry placeholders
+    bool StreamHasNormals() const { return !normals.empty(); }
+    bool StreamHasTexCoords() const { return !texCoords.empty(); }
+    void EndStream();
+
+    // Scratch memory is kept between loads for reuse until Release() hands it back
+    void Release();
+    size_t GetScratchMemoryUsage() const;
 
 private:
-    static std::vector<glm::vec3> positions;
-    static std::vector<glm::vec2> texCoords;
-    static std::vector<glm::vec3> normals;
-    static std::vector<Vertex> vertices;
-    static std::vector<unsigned int> indices;
-    static std::vector<ObjMaterial> materials;
-    static std::function<void(float)> progressCallback;
-
-    static void parseLine(const std::string& line, size_t lineNumber, size_t totalLines);
-    static void parseFace(const std::string& line);
-    static void parseFaceWithMaterial(const std::string& line, const std::string& material,
-        std::map<std::string, std::vector<Vertex>>& materialVertices,
-        std::map<std::string, std::vector<unsigned int>>& materialIndices,
-        std::map<std::string, std::unordered_map<std::string, unsigned int>>& materialVertexCache);
-    static Vertex getVertex(const std::string& vertexStr);
-    static unsigned int TextureFromFile(const std::string& path, const std::string& directory);
-    static std::vector<Texture> loadTexturesForMaterial(const std::string& materialName, const std::string& directory);
-    static void clear();
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> texCoords;
+    std::vector<glm::vec3> normals;
+    std::vector<ObjMaterial> materials;
+    std::vector<ObjMaterialGeometry> materialGeometry;    // indexed by material id in order of first use
+    std::vector<TextureCache::Handle> textureHandles;
+    std::string directory;
+    std::function<void(float)> progressCallback;
+    ObjParseMode parseMode = ObjParseMode::Parallel;
+    unsigned int threadCount = 0;
+    const std::atomic<bool>* cancelFlag = nullptr;
+
+    MappedFile streamFile;
+    ObjMappedParseState streamState;
+
+    bool parseBuffered(const std::string& objPath);
+    void parseMapped(const MappedFile& file, const std::string& objPath);
+    void parseParallel(const MappedFile& file, const std::string& objPath);
+    bool parseMappedLines(ObjMappedParseState& state, const char* stopAt);
+    void generateVertexFrames();
+
+    void parseLine(const std::string& line);
+    void parseFaceWithMaterial(const char* cursor, const char* lineEnd,
+        ObjMaterialGeometry& geometry, std::vector<unsigned int>& faceIndices);
+    Vertex buildVertex(int posIndex, int texIndex, int normIndex) const;
+    bool isCancelled() const { return cancelFlag && cancelFlag->load(std::memory_order_relaxed); }
+    static TextureCache::Handle TextureFromFile(const std::string& path, const std::string& directory, TextureRole role = TextureRole::Color);
+    std::vector<TextureRef> textureRefsForMaterial(const std::string& materialName) const;
+    std::vector<Texture> loadTexturesForMaterial(const std::string& materialName);
+    std::vector<Texture> uploadTextures(const std::vector<TextureRef>& refs);
+    void clear();
 };
\ No newline at end of file
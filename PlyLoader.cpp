@@ -0,0 +1,497 @@
+#include "PlyLoader.h"
+#include "MappedFile.h"
+#include "MeshProcessing.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+namespace {
+    const size_t VERTEX_BLOCK = 65536;
+    const size_t FACE_BLOCK = 65536;
+
+    template<typename T>
+    T readUnaligned(const char* data) {
+        T value;
+        std::memcpy(&value, data, sizeof(T));
+        return value;
+    }
+
+    // Index of the first property with one of the given names, SIZE_MAX if none
+    size_t findProperty(const std::vector<std::string>& names, std::initializer_list<const char*> candidates) {
+        for (const char* candidate : candidates) {
+            auto found = std::find(names.begin(), names.end(), candidate);
+            if (found != names.end()) {
+                return static_cast<size_t>(found - names.begin());
+            }
+        }
+        return SIZE_MAX;
+    }
+}
+
+void PlyLoader::SetProgressCallback(std::function<void(float)> callback) {
+    progressCallback = callback;
+}
+
+void PlyLoader::SetCancelFlag(const std::atomic<bool>* flag) {
+    cancelFlag = flag;
+}
+
+bool PlyLoader::fail(const std::string& message) {
+    error = message;
+    return false;
+}
+
+void PlyLoader::reportProgress(float progress) const {
+    if (progressCallback) {
+        progressCallback(progress);
+    }
+}
+
+PlyLoader::ScalarType PlyLoader::parseType(const std::string& name) {
+    if (name == "char" || name == "int8") return ScalarType::Int8;
+    if (name == "uchar" || name == "uint8") return ScalarType::UInt8;
+    if (name == "short" || name == "int16") return ScalarType::Int16;
+    if (name == "ushort" || name == "uint16") return ScalarType::UInt16;
+    if (name == "int" || name == "int32") return ScalarType::Int32;
+    if (name == "uint" || name == "uint32") return ScalarType::UInt32;
+    if (name == "float" || name == "float32") return ScalarType::Float32;
+    if (name == "double" || name == "float64") return ScalarType::Float64;
+    return ScalarType::Invalid;
+}
+
+size_t PlyLoader::TypeSize(ScalarType type) {
+    switch (type) {
+    case ScalarType::Int8:
+    case ScalarType::UInt8:
+        return 1;
+    case ScalarType::Int16:
+    case ScalarType::UInt16:
+        return 2;
+    case ScalarType::Int32:
+    case ScalarType::UInt32:
+    case ScalarType::Float32:
+        return 4;
+    case ScalarType::Float64:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+double PlyLoader::ReadScalar(const char* data, ScalarType type) {
+    switch (type) {
+    case ScalarType::Int8: return readUnaligned<int8_t>(data);
+    case ScalarType::UInt8: return readUnaligned<uint8_t>(data);
+    case ScalarType::Int16: return readUnaligned<int16_t>(data);
+    case ScalarType::UInt16: return readUnaligned<uint16_t>(data);
+    case ScalarType::Int32: return readUnaligned<int32_t>(data);
+    case ScalarType::UInt32: return readUnaligned<uint32_t>(data);
+    case ScalarType::Float32: return readUnaligned<float>(data);
+    case ScalarType::Float64: return readUnaligned<double>(data);
+    default: return 0.0;
+    }
+}
+
+bool PlyLoader::ParseHeader(const char* begin, const char* end, const char*& body) {
+    elements.clear();
+    const char* cursor = begin;
+    bool first = true;
+
+    while (cursor < end) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+        if (!lineEnd) {
+            break;
+        }
+        std::string line(cursor, lineEnd);
+        cursor = lineEnd + 1;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+
+        std::istringstream tokens(line);
+        std::string keyword;
+        tokens >> keyword;
+
+        if (first) {
+            if (keyword != "ply") {
+                return fail("Missing PLY signature");
+            }
+            first = false;
+        }
+        else if (keyword == "format") {
+            std::string format;
+            tokens >> format;
+            if (format != "binary_little_endian") {
+                return fail("Only binary little-endian PLY is read natively, this file is " + format);
+            }
+        }
+        else if (keyword == "element") {
+            Element element;
+            tokens >> element.name >> element.count;
+            if (!tokens) {
+                return fail("Malformed PLY element: " + line);
+            }
+            elements.push_back(element);
+        }
+        else if (keyword == "property") {
+            if (elements.empty()) {
+                return fail("PLY property outside an element: " + line);
+            }
+            Property property;
+            std::string type;
+            tokens >> type;
+            if (type == "list") {
+                std::string countType, itemType;
+                tokens >> countType >> itemType;
+                property.isList = true;
+                property.countType = parseType(countType);
+                property.type = parseType(itemType);
+            }
+            else {
+                property.type = parseType(type);
+            }
+            tokens >> property.name;
+            if (!tokens || property.type == ScalarType::Invalid || (property.isList && property.countType == ScalarType::Invalid)) {
+                return fail("Unsupported PLY property: " + line);
+            }
+            elements.back().properties.push_back(property);
+        }
+        else if (keyword == "end_header") {
+            body = cursor;
+
+            // Fixed-size elements get property offsets and a stride, so items can be addressed directly
+            for (Element& element : elements) {
+                size_t offset = 0;
+                bool fixedSize = true;
+                for (Property& property : element.properties) {
+                    if (property.isList) {
+                        fixedSize = false;
+                        break;
+                    }
+                    property.offset = offset;
+                    offset += TypeSize(property.type);
+                }
+                element.stride = fixedSize ? offset : 0;
+            }
+            return true;
+        }
+        // comment, obj_info and unknown keywords are ignored
+    }
+
+    return fail("PLY header has no end_header line");
+}
+
+bool PlyLoader::FindVertexFormat(const Element& element, VertexFormat& format) {
+    std::vector<std::string> names;
+    for (const Property& property : element.properties) {
+        names.push_back(property.name);
+    }
+
+    format.position[0] = findProperty(names, { "x" });
+    format.position[1] = findProperty(names, { "y" });
+    format.position[2] = findProperty(names, { "z" });
+    if (format.position[0] == SIZE_MAX || format.position[1] == SIZE_MAX || format.position[2] == SIZE_MAX) {
+        return fail("PLY vertices have no x/y/z properties");
+    }
+    format.normal[0] = findProperty(names, { "nx" });
+    format.normal[1] = findProperty(names, { "ny" });
+    format.normal[2] = findProperty(names, { "nz" });
+    format.texCoord[0] = findProperty(names, { "u", "s", "texture_u", "texture_s" });
+    format.texCoord[1] = findProperty(names, { "v", "t", "texture_v", "texture_t" });
+    format.hasNormals = format.normal[0] != SIZE_MAX && format.normal[1] != SIZE_MAX && format.normal[2] != SIZE_MAX;
+    format.hasTexCoords = format.texCoord[0] != SIZE_MAX && format.texCoord[1] != SIZE_MAX;
+    return true;
+}
+
+void PlyLoader::ReadVertex(const Element& element, const VertexFormat& format, const char* item, Vertex& vertex) {
+    const std::vector<Property>& properties = element.properties;
+    auto read = [&properties, item](size_t property) {
+        const Property& p = properties[property];
+        if (p.type == ScalarType::Float32) {
+            return readUnaligned<float>(item + p.offset);
+        }
+        return static_cast<float>(ReadScalar(item + p.offset, p.type));
+    };
+
+    vertex.Position = glm::vec3(read(format.position[0]), read(format.position[1]), read(format.position[2]));
+    vertex.Normal = format.hasNormals ? glm::vec3(read(format.normal[0]), read(format.normal[1]), read(format.normal[2])) : glm::vec3(0.0f, 1.0f, 0.0f);
+    // PLY texture coordinates start at the bottom of the image, like OBJ
+    vertex.TexCoords = format.hasTexCoords ? glm::vec2(read(format.texCoord[0]), 1.0f - read(format.texCoord[1])) : glm::vec2(0.0f);
+    vertex.Tangent = glm::vec3(1.0f, 0.0f, 0.0f);
+    vertex.Bitangent = glm::vec3(0.0f, 1.0f, 0.0f);
+}
+
+bool PlyLoader::readVertices(const Element& element, const char* data, std::vector<Vertex>& vertices, bool& hasNormals) {
+    VertexFormat format;
+    if (!FindVertexFormat(element, format)) {
+        return false;
+    }
+    hasNormals = format.hasNormals;
+
+    vertices.resize(element.count);
+    const size_t blockCount = (element.count + VERTEX_BLOCK - 1) / VERTEX_BLOCK;
+    ThreadPool::Shared().ParallelFor(blockCount, [&](size_t block) {
+        size_t first = block * VERTEX_BLOCK;
+        size_t last = std::min(first + VERTEX_BLOCK, element.count);
+        for (size_t i = first; i < last; i++) {
+            ReadVertex(element, format, data + i * element.stride, vertices[i]);
+        }
+    });
+    return true;
+}
+
+bool PlyLoader::readFaces(const Element& element, const char*& cursor, const char* end, size_t vertexCount, std::vector<unsigned int>& indices) {
+    size_t listProperty = SIZE_MAX;
+    for (size_t i = 0; i < element.properties.size(); i++) {
+        const std::string& name = element.properties[i].name;
+        if (element.properties[i].isList && (name == "vertex_indices" || name == "vertex_index")) {
+            listProperty = i;
+            break;
+        }
+    }
+    if (listProperty == SIZE_MAX) {
+        return fail("PLY faces have no vertex_indices list");
+    }
+    const Property& list = element.properties[listProperty];
+    if (list.type == ScalarType::Float32 || list.type == ScalarType::Float64) {
+        return fail("PLY face indices are not integers");
+    }
+
+    // The usual layout, a uchar 3 followed by three 32-bit indices per face, is read in parallel
+    // straight into the index buffer. Any other face falls back to the general walk in ReadTriangles.
+    const size_t triangleBytes = 1 + 3 * sizeof(uint32_t);
+    if (element.properties.size() == 1 && list.countType == ScalarType::UInt8 && TypeSize(list.type) == 4 &&
+        element.count <= static_cast<size_t>(end - cursor) / triangleBytes) {
+        indices.resize(element.count * 3);
+        std::atomic<bool> allTriangles{ true };
+        std::atomic<bool> inRange{ true };
+        const char* faces = cursor;
+
+        const size_t blockCount = (element.count + FACE_BLOCK - 1) / FACE_BLOCK;
+        ThreadPool::Shared().ParallelFor(blockCount, [&](size_t block) {
+            size_t first = block * FACE_BLOCK;
+            size_t last = std::min(first + FACE_BLOCK, element.count);
+            for (size_t f = first; f < last && allTriangles.load(std::memory_order_relaxed); f++) {
+                const char* face = faces + f * triangleBytes;
+                if (static_cast<uint8_t>(face[0]) != 3) {
+                    allTriangles = false;
+                    break;
+                }
+                std::memcpy(&indices[f * 3], face + 1, 3 * sizeof(uint32_t));
+                // Negative int32 indices wrap to huge values and fail here as well
+                if (indices[f * 3] >= vertexCount || indices[f * 3 + 1] >= vertexCount || indices[f * 3 + 2] >= vertexCount) {
+                    inRange = false;
+                }
+            }
+        });
+
+        if (allTriangles) {
+            if (!inRange) {
+                return fail("PLY face index out of range");
+            }
+            cursor += element.count * triangleBytes;
+            return true;
+        }
+        indices.clear();
+    }
+
+    // Every face takes at least a byte, so the header's count cannot reserve more than the file holds
+    indices.reserve(std::min(element.count, static_cast<size_t>(end - cursor)) * 3);
+    return ReadTriangles(element, cursor, end, vertexCount, [&indices](const unsigned int* triangles, size_t count) {
+        indices.insert(indices.end(), triangles, triangles + count * 3);
+        return true;
+        });
+}
+
+bool PlyLoader::ReadTriangles(const Element& element, const char*& cursor, const char* end, size_t vertexCount,
+    const std::function<bool(const unsigned int*, size_t)>& emit) {
+    size_t listProperty = SIZE_MAX;
+    for (size_t i = 0; i < element.properties.size(); i++) {
+        const std::string& name = element.properties[i].name;
+        if (element.properties[i].isList && (name == "vertex_indices" || name == "vertex_index")) {
+            listProperty = i;
+            break;
+        }
+    }
+    if (listProperty == SIZE_MAX) {
+        return fail("PLY faces have no vertex_indices list");
+    }
+    if (element.properties[listProperty].type == ScalarType::Float32 || element.properties[listProperty].type == ScalarType::Float64) {
+        return fail("PLY face indices are not integers");
+    }
+
+    std::vector<unsigned int> triangles;
+    triangles.reserve(FACE_BLOCK * 3);
+    std::vector<unsigned int> polygon;
+    for (size_t f = 0; f < element.count; f++) {
+        if ((f & 0xFFFF) == 0 && isCancelled()) {
+            return fail("Cancelled");
+        }
+
+        for (size_t p = 0; p < element.properties.size(); p++) {
+            const Property& property = element.properties[p];
+            if (!property.isList) {
+                size_t size = TypeSize(property.type);
+                if (static_cast<size_t>(end - cursor) < size) {
+                    return fail("PLY face data is truncated");
+                }
+                cursor += size;
+                continue;
+            }
+
+            size_t countSize = TypeSize(property.countType);
+            if (static_cast<size_t>(end - cursor) < countSize) {
+                return fail("PLY face data is truncated");
+            }
+            double count = ReadScalar(cursor, property.countType);
+            cursor += countSize;
+            size_t itemSize = TypeSize(property.type);
+            if (count < 0.0 || static_cast<size_t>(end - cursor) / itemSize < static_cast<size_t>(count)) {
+                return fail("PLY face data is truncated");
+            }
+
+            if (p == listProperty) {
+                polygon.clear();
+                for (size_t i = 0; i < static_cast<size_t>(count); i++) {
+                    double index = ReadScalar(cursor + i * itemSize, property.type);
+                    if (index < 0.0 || index >= static_cast<double>(vertexCount)) {
+                        return fail("PLY face index out of range");
+                    }
+                    polygon.push_back(static_cast<unsigned int>(index));
+                }
+                // Polygons are split into a fan around their first corner
+                for (size_t i = 1; i + 1 < polygon.size(); i++) {
+                    triangles.insert(triangles.end(), { polygon[0], polygon[i], polygon[i + 1] });
+                }
+            }
+            cursor += static_cast<size_t>(count) * itemSize;
+        }
+
+        if (triangles.size() >= FACE_BLOCK * 3) {
+            if (!emit(triangles.data(), triangles.size() / 3)) {
+                return fail("Cancelled");
+            }
+            triangles.clear();
+        }
+    }
+
+    if (!triangles.empty() && !emit(triangles.data(), triangles.size() / 3)) {
+        return fail("Cancelled");
+    }
+    return true;
+}
+
+bool PlyLoader::SkipElement(const Element& element, const char*& cursor, const char* end) const {
+    if (element.stride > 0) {
+        if (static_cast<size_t>(end - cursor) / element.stride < element.count) {
+            return false;
+        }
+        cursor += element.count * element.stride;
+        return true;
+    }
+
+    for (size_t i = 0; i < element.count; i++) {
+        for (const Property& property : element.properties) {
+            size_t size = TypeSize(property.type);
+            if (property.isList) {
+                size_t countSize = TypeSize(property.countType);
+                if (static_cast<size_t>(end - cursor) < countSize) {
+                    return false;
+                }
+                double count = ReadScalar(cursor, property.countType);
+                cursor += countSize;
+                if (count < 0.0) {
+                    return false;
+                }
+                size *= static_cast<size_t>(count);
+            }
+            if (static_cast<size_t>(end - cursor) < size) {
+                return false;
+            }
+            cursor += size;
+        }
+    }
+    return true;
+}
+
+bool PlyLoader::Load(const std::string& path, std::vector<MeshData>& meshes) {
+    error.clear();
+
+    MappedFile file;
+    if (!file.Open(path)) {
+        return fail("Could not open " + path);
+    }
+
+    const char* end = file.Data() + file.Size();
+    const char* cursor = nullptr;
+    if (!ParseHeader(file.Data(), end, cursor)) {
+        return false;
+    }
+
+    const Element* vertexElement = nullptr;
+    for (const Element& element : elements) {
+        if (element.name == "vertex") {
+            vertexElement = &element;
+        }
+    }
+    if (!vertexElement || vertexElement->count == 0) {
+        return fail("PLY file has no vertices");
+    }
+    if (vertexElement->stride == 0) {
+        return fail("PLY vertices with list properties are not supported");
+    }
+    if (vertexElement->count > 0xFFFFFFFFu) {
+        return fail("PLY file has more vertices than 32-bit indices can address");
+    }
+
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    bool hasNormals = false;
+    bool hasFaces = false;
+
+    for (const Element& element : elements) {
+        if (isCancelled()) {
+            return fail("Cancelled");
+        }
+
+        if (&element == vertexElement) {
+            if (static_cast<size_t>(end - cursor) / element.stride < element.count) {
+                return fail("PLY vertex data is truncated");
+            }
+            if (!readVertices(element, cursor, vertices, hasNormals)) {
+                return false;
+            }
+            cursor += element.count * element.stride;
+            reportProgress(0.4f);
+        }
+        else if (element.name == "face" && !hasFaces) {
+            if (!readFaces(element, cursor, end, vertexElement->count, indices)) {
+                return false;
+            }
+            hasFaces = true;
+            reportProgress(0.8f);
+        }
+        else if (!SkipElement(element, cursor, end)) {
+            return fail("PLY element '" + element.name + "' is truncated");
+        }
+    }
+
+    if (indices.empty()) {
+        return fail("PLY file has no faces");
+    }
+
+    if (!hasNormals) {
+        MeshProcessing::GenerateNormals(vertices, indices);
+    }
+    reportProgress(1.0f);
+
+    MeshData mesh;
+    mesh.vertices = std::move(vertices);
+    mesh.indices = std::move(indices);
+    meshes.clear();
+    meshes.push_back(std::move(mesh));
+    return true;
+}
\ No newline at end of file
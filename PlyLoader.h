@@ -0,0 +1,85 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <functional>
+#include <atomic>
+#include "Mesh.h"
+
+// Binary little-endian PLY reader. The file is memory-mapped; vertices are read straight from the
+// fixed-stride vertex element into Vertex and triangle faces straight into the index buffer.
+// Position, normal and texture coordinate properties are used, any other property is skipped.
+// ASCII and big-endian files are left to Assimp.
+class PlyLoader {
+public:
+    PlyLoader() = default;
+    PlyLoader(const PlyLoader&) = delete;
+    PlyLoader& operator=(const PlyLoader&) = delete;
+
+    // One mesh for the whole file; false if the file is not binary little-endian or has no faces
+    bool Load(const std::string& path, std::vector<MeshData>& meshes);
+
+    const std::string& GetError() const { return error; }
+
+    void SetProgressCallback(std::function<void(float)> callback);
+    void SetCancelFlag(const std::atomic<bool>* flag);
+
+    // Header layout, shared with other readers of binary PLY (the point cloud builder)
+    enum class ScalarType { Invalid, Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64 };
+
+    struct Property {
+        std::string name;
+        ScalarType type = ScalarType::Invalid;
+        bool isList = false;
+        ScalarType countType = ScalarType::Invalid;
+        size_t offset = 0;      // within the element, for fixed-size elements
+    };
+
+    struct Element {
+        std::string name;
+        size_t count = 0;
+        std::vector<Property> properties;
+        size_t stride = 0;      // bytes per item, 0 if the element has list properties
+    };
+
+    // Parses the header in [begin, end); body is set to the first byte of element data
+    bool ParseHeader(const char* begin, const char* end, const char*& body);
+    const std::vector<Element>& GetElements() const { return elements; }
+    // Advances cursor past every item of the element, false if the data is truncated
+    bool SkipElement(const Element& element, const char*& cursor, const char* end) const;
+
+    // Properties read into a Vertex, SIZE_MAX where the file has none
+    struct VertexFormat {
+        size_t position[3] = { SIZE_MAX, SIZE_MAX, SIZE_MAX };
+        size_t normal[3] = { SIZE_MAX, SIZE_MAX, SIZE_MAX };
+        size_t texCoord[2] = { SIZE_MAX, SIZE_MAX };
+        bool hasNormals = false;
+        bool hasTexCoords = false;
+    };
+
+    // False (with GetError set) if the element has no x/y/z properties
+    bool FindVertexFormat(const Element& element, VertexFormat& format);
+    static void ReadVertex(const Element& element, const VertexFormat& format, const char* item, Vertex& vertex);
+
+    // Walks a face element from cursor, splitting polygons into fans and handing out the triangles'
+    // vertex indices in batches. emit returning false stops the walk as cancelled.
+    bool ReadTriangles(const Element& element, const char*& cursor, const char* end, size_t vertexCount,
+        const std::function<bool(const unsigned int*, size_t)>& emit);
+
+    static size_t TypeSize(ScalarType type);
+    static double ReadScalar(const char* data, ScalarType type);
+
+private:
+    std::vector<Element> elements;
+    std::string error;
+    std::function<void(float)> progressCallback;
+    const std::atomic<bool>* cancelFlag = nullptr;
+
+    bool fail(const std::string& message);
+    bool isCancelled() const { return cancelFlag && cancelFlag->load(std::memory_order_relaxed); }
+    void reportProgress(float progress) const;
+
+    bool readVertices(const Element& element, const char* data, std::vector<Vertex>& vertices, bool& hasNormals);
+    bool readFaces(const Element& element, const char*& cursor, const char* end, size_t vertexCount, std::vector<unsigned int>& indices);
+
+    static ScalarType parseType(const std::string& name);
+};
\ No newline at end of file
@@ -0,0 +1,319 @@
+#include <glad/glad.h>
+#include "PointCloud.h"
+#include "Frustum.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <utility>
+
+namespace {
+    // Nodes smaller than this on screen are not worth their points
+    const float MIN_NODE_PIXELS = 80.0f;
+    // Requests handed to the loader per frame, the rest wait for the next selection
+    const size_t MAX_QUEUED_LOADS = 32;
+}
+
+PointCloud::PointCloud(const std::string& plyPath)
+    : plyPath(plyPath), octreePath(PointCloudFile::GetOctreePath(plyPath)) {
+    buildThread = std::thread([this]() {
+        if (PointCloudFile::IsUpToDate(this->plyPath, octreePath)) {
+            std::cout << "Using point cloud octree: " << octreePath << std::endl;
+        }
+        else {
+            std::cout << "Building point cloud octree: " << octreePath << std::endl;
+            PointCloudFile::Build(this->plyPath, octreePath, [this](float progress) {
+                buildProgress.store(progress, std::memory_order_relaxed);
+                }, &cancelled, buildError);
+        }
+        buildFinished.store(true, std::memory_order_release);
+        });
+}
+
+PointCloud::~PointCloud() {
+    cancelled.store(true, std::memory_order_relaxed);
+    if (buildThread.joinable()) {
+        buildThread.join();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(loaderMutex);
+        stopLoader = true;
+    }
+    loaderCondition.notify_all();
+    if (loaderThread.joinable()) {
+        loaderThread.join();
+    }
+
+    for (uint32_t i = 0; i < states.size(); i++) {
+        if (states[i].resident) {
+            evictNode(i);
+        }
+    }
+}
+
+bool PointCloud::openOctree() {
+    std::ifstream file(octreePath, std::ios::binary);
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || std::memcmp(header.magic, PointCloudFile::MAGIC, sizeof(PointCloudFile::MAGIC)) != 0
+        || header.version != PointCloudFile::VERSION || header.nodeCount == 0) {
+        error = "Invalid point cloud octree: " + octreePath;
+        return false;
+    }
+
+    nodes.resize(header.nodeCount);
+    file.seekg(static_cast<std::streamoff>(header.nodeTableOffset));
+    if (!file.read(reinterpret_cast<char*>(nodes.data()), nodes.size() * sizeof(PointCloudFile::Node))) {
+        error = "Point cloud octree is truncated: " + octreePath;
+        return false;
+    }
+    states.clear();
+    states.resize(nodes.size());
+
+    glm::vec3 minBounds(header.minBounds[0], header.minBounds[1], header.minBounds[2]);
+    glm::vec3 maxBounds(header.maxBounds[0], header.maxBounds[1], header.maxBounds[2]);
+    modelCenter = (minBounds + maxBounds) * 0.5f;
+    modelSize = maxBounds - minBounds;
+    float maxDimension = (std::max)({ modelSize.x, modelSize.y, modelSize.z });
+    recommendedScale = maxDimension > 0.0f ? 2.0f / maxDimension : 1.0f;
+
+    loaderThread = std::thread([this]() { loaderLoop(); });
+
+    std::cout << "Opened point cloud: " << header.pointCount << " points in " << nodes.size() << " octree nodes" << std::endl;
+    return true;
+}
+
+void PointCloud::loaderLoop() {
+    std::ifstream file(octreePath, std::ios::binary);
+
+    while (true) {
+        uint32_t index;
+        {
+            std::unique_lock<std::mutex> lock(loaderMutex);
+            loaderCondition.wait(lock, [this]() { return stopLoader || !loadQueue.empty(); });
+            if (stopLoader) {
+                return;
+            }
+            index = loadQueue.front();
+            loadQueue.pop_front();
+        }
+
+        const PointCloudFile::Node& node = nodes[index];
+        LoadedNode loaded;
+        loaded.node = index;
+        loaded.points.resize(node.pointCount);
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(node.offset));
+        if (!file.read(reinterpret_cast<char*>(loaded.points.data()), loaded.points.size() * sizeof(PointCloudFile::Point))) {
+            std::cerr << "Failed to read point cloud node " << index << " from " << octreePath << std::endl;
+            loaded.points.clear();
+        }
+
+        std::lock_guard<std::mutex> lock(loaderMutex);
+        loadedNodes.push_back(std::move(loaded));
+    }
+}
+
+void PointCloud::Update(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, int viewportHeight) {
+    if (!ready) {
+        if (failed || !buildFinished.load(std::memory_order_acquire)) {
+            return;
+        }
+        buildThread.join();
+
+        if (!buildError.empty()) {
+            error = buildError;
+        }
+        if (!error.empty() || !openOctree()) {
+            failed = true;
+            std::cerr << "Point cloud failed: " << error << std::endl;
+            return;
+        }
+        ready = true;
+    }
+
+    frame++;
+    uploadLoadedNodes();
+    selectNodes(model, view, projection, viewportHeight);
+    evictToBudget();
+}
+
+void PointCloud::uploadLoadedNodes() {
+    size_t uploaded = 0;
+    while (uploaded < uploadBudget) {
+        LoadedNode loaded;
+        {
+            std::lock_guard<std::mutex> lock(loaderMutex);
+            if (loadedNodes.empty()) {
+                return;
+            }
+            loaded = std::move(loadedNodes.front());
+            loadedNodes.pop_front();
+        }
+
+        // A node that could not be read stays requested, so it is not asked for again
+        if (!loaded.points.empty()) {
+            states[loaded.node].requested = false;
+            uploadNode(loaded);
+            uploaded += loaded.points.size();
+        }
+    }
+}
+
+void PointCloud::uploadNode(const LoadedNode& loaded) {
+    NodeState& state = states[loaded.node];
+
+    state.VAO = GLVertexArray::Create();
+    state.VBO = GLBuffer::Create();
+    glBindVertexArray(state.VAO.Get());
+    glBindBuffer(GL_ARRAY_BUFFER, state.VBO.Get());
+    glBufferData(GL_ARRAY_BUFFER, loaded.points.size() * sizeof(PointCloudFile::Point), loaded.points.data(), GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PointCloudFile::Point), (void*)0);
+
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PointCloudFile::Point), (void*)offsetof(PointCloudFile::Point, r));
+
+    glBindVertexArray(0);
+
+    state.resident = true;
+    residentPoints += nodes[loaded.node].pointCount;
+    residentNodes++;
+}
+
+void PointCloud::evictNode(uint32_t index) {
+    NodeState& state = states[index];
+    state.VBO.Reset();
+    state.VAO.Reset();
+    state.resident = false;
+    residentPoints -= nodes[index].pointCount;
+    residentNodes--;
+}
+
+// Traverses the octree from the root, largest projected nodes first. A node is only refined once it
+// is drawn itself, since children add detail to their parent rather than replacing it.
+void PointCloud::selectNodes(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, int viewportHeight) {
+    glm::mat4 modelView = view * model;
+    Frustum frustum(projection * modelView);
+    glm::vec3 cameraPosition = glm::vec3(glm::inverse(modelView)[3]);
+    float pixelsPerUnit = viewportHeight * 0.5f * projection[1][1];
+
+    // Radius over distance is unchanged by a uniform model scale, so it is measured in model space
+    auto projectedSize = [&](const PointCloudFile::Node& node) {
+        float halfSize = node.size * 0.5f;
+        glm::vec3 center(node.minBounds[0] + halfSize, node.minBounds[1] + halfSize, node.minBounds[2] + halfSize);
+        float radius = halfSize * 1.7320508f;
+        float distance = glm::length(center - cameraPosition);
+        return distance > radius ? radius / distance * pixelsPerUnit : FLT_MAX;
+    };
+
+    std::priority_queue<std::pair<float, uint32_t>> candidates;
+    candidates.push({ projectedSize(nodes[0]), 0 });
+    std::vector<uint32_t> requests;
+    drawList.clear();
+    visiblePoints = 0;
+
+    while (!candidates.empty()) {
+        auto [size, index] = candidates.top();
+        candidates.pop();
+
+        const PointCloudFile::Node& node = nodes[index];
+        glm::vec3 minBounds(node.minBounds[0], node.minBounds[1], node.minBounds[2]);
+        if ((index != 0 && size < MIN_NODE_PIXELS) || !frustum.IntersectsBox(minBounds, minBounds + glm::vec3(node.size))) {
+            continue;
+        }
+        if (visiblePoints + node.pointCount > pointBudget) {
+            break;
+        }
+
+        NodeState& state = states[index];
+        if (!state.resident) {
+            requests.push_back(index);
+            continue;
+        }
+
+        state.lastUsedFrame = frame;
+        state.deepestDrawnLevel = node.level;
+        drawList.push_back(index);
+        visiblePoints += node.pointCount;
+
+        for (uint32_t child : node.children) {
+            if (child != PointCloudFile::NO_NODE) {
+                candidates.push({ projectedSize(nodes[child]), child });
+            }
+        }
+    }
+
+    // Point size follows the finest level drawn below a node, where its points are interleaved with denser ones
+    for (uint32_t index : drawList) {
+        uint32_t level = nodes[index].level;
+        for (uint32_t parent = nodes[index].parent; parent != PointCloudFile::NO_NODE; parent = nodes[parent].parent) {
+            states[parent].deepestDrawnLevel = (std::max)(states[parent].deepestDrawnLevel, level);
+        }
+    }
+
+    // Replace the queued requests with this frame's, most important first; nodes already being read stay requested
+    std::lock_guard<std::mutex> lock(loaderMutex);
+    for (uint32_t index : loadQueue) {
+        states[index].requested = false;
+    }
+    loadQueue.clear();
+    for (uint32_t index : requests) {
+        if (loadQueue.size() >= MAX_QUEUED_LOADS) {
+            break;
+        }
+        if (!states[index].requested) {
+            states[index].requested = true;
+            loadQueue.push_back(index);
+        }
+    }
+    if (!loadQueue.empty()) {
+        loaderCondition.notify_one();
+    }
+}
+
+void PointCloud::evictToBudget() {
+    if (residentPoints <= gpuBudget) {
+        return;
+    }
+
+    std::vector<uint32_t> candidates;
+    for (uint32_t i = 0; i < states.size(); i++) {
+        if (states[i].resident && states[i].lastUsedFrame != frame) {
+            candidates.push_back(i);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [this](uint32_t a, uint32_t b) {
+        return states[a].lastUsedFrame < states[b].lastUsedFrame;
+    });
+
+    for (uint32_t index : candidates) {
+        if (residentPoints <= gpuBudget) {
+            break;
+        }
+        evictNode(index);
+    }
+}
+
+void PointCloud::Draw(unsigned int shaderProgram) {
+    if (!ready) {
+        return;
+    }
+
+    glUniform1i(glGetUniformLocation(shaderProgram, "hasColor"), header.hasColor ? 1 : 0);
+    glUniform2f(glGetUniformLocation(shaderProgram, "heightRange"), header.minBounds[1], header.maxBounds[1]);
+    int spacingLocation = glGetUniformLocation(shaderProgram, "spacing");
+
+    for (uint32_t index : drawList) {
+        const PointCloudFile::Node& node = nodes[index];
+        float spacing = std::ldexp(node.spacing, -static_cast<int>(states[index].deepestDrawnLevel - node.level));
+        glUniform1f(spacingLocation, spacing);
+        glBindVertexArray(states[index].VAO.Get());
+        glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(node.pointCount));
+    }
+    glBindVertexArray(0);
+}
\ No newline at end of file
@@ -0,0 +1,114 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <glm/glm.hpp>
+#include "PointCloudFile.h"
+#include "GLHandle.h"
+
+// Out-of-core point cloud. The PLY is converted once into an LOD octree file on a background thread
+// (reused while the PLY is unchanged); afterwards every frame Update picks the nodes worth drawing by
+// their projected size within a point budget, a loader thread reads the missing ones from disk and a
+// limited number of points is uploaded per frame. Nodes not drawn for the longest time are evicted
+// once the resident points exceed the GPU budget.
+class PointCloud {
+public:
+    explicit PointCloud(const std::string& plyPath);
+    ~PointCloud();
+
+    PointCloud(const PointCloud&) = delete;
+    PointCloud& operator=(const PointCloud&) = delete;
+
+    // True until the octree is built (or found up to date) and opened
+    bool IsLoading() const { return !ready && !failed; }
+    bool HasFailed() const { return failed; }
+    float GetLoadingProgress() const { return buildProgress.load(std::memory_order_relaxed); }
+    const std::string& GetError() const { return error; }
+
+    // Selects the nodes for the coming frame, queues missing ones for loading, uploads finished loads
+    // and evicts over budget; call once per frame on the GL thread before Draw
+    void Update(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, int viewportHeight);
+    // Draws the nodes selected by the last Update as GL_POINTS; the shader's "spacing" uniform
+    // receives each node's point spacing in model units
+    void Draw(unsigned int shaderProgram);
+
+    // Budgets in points: drawn per frame, kept in GPU buffers, uploaded per frame
+    void SetPointBudget(size_t points) { pointBudget = points; }
+    void SetGpuBudget(size_t points) { gpuBudget = points; }
+    void SetUploadBudget(size_t points) { uploadBudget = points; }
+
+    glm::vec3 GetModelCenter() const { return modelCenter; }
+    glm::vec3 GetModelSize() const { return modelSize; }
+    float GetRecommendedScale() const { return recommendedScale; }
+    bool HasColor() const { return header.hasColor != 0; }
+
+    size_t GetVisiblePointCount() const { return visiblePoints; }
+    size_t GetResidentPointCount() const { return residentPoints; }
+    size_t GetResidentNodeCount() const { return residentNodes; }
+    size_t GetNodeCount() const { return nodes.size(); }
+
+private:
+    struct NodeState {
+        GLVertexArray VAO;
+        GLBuffer VBO;
+        bool resident = false;
+        bool requested = false;         // queued or being read by the loader thread
+        uint64_t lastUsedFrame = 0;
+        uint32_t deepestDrawnLevel = 0; // finest level drawn below the node this frame
+    };
+
+    struct LoadedNode {
+        uint32_t node;
+        std::vector<PointCloudFile::Point> points;
+    };
+
+    std::string plyPath;
+    std::string octreePath;
+
+    // Octree build, runs once when the cloud is created
+    std::thread buildThread;
+    std::atomic<bool> buildFinished{ false };
+    std::atomic<bool> cancelled{ false };
+    std::atomic<float> buildProgress{ 0.0f };
+    std::string buildError;
+    bool ready = false;
+    bool failed = false;
+    std::string error;
+
+    PointCloudFile::Header header = {};
+    std::vector<PointCloudFile::Node> nodes;
+    std::vector<NodeState> states;
+
+    // Node reads, requests are replaced every frame in priority order
+    std::thread loaderThread;
+    std::mutex loaderMutex;
+    std::condition_variable loaderCondition;
+    std::deque<uint32_t> loadQueue;
+    std::deque<LoadedNode> loadedNodes;
+    bool stopLoader = false;
+
+    std::vector<uint32_t> drawList;
+    uint64_t frame = 0;
+    size_t pointBudget = 5000000;
+    size_t gpuBudget = 20000000;
+    size_t uploadBudget = 500000;
+    size_t visiblePoints = 0;
+    size_t residentPoints = 0;
+    size_t residentNodes = 0;
+
+    glm::vec3 modelCenter = glm::vec3(0.0f);
+    glm::vec3 modelSize = glm::vec3(0.0f);
+    float recommendedScale = 1.0f;
+
+    bool openOctree();
+    void loaderLoop();
+    void uploadLoadedNodes();
+    void selectNodes(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, int viewportHeight);
+    void uploadNode(const LoadedNode& loaded);
+    void evictNode(uint32_t index);
+    void evictToBudget();
+};
\ No newline at end of file
@@ -0,0 +1,774 @@
+#include "PointCloudFile.h"
+#include "PlyLoader.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace PointCloudFile {
+    namespace {
+        // Points are counted into a grid over the whole cloud; chunks are cut from its cells
+        const uint32_t GRID_LEVELS = 7;
+        const uint32_t GRID_SIZE = 1u << GRID_LEVELS;
+        // A chunk is sorted into its subtree in memory, this bounds the memory of one build task
+        const uint64_t CHUNK_MAX_POINTS = 4 * 1024 * 1024;
+        const size_t CHUNK_CONCURRENCY = 4;
+        // Every node keeps one point per cell of a SAMPLE_GRID^3 grid over its cube
+        const uint32_t SAMPLE_BITS = 7;
+        const uint32_t SAMPLE_GRID = 1u << SAMPLE_BITS;
+        const size_t LEAF_MAX_POINTS = 20000;
+        const uint32_t MAX_LEVEL = 24;
+        // Source points read per pass step
+        const size_t READ_BLOCK_POINTS = 1 << 21;
+        const size_t READ_TASK_POINTS = 1 << 16;
+
+        struct FileStamp {
+            uint64_t size = 0;
+            int64_t time = 0;
+        };
+
+        FileStamp stampOf(const std::string& path) {
+            FileStamp stamp;
+            std::error_code ec;
+            uint64_t size = std::filesystem::file_size(path, ec);
+            if (ec) {
+                return stamp;
+            }
+            auto time = std::filesystem::last_write_time(path, ec);
+            if (ec) {
+                return stamp;
+            }
+
+            stamp.size = size;
+            stamp.time = static_cast<int64_t>(time.time_since_epoch().count());
+            return stamp;
+        }
+
+        // Where the PLY vertex element lives and which properties hold position and color
+        struct VertexLayout {
+            const char* data = nullptr;
+            size_t count = 0;
+            size_t stride = 0;
+            const PlyLoader::Property* position[3] = {};
+            const PlyLoader::Property* color[3] = {};
+        };
+
+        float readFloat(const char* item, const PlyLoader::Property& property) {
+            if (property.type == PlyLoader::ScalarType::Float32) {
+                float value;
+                std::memcpy(&value, item + property.offset, sizeof(float));
+                return value;
+            }
+            return static_cast<float>(PlyLoader::ReadScalar(item + property.offset, property.type));
+        }
+
+        uint8_t readColor(const char* item, const PlyLoader::Property& property) {
+            double value = PlyLoader::ReadScalar(item + property.offset, property.type);
+            switch (property.type) {
+            case PlyLoader::ScalarType::UInt8:
+                return static_cast<uint8_t>(value);
+            case PlyLoader::ScalarType::UInt16:
+                return static_cast<uint8_t>(value / 257.0);
+            case PlyLoader::ScalarType::Float32:
+            case PlyLoader::ScalarType::Float64:
+                return static_cast<uint8_t>(std::clamp(value, 0.0, 1.0) * 255.0 + 0.5);
+            default:
+                return static_cast<uint8_t>(std::clamp(value, 0.0, 255.0));
+            }
+        }
+
+        // False for points with non-finite coordinates, which are dropped
+        bool readPoint(const VertexLayout& layout, size_t index, Point& point) {
+            const char* item = layout.data + index * layout.stride;
+            point.x = readFloat(item, *layout.position[0]);
+            point.y = readFloat(item, *layout.position[1]);
+            point.z = readFloat(item, *layout.position[2]);
+            if (layout.color[0]) {
+                point.r = readColor(item, *layout.color[0]);
+                point.g = readColor(item, *layout.color[1]);
+                point.b = readColor(item, *layout.color[2]);
+            }
+            else {
+                point.r = point.g = point.b = 255;
+            }
+            point.a = 255;
+            return std::isfinite(point.x) && std::isfinite(point.y) && std::isfinite(point.z);
+        }
+
+        const PlyLoader::Property* findProperty(const PlyLoader::Element& element, std::initializer_list<const char*> names) {
+            for (const char* name : names) {
+                for (const PlyLoader::Property& property : element.properties) {
+                    if (property.name == name && !property.isList) {
+                        return &property;
+                    }
+                }
+            }
+            return nullptr;
+        }
+
+        struct Cube {
+            float origin[3];
+            float size;
+        };
+
+        uint32_t cellOf(float value, float origin, float cellsPerUnit, uint32_t cells) {
+            float cell = (value - origin) * cellsPerUnit;
+            if (!(cell > 0.0f)) {
+                return 0;
+            }
+            return (std::min)(static_cast<uint32_t>(cell), cells - 1);
+        }
+
+        size_t gridIndex(uint32_t x, uint32_t y, uint32_t z, uint32_t cells) {
+            return (static_cast<size_t>(z) * cells + y) * cells + x;
+        }
+
+        Cube childCube(const Cube& cube, uint32_t octant) {
+            Cube child;
+            child.size = cube.size * 0.5f;
+            for (int axis = 0; axis < 3; axis++) {
+                child.origin[axis] = cube.origin[axis] + ((octant >> axis) & 1 ? child.size : 0.0f);
+            }
+            return child;
+        }
+
+        uint32_t octantOf(const Point& point, const Cube& cube) {
+            float half = cube.size * 0.5f;
+            return (point.x >= cube.origin[0] + half ? 1u : 0u)
+                | (point.y >= cube.origin[1] + half ? 2u : 0u)
+                | (point.z >= cube.origin[2] + half ? 4u : 0u);
+        }
+
+        // One bit per sampling cell, cleared again through the list of cells that were set
+        class SampleGrid {
+        public:
+            SampleGrid() : bits((size_t(1) << (3 * SAMPLE_BITS)) / 64, 0) {}
+
+            // Moves the first point of every occupied cell to the front of [first, last), returns how many
+            size_t Sample(Point* first, Point* last, const Cube& cube, uint32_t cells) {
+                float cellsPerUnit = cells / cube.size;
+                Point* kept = first;
+                for (Point* point = first; point != last; ++point) {
+                    uint32_t key = static_cast<uint32_t>(gridIndex(
+                        cellOf(point->x, cube.origin[0], cellsPerUnit, cells),
+                        cellOf(point->y, cube.origin[1], cellsPerUnit, cells),
+                        cellOf(point->z, cube.origin[2], cellsPerUnit, cells), cells));
+                    uint64_t mask = uint64_t(1) << (key & 63);
+                    if (bits[key >> 6] & mask) {
+                        continue;
+                    }
+                    bits[key >> 6] |= mask;
+                    touched.push_back(key);
+                    std::swap(*kept++, *point);
+                }
+
+                for (uint32_t key : touched) {
+                    bits[key >> 6] = 0;
+                }
+                touched.clear();
+                return kept - first;
+            }
+
+        private:
+            std::vector<uint64_t> bits;
+            std::vector<uint32_t> touched;
+        };
+
+        // Subtree of one chunk, node offsets count points from the start of the chunk
+        struct Subtree {
+            std::vector<Node> nodes;
+            std::vector<Point> points;
+            std::vector<Point> coarse;      // the root's points sampled at the parent's spacing
+        };
+
+        void fillNode(Node& node, const Cube& cube, uint32_t level, uint32_t parent) {
+            std::memcpy(node.minBounds, cube.origin, sizeof(node.minBounds));
+            node.size = cube.size;
+            node.spacing = cube.size / SAMPLE_GRID;
+            node.level = level;
+            node.offset = 0;
+            node.pointCount = 0;
+            node.parent = parent;
+            std::fill(std::begin(node.children), std::end(node.children), NO_NODE);
+        }
+
+        // Keeps a sample of [first, last) in a new node and recurses into the octants with the rest.
+        // Each node's points end up contiguous, followed by its children's.
+        uint32_t buildNode(Subtree& tree, size_t first, size_t last, const Cube& cube, uint32_t level, uint32_t parent,
+            SampleGrid& grid, std::vector<Point>& scratch) {
+            uint32_t index = static_cast<uint32_t>(tree.nodes.size());
+            tree.nodes.emplace_back();
+            fillNode(tree.nodes[index], cube, level, parent);
+            tree.nodes[index].offset = first;
+
+            size_t count = last - first;
+            if (count <= LEAF_MAX_POINTS || level >= MAX_LEVEL) {
+                tree.nodes[index].pointCount = static_cast<uint32_t>(count);
+                return index;
+            }
+
+            Point* points = tree.points.data();
+            size_t kept = grid.Sample(points + first, points + last, cube, SAMPLE_GRID);
+            tree.nodes[index].pointCount = static_cast<uint32_t>(kept);
+
+            // Counting sort of the remaining points by octant
+            size_t rest = first + kept;
+            size_t octantStart[9] = {};
+            for (size_t i = rest; i < last; i++) {
+                octantStart[octantOf(points[i], cube) + 1]++;
+            }
+            for (int octant = 0; octant < 8; octant++) {
+                octantStart[octant + 1] += octantStart[octant];
+            }
+            scratch.resize(last - rest);
+            size_t cursor[8];
+            std::copy(octantStart, octantStart + 8, cursor);
+            for (size_t i = rest; i < last; i++) {
+                scratch[cursor[octantOf(points[i], cube)]++] = points[i];
+            }
+            std::copy(scratch.begin(), scratch.end(), points + rest);
+
+            for (uint32_t octant = 0; octant < 8; octant++) {
+                if (octantStart[octant + 1] == octantStart[octant]) {
+                    continue;
+                }
+                uint32_t child = buildNode(tree, rest + octantStart[octant], rest + octantStart[octant + 1],
+                    childCube(cube, octant), level + 1, index, grid, scratch);
+                tree.nodes[index].children[octant] = child;
+            }
+            return index;
+        }
+
+        // A cell of the counting grid pyramid that holds too many points to be a chunk, kept as an
+        // upper node filled from its children's coarse samples
+        struct UpperNode {
+            Cube cube;
+            uint32_t level = 0;
+            uint32_t parent = NO_NODE;
+            uint32_t children[8];
+            std::vector<Point> points;
+        };
+
+        struct Chunk {
+            Cube cube;
+            uint32_t level = 0;
+            uint32_t cellMin[3] = {};       // finest grid cells covered by the chunk
+            uint32_t cellCount = 0;
+            uint64_t pointCount = 0;
+            uint32_t parent = NO_NODE;      // upper node, NO_NODE when the chunk is the whole cloud
+            uint32_t octant = 0;
+            std::string partPath;
+        };
+
+        bool cancelled(const std::atomic<bool>* cancel) {
+            return cancel && cancel->load(std::memory_order_relaxed);
+        }
+    }
+
+    std::string GetOctreePath(const std::string& plyPath) {
+        std::error_code ec;
+        std::string key = std::filesystem::absolute(plyPath, ec).lexically_normal().string();
+
+        std::ostringstream name;
+        name << std::hex << std::setw(16) << std::setfill('0') << static_cast<uint64_t>(std::hash<std::string>()(key)) << ".lxpc";
+        return (std::filesystem::path("cache/pointcloud") / name.str()).string();
+    }
+
+    bool IsUpToDate(const std::string& plyPath, const std::string& octreePath) {
+        std::ifstream file(octreePath, std::ios::binary);
+        Header header;
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+            return false;
+        }
+
+        FileStamp stamp = stampOf(plyPath);
+        return std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.version == VERSION
+            && header.sourceSize == stamp.size && header.sourceTime == stamp.time;
+    }
+
+    bool Build(const std::string& plyPath, const std::string& octreePath,
+        const std::function<void(float)>& onProgress, const std::atomic<bool>* cancel, std::string& error) {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        auto report = [&onProgress](float progress) {
+            if (onProgress) {
+                onProgress(progress);
+            }
+        };
+
+        MappedFile file;
+        if (!file.Open(plyPath)) {
+            error = "Could not open " + plyPath;
+            return false;
+        }
+
+        // Locate the vertex element
+        PlyLoader reader;
+        const char* end = file.Data() + file.Size();
+        const char* cursor = nullptr;
+        if (!reader.ParseHeader(file.Data(), end, cursor)) {
+            error = reader.GetError();
+            return false;
+        }
+
+        VertexLayout layout;
+        for (const PlyLoader::Element& element : reader.GetElements()) {
+            if (element.name != "vertex") {
+                if (!reader.SkipElement(element, cursor, end)) {
+                    error = "PLY element '" + element.name + "' is truncated";
+                    return false;
+                }
+                continue;
+            }
+            if (element.stride == 0) {
+                error = "PLY vertices with list properties are not supported";
+                return false;
+            }
+            if (static_cast<size_t>(end - cursor) / element.stride < element.count) {
+                error = "PLY vertex data is truncated";
+                return false;
+            }
+
+            layout.data = cursor;
+            layout.count = element.count;
+            layout.stride = element.stride;
+            layout.position[0] = findProperty(element, { "x" });
+            layout.position[1] = findProperty(element, { "y" });
+            layout.position[2] = findProperty(element, { "z" });
+            layout.color[0] = findProperty(element, { "red", "r", "diffuse_red" });
+            layout.color[1] = findProperty(element, { "green", "g", "diffuse_green" });
+            layout.color[2] = findProperty(element, { "blue", "b", "diffuse_blue" });
+            if (!layout.color[0] || !layout.color[1] || !layout.color[2]) {
+                layout.color[0] = layout.color[1] = layout.color[2] = nullptr;
+            }
+            break;
+        }
+        if (!layout.data || layout.count == 0) {
+            error = "PLY file has no vertices";
+            return false;
+        }
+        if (!layout.position[0] || !layout.position[1] || !layout.position[2]) {
+            error = "PLY vertices have no x/y/z properties";
+            return false;
+        }
+
+        ThreadPool& pool = ThreadPool::Shared();
+        size_t blockCount = (layout.count + READ_BLOCK_POINTS - 1) / READ_BLOCK_POINTS;
+        auto forEachTask = [&](size_t blockFirst, size_t blockLast, const std::function<void(size_t, size_t, size_t)>& body) {
+            size_t taskCount = (blockLast - blockFirst + READ_TASK_POINTS - 1) / READ_TASK_POINTS;
+            pool.ParallelFor(taskCount, [&](size_t task) {
+                size_t first = blockFirst + task * READ_TASK_POINTS;
+                body(task, first, (std::min)(first + READ_TASK_POINTS, blockLast));
+                });
+        };
+
+        // Pass 1: bounds
+        float minBounds[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+        float maxBounds[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        uint64_t validPoints = 0;
+        for (size_t block = 0; block < blockCount; block++) {
+            if (cancelled(cancel)) {
+                error = "Cancelled";
+                return false;
+            }
+
+            size_t blockFirst = block * READ_BLOCK_POINTS;
+            size_t blockLast = (std::min)(blockFirst + READ_BLOCK_POINTS, layout.count);
+            size_t taskCount = (blockLast - blockFirst + READ_TASK_POINTS - 1) / READ_TASK_POINTS;
+            std::vector<float> taskBounds(taskCount * 6);
+            std::vector<uint64_t> taskValid(taskCount, 0);
+            forEachTask(blockFirst, blockLast, [&](size_t task, size_t first, size_t last) {
+                float* bounds = &taskBounds[task * 6];
+                std::fill(bounds, bounds + 3, FLT_MAX);
+                std::fill(bounds + 3, bounds + 6, -FLT_MAX);
+                Point point;
+                for (size_t i = first; i < last; i++) {
+                    if (!readPoint(layout, i, point)) {
+                        continue;
+                    }
+                    const float position[3] = { point.x, point.y, point.z };
+                    for (int axis = 0; axis < 3; axis++) {
+                        bounds[axis] = (std::min)(bounds[axis], position[axis]);
+                        bounds[axis + 3] = (std::max)(bounds[axis + 3], position[axis]);
+                    }
+                    taskValid[task]++;
+                }
+                });
+
+            for (size_t task = 0; task < taskCount; task++) {
+                for (int axis = 0; axis < 3; axis++) {
+                    minBounds[axis] = (std::min)(minBounds[axis], taskBounds[task * 6 + axis]);
+                    maxBounds[axis] = (std::max)(maxBounds[axis], taskBounds[task * 6 + axis + 3]);
+                }
+                validPoints += taskValid[task];
+            }
+            report(0.1f * (block + 1) / blockCount);
+        }
+        if (validPoints == 0) {
+            error = "PLY file has no finite vertex positions";
+            return false;
+        }
+
+        // The octree is built over a cube around the bounds
+        Cube root;
+        float extent = (std::max)({ maxBounds[0] - minBounds[0], maxBounds[1] - minBounds[1], maxBounds[2] - minBounds[2] });
+        root.size = extent > 0.0f ? extent * 1.0001f : 1.0f;
+        for (int axis = 0; axis < 3; axis++) {
+            float center = (minBounds[axis] + maxBounds[axis]) * 0.5f;
+            root.origin[axis] = center - root.size * 0.5f;
+        }
+        float gridCellsPerUnit = GRID_SIZE / root.size;
+        auto finestCell = [&](const Point& point) {
+            return gridIndex(cellOf(point.x, root.origin[0], gridCellsPerUnit, GRID_SIZE),
+                cellOf(point.y, root.origin[1], gridCellsPerUnit, GRID_SIZE),
+                cellOf(point.z, root.origin[2], gridCellsPerUnit, GRID_SIZE), GRID_SIZE);
+        };
+
+        // Pass 2: count the points in every cell of the finest grid
+        size_t gridCells = size_t(1) << (3 * GRID_LEVELS);
+        std::unique_ptr<std::atomic<uint32_t>[]> cellCounts(new std::atomic<uint32_t>[gridCells]);
+        for (size_t i = 0; i < gridCells; i++) {
+            cellCounts[i].store(0, std::memory_order_relaxed);
+        }
+        for (size_t block = 0; block < blockCount; block++) {
+            if (cancelled(cancel)) {
+                error = "Cancelled";
+                return false;
+            }
+
+            size_t blockFirst = block * READ_BLOCK_POINTS;
+            size_t blockLast = (std::min)(blockFirst + READ_BLOCK_POINTS, layout.count);
+            forEachTask(blockFirst, blockLast, [&](size_t, size_t first, size_t last) {
+                Point point;
+                for (size_t i = first; i < last; i++) {
+                    if (readPoint(layout, i, point)) {
+                        cellCounts[finestCell(point)].fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+                });
+            report(0.1f + 0.1f * (block + 1) / blockCount);
+        }
+
+        // Count pyramid, level 0 is the whole cube
+        std::vector<std::vector<uint64_t>> pyramid(GRID_LEVELS + 1);
+        pyramid[GRID_LEVELS].resize(gridCells);
+        for (size_t i = 0; i < gridCells; i++) {
+            pyramid[GRID_LEVELS][i] = cellCounts[i].load(std::memory_order_relaxed);
+        }
+        cellCounts.reset();
+        for (uint32_t level = GRID_LEVELS; level > 0; level--) {
+            uint32_t cells = 1u << (level - 1);
+            pyramid[level - 1].assign(size_t(cells) * cells * cells, 0);
+            for (uint32_t z = 0; z < cells * 2; z++) {
+                for (uint32_t y = 0; y < cells * 2; y++) {
+                    for (uint32_t x = 0; x < cells * 2; x++) {
+                        pyramid[level - 1][gridIndex(x / 2, y / 2, z / 2, cells)] += pyramid[level][gridIndex(x, y, z, cells * 2)];
+                    }
+                }
+            }
+        }
+
+        // Split cells top-down until they are small enough to build in memory
+        std::vector<UpperNode> upperNodes;
+        std::vector<Chunk> chunks;
+        struct Cell {
+            uint32_t level, x, y, z;
+            uint32_t parent, octant;
+        };
+        std::vector<Cell> pending = { { 0, 0, 0, 0, NO_NODE, 0 } };
+        while (!pending.empty()) {
+            Cell cell = pending.back();
+            pending.pop_back();
+
+            uint32_t cells = 1u << cell.level;
+            uint64_t count = pyramid[cell.level][gridIndex(cell.x, cell.y, cell.z, cells)];
+            Cube cube;
+            cube.size = root.size / cells;
+            cube.origin[0] = root.origin[0] + cell.x * cube.size;
+            cube.origin[1] = root.origin[1] + cell.y * cube.size;
+            cube.origin[2] = root.origin[2] + cell.z * cube.size;
+
+            if (count > CHUNK_MAX_POINTS && cell.level < GRID_LEVELS) {
+                uint32_t index = static_cast<uint32_t>(upperNodes.size());
+                UpperNode node;
+                node.cube = cube;
+                node.level = cell.level;
+                node.parent = cell.parent;
+                std::fill(std::begin(node.children), std::end(node.children), NO_NODE);
+                upperNodes.push_back(std::move(node));
+                if (cell.parent != NO_NODE) {
+                    upperNodes[cell.parent].children[cell.octant] = index;
+                }
+
+                for (uint32_t octant = 0; octant < 8; octant++) {
+                    Cell child = { cell.level + 1, cell.x * 2 + (octant & 1), cell.y * 2 + ((octant >> 1) & 1), cell.z * 2 + ((octant >> 2) & 1), index, octant };
+                    if (pyramid[child.level][gridIndex(child.x, child.y, child.z, cells * 2)] > 0) {
+                        pending.push_back(child);
+                    }
+                }
+            }
+            else if (count > 0) {
+                Chunk chunk;
+                chunk.cube = cube;
+                chunk.level = cell.level;
+                chunk.cellCount = GRID_SIZE >> cell.level;
+                chunk.cellMin[0] = cell.x * chunk.cellCount;
+                chunk.cellMin[1] = cell.y * chunk.cellCount;
+                chunk.cellMin[2] = cell.z * chunk.cellCount;
+                chunk.pointCount = count;
+                chunk.parent = cell.parent;
+                chunk.octant = cell.octant;
+                chunks.push_back(std::move(chunk));
+            }
+        }
+        pyramid.clear();
+
+        std::vector<uint32_t> chunkOfCell(gridCells, NO_NODE);
+        for (uint32_t c = 0; c < chunks.size(); c++) {
+            const Chunk& chunk = chunks[c];
+            for (uint32_t z = 0; z < chunk.cellCount; z++) {
+                for (uint32_t y = 0; y < chunk.cellCount; y++) {
+                    for (uint32_t x = 0; x < chunk.cellCount; x++) {
+                        chunkOfCell[gridIndex(chunk.cellMin[0] + x, chunk.cellMin[1] + y, chunk.cellMin[2] + z, GRID_SIZE)] = c;
+                    }
+                }
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::path partDirectory = octreePath + ".parts";
+        std::filesystem::create_directories(partDirectory, ec);
+        for (size_t c = 0; c < chunks.size(); c++) {
+            chunks[c].partPath = (partDirectory / ("chunk" + std::to_string(c) + ".bin")).string();
+            std::filesystem::remove(chunks[c].partPath, ec);
+        }
+        auto removeParts = [&partDirectory]() {
+            std::error_code removeError;
+            std::filesystem::remove_all(partDirectory, removeError);
+        };
+
+        // Pass 3: scatter the points into one part file per chunk
+        {
+            std::vector<Point> points(READ_BLOCK_POINTS);
+            std::vector<Point> sorted(READ_BLOCK_POINTS);
+            std::vector<uint32_t> pointChunk(READ_BLOCK_POINTS);
+            std::vector<size_t> chunkStart(chunks.size() + 1);
+
+            for (size_t block = 0; block < blockCount; block++) {
+                if (cancelled(cancel)) {
+                    removeParts();
+                    error = "Cancelled";
+                    return false;
+                }
+
+                size_t blockFirst = block * READ_BLOCK_POINTS;
+                size_t blockLast = (std::min)(blockFirst + READ_BLOCK_POINTS, layout.count);
+                forEachTask(blockFirst, blockLast, [&](size_t, size_t first, size_t last) {
+                    for (size_t i = first; i < last; i++) {
+                        Point& point = points[i - blockFirst];
+                        pointChunk[i - blockFirst] = readPoint(layout, i, point) ? chunkOfCell[finestCell(point)] : NO_NODE;
+                    }
+                    });
+
+                size_t blockSize = blockLast - blockFirst;
+                std::fill(chunkStart.begin(), chunkStart.end(), 0);
+                for (size_t i = 0; i < blockSize; i++) {
+                    if (pointChunk[i] != NO_NODE) {
+                        chunkStart[pointChunk[i] + 1]++;
+                    }
+                }
+                for (size_t c = 0; c < chunks.size(); c++) {
+                    chunkStart[c + 1] += chunkStart[c];
+                }
+                std::vector<size_t> chunkCursor(chunkStart.begin(), chunkStart.end() - 1);
+                for (size_t i = 0; i < blockSize; i++) {
+                    if (pointChunk[i] != NO_NODE) {
+                        sorted[chunkCursor[pointChunk[i]]++] = points[i];
+                    }
+                }
+
+                for (size_t c = 0; c < chunks.size(); c++) {
+                    size_t count = chunkStart[c + 1] - chunkStart[c];
+                    if (count == 0) {
+                        continue;
+                    }
+                    std::ofstream part(chunks[c].partPath, std::ios::binary | std::ios::app);
+                    if (!part.write(reinterpret_cast<const char*>(sorted.data() + chunkStart[c]), count * sizeof(Point))) {
+                        removeParts();
+                        error = "Failed to write point cloud part file: " + chunks[c].partPath;
+                        return false;
+                    }
+                }
+                report(0.2f + 0.3f * (block + 1) / blockCount);
+            }
+        }
+        file.Close();
+        chunkOfCell.clear();
+        chunkOfCell.shrink_to_fit();
+
+        std::filesystem::create_directories(std::filesystem::path(octreePath).parent_path(), ec);
+        std::string tempPath = octreePath + ".tmp";
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        Header header = {};
+        if (!out.write(reinterpret_cast<const char*>(&header), sizeof(header))) {
+            removeParts();
+            error = "Failed to create point cloud octree: " + tempPath;
+            return false;
+        }
+
+        // Pass 4: build the chunk subtrees in parallel, appending each to the output as it completes
+        std::vector<Node> nodes(upperNodes.size());
+        std::vector<uint32_t> chunkRoot(chunks.size(), NO_NODE);
+        std::vector<std::vector<Point>> chunkCoarse(chunks.size());
+        uint64_t dataEnd = sizeof(Header);
+        uint64_t pointsDone = 0;
+        std::atomic<bool> writeFailed{ false };
+        std::mutex outputMutex;
+
+        // Largest chunks first, so one big chunk does not finish alone at the end
+        std::vector<size_t> chunkOrder(chunks.size());
+        for (size_t c = 0; c < chunks.size(); c++) {
+            chunkOrder[c] = c;
+        }
+        std::sort(chunkOrder.begin(), chunkOrder.end(), [&chunks](size_t a, size_t b) {
+            return chunks[a].pointCount > chunks[b].pointCount;
+        });
+
+        pool.ParallelFor(chunks.size(), [&](size_t order) {
+            if (cancelled(cancel) || writeFailed) {
+                return;
+            }
+
+            size_t c = chunkOrder[order];
+            const Chunk& chunk = chunks[c];
+            Subtree tree;
+            {
+                std::ifstream part(chunk.partPath, std::ios::binary);
+                tree.points.resize(chunk.pointCount);
+                if (!part.read(reinterpret_cast<char*>(tree.points.data()), chunk.pointCount * sizeof(Point))) {
+                    writeFailed = true;
+                    return;
+                }
+            }
+
+            SampleGrid grid;
+            std::vector<Point> scratch;
+            buildNode(tree, 0, tree.points.size(), chunk.cube, chunk.level, NO_NODE, grid, scratch);
+
+            const Node& rootNode = tree.nodes[0];
+            tree.coarse.assign(tree.points.begin(), tree.points.begin() + rootNode.pointCount);
+            tree.coarse.resize(grid.Sample(tree.coarse.data(), tree.coarse.data() + tree.coarse.size(), chunk.cube, SAMPLE_GRID / 2));
+
+            std::lock_guard<std::mutex> lock(outputMutex);
+            if (!out.write(reinterpret_cast<const char*>(tree.points.data()), tree.points.size() * sizeof(Point))) {
+                writeFailed = true;
+                return;
+            }
+
+            uint32_t base = static_cast<uint32_t>(nodes.size());
+            for (Node node : tree.nodes) {
+                node.offset = dataEnd + node.offset * sizeof(Point);
+                node.parent = node.parent == NO_NODE ? chunk.parent : node.parent + base;
+                for (uint32_t& child : node.children) {
+                    if (child != NO_NODE) {
+                        child += base;
+                    }
+                }
+                nodes.push_back(node);
+            }
+            dataEnd += tree.points.size() * sizeof(Point);
+            chunkRoot[c] = base;
+            chunkCoarse[c] = std::move(tree.coarse);
+
+            pointsDone += chunk.pointCount;
+            report(0.5f + 0.45f * pointsDone / validPoints);
+            }, CHUNK_CONCURRENCY);
+
+        removeParts();
+        if (cancelled(cancel) || writeFailed) {
+            out.close();
+            std::filesystem::remove(tempPath, ec);
+            error = writeFailed ? "Failed to write point cloud octree: " + tempPath : "Cancelled";
+            return false;
+        }
+
+        // Upper nodes, children before parents: one sampling cell of a node covers 2^3 cells of
+        // its children, so the union of the children's coarse samples is the node's sample
+        for (size_t c = 0; c < chunks.size(); c++) {
+            if (chunks[c].parent != NO_NODE) {
+                UpperNode& upper = upperNodes[chunks[c].parent];
+                upper.children[chunks[c].octant] = chunkRoot[c];
+                upper.points.insert(upper.points.end(), chunkCoarse[c].begin(), chunkCoarse[c].end());
+            }
+        }
+        chunkCoarse.clear();
+        for (size_t u = upperNodes.size(); u-- > 0;) {
+            UpperNode& upper = upperNodes[u];
+            for (uint32_t child : upper.children) {
+                if (child == NO_NODE || child >= upperNodes.size()) {
+                    continue;
+                }
+                std::vector<Point> coarse = upperNodes[child].points;
+                SampleGrid grid;
+                coarse.resize(grid.Sample(coarse.data(), coarse.data() + coarse.size(), upperNodes[child].cube, SAMPLE_GRID / 2));
+                upper.points.insert(upper.points.end(), coarse.begin(), coarse.end());
+            }
+        }
+
+        for (size_t u = 0; u < upperNodes.size(); u++) {
+            const UpperNode& upper = upperNodes[u];
+            Node& node = nodes[u];
+            fillNode(node, upper.cube, upper.level, upper.parent);
+            std::copy(std::begin(upper.children), std::end(upper.children), node.children);
+            node.offset = dataEnd;
+            node.pointCount = static_cast<uint32_t>(upper.points.size());
+            out.write(reinterpret_cast<const char*>(upper.points.data()), upper.points.size() * sizeof(Point));
+            dataEnd += upper.points.size() * sizeof(Point);
+        }
+
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.hasColor = layout.color[0] ? 1 : 0;
+        FileStamp stamp = stampOf(plyPath);
+        header.sourceSize = stamp.size;
+        header.sourceTime = stamp.time;
+        header.pointCount = validPoints;
+        header.nodeTableOffset = dataEnd;
+        header.nodeCount = static_cast<uint32_t>(nodes.size());
+        std::memcpy(header.minBounds, minBounds, sizeof(minBounds));
+        std::memcpy(header.maxBounds, maxBounds, sizeof(maxBounds));
+
+        out.write(reinterpret_cast<const char*>(nodes.data()), nodes.size() * sizeof(Node));
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.close();
+        if (!out) {
+            std::filesystem::remove(tempPath, ec);
+            error = "Failed to write point cloud octree: " + tempPath;
+            return false;
+        }
+
+        std::filesystem::rename(tempPath, octreePath, ec);
+        if (ec) {
+            std::filesystem::remove(tempPath, ec);
+            error = "Failed to replace point cloud octree: " + octreePath;
+            return false;
+        }
+        report(1.0f);
+
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - startTime);
+        std::cout << "Built point cloud octree in " << duration.count() << "ms: " << validPoints << " points, "
+            << nodes.size() << " nodes, " << chunks.size() << " chunk(s)" << std::endl;
+        return true;
+    }
+}
\ No newline at end of file
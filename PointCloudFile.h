@@ -0,0 +1,60 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <functional>
+#include <atomic>
+
+// On-disk LOD octree for point clouds too large to hold in memory. The file holds a header, the
+// points of every node (each node's points contiguous) and a node table at the end.
+// A node keeps a grid-sampled subset of the points inside it and hands the rest to its children,
+// so drawing a node and any resident descendants adds detail without repeating points. Nodes
+// above the build chunks hold copies of their children's coarsest points instead.
+namespace PointCloudFile {
+    const char MAGIC[8] = { 'L', 'X', 'P', 'C', 'L', 'D', '\0', '\0' };
+    const uint32_t VERSION = 1;
+    const uint32_t NO_NODE = 0xFFFFFFFFu;
+
+    struct Point {
+        float x, y, z;
+        uint8_t r, g, b, a;
+    };
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t hasColor;
+        uint64_t sourceSize;
+        int64_t sourceTime;
+        uint64_t pointCount;        // points in the source file; coarse levels add copies on top
+        uint64_t nodeTableOffset;
+        uint32_t nodeCount;
+        uint32_t reserved;
+        float minBounds[3];         // tight bounds of the source points
+        float maxBounds[3];
+    };
+
+    struct Node {
+        float minBounds[3];         // nodes are cubes
+        float size;
+        float spacing;              // minimum distance between the node's own points
+        uint32_t level;
+        uint64_t offset;            // byte offset of the node's points in the file
+        uint32_t pointCount;
+        uint32_t parent;
+        uint32_t children[8];       // NO_NODE for empty octants
+    };
+
+    static_assert(sizeof(Point) == 16, "points are stored byte for byte");
+
+    // Octree file for a PLY, under cache/pointcloud and named after a hash of its absolute path
+    std::string GetOctreePath(const std::string& plyPath);
+
+    // True if octreePath exists, has the current version and was built from the current plyPath
+    bool IsUpToDate(const std::string& plyPath, const std::string& octreePath);
+
+    // Builds the octree for a binary little-endian PLY with x/y/z (and optional red/green/blue)
+    // vertex properties. Reads the source in blocks, so the PLY may be far larger than memory.
+    // onProgress receives 0..1; returns false with error set on failure or cancellation.
+    bool Build(const std::string& plyPath, const std::string& octreePath,
+        const std::function<void(float)>& onProgress, const std::atomic<bool>* cancel, std::string& error);
+}
\ No newline at end of file
@@ -0,0 +1,387 @@
+#include "StlLoader.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    const size_t HEADER_BYTES = 84;
+    const size_t TRIANGLE_BYTES = 50;
+    const size_t CORNER_OFFSET = 12;            // corners follow the facet normal
+    const size_t TRIANGLE_BLOCK = 65536;        // triangles per parallel work item
+    const unsigned int PARTITION_BITS = 8;
+    const size_t PARTITION_COUNT = size_t(1) << PARTITION_BITS;
+
+    struct Position {
+        float x, y, z;
+
+        bool operator==(const Position& other) const {
+            return std::memcmp(this, &other, sizeof(Position)) == 0;
+        }
+    };
+
+    // A corner welds with another only when both the position and the facet normal match, so
+    // coplanar triangles share vertices while hard edges keep one vertex per side
+    struct Corner {
+        Position position;
+        Position normal;
+
+        bool operator==(const Corner& other) const {
+            return std::memcmp(this, &other, sizeof(Corner)) == 0;
+        }
+    };
+
+    void foldNegativeZero(Position& p) {
+        if (p.x == 0.0f) p.x = 0.0f;
+        if (p.y == 0.0f) p.y = 0.0f;
+        if (p.z == 0.0f) p.z = 0.0f;
+    }
+
+    Position readPosition(const char* data) {
+        Position p;
+        std::memcpy(&p, data, sizeof(Position));
+        return p;
+    }
+
+    // The facet normal stored in the file, unit length; exporters that write zero normals get one
+    // from the winding of the corners instead
+    Position facetNormal(const char* triangle) {
+        Position stored = readPosition(triangle);
+        glm::vec3 n(stored.x, stored.y, stored.z);
+        float length = glm::length(n);
+        if (!(length > 0.0f) || !std::isfinite(length)) {
+            Position a = readPosition(triangle + CORNER_OFFSET);
+            Position b = readPosition(triangle + CORNER_OFFSET + sizeof(Position));
+            Position c = readPosition(triangle + CORNER_OFFSET + 2 * sizeof(Position));
+            n = glm::cross(glm::vec3(b.x - a.x, b.y - a.y, b.z - a.z), glm::vec3(c.x - a.x, c.y - a.y, c.z - a.z));
+            length = glm::length(n);
+            if (!(length > 0.0f) || !std::isfinite(length)) {
+                n = glm::vec3(0.0f, 0.0f, 1.0f);
+                length = 1.0f;
+            }
+        }
+        n = n / length;
+        Position p = { n.x, n.y, n.z };
+        foldNegativeZero(p);
+        return p;
+    }
+
+    // Corners compare by bit pattern, with -0 folded into +0 so both weld together
+    Corner readCorner(const char* triangles, size_t corner) {
+        const char* triangle = triangles + (corner / 3) * TRIANGLE_BYTES;
+        Corner c;
+        c.position = readPosition(triangle + CORNER_OFFSET + (corner % 3) * sizeof(Position));
+        foldNegativeZero(c.position);
+        c.normal = facetNormal(triangle);
+        return c;
+    }
+
+    Position cornerPosition(const char* triangles, size_t corner) {
+        Position p = readPosition(triangles + (corner / 3) * TRIANGLE_BYTES + CORNER_OFFSET + (corner % 3) * sizeof(Position));
+        foldNegativeZero(p);
+        return p;
+    }
+
+    uint32_t hashCorner(const Corner& c) {
+        uint32_t bits[6];
+        std::memcpy(bits, &c, sizeof(bits));
+        uint64_t h = bits[0] * 0x9E3779B97F4A7C15ull;
+        h ^= bits[1] * 0xC2B2AE3D27D4EB4Full;
+        h ^= bits[2] * 0x165667B19E3779F9ull;
+        h = (h ^ (h >> 31)) * 0x94D049BB133111EBull;
+        h ^= bits[3] * 0x9E3779B97F4A7C15ull;
+        h ^= bits[4] * 0xC2B2AE3D27D4EB4Full;
+        h ^= bits[5] * 0x165667B19E3779F9ull;
+        h ^= h >> 29;
+        h *= 0xBF58476D1CE4E5B9ull;
+        return static_cast<uint32_t>(h ^ (h >> 32));
+    }
+
+    size_t partitionOf(uint32_t hash) {
+        return hash >> (32 - PARTITION_BITS);
+    }
+
+    // Open-addressing map from a corner key to the first corner found with it, for one partition
+    class WeldTable {
+    public:
+        explicit WeldTable(size_t expectedEntries) {
+            size_t capacity = 64;
+            while (capacity * 3 < expectedEntries * 4) {
+                capacity *= 2;
+            }
+            slots.assign(capacity, Slot{ {}, EMPTY });
+            mask = capacity - 1;
+        }
+
+        uint32_t FindOrInsert(const Corner& key, uint32_t hash, uint32_t corner) {
+            if ((count + 1) * 4 > slots.size() * 3) {
+                grow();
+            }
+
+            size_t slot = hash & mask;
+            while (true) {
+                Slot& entry = slots[slot];
+                if (entry.corner == EMPTY) {
+                    entry.key = key;
+                    entry.corner = corner;
+                    count++;
+                    return corner;
+                }
+                if (entry.key == key) {
+                    return entry.corner;
+                }
+                slot = (slot + 1) & mask;
+            }
+        }
+
+    private:
+        static const uint32_t EMPTY = 0xFFFFFFFFu;
+
+        struct Slot {
+            Corner key;
+            uint32_t corner;
+        };
+
+        void grow() {
+            std::vector<Slot> old(slots.size() * 2, Slot{ {}, EMPTY });
+            old.swap(slots);
+            mask = slots.size() - 1;
+            for (const Slot& entry : old) {
+                if (entry.corner != EMPTY) {
+                    size_t slot = hashCorner(entry.key) & mask;
+                    while (slots[slot].corner != EMPTY) {
+                        slot = (slot + 1) & mask;
+                    }
+                    slots[slot] = entry;
+                }
+            }
+        }
+
+        std::vector<Slot> slots;
+        size_t mask = 0;
+        size_t count = 0;
+    };
+}
+
+void StlLoader::SetProgressCallback(std::function<void(float)> callback) {
+    progressCallback = callback;
+}
+
+void StlLoader::SetCancelFlag(const std::atomic<bool>* flag) {
+    cancelFlag = flag;
+}
+
+bool StlLoader::fail(const std::string& message) {
+    error = message;
+    return false;
+}
+
+void StlLoader::reportProgress(float progress) const {
+    if (progressCallback) {
+        progressCallback(progress);
+    }
+}
+
+bool StlLoader::openBinary(const std::string& path, MappedFile& file, uint32_t& triangleCount) {
+    if (!file.Open(path)) {
+        return fail("Could not open " + path);
+    }
+    if (file.Size() < HEADER_BYTES) {
+        return fail("File too small for a binary STL: " + path);
+    }
+
+    std::memcpy(&triangleCount, file.Data() + 80, sizeof(triangleCount));
+    uint64_t expectedSize = HEADER_BYTES + uint64_t(triangleCount) * TRIANGLE_BYTES;
+
+    // ASCII files start with "solid"; some binary exporters do too, but then the size still matches
+    bool solidHeader = std::memcmp(file.Data(), "solid", 5) == 0;
+    if (file.Size() < expectedSize || (solidHeader && file.Size() != expectedSize)) {
+        return fail("Not a binary STL file: " + path);
+    }
+    if (triangleCount == 0) {
+        return fail("STL file has no triangles: " + path);
+    }
+    if (triangleCount > 0xFFFFFFFEu / 3) {
+        return fail("STL file has more corners than 32-bit indices can address: " + path);
+    }
+    return true;
+}
+
+bool StlLoader::ReadTriangles(const std::string& path, const std::function<bool(const glm::vec3*, size_t)>& emit) {
+    error.clear();
+
+    MappedFile file;
+    uint32_t triangleCount = 0;
+    if (!openBinary(path, file, triangleCount)) {
+        return false;
+    }
+
+    const char* triangles = file.Data() + HEADER_BYTES;
+    std::vector<glm::vec3> corners;
+    corners.reserve(TRIANGLE_BLOCK * 3);
+    for (size_t first = 0; first < triangleCount; first += TRIANGLE_BLOCK) {
+        if (isCancelled()) {
+            return fail("Cancelled");
+        }
+
+        size_t last = std::min(first + TRIANGLE_BLOCK, size_t(triangleCount));
+        corners.resize((last - first) * 3);
+        for (size_t corner = first * 3; corner < last * 3; corner++) {
+            Position p = cornerPosition(triangles, corner);
+            corners[corner - first * 3] = glm::vec3(p.x, p.y, p.z);
+        }
+        if (!emit(corners.data(), last - first)) {
+            return fail("Cancelled");
+        }
+        reportProgress(static_cast<float>(last) / triangleCount);
+    }
+    return true;
+}
+
+bool StlLoader::Load(const std::string& path, std::vector<MeshData>& meshes) {
+    error.clear();
+
+    MappedFile file;
+    uint32_t triangleCount = 0;
+    if (!openBinary(path, file, triangleCount)) {
+        return false;
+    }
+
+    const char* triangles = file.Data() + HEADER_BYTES;
+    const size_t cornerCount = size_t(triangleCount) * 3;
+    const size_t blockCount = (triangleCount + TRIANGLE_BLOCK - 1) / TRIANGLE_BLOCK;
+    ThreadPool& pool = ThreadPool::Shared();
+
+    // Welding runs in parallel by splitting the corners into partitions on the top bits of their
+    // key hash: equal keys always land in the same partition, so each partition is welded
+    // on its own. Every pass is a parallel loop over triangle blocks or over partitions.
+    std::vector<uint32_t> hashes(cornerCount);
+    std::vector<uint32_t> blockPartitionCounts(blockCount * PARTITION_COUNT, 0);
+    pool.ParallelFor(blockCount, [&](size_t block) {
+        size_t first = block * TRIANGLE_BLOCK * 3;
+        size_t last = std::min(first + TRIANGLE_BLOCK * 3, cornerCount);
+        uint32_t* counts = &blockPartitionCounts[block * PARTITION_COUNT];
+        for (size_t corner = first; corner < last; corner++) {
+            uint32_t hash = hashCorner(readCorner(triangles, corner));
+            hashes[corner] = hash;
+            counts[partitionOf(hash)]++;
+        }
+    });
+    if (isCancelled()) {
+        return fail("Cancelled");
+    }
+    reportProgress(0.2f);
+
+    // Corners grouped by partition, in file order within each partition
+    std::vector<size_t> partitionStart(PARTITION_COUNT + 1, 0);
+    std::vector<uint32_t> blockPartitionOffsets(blockCount * PARTITION_COUNT);
+    {
+        size_t offset = 0;
+        for (size_t partition = 0; partition < PARTITION_COUNT; partition++) {
+            partitionStart[partition] = offset;
+            for (size_t block = 0; block < blockCount; block++) {
+                blockPartitionOffsets[block * PARTITION_COUNT + partition] = static_cast<uint32_t>(offset);
+                offset += blockPartitionCounts[block * PARTITION_COUNT + partition];
+            }
+        }
+        partitionStart[PARTITION_COUNT] = offset;
+    }
+
+    std::vector<uint32_t> order(cornerCount);
+    pool.ParallelFor(blockCount, [&](size_t block) {
+        size_t first = block * TRIANGLE_BLOCK * 3;
+        size_t last = std::min(first + TRIANGLE_BLOCK * 3, cornerCount);
+        uint32_t* offsets = &blockPartitionOffsets[block * PARTITION_COUNT];
+        for (size_t corner = first; corner < last; corner++) {
+            order[offsets[partitionOf(hashes[corner])]++] = static_cast<uint32_t>(corner);
+        }
+    });
+    blockPartitionCounts = std::vector<uint32_t>();
+    blockPartitionOffsets = std::vector<uint32_t>();
+    if (isCancelled()) {
+        return fail("Cancelled");
+    }
+    reportProgress(0.35f);
+
+    // Each corner is mapped to the first corner with the same position and facet normal
+    std::vector<unsigned int> indices(cornerCount);
+    pool.ParallelFor(PARTITION_COUNT, [&](size_t partition) {
+        size_t first = partitionStart[partition];
+        size_t last = partitionStart[partition + 1];
+        // Closed meshes share each position between about six triangles
+        WeldTable table((last - first) / 4);
+        for (size_t i = first; i < last; i++) {
+            uint32_t corner = order[i];
+            indices[corner] = table.FindOrInsert(readCorner(triangles, corner), hashes[corner], corner);
+        }
+    });
+    hashes = std::vector<uint32_t>();
+    if (isCancelled()) {
+        return fail("Cancelled");
+    }
+    reportProgress(0.6f);
+
+    // Vertices are numbered in order of first appearance, which keeps the index buffer cache friendly
+    std::vector<uint32_t> blockVertexStart(blockCount + 1, 0);
+    pool.ParallelFor(blockCount, [&](size_t block) {
+        size_t first = block * TRIANGLE_BLOCK * 3;
+        size_t last = std::min(first + TRIANGLE_BLOCK * 3, cornerCount);
+        uint32_t unique = 0;
+        for (size_t corner = first; corner < last; corner++) {
+            if (indices[corner] == corner) {
+                unique++;
+            }
+        }
+        blockVertexStart[block + 1] = unique;
+    });
+    for (size_t block = 0; block < blockCount; block++) {
+        blockVertexStart[block + 1] += blockVertexStart[block];
+    }
+
+    const size_t vertexCount = blockVertexStart[blockCount];
+    std::vector<Vertex> vertices(vertexCount);
+    std::vector<uint32_t>& vertexOfCorner = order;     // reused: new vertex index of each first corner
+    pool.ParallelFor(blockCount, [&](size_t block) {
+        size_t first = block * TRIANGLE_BLOCK * 3;
+        size_t last = std::min(first + TRIANGLE_BLOCK * 3, cornerCount);
+        uint32_t next = blockVertexStart[block];
+        for (size_t corner = first; corner < last; corner++) {
+            if (indices[corner] == corner) {
+                Corner c = readCorner(triangles, corner);
+                Vertex& vertex = vertices[next];
+                vertex.Position = glm::vec3(c.position.x, c.position.y, c.position.z);
+                vertex.Normal = glm::vec3(c.normal.x, c.normal.y, c.normal.z);
+                vertex.TexCoords = glm::vec2(0.0f);
+                vertex.Tangent = glm::vec3(1.0f, 0.0f, 0.0f);
+                vertex.Bitangent = glm::vec3(0.0f, 1.0f, 0.0f);
+                vertexOfCorner[corner] = next++;
+            }
+        }
+    });
+
+    // Every corner takes the number of the first corner with its key
+    pool.ParallelFor(blockCount, [&](size_t block) {
+        size_t first = block * TRIANGLE_BLOCK * 3;
+        size_t last = std::min(first + TRIANGLE_BLOCK * 3, cornerCount);
+        for (size_t corner = first; corner < last; corner++) {
+            indices[corner] = vertexOfCorner[indices[corner]];
+        }
+    });
+    order = std::vector<uint32_t>();
+    if (isCancelled()) {
+        return fail("Cancelled");
+    }
+    reportProgress(1.0f);
+
+    std::cout << "Welded " << cornerCount << " STL corners into " << vertexCount << " vertices" << std::endl;
+
+    MeshData mesh;
+    mesh.vertices = std::move(vertices);
+    mesh.indices = std::move(indices);
+    meshes.clear();
+    meshes.push_back(std::move(mesh));
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <functional>
+#include <atomic>
+#include "Mesh.h"
+
+class MappedFile;
+
+// Binary STL reader. The file is memory-mapped and read in place: an 80-byte header, a triangle
+// count, then 50 bytes per triangle (facet normal, three corners, attribute word). STL stores
+// every corner of every triangle, so corners with the same position and facet normal are welded
+// through a hash of both, and the vertices keep the facet normals: flat regions share vertices while
+// hard edges stay sharp. ASCII STL is left to Assimp.
+class StlLoader {
+public:
+    StlLoader() = default;
+    StlLoader(const StlLoader&) = delete;
+    StlLoader& operator=(const StlLoader&) = delete;
+
+    // One mesh for the whole file; false for ASCII or malformed files, with the reason in GetError()
+    bool Load(const std::string& path, std::vector<MeshData>& meshes);
+
+    // Hands out the corner positions of every triangle in batches, without welding; emit returning
+    // false stops the read as cancelled
+    bool ReadTriangles(const std::string& path, const std::function<bool(const glm::vec3*, size_t)>& emit);
+
+    const std::string& GetError() const { return error; }
+
+    void SetProgressCallback(std::function<void(float)> callback);
+    void SetCancelFlag(const std::atomic<bool>* flag);
+
+private:
+    std::string error;
+    std::function<void(float)> progressCallback;
+    const std::atomic<bool>* cancelFlag = nullptr;
+
+    bool fail(const std::string& message);
+    bool isCancelled() const { return cancelFlag && cancelFlag->load(std::memory_order_relaxed); }
+    void reportProgress(float progress) const;
+    bool openBinary(const std::string& path, MappedFile& file, uint32_t& triangleCount);
+};
\ No newline at end of file
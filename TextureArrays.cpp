@@ -0,0 +1,381 @@
+#include <glad/glad.h>
+#include "TextureArrays.h"
+#include "TextureStreamer.h"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <cstdint>
+#include <map>
+#include <tuple>
+
+namespace TextureArrays {
+    namespace {
+        const char* SLOT_TYPES[SLOT_COUNT] = {
+            "texture_diffuse", "texture_specular", "texture_normal", "texture_height",
+            "texture_emission", "texture_roughness", "texture_metallic", "texture_ao"
+        };
+        const int MAX_LEVELS = 16;
+
+        std::atomic<bool> enabled{ true };
+        unsigned int boundArrays[SLOT_COUNT] = {};
+
+        // A texture the meshes sample, as it is on the GPU
+        struct Source {
+            unsigned int texture = 0;
+            GLenum target = GL_TEXTURE_2D;      // GL_TEXTURE_2D_ARRAY for a layer of an earlier pack
+            int layer = 0;
+            int layerCount = 1;
+            int slot = 0;
+            int width = 0;
+            int height = 0;
+            int levels = 0;
+            GLint internalFormat = 0;
+            bool compressed = false;
+            GLenum format = 0;                  // transfer format of an uncompressed texture
+            size_t levelBytes[MAX_LEVELS] = {}; // size of one layer of each level
+            unsigned int array = 0;             // where it is packed
+            int arrayLayer = -1;
+            unsigned int copy = 0;              // the 2D texture a layer is unpacked into
+        };
+
+        // Transfer format and pixel size of an uncompressed internal format, false if it is not packed
+        bool pixelTransfer(GLint internalFormat, GLenum& format, int& pixelBytes) {
+            switch (internalFormat) {
+            case GL_RED: case GL_R8:
+                format = GL_RED; pixelBytes = 1; return true;
+            case GL_RG: case GL_RG8:
+                format = GL_RG; pixelBytes = 2; return true;
+            case GL_RGB: case GL_RGB8: case GL_SRGB: case GL_SRGB8:
+                format = GL_RGB; pixelBytes = 3; return true;
+            case GL_RGBA: case GL_RGBA8: case GL_SRGB_ALPHA: case GL_SRGB8_ALPHA8:
+                format = GL_RGBA; pixelBytes = 4; return true;
+            default:
+                return false;
+            }
+        }
+
+        // Reads size, format and levels of a texture; false if it cannot be packed
+        bool describe(const Texture& texture, Source& source) {
+            source.texture = texture.id;
+            source.target = texture.layer >= 0 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+            source.layer = (std::max)(texture.layer, 0);
+            glBindTexture(source.target, texture.id);
+
+            GLint maxLevel = 0, compressed = 0;
+            glGetTexParameteriv(source.target, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+            glGetTexLevelParameteriv(source.target, 0, GL_TEXTURE_WIDTH, &source.width);
+            glGetTexLevelParameteriv(source.target, 0, GL_TEXTURE_HEIGHT, &source.height);
+            glGetTexLevelParameteriv(source.target, 0, GL_TEXTURE_INTERNAL_FORMAT, &source.internalFormat);
+            glGetTexLevelParameteriv(source.target, 0, GL_TEXTURE_COMPRESSED, &compressed);
+            if (source.target == GL_TEXTURE_2D_ARRAY) {
+                glGetTexLevelParameteriv(source.target, 0, GL_TEXTURE_DEPTH, &source.layerCount);
+            }
+            source.compressed = compressed != 0;
+
+            // Streamed textures change their levels after this, they stay 2D even while fully resident
+            int pixelBytes = 0;
+            bool packable = !TextureStreamer::IsStreamed(texture.id) && source.width > 0 && source.height > 0 && source.layerCount > 0 &&
+                (source.compressed || pixelTransfer(source.internalFormat, source.format, pixelBytes));
+
+            source.levels = 0;
+            while (packable && source.levels < MAX_LEVELS && source.levels <= maxLevel) {
+                int level = source.levels;
+                GLint width = 0, height = 0;
+                glGetTexLevelParameteriv(source.target, level, GL_TEXTURE_WIDTH, &width);
+                glGetTexLevelParameteriv(source.target, level, GL_TEXTURE_HEIGHT, &height);
+                if (width != (std::max)(source.width >> level, 1) || height != (std::max)(source.height >> level, 1)) {
+                    break;
+                }
+                if (source.compressed) {
+                    GLint imageSize = 0;
+                    glGetTexLevelParameteriv(source.target, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &imageSize);
+                    source.levelBytes[level] = static_cast<size_t>(imageSize) / source.layerCount;
+                }
+                else {
+                    source.levelBytes[level] = static_cast<size_t>(width) * height * pixelBytes;
+                }
+                source.levels++;
+            }
+            glBindTexture(source.target, 0);
+            return packable && source.levels > 0;
+        }
+
+        GLTexture createArray(const Source& shape, int layers) {
+            GLTexture array = GLTexture::Create();
+            glBindTexture(GL_TEXTURE_2D_ARRAY, array.Get());
+            for (int level = 0; level < shape.levels; level++) {
+                int width = (std::max)(shape.width >> level, 1);
+                int height = (std::max)(shape.height >> level, 1);
+                if (shape.compressed) {
+                    glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, shape.internalFormat, width, height, layers, 0,
+                        static_cast<GLsizei>(shape.levelBytes[level] * layers), nullptr);
+                }
+                else {
+                    glTexImage3D(GL_TEXTURE_2D_ARRAY, level, shape.internalFormat, width, height, layers, 0,
+                        shape.format, GL_UNSIGNED_BYTE, nullptr);
+                }
+            }
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, shape.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, shape.levels - 1);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+            return array;
+        }
+
+        GLTexture createTexture(const Source& shape) {
+            GLTexture texture = GLTexture::Create();
+            glBindTexture(GL_TEXTURE_2D, texture.Get());
+            for (int level = 0; level < shape.levels; level++) {
+                int width = (std::max)(shape.width >> level, 1);
+                int height = (std::max)(shape.height >> level, 1);
+                if (shape.compressed) {
+                    glCompressedTexImage2D(GL_TEXTURE_2D, level, shape.internalFormat, width, height, 0,
+                        static_cast<GLsizei>(shape.levelBytes[level]), nullptr);
+                }
+                else {
+                    glTexImage2D(GL_TEXTURE_2D, level, shape.internalFormat, width, height, 0,
+                        shape.format, GL_UNSIGNED_BYTE, nullptr);
+                }
+            }
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, shape.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, shape.levels - 1);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            return texture;
+        }
+
+        // Copies every level of one source texture into the arrays its layers were given, or into their 2D
+        // copies when unpacking. Each level is read into the pixel buffer once and written to the layers from
+        // there, without a trip through system memory.
+        void copyTexture(const std::vector<Source*>& layers, unsigned int pixelBuffer) {
+            const Source& shape = *layers.front();
+            for (int level = 0; level < shape.levels; level++) {
+                int width = (std::max)(shape.width >> level, 1);
+                int height = (std::max)(shape.height >> level, 1);
+                size_t layerBytes = shape.levelBytes[level];
+
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffer);
+                glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(layerBytes * shape.layerCount), nullptr, GL_STREAM_COPY);
+                glBindTexture(shape.target, shape.texture);
+                if (shape.compressed) {
+                    glGetCompressedTexImage(shape.target, level, nullptr);
+                }
+                else {
+                    glGetTexImage(shape.target, level, shape.format, GL_UNSIGNED_BYTE, nullptr);
+                }
+                glBindTexture(shape.target, 0);
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+                for (const Source* source : layers) {
+                    const void* offset = reinterpret_cast<const void*>(source->layer * layerBytes);
+                    if (source->copy != 0) {
+                        glBindTexture(GL_TEXTURE_2D, source->copy);
+                        if (shape.compressed) {
+                            glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height,
+                                shape.internalFormat, static_cast<GLsizei>(layerBytes), offset);
+                        }
+                        else {
+                            glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, shape.format, GL_UNSIGNED_BYTE, offset);
+                        }
+                        glBindTexture(GL_TEXTURE_2D, 0);
+                        continue;
+                    }
+                    glBindTexture(GL_TEXTURE_2D_ARRAY, source->array);
+                    if (shape.compressed) {
+                        glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, source->arrayLayer, width, height, 1,
+                            shape.internalFormat, static_cast<GLsizei>(layerBytes), offset);
+                    }
+                    else {
+                        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, source->arrayLayer, width, height, 1,
+                            shape.format, GL_UNSIGNED_BYTE, offset);
+                    }
+                }
+                glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            }
+        }
+    }
+
+    int SlotForType(const std::string& type) {
+        for (int slot = 0; slot < SLOT_COUNT; slot++) {
+            if (type == SLOT_TYPES[slot]) {
+                return slot;
+            }
+        }
+        return -1;
+    }
+
+    std::vector<GLTexture> Pack(std::vector<Mesh>& meshes) {
+        std::vector<GLTexture> arrays;
+
+        // The texture each mesh samples per slot, once per (slot, texture, layer)
+        std::vector<Source> sources;
+        std::map<std::tuple<int, unsigned int, int>, size_t> sourceIndex;
+        std::vector<std::pair<Texture*, size_t>> references;
+        for (Mesh& mesh : meshes) {
+            bool seen[SLOT_COUNT] = {};
+            for (Texture& texture : mesh.textures) {
+                int slot = SlotForType(texture.type);
+                if (slot < 0 || seen[slot]) {
+                    continue;
+                }
+                seen[slot] = true;
+
+                auto key = std::make_tuple(slot, texture.id, texture.layer);
+                auto found = sourceIndex.find(key);
+                if (found == sourceIndex.end()) {
+                    Source source;
+                    if (!describe(texture, source)) {
+                        sourceIndex[key] = SIZE_MAX;
+                        continue;
+                    }
+                    source.slot = slot;
+                    found = sourceIndex.emplace_hint(found, key, sources.size());
+                    sources.push_back(source);
+                }
+                if (found->second != SIZE_MAX) {
+                    references.push_back({ &texture, found->second });
+                }
+            }
+        }
+
+        // One array per slot, size, format and mip count; a texture alone in its group gains nothing
+        // unless it already lives in an array, whose old arrays are about to be deleted
+        std::map<std::tuple<int, int, int, GLint, int>, std::vector<size_t>> groups;
+        for (size_t i = 0; i < sources.size(); i++) {
+            const Source& source = sources[i];
+            groups[std::make_tuple(source.slot, source.width, source.height, source.internalFormat, source.levels)].push_back(i);
+        }
+
+        size_t packed = 0;
+        for (auto& [key, members] : groups) {
+            bool fromArray = std::any_of(members.begin(), members.end(),
+                [&](size_t i) { return sources[i].target == GL_TEXTURE_2D_ARRAY; });
+            if (members.size() < 2 && !fromArray) {
+                continue;
+            }
+            GLTexture array = createArray(sources[members.front()], static_cast<int>(members.size()));
+            for (size_t layer = 0; layer < members.size(); layer++) {
+                sources[members[layer]].array = array.Get();
+                sources[members[layer]].arrayLayer = static_cast<int>(layer);
+            }
+            packed += members.size();
+            arrays.push_back(std::move(array));
+        }
+        if (arrays.empty()) {
+            return arrays;
+        }
+
+        std::map<unsigned int, std::vector<Source*>> bySourceTexture;
+        for (Source& source : sources) {
+            if (source.array != 0) {
+                bySourceTexture[source.texture].push_back(&source);
+            }
+        }
+
+        GLBuffer pixelBuffer = GLBuffer::Create();
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (auto& [texture, layers] : bySourceTexture) {
+            copyTexture(layers, pixelBuffer.Get());
+        }
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        for (auto& [texture, index] : references) {
+            const Source& source = sources[index];
+            if (source.array != 0) {
+                texture->id = source.array;
+                texture->layer = source.arrayLayer;
+            }
+        }
+
+        std::cout << "Packed " << packed << " texture(s) into " << arrays.size() << " texture array(s)" << std::endl;
+        return arrays;
+    }
+
+    std::vector<GLTexture> Unpack(std::vector<Mesh>& meshes) {
+        std::vector<GLTexture> textures;
+
+        // Every array layer a mesh refers to, once
+        std::vector<Source> sources;
+        std::map<std::pair<unsigned int, int>, size_t> sourceIndex;
+        std::vector<std::pair<Texture*, size_t>> references;
+        for (Mesh& mesh : meshes) {
+            for (Texture& texture : mesh.textures) {
+                if (texture.layer < 0) {
+                    continue;
+                }
+
+                auto key = std::make_pair(texture.id, texture.layer);
+                auto found = sourceIndex.find(key);
+                if (found == sourceIndex.end()) {
+                    Source source;
+                    if (!describe(texture, source)) {
+                        sourceIndex[key] = SIZE_MAX;
+                        continue;
+                    }
+                    GLTexture copy = createTexture(source);
+                    source.copy = copy.Get();
+                    textures.push_back(std::move(copy));
+                    found = sourceIndex.emplace_hint(found, key, sources.size());
+                    sources.push_back(source);
+                }
+                if (found->second != SIZE_MAX) {
+                    references.push_back({ &texture, found->second });
+                }
+            }
+        }
+        if (sources.empty()) {
+            return textures;
+        }
+
+        std::map<unsigned int, std::vector<Source*>> bySourceTexture;
+        for (Source& source : sources) {
+            bySourceTexture[source.texture].push_back(&source);
+        }
+
+        GLBuffer pixelBuffer = GLBuffer::Create();
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (auto& [texture, layers] : bySourceTexture) {
+            copyTexture(layers, pixelBuffer.Get());
+        }
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        for (auto& [texture, index] : references) {
+            texture->id = sources[index].copy;
+            texture->layer = -1;
+        }
+
+        std::cout << "Unpacked " << textures.size() << " texture array layer(s) into 2D textures" << std::endl;
+        return textures;
+    }
+
+    void Bind(int slot, unsigned int array) {
+        if (boundArrays[slot] == array) {
+            return;
+        }
+        glActiveTexture(GL_TEXTURE0 + ARRAY_UNIT + slot);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, array);
+        boundArrays[slot] = array;
+    }
+
+    void ResetBindings() {
+        std::fill(std::begin(boundArrays), std::end(boundArrays), 0u);
+    }
+
+    void SetEnabled(bool value) {
+        enabled.store(value);
+    }
+
+    bool IsEnabled() {
+        return enabled.load();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Mesh.h"
+
+// Packs the material textures of a model into GL_TEXTURE_2D_ARRAY textures, one per material slot,
+// size, format and mip count, so meshes differ by a layer uniform instead of a texture bind.
+// The copy stays on the GPU: each source level is read into a pack buffer and written into its layer
+// from there. Textures TextureStreamer manages and textures alone in their group stay 2D.
+// GL thread only.
+namespace TextureArrays {
+    // Units the shader's 2D samplers use are the slot index, the arrays use ARRAY_UNIT + slot
+    const int SLOT_COUNT = 8;
+    const int ARRAY_UNIT = 8;
+
+    // Slot of a material texture type such as "texture_normal", -1 if the shader does not sample it
+    int SlotForType(const std::string& type);
+
+    // Copies the textures the meshes sample into arrays and points those Textures at their array and
+    // layer. Textures already in an array are packed again, so it can be rerun after textures change.
+    // Returns the new arrays, which the caller owns; the previous ones can be deleted afterwards.
+    std::vector<GLTexture> Pack(std::vector<Mesh>& meshes);
+
+    // The reverse, for when packing is turned off: copies every layer the meshes sample into a 2D texture
+    // of its own and points those Textures back at it. Returns the new textures, which the caller owns;
+    // the arrays can be deleted afterwards.
+    std::vector<GLTexture> Unpack(std::vector<Mesh>& meshes);
+
+    // Binds an array to the slot's array unit unless it is still bound there
+    void Bind(int slot, unsigned int array);
+    // Forgets what Bind last bound, once per frame and whenever arrays are deleted
+    void ResetBindings();
+
+    void SetEnabled(bool enabled);
+    bool IsEnabled();
+}
\ No newline at end of file
@@ -0,0 +1,153 @@
+#include "TextureCache.h"
+#include "TextureStreamer.h"
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace TextureCache {
+    namespace {
+        // Keys of one live texture, removed together when it is released
+        struct Record {
+            std::vector<std::string> paths;
+            uint64_t hash;
+            size_t bytes;
+            bool compressed;
+        };
+
+        std::mutex cacheMutex;
+        std::unordered_map<std::string, std::weak_ptr<GLTexture>> byPath;
+        std::unordered_map<uint64_t, std::weak_ptr<GLTexture>> byContent;
+        std::unordered_map<const GLTexture*, Record> records;
+        Stats stats;
+
+        std::string pathKey(const std::string& filename, TextureRole role, bool gamma) {
+            std::error_code ec;
+            std::filesystem::path canonical = std::filesystem::weakly_canonical(filename, ec);
+            std::string key = ec ? filename : canonical.generic_string();
+            if (role == TextureRole::Normal) {
+                key += "|normal";
+            }
+            else if (role == TextureRole::Mask) {
+                key += "|mask";
+            }
+            return gamma ? key + "|srgb" : key;
+        }
+
+        uint64_t mix(uint64_t h, uint64_t value) {
+            h ^= value * 0x9E3779B97F4A7C15ull;
+            h = (h << 31) | (h >> 33);
+            return h * 0xC2B2AE3D27D4EB4Full;
+        }
+
+        // The pixels were hashed where the image was decoded; only images that did not come through
+        // TextureLoader::Load are hashed here
+        uint64_t contentHash(const ImageData& image, bool gamma) {
+            uint64_t hash = image.contentHash != 0 ? image.contentHash : TextureLoader::ContentHash(image);
+            return mix(hash, gamma ? 1 : 0);
+        }
+
+        // Deleter of the last handle: forgets the texture's keys, then deletes the GL object outside the lock
+        void release(GLTexture* texture) {
+            {
+                std::lock_guard<std::mutex> lock(cacheMutex);
+                auto found = records.find(texture);
+                if (found != records.end()) {
+                    for (const std::string& path : found->second.paths) {
+                        byPath.erase(path);
+                    }
+                    byContent.erase(found->second.hash);
+                    stats.gpuBytes -= found->second.bytes;
+                    stats.compressed -= found->second.compressed ? 1 : 0;
+                    records.erase(found);
+                }
+                stats.textures = records.size();
+            }
+            TextureStreamer::Release(texture->Get());
+            delete texture;
+        }
+
+        Handle findPath(const std::string& key) {
+            std::lock_guard<std::mutex> lock(cacheMutex);
+            auto found = byPath.find(key);
+            return found != byPath.end() ? found->second.lock() : nullptr;
+        }
+
+        Handle upload(const std::string& key, const ImageData& image, bool gamma, unsigned int pixelBuffer) {
+            uint64_t hash = contentHash(image, gamma);
+            {
+                std::lock_guard<std::mutex> lock(cacheMutex);
+                auto found = byContent.find(hash);
+                Handle texture = found != byContent.end() ? found->second.lock() : nullptr;
+                if (texture) {
+                    byPath[key] = texture;
+                    records[texture.get()].paths.push_back(key);
+                    stats.uploadsAvoided++;
+                    return texture;
+                }
+            }
+
+            bool streamed = TextureStreamer::CanStream(image);
+            GLTexture uploaded = streamed ? TextureStreamer::Upload(image, gamma) : TextureLoader::Upload(image, gamma, pixelBuffer);
+            if (!uploaded) {
+                return nullptr;
+            }
+            Handle texture(new GLTexture(std::move(uploaded)), release);
+
+            std::lock_guard<std::mutex> lock(cacheMutex);
+            byPath[key] = texture;
+            byContent[hash] = texture;
+            // Textures without a stored mip chain get a generated one on top of their pixels; the memory
+            // of streamed textures changes as they stream and is counted by TextureStreamer
+            bool compressed = image.format != BlockFormat::None;
+            size_t bytes = streamed ? 0 : !image.levelData.empty() ? image.GetByteSize() : image.GetByteSize() * 4 / 3;
+            records[texture.get()] = { { key }, hash, bytes, compressed };
+            stats.textures = records.size();
+            stats.compressed += compressed ? 1 : 0;
+            stats.gpuBytes += bytes;
+            stats.uploads++;
+            return texture;
+        }
+    }
+
+    bool Contains(const std::string& filename, TextureRole role, bool gamma) {
+        std::string key = pathKey(filename, role, gamma);
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto found = byPath.find(key);
+        return found != byPath.end() && !found->second.expired();
+    }
+
+    Handle Acquire(const std::string& filename, TextureRole role, bool gamma, unsigned int pixelBuffer) {
+        std::string key = pathKey(filename, role, gamma);
+        if (Handle texture = findPath(key)) {
+            std::lock_guard<std::mutex> lock(cacheMutex);
+            stats.decodesAvoided++;
+            return texture;
+        }
+
+        ImageData image;
+        if (!TextureLoader::Load(filename, role, image)) {
+            return nullptr;
+        }
+        return upload(key, image, gamma, pixelBuffer);
+    }
+
+    Handle Acquire(const ImageData& image, bool gamma, unsigned int pixelBuffer) {
+        if (!image.IsValid()) {
+            return image.path.empty() ? nullptr : Acquire(image.path, image.role, gamma, pixelBuffer);
+        }
+
+        std::string key = pathKey(image.path, image.role, gamma);
+        if (Handle texture = findPath(key)) {
+            std::lock_guard<std::mutex> lock(cacheMutex);
+            stats.uploadsAvoided++;
+            return texture;
+        }
+        return upload(key, image, gamma, pixelBuffer);
+    }
+
+    Stats GetStats() {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        return stats;
+    }
+}
\ No newline at end of file
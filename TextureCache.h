@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <cstddef>
+#include "TextureLoader.h"
+
+// GL textures shared by every model and loader. A texture is found by the canonical path of its file
+// and role and, once decoded, by a hash of its pixels, so the same image reached through different
+// paths is uploaded once. Handles are reference counted; the GL texture is deleted when the last one goes away.
+namespace TextureCache {
+    using Handle = std::shared_ptr<GLTexture>;
+
+    struct Stats {
+        size_t textures = 0;            // live GL textures
+        size_t uploads = 0;
+        size_t decodesAvoided = 0;      // requests served by path without decoding the file
+        size_t uploadsAvoided = 0;      // decoded images that matched a live texture by path or pixels
+        size_t compressed = 0;          // live textures stored block-compressed
+        size_t gpuBytes = 0;            // estimated video memory of the live textures, mipmaps included, streamed ones excluded
+    };
+
+    // True if a live texture exists for the file, safe to call from any thread so loaders can skip decoding it
+    bool Contains(const std::string& filename, TextureRole role = TextureRole::Color, bool gamma = false);
+
+    // Texture for an image file, loaded for its role and uploaded only when no live texture matches.
+    // Null if the file cannot be decoded. GL thread only, as is dropping the last handle.
+    // pixelBuffer is passed on to TextureLoader::Upload.
+    Handle Acquire(const std::string& filename, TextureRole role = TextureRole::Color, bool gamma = false, unsigned int pixelBuffer = 0);
+
+    // Same for an image loaded on a loader thread, with the image's role; an image with a path but no
+    // pixels is looked up by path and loaded here if the texture has gone away since
+    Handle Acquire(const ImageData& image, bool gamma = false, unsigned int pixelBuffer = 0);
+
+    Stats GetStats();
+}
\ No newline at end of file
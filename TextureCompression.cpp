@@ -0,0 +1,816 @@
+#include <glad/glad.h>
+#include "TextureCompression.h"
+#include "MipBuilder.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace TextureCompression {
+    namespace {
+        const char CACHE_MAGIC[8] = { 'L', 'X', 'B', 'T', 'E', 'X', '\0', '\0' };
+        const uint32_t CACHE_VERSION = 2;
+        // Larger sizes in an entry header are treated as corruption rather than trusted
+        const int32_t MAX_CACHED_DIMENSION = 65536;
+
+        std::atomic<bool> enabled{ true };
+        std::atomic<bool> useBC7{ false };
+        std::atomic<bool> s3tcSupported{ false };
+        std::atomic<bool> bptcSupported{ false };
+        std::atomic<int> maxTextureSize{ 16384 };
+
+        struct CacheHeader {
+            char magic[8];
+            uint32_t version;
+            uint32_t format;
+            uint32_t role;
+            int32_t width;
+            int32_t height;
+            int32_t levels;
+            int32_t components;
+            uint64_t sourceSize;
+            int64_t sourceTime;
+            uint64_t blockBytes;
+        };
+
+        int fullChainLength(int width, int height) {
+            int levels = 1;
+            while (width > 1 || height > 1) {
+                width = (std::max)(width / 2, 1);
+                height = (std::max)(height / 2, 1);
+                levels++;
+            }
+            return levels;
+        }
+
+        // Whether the header describes a chain whose level sizes add up to the stored blocks, which
+        // must also be present in the file
+        bool validHeader(const CacheHeader& header, uint64_t fileSize) {
+            if (header.width <= 0 || header.height <= 0 || header.width > MAX_CACHED_DIMENSION || header.height > MAX_CACHED_DIMENSION
+                || header.levels <= 0 || header.components < 1 || header.components > 4
+                || header.format > static_cast<uint32_t>(BlockFormat::BC7)) {
+                return false;
+            }
+
+            ImageData shape;
+            shape.width = header.width;
+            shape.height = header.height;
+            shape.components = header.components;
+            shape.format = static_cast<BlockFormat>(header.format);
+            int levels = (std::min)(header.levels, fullChainLength(header.width, header.height));
+            uint64_t expected = 0;
+            for (int level = 0; level < levels; level++) {
+                expected += TextureLoader::GetLevelSize(shape, level);
+            }
+            return levels == header.levels && expected == header.blockBytes
+                && fileSize >= sizeof(CacheHeader) && header.blockBytes <= fileSize - sizeof(CacheHeader);
+        }
+
+        // Size and modification time of the source, matched against the entry. An embedded image,
+        // named "<model path>*<index>", goes stale with its model file.
+        bool stampOf(const std::string& filename, uint64_t& size, int64_t& time) {
+            size_t star = filename.find_last_of('*');
+            size_t slash = filename.find_last_of("/\\");
+            bool embedded = star != std::string::npos && (slash == std::string::npos || star > slash);
+            std::string path = embedded ? filename.substr(0, star) : filename;
+
+            std::error_code ec;
+            size = std::filesystem::file_size(path, ec);
+            if (ec) {
+                return false;
+            }
+            auto writeTime = std::filesystem::last_write_time(path, ec);
+            if (ec) {
+                return false;
+            }
+            time = static_cast<int64_t>(writeTime.time_since_epoch().count());
+            return true;
+        }
+
+        // Entry file for a texture, named after a hash of its absolute path, role, colour format choice and
+        // the mip settings; an uncompressed chain is kept apart from the compressed one
+        std::string entryPath(const std::string& filename, TextureRole role) {
+            std::error_code ec;
+            std::string key = std::filesystem::absolute(filename, ec).lexically_normal().string();
+            if (ec) {
+                key = filename;
+            }
+            key += '\n';
+            key += std::to_string(static_cast<int>(role));
+            key += useBC7.load() ? "bc7" : "";
+            key += IsEnabled() ? "" : "raw";
+            key += '\n';
+            key += std::to_string(MipBuilder::GetMaxSize(role));
+            key += MipBuilder::GetFilter() == MipBuilder::Filter::Box ? "box" : "kaiser";
+
+            std::ostringstream name;
+            name << std::hex << std::setw(16) << std::setfill('0') << static_cast<uint64_t>(std::hash<std::string>()(key)) << ".btex";
+            return (std::filesystem::path(GetDirectory()) / name.str()).string();
+        }
+
+        size_t blockBytes(BlockFormat format) {
+            return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+        }
+
+        // RGBA copy of a level's pixels, whatever their component count
+        std::vector<unsigned char> expandToRGBA(const unsigned char* source, int width, int height, int components) {
+            size_t count = size_t(width) * height;
+            std::vector<unsigned char> rgba(count * 4);
+            for (size_t i = 0; i < count; i++) {
+                const unsigned char* texel = source + i * components;
+                unsigned char* out = &rgba[i * 4];
+                switch (components) {
+                case 1:
+                    out[0] = out[1] = out[2] = texel[0];
+                    out[3] = 255;
+                    break;
+                case 2:
+                    out[0] = texel[0];
+                    out[1] = texel[1];
+                    out[2] = 0;
+                    out[3] = 255;
+                    break;
+                case 3:
+                    out[0] = texel[0];
+                    out[1] = texel[1];
+                    out[2] = texel[2];
+                    out[3] = 255;
+                    break;
+                default:
+                    std::memcpy(out, texel, 4);
+                    break;
+                }
+            }
+            return rgba;
+        }
+
+        // 4x4 texels starting at (x, y), edge texels repeated past the border
+        void fetchBlock(const std::vector<unsigned char>& level, int width, int height, int x, int y, unsigned char block[16][4]) {
+            for (int row = 0; row < 4; row++) {
+                int sy = (std::min)(y + row, height - 1);
+                for (int column = 0; column < 4; column++) {
+                    int sx = (std::min)(x + column, width - 1);
+                    std::memcpy(block[row * 4 + column], &level[(size_t(sy) * width + sx) * 4], 4);
+                }
+            }
+        }
+
+        // Endpoints along the principal axis of the first channels of the block, found by power iteration
+        template<int Channels>
+        void principalEndpoints(const unsigned char block[16][4], float low[Channels], float high[Channels]) {
+            float mean[Channels] = {};
+            for (int i = 0; i < 16; i++) {
+                for (int c = 0; c < Channels; c++) {
+                    mean[c] += block[i][c];
+                }
+            }
+            for (int c = 0; c < Channels; c++) {
+                mean[c] /= 16.0f;
+            }
+
+            float covariance[Channels][Channels] = {};
+            for (int i = 0; i < 16; i++) {
+                float d[Channels];
+                for (int c = 0; c < Channels; c++) {
+                    d[c] = block[i][c] - mean[c];
+                }
+                for (int a = 0; a < Channels; a++) {
+                    for (int b = 0; b < Channels; b++) {
+                        covariance[a][b] += d[a] * d[b];
+                    }
+                }
+            }
+
+            float axis[Channels];
+            for (int c = 0; c < Channels; c++) {
+                axis[c] = 1.0f;
+            }
+            for (int iteration = 0; iteration < 8; iteration++) {
+                float next[Channels] = {};
+                float length = 0.0f;
+                for (int a = 0; a < Channels; a++) {
+                    for (int b = 0; b < Channels; b++) {
+                        next[a] += covariance[a][b] * axis[b];
+                    }
+                    length = (std::max)(length, std::fabs(next[a]));
+                }
+                if (length < 1e-6f) {
+                    break;
+                }
+                for (int c = 0; c < Channels; c++) {
+                    axis[c] = next[c] / length;
+                }
+            }
+
+            float minT = 0.0f;
+            float maxT = 0.0f;
+            float axisLength = 0.0f;
+            for (int c = 0; c < Channels; c++) {
+                axisLength += axis[c] * axis[c];
+            }
+            if (axisLength > 0.0f) {
+                for (int i = 0; i < 16; i++) {
+                    float t = 0.0f;
+                    for (int c = 0; c < Channels; c++) {
+                        t += (block[i][c] - mean[c]) * axis[c];
+                    }
+                    t /= axisLength;
+                    minT = (std::min)(minT, t);
+                    maxT = (std::max)(maxT, t);
+                }
+            }
+            for (int c = 0; c < Channels; c++) {
+                low[c] = (std::clamp)(mean[c] + axis[c] * minT, 0.0f, 255.0f);
+                high[c] = (std::clamp)(mean[c] + axis[c] * maxT, 0.0f, 255.0f);
+            }
+        }
+
+        uint16_t pack565(const float color[3]) {
+            int r = static_cast<int>(color[0] * 31.0f / 255.0f + 0.5f);
+            int g = static_cast<int>(color[1] * 63.0f / 255.0f + 0.5f);
+            int b = static_cast<int>(color[2] * 31.0f / 255.0f + 0.5f);
+            return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+        }
+
+        void unpack565(uint16_t packed, int color[3]) {
+            int r = (packed >> 11) & 31;
+            int g = (packed >> 5) & 63;
+            int b = packed & 31;
+            color[0] = (r << 3) | (r >> 2);
+            color[1] = (g << 2) | (g >> 4);
+            color[2] = (b << 3) | (b >> 2);
+        }
+
+        // Picks the nearest of the four colours for every texel; returns the total squared error
+        int indexBC1(const unsigned char block[16][4], uint16_t color0, uint16_t color1, uint32_t& indices) {
+            int palette[4][3];
+            unpack565(color0, palette[0]);
+            unpack565(color1, palette[1]);
+            for (int c = 0; c < 3; c++) {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+
+            indices = 0;
+            int total = 0;
+            for (int i = 0; i < 16; i++) {
+                int best = 0;
+                int bestError = INT32_MAX;
+                for (int p = 0; p < 4; p++) {
+                    int error = 0;
+                    for (int c = 0; c < 3; c++) {
+                        int d = block[i][c] - palette[p][c];
+                        error += d * d;
+                    }
+                    if (error < bestError) {
+                        bestError = error;
+                        best = p;
+                    }
+                }
+                indices |= uint32_t(best) << (i * 2);
+                total += bestError;
+            }
+            return total;
+        }
+
+        // Colour block shared by BC1 and BC3, always in four-colour mode
+        void encodeColorBlock(const unsigned char block[16][4], unsigned char* out) {
+            float low[3];
+            float high[3];
+            principalEndpoints<3>(block, low, high);
+
+            uint16_t color0 = pack565(high);
+            uint16_t color1 = pack565(low);
+            if (color0 < color1) {
+                std::swap(color0, color1);
+            }
+
+            uint32_t indices = 0;
+            if (color0 != color1) {
+                int error = indexBC1(block, color0, color1, indices);
+
+                // One least-squares pass refits the endpoints to the chosen indices
+                const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+                float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+                float ax[3] = {}, bx[3] = {};
+                for (int i = 0; i < 16; i++) {
+                    float a = weights[(indices >> (i * 2)) & 3];
+                    float b = 1.0f - a;
+                    aa += a * a;
+                    ab += a * b;
+                    bb += b * b;
+                    for (int c = 0; c < 3; c++) {
+                        ax[c] += a * block[i][c];
+                        bx[c] += b * block[i][c];
+                    }
+                }
+                float determinant = aa * bb - ab * ab;
+                if (std::fabs(determinant) > 1e-6f) {
+                    float refitHigh[3];
+                    float refitLow[3];
+                    for (int c = 0; c < 3; c++) {
+                        refitHigh[c] = (std::clamp)((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+                        refitLow[c] = (std::clamp)((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+                    }
+                    uint16_t refit0 = pack565(refitHigh);
+                    uint16_t refit1 = pack565(refitLow);
+                    if (refit0 < refit1) {
+                        std::swap(refit0, refit1);
+                    }
+                    uint32_t refitIndices = 0;
+                    if (refit0 != refit1 && indexBC1(block, refit0, refit1, refitIndices) < error) {
+                        color0 = refit0;
+                        color1 = refit1;
+                        indices = refitIndices;
+                    }
+                }
+            }
+
+            std::memcpy(out, &color0, 2);
+            std::memcpy(out + 2, &color1, 2);
+            std::memcpy(out + 4, &indices, 4);
+        }
+
+        // One channel of the block in eight-value mode
+        void encodeChannelBlock(const unsigned char block[16][4], int channel, unsigned char* out) {
+            int low = 255;
+            int high = 0;
+            for (int i = 0; i < 16; i++) {
+                low = (std::min)(low, int(block[i][channel]));
+                high = (std::max)(high, int(block[i][channel]));
+            }
+
+            out[0] = static_cast<unsigned char>(high);
+            out[1] = static_cast<unsigned char>(low);
+            uint64_t indices = 0;
+            if (high != low) {
+                int palette[8] = { high, low };
+                for (int p = 2; p < 8; p++) {
+                    palette[p] = ((8 - p) * high + (p - 1) * low) / 7;
+                }
+                for (int i = 0; i < 16; i++) {
+                    int best = 0;
+                    int bestError = INT32_MAX;
+                    for (int p = 0; p < 8; p++) {
+                        int error = std::abs(block[i][channel] - palette[p]);
+                        if (error < bestError) {
+                            bestError = error;
+                            best = p;
+                        }
+                    }
+                    indices |= uint64_t(best) << (i * 3);
+                }
+            }
+            for (int b = 0; b < 6; b++) {
+                out[2 + b] = static_cast<unsigned char>(indices >> (b * 8));
+            }
+        }
+
+        // Little-endian bit packing for BC7
+        struct BitWriter {
+            unsigned char* out;
+            int position = 0;
+
+            void Write(uint32_t value, int bits) {
+                for (int b = 0; b < bits; b++, position++) {
+                    if ((value >> b) & 1) {
+                        out[position / 8] |= static_cast<unsigned char>(1 << (position % 8));
+                    }
+                }
+            }
+        };
+
+        // 7-bit endpoint with the shared p-bit that reproduces it best
+        void quantizeBC7(const float endpoint[4], int quantized[4], int& pBit) {
+            int bestError = INT32_MAX;
+            for (int p = 0; p < 2; p++) {
+                int candidate[4];
+                int error = 0;
+                for (int c = 0; c < 4; c++) {
+                    candidate[c] = (std::clamp)(static_cast<int>((endpoint[c] - p) / 2.0f + 0.5f), 0, 127);
+                    int d = ((candidate[c] << 1) | p) - static_cast<int>(endpoint[c] + 0.5f);
+                    error += d * d;
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    pBit = p;
+                    std::memcpy(quantized, candidate, sizeof(candidate));
+                }
+            }
+        }
+
+        // Mode 6: one RGBA subset with 7-bit endpoints plus p-bits and 4-bit indices
+        void encodeBC7(const unsigned char block[16][4], unsigned char* out) {
+            static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+            float low[4];
+            float high[4];
+            principalEndpoints<4>(block, low, high);
+
+            int endpoints[2][4];
+            int pBits[2];
+            quantizeBC7(low, endpoints[0], pBits[0]);
+            quantizeBC7(high, endpoints[1], pBits[1]);
+
+            int palette[16][4];
+            for (int c = 0; c < 4; c++) {
+                int e0 = (endpoints[0][c] << 1) | pBits[0];
+                int e1 = (endpoints[1][c] << 1) | pBits[1];
+                for (int p = 0; p < 16; p++) {
+                    palette[p][c] = ((64 - weights[p]) * e0 + weights[p] * e1 + 32) >> 6;
+                }
+            }
+
+            int indices[16];
+            for (int i = 0; i < 16; i++) {
+                int bestError = INT32_MAX;
+                for (int p = 0; p < 16; p++) {
+                    int error = 0;
+                    for (int c = 0; c < 4; c++) {
+                        int d = block[i][c] - palette[p][c];
+                        error += d * d;
+                    }
+                    if (error < bestError) {
+                        bestError = error;
+                        indices[i] = p;
+                    }
+                }
+            }
+
+            // The first index is stored without its top bit, so it must be below 8
+            if (indices[0] >= 8) {
+                std::swap(endpoints[0], endpoints[1]);
+                std::swap(pBits[0], pBits[1]);
+                for (int& index : indices) {
+                    index = 15 - index;
+                }
+            }
+
+            std::memset(out, 0, 16);
+            BitWriter writer{ out };
+            writer.Write(1u << 6, 7);
+            for (int c = 0; c < 4; c++) {
+                writer.Write(endpoints[0][c], 7);
+                writer.Write(endpoints[1][c], 7);
+            }
+            writer.Write(pBits[0], 1);
+            writer.Write(pBits[1], 1);
+            for (int i = 0; i < 16; i++) {
+                writer.Write(indices[i], i == 0 ? 3 : 4);
+            }
+        }
+
+        void encodeBlock(BlockFormat format, const unsigned char block[16][4], unsigned char* out) {
+            switch (format) {
+            case BlockFormat::BC1:
+                encodeColorBlock(block, out);
+                break;
+            case BlockFormat::BC3:
+                encodeChannelBlock(block, 3, out);
+                encodeColorBlock(block, out + 8);
+                break;
+            case BlockFormat::BC4:
+                encodeChannelBlock(block, 0, out);
+                break;
+            case BlockFormat::BC5:
+                encodeChannelBlock(block, 0, out);
+                encodeChannelBlock(block, 1, out + 8);
+                break;
+            case BlockFormat::BC7:
+                encodeBC7(block, out);
+                break;
+            case BlockFormat::BC2:
+            case BlockFormat::None:
+                break;
+            }
+        }
+
+        bool hasAlpha(const ImageData& image) {
+            if (image.components != 4) {
+                return false;
+            }
+            size_t count = size_t(image.width) * image.height;
+            const unsigned char* pixels = image.pixels.get();
+            for (size_t i = 0; i < count; i++) {
+                if (pixels[i * 4 + 3] != 255) {
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+
+    TextureRole RoleForType(const std::string& type) {
+        if (type == "texture_normal") {
+            return TextureRole::Normal;
+        }
+        if (type == "texture_roughness" || type == "texture_metallic" || type == "texture_ao") {
+            return TextureRole::Mask;
+        }
+        return TextureRole::Color;
+    }
+
+    void DetectSupport() {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++) {
+            const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            if (!name) {
+                continue;
+            }
+            if (std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0) {
+                s3tcSupported.store(true);
+            }
+            else if (std::strcmp(name, "GL_ARB_texture_compression_bptc") == 0) {
+                bptcSupported.store(true);
+            }
+        }
+
+        GLint maxSize = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+        if (maxSize > 0) {
+            maxTextureSize.store(maxSize);
+        }
+
+        std::cout << "Texture compression: BC1/BC3 " << (s3tcSupported.load() ? "supported" : "unsupported")
+            << ", BC7 " << (bptcSupported.load() ? "supported" : "unsupported") << std::endl;
+    }
+
+    int GetMaxTextureSize() {
+        return maxTextureSize.load();
+    }
+
+    BlockFormat ChooseFormat(const ImageData& image) {
+        if (!image.pixels || image.width <= 0 || image.height <= 0) {
+            return BlockFormat::None;
+        }
+
+        switch (image.role) {
+        case TextureRole::Normal:
+            return image.components >= 2 ? BlockFormat::BC5 : BlockFormat::None;
+        case TextureRole::Mask:
+            return BlockFormat::BC4;
+        case TextureRole::Color:
+            break;
+        }
+
+        if (useBC7.load() && IsSupported(BlockFormat::BC7)) {
+            return BlockFormat::BC7;
+        }
+        BlockFormat format = hasAlpha(image) ? BlockFormat::BC3 : BlockFormat::BC1;
+        return IsSupported(format) ? format : BlockFormat::None;
+    }
+
+    bool IsSupported(BlockFormat format) {
+        switch (format) {
+        case BlockFormat::BC1:
+        case BlockFormat::BC2:
+        case BlockFormat::BC3:
+            return s3tcSupported.load();
+        case BlockFormat::BC4:
+        case BlockFormat::BC5:
+            return true;
+        case BlockFormat::BC7:
+            return bptcSupported.load();
+        case BlockFormat::None:
+            break;
+        }
+        return false;
+    }
+
+    bool Compress(ImageData& image, BlockFormat format) {
+        if (format == BlockFormat::None || !image.pixels) {
+            return false;
+        }
+
+        // The levels come from MipBuilder, so compressed and uncompressed chains are filtered alike
+        if (!MipBuilder::Build(image)) {
+            return false;
+        }
+
+        // Block offsets first, so every level's blocks can be written in place
+        std::vector<size_t> offsets;
+        size_t total = 0;
+        for (int levelIndex = 0; levelIndex < image.levels; levelIndex++) {
+            offsets.push_back(total);
+            total += GetLevelSize(format, (std::max)(image.width >> levelIndex, 1), (std::max)(image.height >> levelIndex, 1));
+        }
+
+        std::vector<unsigned char> blocks(total);
+        size_t bytesPerBlock = blockBytes(format);
+        const unsigned char* source = image.levelData.data();
+        for (size_t levelIndex = 0; levelIndex < offsets.size(); levelIndex++) {
+            int width = (std::max)(image.width >> levelIndex, 1);
+            int height = (std::max)(image.height >> levelIndex, 1);
+            std::vector<unsigned char> level = expandToRGBA(source, width, height, image.components);
+            source += size_t(width) * height * image.components;
+
+            int blocksX = (width + 3) / 4;
+            int blocksY = (height + 3) / 4;
+            unsigned char* out = blocks.data() + offsets[levelIndex];
+
+            // Rows of blocks are independent, small levels are not worth spreading out
+            auto encodeRow = [&](size_t row) {
+                unsigned char block[16][4];
+                for (int x = 0; x < blocksX; x++) {
+                    fetchBlock(level, width, height, x * 4, static_cast<int>(row) * 4, block);
+                    encodeBlock(format, block, out + (row * blocksX + x) * bytesPerBlock);
+                }
+            };
+            if (size_t(blocksX) * blocksY >= 1024) {
+                ThreadPool::Shared().ParallelFor(blocksY, encodeRow);
+            }
+            else {
+                for (int row = 0; row < blocksY; row++) {
+                    encodeRow(row);
+                }
+            }
+        }
+
+        image.format = format;
+        image.levelData = std::move(blocks);
+        return true;
+    }
+
+    size_t GetLevelSize(BlockFormat format, int width, int height) {
+        if (format == BlockFormat::None) {
+            return 0;
+        }
+        return size_t((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+    }
+
+    bool LoadCached(const std::string& filename, TextureRole role, ImageData& image) {
+        return LoadCachedLevels(filename, role, 0, INT_MAX, image);
+    }
+
+    bool LoadCachedLevels(const std::string& filename, TextureRole role, int firstLevel, int lastLevel, ImageData& image) {
+        if (!IsEnabled() && !MipBuilder::IsEnabled()) {
+            return false;
+        }
+
+        std::string cachePath = entryPath(filename, role);
+        std::ifstream file(cachePath, std::ios::binary);
+        CacheHeader header = {};
+        if (!file || !file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+            return false;
+        }
+
+        uint64_t sourceSize;
+        int64_t sourceTime;
+        if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION
+            || header.role != static_cast<uint32_t>(role) || !stampOf(filename, sourceSize, sourceTime)
+            || header.sourceSize != sourceSize || header.sourceTime != sourceTime) {
+            return false;
+        }
+
+        // A damaged entry is removed, the caller encodes the texture again and stores a fresh one
+        std::error_code ec;
+        uint64_t fileSize = std::filesystem::file_size(cachePath, ec);
+        std::vector<unsigned char> blocks;
+        bool valid = !ec && validHeader(header, fileSize);
+        if (valid) {
+            lastLevel = (std::min)(lastLevel, header.levels - 1);
+            if (firstLevel < 0 || firstLevel > lastLevel) {
+                return false;
+            }
+
+            // Levels are stored back to back, largest first
+            ImageData shape;
+            shape.width = header.width;
+            shape.height = header.height;
+            shape.components = header.components;
+            shape.format = static_cast<BlockFormat>(header.format);
+            size_t start = 0;
+            for (int level = 0; level < firstLevel; level++) {
+                start += TextureLoader::GetLevelSize(shape, level);
+            }
+            size_t bytes = 0;
+            for (int level = firstLevel; level <= lastLevel; level++) {
+                bytes += TextureLoader::GetLevelSize(shape, level);
+            }
+
+            blocks.resize(bytes);
+            valid = start == 0 || static_cast<bool>(file.seekg(static_cast<std::streamoff>(start), std::ios::cur));
+            valid = valid && static_cast<bool>(file.read(reinterpret_cast<char*>(blocks.data()), static_cast<std::streamsize>(blocks.size())));
+        }
+        if (!valid) {
+            file.close();
+            std::filesystem::remove(cachePath, ec);
+            std::cerr << "Discarded damaged texture cache entry: " << cachePath << std::endl;
+            return false;
+        }
+
+        image.path = filename;
+        image.width = header.width;
+        image.height = header.height;
+        image.components = header.components;
+        image.pixels.reset();
+        image.role = role;
+        image.format = static_cast<BlockFormat>(header.format);
+        image.levels = header.levels;
+        image.levelData = std::move(blocks);
+        image.firstLevel = firstLevel;
+        return true;
+    }
+
+    bool StoreCached(const std::string& filename, const ImageData& image) {
+        if ((!IsEnabled() && !MipBuilder::IsEnabled()) || image.levelData.empty()) {
+            return false;
+        }
+
+        CacheHeader header = {};
+        std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        header.version = CACHE_VERSION;
+        header.format = static_cast<uint32_t>(image.format);
+        header.role = static_cast<uint32_t>(image.role);
+        header.width = image.width;
+        header.height = image.height;
+        header.levels = image.levels;
+        header.components = image.components;
+        header.blockBytes = image.levelData.size();
+        if (!stampOf(filename, header.sourceSize, header.sourceTime)) {
+            return false;
+        }
+
+        std::error_code ec;
+        std::filesystem::create_directories(GetDirectory(), ec);
+
+        // Written under a private name and renamed into place, so readers never see a partial entry
+        std::string cachePath = entryPath(filename, image.role);
+        std::ostringstream tempName;
+        tempName << cachePath << '.' << std::hash<std::thread::id>()(std::this_thread::get_id()) << ".tmp";
+        std::string tempPath = tempName.str();
+
+        {
+            std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(image.levelData.data()), static_cast<std::streamsize>(image.levelData.size()));
+            if (!out) {
+                std::cerr << "Failed to write texture cache entry: " << tempPath << std::endl;
+                out.close();
+                std::filesystem::remove(tempPath, ec);
+                return false;
+            }
+        }
+
+        std::filesystem::rename(tempPath, cachePath, ec);
+        if (ec) {
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+        return true;
+    }
+
+    void SetEnabled(bool value) {
+        enabled.store(value);
+    }
+
+    bool IsEnabled() {
+        return enabled.load();
+    }
+
+    void SetUseBC7(bool value) {
+        useBC7.store(value);
+    }
+
+    bool IsUsingBC7() {
+        return useBC7.load();
+    }
+
+    size_t Clear() {
+        size_t removed = 0;
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(GetDirectory(), ec)) {
+            if (entry.is_regular_file(ec) && entry.path().extension() == ".btex" && std::filesystem::remove(entry.path(), ec)) {
+                removed++;
+            }
+        }
+        std::cout << "Removed " << removed << " texture cache entries" << std::endl;
+        return removed;
+    }
+
+    size_t GetDiskUsage() {
+        size_t bytes = 0;
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(GetDirectory(), ec)) {
+            if (entry.is_regular_file(ec) && entry.path().extension() == ".btex") {
+                bytes += static_cast<size_t>(entry.file_size(ec));
+            }
+        }
+        return bytes;
+    }
+
+    const std::string& GetDirectory() {
+        static const std::string directory = "cache/textures";
+        return directory;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+#include <string>
+#include <cstddef>
+#include "TextureLoader.h"
+
+// CPU block compression for material textures. The format follows the role: BC5 for normal maps,
+// BC4 for single-channel masks, BC1 for opaque colour and BC3 for colour with alpha (BC7 for all
+// colour when enabled). Mip chains are cached on disk, encoded or, with compression off, as MipBuilder
+// built them. Entries are keyed by the source path, role and mip settings and validated against the
+// source file's size and modification time, so a warm load skips decoding.
+namespace TextureCompression {
+    // Role of a material texture type such as "texture_normal"
+    TextureRole RoleForType(const std::string& type);
+
+    // Reads the GL extensions and limits once on the GL thread; formats the driver lacks are never chosen
+    void DetectSupport();
+    // GL_MAX_TEXTURE_SIZE as read by DetectSupport, for checks made off the GL thread
+    int GetMaxTextureSize();
+
+    // Format a decoded image would be encoded in, None when it stays uncompressed
+    BlockFormat ChooseFormat(const ImageData& image);
+    // True if the driver can sample the format; RGTC (BC4/BC5) is core in GL 3.3
+    bool IsSupported(BlockFormat format);
+
+    // Replaces the pixels with a mip chain in format, built by MipBuilder and encoded on the shared thread pool.
+    // False (image untouched) if format is None.
+    bool Compress(ImageData& image, BlockFormat format);
+
+    // Fills image from the cache entry of the file, false if there is none or it is stale. Embedded
+    // images are cached under their name and validated against their model file.
+    bool LoadCached(const std::string& filename, TextureRole role, ImageData& image);
+    // Same, but reads only levels firstLevel..lastLevel of the entry; levelData then starts at firstLevel
+    bool LoadCachedLevels(const std::string& filename, TextureRole role, int firstLevel, int lastLevel, ImageData& image);
+    // Writes an image's mip chain, replacing any previous entry
+    bool StoreCached(const std::string& filename, const ImageData& image);
+
+    void SetEnabled(bool enabled);
+    bool IsEnabled();
+    void SetUseBC7(bool enabled);
+    bool IsUsingBC7();
+
+    // Bytes of one mip level
+    size_t GetLevelSize(BlockFormat format, int width, int height);
+
+    // Removes every cache entry, returns how many files were deleted
+    size_t Clear();
+    size_t GetDiskUsage();
+    const std::string& GetDirectory();
+}
\ No newline at end of file
@@ -0,0 +1,556 @@
+#include "TextureContainer.h"
+#include "TextureCompression.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace TextureContainer {
+    namespace {
+        const uint32_t DDS_MAGIC = 0x20534444;          // "DDS "
+        const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+        const uint32_t DDPF_ALPHAPIXELS = 0x1;
+        const uint32_t DDPF_FOURCC = 0x4;
+        const uint32_t DDPF_RGB = 0x40;
+        const uint32_t DDPF_LUMINANCE = 0x20000;
+        const uint32_t DDSCAPS2_CUBEMAP = 0x200;
+        const uint32_t DDSCAPS2_VOLUME = 0x200000;
+        const uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+        const uint32_t DDS_MISC_TEXTURECUBE = 0x4;
+
+        const unsigned char KTX_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+        const uint32_t KTX_ENDIANNESS = 0x04030201;
+
+        struct DdsPixelFormat {
+            uint32_t size;
+            uint32_t flags;
+            uint32_t fourCC;
+            uint32_t rgbBitCount;
+            uint32_t masks[4];      // red, green, blue, alpha
+        };
+
+        struct DdsHeader {
+            uint32_t size;
+            uint32_t flags;
+            uint32_t height;
+            uint32_t width;
+            uint32_t pitchOrLinearSize;
+            uint32_t depth;
+            uint32_t mipMapCount;
+            uint32_t reserved1[11];
+            DdsPixelFormat pixelFormat;
+            uint32_t caps;
+            uint32_t caps2;
+            uint32_t caps3;
+            uint32_t caps4;
+            uint32_t reserved2;
+        };
+
+        struct DdsHeaderDx10 {
+            uint32_t dxgiFormat;
+            uint32_t resourceDimension;
+            uint32_t miscFlag;
+            uint32_t arraySize;
+            uint32_t miscFlags2;
+        };
+
+        struct KtxHeader {
+            uint32_t endianness;
+            uint32_t glType;
+            uint32_t glTypeSize;
+            uint32_t glFormat;
+            uint32_t glInternalFormat;
+            uint32_t glBaseInternalFormat;
+            uint32_t pixelWidth;
+            uint32_t pixelHeight;
+            uint32_t pixelDepth;
+            uint32_t numberOfArrayElements;
+            uint32_t numberOfFaces;
+            uint32_t numberOfMipmapLevels;
+            uint32_t bytesOfKeyValueData;
+        };
+
+        static_assert(sizeof(DdsHeader) == 124, "DDS header layout");
+        static_assert(sizeof(DdsHeaderDx10) == 20, "DDS DX10 header layout");
+        static_assert(sizeof(KtxHeader) == 52, "KTX header layout");
+
+        // Uncompressed texel layout: 8-bit channels picked out of a little-endian texel by mask
+        struct PixelLayout {
+            int bytes = 0;
+            int components = 0;
+            uint32_t masks[4] = {};
+        };
+
+        // What a container holds: block-compressed, or uncompressed with a layout
+        struct Layout {
+            BlockFormat format = BlockFormat::None;
+            PixelLayout pixels;
+        };
+
+        // Levels copied out of a container, counted after those larger than maxSize are dropped
+        struct LevelRange {
+            int maxSize = INT_MAX;
+            int first = 0;
+            int last = INT_MAX;
+        };
+
+        constexpr uint32_t fourCC(char a, char b, char c, char d) {
+            return uint32_t(uint8_t(a)) | uint32_t(uint8_t(b)) << 8 | uint32_t(uint8_t(c)) << 16 | uint32_t(uint8_t(d)) << 24;
+        }
+
+        PixelLayout pixelLayout(int bytes, int components, uint32_t r, uint32_t g = 0, uint32_t b = 0, uint32_t a = 0) {
+            PixelLayout layout;
+            layout.bytes = bytes;
+            layout.components = components;
+            layout.masks[0] = r;
+            layout.masks[1] = g;
+            layout.masks[2] = b;
+            layout.masks[3] = a;
+            return layout;
+        }
+
+        // Every used mask must be one whole byte of the texel
+        bool isByteLayout(const PixelLayout& layout) {
+            if (layout.bytes < 1 || layout.bytes > 4 || layout.components < 1) {
+                return false;
+            }
+            for (int c = 0; c < layout.components; c++) {
+                uint32_t mask = layout.masks[c];
+                if (std::popcount(mask) != 8 || std::countr_zero(mask) % 8 != 0 || std::countr_zero(mask) >= layout.bytes * 8) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        size_t levelSize(const Layout& layout, int width, int height) {
+            if (layout.format != BlockFormat::None) {
+                return TextureCompression::GetLevelSize(layout.format, width, height);
+            }
+            return size_t(width) * height * layout.pixels.components;
+        }
+
+        // Copies one level into out, unpacking uncompressed texels into tightly packed channels
+        void copyLevel(const Layout& layout, const unsigned char* source, size_t rowStride, int width, int height, unsigned char* out) {
+            if (layout.format != BlockFormat::None) {
+                std::memcpy(out, source, TextureCompression::GetLevelSize(layout.format, width, height));
+                return;
+            }
+
+            const PixelLayout& pixels = layout.pixels;
+            int shifts[4];
+            for (int c = 0; c < pixels.components; c++) {
+                shifts[c] = std::countr_zero(pixels.masks[c]);
+            }
+            for (int y = 0; y < height; y++) {
+                const unsigned char* row = source + y * rowStride;
+                for (int x = 0; x < width; x++) {
+                    uint32_t texel = 0;
+                    std::memcpy(&texel, row + size_t(x) * pixels.bytes, pixels.bytes);
+                    for (int c = 0; c < pixels.components; c++) {
+                        *out++ = static_cast<unsigned char>(texel >> shifts[c]);
+                    }
+                }
+            }
+        }
+
+        int fullChainLength(int width, int height) {
+            int levels = 1;
+            while (width > 1 || height > 1) {
+                width = (std::max)(width / 2, 1);
+                height = (std::max)(height / 2, 1);
+                levels++;
+            }
+            return levels;
+        }
+
+        // Levels MipBuilder::Fit drops from the top of a chain to bring it within maxSize
+        int droppedLevels(int width, int height, int levels, int maxSize) {
+            int dropped = 0;
+            while (dropped < levels - 1 && (std::max)(width >> dropped, height >> dropped) > maxSize) {
+                dropped++;
+            }
+            return dropped;
+        }
+
+        bool fail(const std::string& filename, const std::string& reason) {
+            std::cerr << "Texture container " << filename << ": " << reason << std::endl;
+            return false;
+        }
+
+        Layout dxgiLayout(uint32_t dxgiFormat) {
+            Layout layout;
+            switch (dxgiFormat) {
+            case 70: case 71: case 72:
+                layout.format = BlockFormat::BC1;
+                break;
+            case 73: case 74: case 75:
+                layout.format = BlockFormat::BC2;
+                break;
+            case 76: case 77: case 78:
+                layout.format = BlockFormat::BC3;
+                break;
+            case 79: case 80:
+                layout.format = BlockFormat::BC4;
+                break;
+            case 82: case 83:
+                layout.format = BlockFormat::BC5;
+                break;
+            case 97: case 98: case 99:
+                layout.format = BlockFormat::BC7;
+                break;
+            case 27: case 28: case 29:         // R8G8B8A8
+                layout.pixels = pixelLayout(4, 4, 0xFF, 0xFF00, 0xFF0000, 0xFF000000);
+                break;
+            case 87: case 90: case 91:         // B8G8R8A8
+                layout.pixels = pixelLayout(4, 4, 0xFF0000, 0xFF00, 0xFF, 0xFF000000);
+                break;
+            case 88: case 92: case 93:         // B8G8R8X8
+                layout.pixels = pixelLayout(4, 3, 0xFF0000, 0xFF00, 0xFF);
+                break;
+            case 48: case 49:                  // R8G8
+                layout.pixels = pixelLayout(2, 2, 0xFF, 0xFF00);
+                break;
+            case 60: case 61:                  // R8
+                layout.pixels = pixelLayout(1, 1, 0xFF);
+                break;
+            }
+            return layout;
+        }
+
+        Layout ddsLayout(const DdsPixelFormat& pixelFormat) {
+            Layout layout;
+            if (pixelFormat.flags & DDPF_FOURCC) {
+                switch (pixelFormat.fourCC) {
+                case fourCC('D', 'X', 'T', '1'):
+                    layout.format = BlockFormat::BC1;
+                    break;
+                case fourCC('D', 'X', 'T', '2'):
+                case fourCC('D', 'X', 'T', '3'):
+                    layout.format = BlockFormat::BC2;
+                    break;
+                case fourCC('D', 'X', 'T', '4'):
+                case fourCC('D', 'X', 'T', '5'):
+                    layout.format = BlockFormat::BC3;
+                    break;
+                case fourCC('A', 'T', 'I', '1'):
+                case fourCC('B', 'C', '4', 'U'):
+                    layout.format = BlockFormat::BC4;
+                    break;
+                case fourCC('A', 'T', 'I', '2'):
+                case fourCC('B', 'C', '5', 'U'):
+                    layout.format = BlockFormat::BC5;
+                    break;
+                }
+                return layout;
+            }
+
+            int bytes = static_cast<int>(pixelFormat.rgbBitCount / 8);
+            const uint32_t* masks = pixelFormat.masks;
+            if (pixelFormat.flags & DDPF_RGB) {
+                bool alpha = (pixelFormat.flags & DDPF_ALPHAPIXELS) && masks[3] != 0;
+                layout.pixels = pixelLayout(bytes, alpha ? 4 : 3, masks[0], masks[1], masks[2], alpha ? masks[3] : 0);
+            }
+            else if ((pixelFormat.flags & DDPF_LUMINANCE) && !(pixelFormat.flags & DDPF_ALPHAPIXELS)) {
+                layout.pixels = pixelLayout(bytes, 1, masks[0]);
+            }
+            return layout;
+        }
+
+        Layout ktxLayout(const KtxHeader& header) {
+            Layout layout;
+            if (header.glType == 0) {
+                switch (header.glInternalFormat) {
+                case 0x83F0: case 0x83F1: case 0x8C4C: case 0x8C4D:
+                    layout.format = BlockFormat::BC1;
+                    break;
+                case 0x83F2: case 0x8C4E:
+                    layout.format = BlockFormat::BC2;
+                    break;
+                case 0x83F3: case 0x8C4F:
+                    layout.format = BlockFormat::BC3;
+                    break;
+                case 0x8DBB:
+                    layout.format = BlockFormat::BC4;
+                    break;
+                case 0x8DBD:
+                    layout.format = BlockFormat::BC5;
+                    break;
+                case 0x8E8C: case 0x8E8D:
+                    layout.format = BlockFormat::BC7;
+                    break;
+                }
+                return layout;
+            }
+
+            // GL_UNSIGNED_BYTE texels only
+            if (header.glType != 0x1401) {
+                return layout;
+            }
+            switch (header.glFormat) {
+            case 0x1903:                       // GL_RED
+            case 0x1909:                       // GL_LUMINANCE
+                layout.pixels = pixelLayout(1, 1, 0xFF);
+                break;
+            case 0x8227:                       // GL_RG
+                layout.pixels = pixelLayout(2, 2, 0xFF, 0xFF00);
+                break;
+            case 0x1907:                       // GL_RGB
+                layout.pixels = pixelLayout(3, 3, 0xFF, 0xFF00, 0xFF0000);
+                break;
+            case 0x80E0:                       // GL_BGR
+                layout.pixels = pixelLayout(3, 3, 0xFF0000, 0xFF00, 0xFF);
+                break;
+            case 0x1908:                       // GL_RGBA
+                layout.pixels = pixelLayout(4, 4, 0xFF, 0xFF00, 0xFF0000, 0xFF000000);
+                break;
+            case 0x80E1:                       // GL_BGRA
+                layout.pixels = pixelLayout(4, 4, 0xFF0000, 0xFF00, 0xFF, 0xFF000000);
+                break;
+            }
+            return layout;
+        }
+
+        bool checkLayout(const std::string& filename, const Layout& layout) {
+            if (layout.format != BlockFormat::None) {
+                return TextureCompression::IsSupported(layout.format) || fail(filename, "block format not supported by the driver");
+            }
+            return isByteLayout(layout.pixels) || fail(filename, "unsupported pixel format");
+        }
+
+        // Checked on the header's unsigned sizes, before they are used as int
+        bool checkSize(const std::string& filename, uint32_t width, uint32_t height) {
+            if (width == 0 || height == 0) {
+                return fail(filename, "empty texture");
+            }
+            uint32_t limit = static_cast<uint32_t>(TextureCompression::GetMaxTextureSize());
+            if (width > limit || height > limit) {
+                return fail(filename, "larger than the maximum texture size " + std::to_string(limit));
+            }
+            return true;
+        }
+
+        // Moves the levels into image, shaped as the chain without its dropped levels; a file of a single
+        // uncompressed level becomes pixels
+        void finish(const std::string& filename, const Layout& layout, int width, int height, int levels, int dropped,
+            const LevelRange& range, std::vector<unsigned char>&& levelData, ImageData& image) {
+            image.path = filename;
+            image.width = (std::max)(width >> dropped, 1);
+            image.height = (std::max)(height >> dropped, 1);
+            image.components = layout.format != BlockFormat::None ? 0 : layout.pixels.components;
+            image.format = layout.format;
+
+            if (layout.format == BlockFormat::None && levels == 1) {
+                unsigned char* pixels = static_cast<unsigned char*>(std::malloc(levelData.size()));
+                std::memcpy(pixels, levelData.data(), levelData.size());
+                image.pixels = std::unique_ptr<unsigned char, void(*)(void*)>(pixels, std::free);
+                image.levels = 0;
+                image.levelData.clear();
+                return;
+            }
+            image.levels = levels - dropped;
+            image.levelData = std::move(levelData);
+            image.firstLevel = range.first;
+        }
+
+        bool loadDds(const std::string& filename, const unsigned char* data, size_t size, const LevelRange& range, ImageData& image) {
+            size_t offset = sizeof(uint32_t) + sizeof(DdsHeader);
+            if (size < offset) {
+                return fail(filename, "truncated header");
+            }
+
+            DdsHeader header;
+            std::memcpy(&header, data + sizeof(uint32_t), sizeof(header));
+            if (header.size != sizeof(DdsHeader) || (header.caps2 & (DDSCAPS2_CUBEMAP | DDSCAPS2_VOLUME))) {
+                return fail(filename, "not a 2D DDS texture");
+            }
+
+            Layout layout;
+            if ((header.pixelFormat.flags & DDPF_FOURCC) && header.pixelFormat.fourCC == fourCC('D', 'X', '1', '0')) {
+                DdsHeaderDx10 extension;
+                if (size < offset + sizeof(extension)) {
+                    return fail(filename, "truncated header");
+                }
+                std::memcpy(&extension, data + offset, sizeof(extension));
+                offset += sizeof(extension);
+                if (extension.resourceDimension != DDS_DIMENSION_TEXTURE2D || extension.arraySize > 1 || (extension.miscFlag & DDS_MISC_TEXTURECUBE)) {
+                    return fail(filename, "not a 2D DDS texture");
+                }
+                layout = dxgiLayout(extension.dxgiFormat);
+            }
+            else {
+                layout = ddsLayout(header.pixelFormat);
+            }
+            if (!checkLayout(filename, layout)) {
+                return false;
+            }
+
+            if (!checkSize(filename, header.width, header.height)) {
+                return false;
+            }
+            int width = static_cast<int>(header.width);
+            int height = static_cast<int>(header.height);
+            int levels = (header.flags & DDSD_MIPMAPCOUNT) && header.mipMapCount > 0 ? static_cast<int>(header.mipMapCount) : 1;
+            levels = (std::min)(levels, fullChainLength(width, height));
+            int dropped = droppedLevels(width, height, levels, range.maxSize);
+            int first = range.first + dropped;
+            int last = (std::min)(range.last, levels - 1 - dropped) + dropped;
+            if (range.first < 0 || first > last) {
+                return fail(filename, "no mip level " + std::to_string(range.first));
+            }
+
+            // Levels follow each other without padding, uncompressed rows are tightly packed
+            std::vector<unsigned char> levelData;
+            for (int level = 0, w = width, h = height; level <= last; level++, w = (std::max)(w / 2, 1), h = (std::max)(h / 2, 1)) {
+                size_t rowStride = size_t(w) * layout.pixels.bytes;
+                size_t stored = layout.format != BlockFormat::None ? levelSize(layout, w, h) : rowStride * h;
+                if (size - offset < stored) {
+                    return fail(filename, "truncated mip level " + std::to_string(level));
+                }
+                if (level >= first) {
+                    size_t start = levelData.size();
+                    levelData.resize(start + levelSize(layout, w, h));
+                    copyLevel(layout, data + offset, rowStride, w, h, levelData.data() + start);
+                }
+                offset += stored;
+            }
+
+            finish(filename, layout, width, height, levels, dropped, range, std::move(levelData), image);
+            return true;
+        }
+
+        uint32_t swapBytes(uint32_t value) {
+            return (value >> 24) | ((value >> 8) & 0xFF00) | ((value << 8) & 0xFF0000) | (value << 24);
+        }
+
+        bool loadKtx(const std::string& filename, const unsigned char* data, size_t size, const LevelRange& range, ImageData& image) {
+            size_t offset = sizeof(KTX_IDENTIFIER) + sizeof(KtxHeader);
+            if (size < offset) {
+                return fail(filename, "truncated header");
+            }
+
+            KtxHeader header;
+            std::memcpy(&header, data + sizeof(KTX_IDENTIFIER), sizeof(header));
+            bool swapped = header.endianness != KTX_ENDIANNESS;
+            if (swapped) {
+                uint32_t* fields = reinterpret_cast<uint32_t*>(&header);
+                for (size_t i = 0; i < sizeof(header) / sizeof(uint32_t); i++) {
+                    fields[i] = swapBytes(fields[i]);
+                }
+                if (header.endianness != KTX_ENDIANNESS) {
+                    return fail(filename, "bad endianness marker");
+                }
+            }
+            if (header.pixelHeight == 0 || header.pixelDepth > 1 || header.numberOfArrayElements > 0 || header.numberOfFaces != 1) {
+                return fail(filename, "not a 2D KTX texture");
+            }
+
+            Layout layout = ktxLayout(header);
+            if (!checkLayout(filename, layout)) {
+                return false;
+            }
+            if (size - offset < header.bytesOfKeyValueData) {
+                return fail(filename, "truncated key/value data");
+            }
+            offset += header.bytesOfKeyValueData;
+
+            if (!checkSize(filename, header.pixelWidth, header.pixelHeight)) {
+                return false;
+            }
+            int width = static_cast<int>(header.pixelWidth);
+            int height = static_cast<int>(header.pixelHeight);
+            int levels = (std::max)(static_cast<int>(header.numberOfMipmapLevels), 1);
+            levels = (std::min)(levels, fullChainLength(width, height));
+            int dropped = droppedLevels(width, height, levels, range.maxSize);
+            int first = range.first + dropped;
+            int last = (std::min)(range.last, levels - 1 - dropped) + dropped;
+            if (range.first < 0 || first > last) {
+                return fail(filename, "no mip level " + std::to_string(range.first));
+            }
+
+            // Every level is preceded by its size; uncompressed rows and whole levels are padded to 4 bytes.
+            // Levels before the range are skipped by their sizes.
+            std::vector<unsigned char> levelData;
+            for (int level = 0, w = width, h = height; level <= last; level++, w = (std::max)(w / 2, 1), h = (std::max)(h / 2, 1)) {
+                uint32_t imageSize;
+                if (size - offset < sizeof(imageSize)) {
+                    return fail(filename, "truncated mip level " + std::to_string(level));
+                }
+                std::memcpy(&imageSize, data + offset, sizeof(imageSize));
+                imageSize = swapped ? swapBytes(imageSize) : imageSize;
+                offset += sizeof(imageSize);
+
+                size_t rowStride = (size_t(w) * layout.pixels.bytes + 3) & ~size_t(3);
+                size_t stored = layout.format != BlockFormat::None ? levelSize(layout, w, h) : rowStride * h;
+                if (imageSize < stored || size - offset < imageSize) {
+                    return fail(filename, "truncated mip level " + std::to_string(level));
+                }
+                if (level >= first) {
+                    size_t start = levelData.size();
+                    levelData.resize(start + levelSize(layout, w, h));
+                    copyLevel(layout, data + offset, rowStride, w, h, levelData.data() + start);
+                }
+                offset += (size_t(imageSize) + 3) & ~size_t(3);
+                offset = (std::min)(offset, size);
+            }
+
+            finish(filename, layout, width, height, levels, dropped, range, std::move(levelData), image);
+            return true;
+        }
+
+        std::string lowerExtension(const std::string& filename) {
+            size_t dot = filename.find_last_of('.');
+            std::string extension = dot == std::string::npos ? "" : filename.substr(dot + 1);
+            std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+            return extension;
+        }
+
+        bool loadMemory(const std::string& name, const unsigned char* data, size_t size, const LevelRange& range, ImageData& image) {
+            if (size >= sizeof(DDS_MAGIC) && std::memcmp(data, &DDS_MAGIC, sizeof(DDS_MAGIC)) == 0) {
+                return loadDds(name, data, size, range, image);
+            }
+            if (size >= sizeof(KTX_IDENTIFIER) && std::memcmp(data, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) == 0) {
+                return loadKtx(name, data, size, range, image);
+            }
+            return fail(name, "unknown container format");
+        }
+    }
+
+    bool IsContainer(const std::string& filename) {
+        std::string extension = lowerExtension(filename);
+        return extension == "dds" || extension == "ktx";
+    }
+
+    bool IsContainerData(const unsigned char* data, size_t size) {
+        return (size >= sizeof(DDS_MAGIC) && std::memcmp(data, &DDS_MAGIC, sizeof(DDS_MAGIC)) == 0)
+            || (size >= sizeof(KTX_IDENTIFIER) && std::memcmp(data, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) == 0);
+    }
+
+    bool Load(const std::string& filename, ImageData& image) {
+        MappedFile file;
+        if (!file.Open(filename)) {
+            return false;
+        }
+        return LoadMemory(filename, reinterpret_cast<const unsigned char*>(file.Data()), file.Size(), image);
+    }
+
+    bool LoadMemory(const std::string& name, const unsigned char* data, size_t size, ImageData& image) {
+        return loadMemory(name, data, size, LevelRange(), image);
+    }
+
+    bool LoadLevels(const std::string& filename, int maxSize, int firstLevel, int lastLevel, ImageData& image) {
+        MappedFile file;
+        if (!file.Open(filename)) {
+            return false;
+        }
+        LevelRange range;
+        range.maxSize = maxSize;
+        range.first = firstLevel;
+        range.last = lastLevel;
+        return loadMemory(filename, reinterpret_cast<const unsigned char*>(file.Data()), file.Size(), range, image);
+    }
+}
\ No newline at end of file
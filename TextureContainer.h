@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+#include "TextureLoader.h"
+
+// Readers for GPU-ready texture containers, DDS and KTX 1. The file is memory-mapped and its stored mip
+// chain is copied out as it is, block-compressed or 8 bits per channel, so a texture set exported with
+// mipmaps loads without decoding and without generating mipmaps on upload. Cube maps, arrays and volume
+// textures are rejected.
+namespace TextureContainer {
+    // True for a .dds or .ktx file name
+    bool IsContainer(const std::string& filename);
+    // True if the bytes start like a DDS or KTX file
+    bool IsContainerData(const unsigned char* data, size_t size);
+
+    // Fills levels and levelData from the file, safe to call from any thread. A single uncompressed
+    // level is returned as pixels instead, so it still gets mipmaps on upload. False (with a message)
+    // if the file is broken or holds a format that cannot be uploaded here.
+    bool Load(const std::string& filename, ImageData& image);
+
+    // Reads only levels firstLevel..lastLevel, counted after the levels larger than maxSize are dropped
+    // as MipBuilder::Fit does. The image gets the shape of that chain and its levelData starts at
+    // firstLevel; the levels skipped are never read from the mapped file.
+    bool LoadLevels(const std::string& filename, int maxSize, int firstLevel, int lastLevel, ImageData& image);
+
+    // Same for a container already in memory, such as an image embedded in a model; name is only used
+    // for the image's path and messages
+    bool LoadMemory(const std::string& name, const unsigned char* data, size_t size, ImageData& image);
+}
\ No newline at end of file
@@ -0,0 +1,400 @@
+#include "TextureLoader.h"
+#include "TextureCompression.h"
+#include "TextureContainer.h"
+#include "MipBuilder.h"
+#include <glad/glad.h>
+#include "stb_image.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// S3TC and BPTC are extensions to GL 3.3, so the loader does not define them
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT 0x83F2
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT 0x8C4E
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
+#endif
+
+namespace TextureLoader {
+    namespace {
+        bool fileExists(const std::string& filename) {
+            std::ifstream file(filename);
+            return file.good();
+        }
+
+        GLenum compressedFormat(BlockFormat format, bool gamma) {
+            switch (format) {
+            case BlockFormat::BC1:
+                return gamma ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+            case BlockFormat::BC2:
+                return gamma ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT : GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+            case BlockFormat::BC3:
+                return gamma ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            case BlockFormat::BC4:
+                return GL_COMPRESSED_RED_RGTC1;
+            case BlockFormat::BC5:
+                return GL_COMPRESSED_RG_RGTC2;
+            case BlockFormat::BC7:
+                return gamma ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+            default:
+                return 0;
+            }
+        }
+
+        // Copies the data into the pixel buffer and leaves it bound; false (nothing bound) if the buffer
+        // cannot be used and the data has to go straight from memory. The buffer's storage is orphaned
+        // first so writing it never waits for the previous upload.
+        bool stage(unsigned int pixelBuffer, const void* data, size_t size) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+            void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            if (mapped) {
+                std::memcpy(mapped, data, size);
+            }
+            // Unmapping fails if the storage was lost meanwhile
+            if (mapped && glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER)) {
+                return true;
+            }
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            return false;
+        }
+
+        void pixelFormat(int components, bool gamma, GLenum& format, GLenum& internalFormat) {
+            if (components == 1) {
+                format = GL_RED;
+                internalFormat = GL_RED;
+            }
+            else if (components == 2) {
+                format = GL_RG;
+                internalFormat = GL_RG;
+            }
+            else if (components == 3) {
+                format = GL_RGB;
+                internalFormat = gamma ? GL_SRGB : GL_RGB;
+            }
+            else {
+                format = GL_RGBA;
+                internalFormat = gamma ? GL_SRGB_ALPHA : GL_RGBA;
+            }
+        }
+
+        // Uploads levels firstLevel..lastLevel of a stored mip chain as they are, no mipmaps are generated.
+        // With staged set the data is read from the bound pixel buffer at the same offsets.
+        void uploadLevels(const ImageData& image, bool gamma, bool staged, int firstLevel, int lastLevel) {
+            bool compressed = image.format != BlockFormat::None;
+            GLenum format = 0;
+            GLenum internalFormat = compressedFormat(image.format, gamma);
+            if (!compressed) {
+                pixelFormat(image.components, gamma, format, internalFormat);
+            }
+
+            size_t offset = 0;
+            for (int level = image.firstLevel; level < firstLevel; level++) {
+                offset += GetLevelSize(image, level);
+            }
+            for (int level = firstLevel; level <= lastLevel; level++) {
+                int width = (std::max)(image.width >> level, 1);
+                int height = (std::max)(image.height >> level, 1);
+                size_t size = GetLevelSize(image, level);
+                const void* data = staged ? reinterpret_cast<const void*>(offset) : image.levelData.data() + offset;
+                if (compressed) {
+                    glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0, static_cast<GLsizei>(size), data);
+                }
+                else {
+                    glTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+                }
+                offset += size;
+            }
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, firstLevel);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.levels - 1);
+        }
+
+        // Mip chains are read from and written to the texture cache while either kind is built
+        bool useCache() {
+            return TextureCompression::IsEnabled() || MipBuilder::IsEnabled();
+        }
+
+        // Turns decoded pixels into the chain that is uploaded: block-compressed when compression is on
+        // and the role has a format, otherwise uncompressed from MipBuilder. False if the pixels stay as
+        // they are and get their mipmaps on upload.
+        bool buildChain(ImageData& image) {
+            if (TextureCompression::IsEnabled() && TextureCompression::Compress(image, TextureCompression::ChooseFormat(image))) {
+                return true;
+            }
+            return MipBuilder::IsEnabled() && MipBuilder::Build(image);
+        }
+
+        uint64_t mix(uint64_t h, uint64_t value) {
+            h ^= value * 0x9E3779B97F4A7C15ull;
+            h = (h << 31) | (h >> 33);
+            return h * 0xC2B2AE3D27D4EB4Full;
+        }
+
+        bool loadEmbedded(const EmbeddedImage& embedded, TextureRole role, ImageData& image) {
+            if (useCache() && TextureCompression::LoadCached(embedded.name, role, image)) {
+                return true;
+            }
+            if (!DecodeEmbedded(embedded, image)) {
+                return false;
+            }
+            image.role = role;
+
+            // A container is cached as it is, so its levels can be read back by name later
+            if (!image.levelData.empty()) {
+                MipBuilder::Fit(image);
+            }
+            if (!image.levelData.empty() || buildChain(image)) {
+                TextureCompression::StoreCached(embedded.name, image);
+            }
+            return true;
+        }
+
+        bool load(const std::string& filename, TextureRole role, ImageData& image) {
+            // Containers are uploaded as authored, neither decoded nor recompressed
+            if (TextureContainer::IsContainer(filename)) {
+                if (!TextureContainer::Load(filename, image)) {
+                    return false;
+                }
+                image.role = role;
+                MipBuilder::Fit(image);
+                return true;
+            }
+
+            if (useCache() && TextureCompression::LoadCached(filename, role, image)) {
+                return true;
+            }
+            if (!Decode(filename, image)) {
+                return false;
+            }
+            image.role = role;
+
+            if (buildChain(image)) {
+                TextureCompression::StoreCached(filename, image);
+            }
+            return true;
+        }
+    }
+
+    std::string ResolvePath(const std::string& path, const std::string& directory) {
+        std::string filename = directory.empty() ? path : directory + '/' + path;
+
+        if (fileExists(filename)) {
+            return filename;
+        }
+
+        // Try different extensions for missing textures
+        std::vector<std::string> extensions = { ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".dds", ".ktx" };
+        std::string baseName = filename.substr(0, filename.find_last_of('.'));
+
+        for (const auto& ext : extensions) {
+            std::string altPath = baseName + ext;
+            if (fileExists(altPath)) {
+                return altPath;
+            }
+        }
+
+        return "";
+    }
+
+    bool Decode(const std::string& filename, ImageData& image) {
+        int width, height, nrComponents;
+        unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
+        if (!data) {
+            return false;
+        }
+
+        image.path = filename;
+        image.width = width;
+        image.height = height;
+        image.components = nrComponents;
+        image.pixels = std::unique_ptr<unsigned char, void(*)(void*)>(data, stbi_image_free);
+        return true;
+    }
+
+    bool LoadLevels(const std::string& filename, TextureRole role, int firstLevel, int lastLevel, ImageData& image) {
+        if (TextureContainer::IsContainer(filename)) {
+            if (!TextureContainer::LoadLevels(filename, MipBuilder::GetMaxSize(role), firstLevel, lastLevel, image)) {
+                return false;
+            }
+            image.role = role;
+            return true;
+        }
+
+        if (useCache() && TextureCompression::LoadCachedLevels(filename, role, firstLevel, lastLevel, image)) {
+            return true;
+        }
+        if (!load(filename, role, image) || image.levelData.empty() || firstLevel > lastLevel || lastLevel >= image.levels) {
+            return false;
+        }
+
+        size_t start = 0;
+        for (int level = 0; level < firstLevel; level++) {
+            start += GetLevelSize(image, level);
+        }
+        size_t end = start;
+        for (int level = firstLevel; level <= lastLevel; level++) {
+            end += GetLevelSize(image, level);
+        }
+        if (end > image.levelData.size()) {
+            return false;
+        }
+        image.levelData = std::vector<unsigned char>(image.levelData.begin() + start, image.levelData.begin() + end);
+        image.firstLevel = firstLevel;
+        return true;
+    }
+
+    bool DecodeEmbedded(const EmbeddedImage& embedded, ImageData& image) {
+        if (embedded.data.empty()) {
+            return false;
+        }
+        if (TextureContainer::IsContainerData(embedded.data.data(), embedded.data.size())) {
+            return TextureContainer::LoadMemory(embedded.name, embedded.data.data(), embedded.data.size(), image);
+        }
+
+        int width = embedded.width;
+        int height = embedded.height;
+        int nrComponents = 4;
+        unsigned char* data = nullptr;
+        if (width == 0) {
+            data = stbi_load_from_memory(embedded.data.data(), static_cast<int>(embedded.data.size()), &width, &height, &nrComponents, 0);
+        }
+        else if (embedded.data.size() >= size_t(width) * height * 4) {
+            data = static_cast<unsigned char*>(std::malloc(embedded.data.size()));
+            std::memcpy(data, embedded.data.data(), embedded.data.size());
+        }
+        if (!data) {
+            return false;
+        }
+
+        image.path = embedded.name;
+        image.width = width;
+        image.height = height;
+        image.components = nrComponents;
+        image.pixels = std::unique_ptr<unsigned char, void(*)(void*)>(data, embedded.width == 0 ? stbi_image_free : std::free);
+        return true;
+    }
+
+    bool LoadEmbedded(const EmbeddedImage& embedded, TextureRole role, ImageData& image) {
+        if (!loadEmbedded(embedded, role, image)) {
+            return false;
+        }
+        image.contentHash = ContentHash(image);
+        return true;
+    }
+
+    bool Load(const std::string& filename, TextureRole role, ImageData& image) {
+        if (!load(filename, role, image)) {
+            return false;
+        }
+        image.contentHash = ContentHash(image);
+        return true;
+    }
+
+    uint64_t ContentHash(const ImageData& image) {
+        const unsigned char* data = !image.levelData.empty() ? image.levelData.data() : image.pixels.get();
+        size_t size = image.GetByteSize();
+
+        uint64_t h = mix(uint64_t(image.width) << 32 | uint32_t(image.height), image.components);
+        h = mix(h, static_cast<uint64_t>(image.format));
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, data + i, 8);
+            h = mix(h, word);
+        }
+        uint64_t tail = 0;
+        std::memcpy(&tail, data + i, size - i);
+        h = mix(h, tail);
+
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDull;
+        h ^= h >> 33;
+        // 0 stands for "not computed"
+        return h != 0 ? h : 1;
+    }
+
+    GLTexture Upload(const ImageData& image, bool gamma, unsigned int pixelBuffer, int firstLevel) {
+        if (!image.IsValid()) {
+            return GLTexture();
+        }
+
+        GLTexture texture = GLTexture::Create();
+        glBindTexture(GL_TEXTURE_2D, texture.Get());
+
+        // Rows of 1- and 3-channel images are not 4-byte aligned in general
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        const unsigned char* source = !image.levelData.empty() ? image.levelData.data() : image.pixels.get();
+        // Only the whole image goes through the pixel buffer, a few small mips are not worth staging
+        bool staged = pixelBuffer != 0 && firstLevel == 0 && stage(pixelBuffer, source, image.GetByteSize());
+
+        if (!image.levelData.empty()) {
+            uploadLevels(image, gamma, staged, (std::min)(firstLevel, image.levels - 1), image.levels - 1);
+        }
+        else {
+            GLenum format;
+            GLenum internalFormat;
+            pixelFormat(image.components, gamma, format, internalFormat);
+            glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, staged ? nullptr : source);
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
+
+        if (staged) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        return texture;
+    }
+    void UploadLevels(const ImageData& image, bool gamma, int firstLevel, int lastLevel) {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        uploadLevels(image, gamma, false, firstLevel, lastLevel);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+    void DiscardLevels(const ImageData& image, bool gamma, int firstLevel, int lastLevel) {
+        bool compressed = image.format != BlockFormat::None;
+        GLenum format = 0;
+        GLenum internalFormat = compressedFormat(image.format, gamma);
+        if (!compressed) {
+            pixelFormat(image.components, gamma, format, internalFormat);
+        }
+
+        // The finer levels are outside the base..max range first, so the texture stays complete throughout
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, lastLevel + 1);
+        for (int level = firstLevel; level <= lastLevel; level++) {
+            if (compressed) {
+                glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, 0, 0, 0, 0, nullptr);
+            }
+            else {
+                glTexImage2D(GL_TEXTURE_2D, level, internalFormat, 0, 0, 0, format, GL_UNSIGNED_BYTE, nullptr);
+            }
+        }
+    }
+
+    size_t GetLevelSize(const ImageData& image, int level) {
+        int width = (std::max)(image.width >> level, 1);
+        int height = (std::max)(image.height >> level, 1);
+        if (image.format != BlockFormat::None) {
+            return TextureCompression::GetLevelSize(image.format, width, height);
+        }
+        return size_t(width) * height * image.components;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,107 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "GLHandle.h"
+
+// What a material texture holds, which decides how it may be compressed
+enum class TextureRole {
+    Color,
+    Normal,         // tangent-space normal map, only X and Y are kept when compressed
+    Mask            // single-channel data read from red (roughness, metallic, occlusion)
+};
+
+enum class BlockFormat {
+    None,
+    BC1,
+    BC2,
+    BC3,
+    BC4,
+    BC5,
+    BC7
+};
+
+// 8-bit image decoded into system memory, waiting to be uploaded as a GL texture. Either pixels holds
+// the top level and the mipmaps are generated on upload, or levelData holds a complete stored mip chain.
+struct ImageData {
+    std::string path;       // file the pixels came from
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    std::unique_ptr<unsigned char, void(*)(void*)> pixels{ nullptr, nullptr };
+
+    TextureRole role = TextureRole::Color;
+    BlockFormat format = BlockFormat::None;
+    // Levels largest first: blocks when format is set, otherwise tightly packed pixels
+    int levels = 0;
+    std::vector<unsigned char> levelData;
+    // Level levelData starts at; only TextureLoader::LoadLevels leaves out the larger levels
+    int firstLevel = 0;
+    // TextureLoader::ContentHash of the image, set by Load and LoadEmbedded on the decoding thread; 0 if not computed
+    uint64_t contentHash = 0;
+
+    bool IsValid() const { return pixels != nullptr || !levelData.empty(); }
+    // Bytes handed to GL for the image
+    size_t GetByteSize() const { return !levelData.empty() ? levelData.size() : size_t(width) * height * components; }
+};
+
+// Image stored inside a model file (GLB buffer view, data URI, Assimp aiTexture), referenced by
+// materials as "*<index>". Either an encoded image file or raw RGBA texels.
+struct EmbeddedImage {
+    std::string name;                   // "<model path>*<index>", the texture's cache key
+    int width = 0;                      // 0 for an encoded file, otherwise data holds width * height RGBA texels
+    int height = 0;
+    std::vector<unsigned char> data;
+};
+
+// Image file decoding is split from the GL upload so decoding can happen on a loader thread
+namespace TextureLoader {
+    // Finds the file a material refers to, trying common image extensions when the exact file is missing.
+    // Returns an empty string if nothing usable exists.
+    std::string ResolvePath(const std::string& path, const std::string& directory);
+
+    // Decodes an image file, safe to call from any thread
+    bool Decode(const std::string& filename, ImageData& image);
+
+    // Decode for a texture of the given role. DDS and KTX files keep their stored mip chain. Otherwise the
+    // result is a mip chain built on the CPU, block-compressed when texture compression is enabled, and
+    // read from the disk cache without decoding when it is up to date. Chains are capped at the role's
+    // maximum size.
+    bool Load(const std::string& filename, TextureRole role, ImageData& image);
+
+    // Reads only levels firstLevel..lastLevel of the stored chain Load would return, for TextureStreamer:
+    // from the container, counted after the levels over the role's maximum size, or from the cache entry.
+    // The image gets the chain's shape and its levelData starts at firstLevel. Without a cache entry the
+    // chain is built in full and cut down. Safe to call from any thread.
+    bool LoadLevels(const std::string& filename, TextureRole role, int firstLevel, int lastLevel, ImageData& image);
+
+    // Decodes an embedded image from memory, safe to call from any thread
+    bool DecodeEmbedded(const EmbeddedImage& embedded, ImageData& image);
+
+    // Load for an embedded image, its mip chain cached on disk under its name like a file
+    bool LoadEmbedded(const EmbeddedImage& embedded, TextureRole role, ImageData& image);
+
+    // Hash of an image's shape, format and every byte, by which identical textures are shared. Reads the
+    // whole image, so Load and LoadEmbedded compute it while decoding rather than the GL thread on upload.
+    uint64_t ContentHash(const ImageData& image);
+
+    // Creates a mipmapped, repeating GL texture from decoded pixels or a compressed mip chain, empty on
+    // failure. GL thread only.
+    // With a pixel buffer the pixels are staged through it, so the driver can copy them to the texture
+    // asynchronously instead of during the call. A stored mip chain is uploaded from firstLevel on, the
+    // finer levels are left empty for TextureStreamer.
+    GLTexture Upload(const ImageData& image, bool gamma = false, unsigned int pixelBuffer = 0, int firstLevel = 0);
+
+    // Uploads levels firstLevel..lastLevel of a stored mip chain into the texture bound to GL_TEXTURE_2D
+    // and makes firstLevel its base level; the levels above it are left as they are. The image may hold
+    // only part of its chain, from image.firstLevel on. GL thread only.
+    void UploadLevels(const ImageData& image, bool gamma, int firstLevel, int lastLevel);
+
+    // Frees levels firstLevel..lastLevel of the texture bound to GL_TEXTURE_2D, an image shaped like
+    // the one it was uploaded from, and makes the next level its base. GL thread only.
+    void DiscardLevels(const ImageData& image, bool gamma, int firstLevel, int lastLevel);
+
+    // Bytes of one level of a stored mip chain
+    size_t GetLevelSize(const ImageData& image, int level);
+}
\ No newline at end of file
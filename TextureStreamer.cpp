@@ -0,0 +1,298 @@
+#include "TextureStreamer.h"
+#include "TextureCompression.h"
+#include "TextureContainer.h"
+#include "MipBuilder.h"
+#include "ThreadPool.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <future>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace TextureStreamer {
+    namespace {
+        // Levels no larger than this are uploaded with the texture and never evicted
+        const int RESIDENT_SIZE = 128;
+        const size_t MAX_LOADS = 4;
+        // Finished loads are uploaded up to this many bytes per frame (at least one)
+        const size_t UPLOAD_BYTES_PER_FRAME = 64 * 1024 * 1024;
+
+        struct StreamedTexture {
+            ImageData shape;                // size, format and source of the image, no data
+            bool gamma = false;
+            int tail = 0;                   // first always-resident level
+            int base = 0;                   // finest resident level
+            int requested = INT_MAX;        // finest level asked for since the last Update
+            int wanted = 0;
+            uint64_t lastWantedFrame = 0;
+            int loadingLevel = 0;           // levels being read, loadingLevel..loadingLast
+            int loadingLast = 0;
+            std::future<ImageData> loading;
+            bool failed = false;            // the levels could not be read back, the texture stays as it is
+        };
+
+        std::atomic<bool> enabled{ true };
+        std::atomic<size_t> budget{ size_t(2048) * 1024 * 1024 };
+        std::unordered_map<unsigned int, StreamedTexture> textures;
+        uint64_t frame = 0;
+        Stats stats;
+
+        int tailLevel(const ImageData& image) {
+            int level = 0;
+            while (level < image.levels - 1 && (std::max)(image.width >> level, image.height >> level) > RESIDENT_SIZE) {
+                level++;
+            }
+            return level;
+        }
+
+        size_t levelBytes(const ImageData& image, int firstLevel, int lastLevel) {
+            size_t bytes = 0;
+            for (int level = firstLevel; level <= lastLevel; level++) {
+                bytes += TextureLoader::GetLevelSize(image, level);
+            }
+            return bytes;
+        }
+
+        // Whether a finished load holds the levels it was started for, of an image shaped as the texture
+        bool loadedLevels(const ImageData& image, const StreamedTexture& texture) {
+            const ImageData& shape = texture.shape;
+            return image.width == shape.width && image.height == shape.height && image.components == shape.components &&
+                image.format == shape.format && image.levels == shape.levels && image.firstLevel == texture.loadingLevel &&
+                image.levelData.size() >= levelBytes(shape, texture.loadingLevel, texture.loadingLast);
+        }
+
+        // Uploads the levels a finished load brought, unless the texture no longer wants them
+        size_t finishLoad(unsigned int id, StreamedTexture& texture) {
+            ImageData image = texture.loading.get();
+            stats.loading--;
+            if (!loadedLevels(image, texture)) {
+                std::cout << "Texture streaming stopped for " << texture.shape.path << ": its levels could not be read back" << std::endl;
+                texture.failed = true;
+                return 0;
+            }
+
+            // Levels evicted meanwhile leave a gap below the loaded ones, the next Update loads them again
+            int first = (std::max)(texture.loadingLevel, texture.wanted);
+            if (first >= texture.base || texture.base - 1 > texture.loadingLast) {
+                return 0;
+            }
+            glBindTexture(GL_TEXTURE_2D, id);
+            TextureLoader::UploadLevels(image, texture.gamma, first, texture.base - 1);
+            glBindTexture(GL_TEXTURE_2D, 0);
+
+            size_t bytes = levelBytes(texture.shape, first, texture.base - 1);
+            stats.residentBytes += bytes;
+            texture.base = first;
+            return bytes;
+        }
+
+        void finishLoads() {
+            size_t uploaded = 0;
+            for (auto& [id, texture] : textures) {
+                if (!texture.loading.valid() || texture.loading.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                    continue;
+                }
+                if (uploaded > 0 && uploaded >= UPLOAD_BYTES_PER_FRAME) {
+                    break;
+                }
+                uploaded += finishLoad(id, texture);
+            }
+        }
+
+        // Drops the levels textures have but do not want, least recently wanted first, until what is
+        // resident plus what is still missing fits the budget
+        void evict(size_t missingBytes) {
+            size_t limit = budget.load();
+            limit = missingBytes < limit ? limit - missingBytes : 0;
+            if (stats.residentBytes <= limit) {
+                return;
+            }
+
+            std::vector<std::pair<unsigned int, StreamedTexture*>> candidates;
+            for (auto& [id, texture] : textures) {
+                if (texture.base < texture.wanted) {
+                    candidates.push_back({ id, &texture });
+                }
+            }
+            std::sort(candidates.begin(), candidates.end(),
+                [](const auto& a, const auto& b) { return a.second->lastWantedFrame < b.second->lastWantedFrame; });
+
+            for (auto& [id, texture] : candidates) {
+                if (stats.residentBytes <= limit) {
+                    break;
+                }
+                int last = texture->base;
+                size_t bytes = TextureLoader::GetLevelSize(texture->shape, last);
+                while (last + 1 < texture->wanted && stats.residentBytes - bytes > limit) {
+                    last++;
+                    bytes += TextureLoader::GetLevelSize(texture->shape, last);
+                }
+
+                glBindTexture(GL_TEXTURE_2D, id);
+                TextureLoader::DiscardLevels(texture->shape, texture->gamma, texture->base, last);
+                glBindTexture(GL_TEXTURE_2D, 0);
+                stats.residentBytes -= bytes;
+                stats.evictedLevels += last - texture->base + 1;
+                texture->base = last + 1;
+            }
+        }
+
+        // Starts reading the textures missing the most levels, each as far as the budget allows
+        void startLoads() {
+            std::vector<std::pair<int, StreamedTexture*>> candidates;
+            for (auto& [id, texture] : textures) {
+                if (texture.wanted < texture.base && !texture.failed && !texture.loading.valid()) {
+                    candidates.push_back({ texture.base - texture.wanted, &texture });
+                }
+            }
+            std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+            size_t limit = budget.load();
+            size_t committed = stats.residentBytes;
+            for (auto& [missing, texture] : candidates) {
+                if (stats.loading >= MAX_LOADS) {
+                    break;
+                }
+
+                int first = texture->base;
+                size_t bytes = 0;
+                while (first > texture->wanted && committed + bytes + TextureLoader::GetLevelSize(texture->shape, first - 1) <= limit) {
+                    first--;
+                    bytes += TextureLoader::GetLevelSize(texture->shape, first);
+                }
+                if (first == texture->base) {
+                    continue;
+                }
+
+                committed += bytes;
+                texture->loadingLevel = first;
+                texture->loadingLast = texture->base - 1;
+                texture->loading = ThreadPool::Shared().Submit([path = texture->shape.path, role = texture->shape.role, first, last = texture->loadingLast]() {
+                    ImageData image;
+                    TextureLoader::LoadLevels(path, role, first, last, image);
+                    return image;
+                });
+                stats.loading++;
+            }
+        }
+    }
+
+    bool CanStream(const ImageData& image) {
+        if (!IsEnabled() || image.levelData.empty() || image.path.empty() || tailLevel(image) == 0) {
+            return false;
+        }
+        // Read back through TextureLoader::LoadLevels: the container itself, or the cache entry of the chain
+        return TextureContainer::IsContainer(image.path) || TextureCompression::IsEnabled() || MipBuilder::IsEnabled();
+    }
+
+    GLTexture Upload(const ImageData& image, bool gamma) {
+        int tail = tailLevel(image);
+        GLTexture texture = TextureLoader::Upload(image, gamma, 0, tail);
+        if (!texture) {
+            return texture;
+        }
+
+        StreamedTexture& streamed = textures[texture.Get()];
+        streamed.shape.path = image.path;
+        streamed.shape.width = image.width;
+        streamed.shape.height = image.height;
+        streamed.shape.components = image.components;
+        streamed.shape.role = image.role;
+        streamed.shape.format = image.format;
+        streamed.shape.levels = image.levels;
+        streamed.gamma = gamma;
+        streamed.tail = tail;
+        streamed.base = tail;
+        streamed.wanted = tail;
+        streamed.lastWantedFrame = frame;
+
+        stats.textures = textures.size();
+        stats.residentBytes += levelBytes(image, tail, image.levels - 1);
+        stats.fullBytes += levelBytes(image, 0, image.levels - 1);
+        return texture;
+    }
+
+    void Release(unsigned int texture) {
+        auto found = textures.find(texture);
+        if (found == textures.end()) {
+            return;
+        }
+        const StreamedTexture& streamed = found->second;
+        stats.residentBytes -= levelBytes(streamed.shape, streamed.base, streamed.shape.levels - 1);
+        stats.fullBytes -= levelBytes(streamed.shape, 0, streamed.shape.levels - 1);
+        // A load still running finishes into a future nobody reads
+        stats.loading -= streamed.loading.valid() ? 1 : 0;
+        textures.erase(found);
+        stats.textures = textures.size();
+    }
+
+    bool IsStreamed(unsigned int texture) {
+        return textures.find(texture) != textures.end();
+    }
+
+    void Request(unsigned int texture, float screenSize) {
+        auto found = textures.find(texture);
+        if (found == textures.end()) {
+            return;
+        }
+        StreamedTexture& streamed = found->second;
+
+        // One texel per pixel across the mesh, assuming its UVs span the texture once
+        int size = (std::max)(streamed.shape.width, streamed.shape.height);
+        int level = 0;
+        if (screenSize < size) {
+            level = screenSize > 1.0f ? static_cast<int>(std::floor(std::log2(size / screenSize))) : streamed.tail;
+        }
+        streamed.requested = (std::min)(streamed.requested, (std::min)(level, streamed.tail));
+    }
+
+    void Update() {
+        frame++;
+
+        // Textures nobody asked for this frame only need their small mips
+        size_t missingBytes = 0;
+        for (auto& [id, texture] : textures) {
+            if (texture.requested != INT_MAX) {
+                texture.wanted = texture.requested;
+                texture.lastWantedFrame = frame;
+            }
+            else {
+                texture.wanted = texture.tail;
+            }
+            texture.requested = INT_MAX;
+            if (texture.wanted < texture.base && !texture.failed) {
+                missingBytes += levelBytes(texture.shape, texture.wanted, texture.base - 1);
+            }
+        }
+
+        finishLoads();
+        evict(missingBytes);
+        startLoads();
+    }
+
+    void SetEnabled(bool value) {
+        enabled.store(value);
+    }
+
+    bool IsEnabled() {
+        return enabled.load();
+    }
+
+    void SetBudget(size_t bytes) {
+        budget.store(bytes);
+    }
+
+    size_t GetBudget() {
+        return budget.load();
+    }
+
+    Stats GetStats() {
+        return stats;
+    }
+}
\ No newline at end of file
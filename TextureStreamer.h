@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include "TextureLoader.h"
+
+// Mip-level residency for textures with a stored mip chain (texture cache entries, DDS and KTX).
+// A streamed texture is created with only its small mips, so it shows at once. Every frame the models ask
+// for the level their meshes need at their size on screen; missing levels are read back from the cache
+// entry or container on the shared thread pool and added to the same GL texture, and the levels wanted
+// least recently are dropped again while the resident total exceeds the budget. Texture names never
+// change, so meshes keep binding the ids they were given. GL thread only.
+namespace TextureStreamer {
+    struct Stats {
+        size_t textures = 0;            // streamed textures
+        size_t residentBytes = 0;       // video memory of their resident levels
+        size_t fullBytes = 0;           // what they would take fully resident
+        size_t loading = 0;             // textures whose finer levels are being read
+        size_t evictedLevels = 0;
+    };
+
+    // True if the image would be streamed: streaming is on, it has a stored mip chain larger than the
+    // always-resident small mips, and its levels can be read back from its file or cache entry
+    bool CanStream(const ImageData& image);
+
+    // Creates the texture with only its small mips and starts tracking it
+    GLTexture Upload(const ImageData& image, bool gamma);
+    // Stops tracking a texture that is about to be deleted
+    void Release(unsigned int texture);
+    // True for a texture created by Upload and not yet released, whatever levels it has resident
+    bool IsStreamed(unsigned int texture);
+
+    // Asks for the level a texture needs this frame, for a mesh spanning screenSize pixels; the finest
+    // request of the frame wins. Unknown textures are ignored.
+    void Request(unsigned int texture, float screenSize);
+    // Once per frame after the requests: uploads levels that finished loading, evicts, starts new loads
+    void Update();
+
+    void SetEnabled(bool enabled);
+    bool IsEnabled();
+    void SetBudget(size_t bytes);
+    size_t GetBudget();
+
+    Stats GetStats();
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "TextureUploadQueue.h"
+#include "ThreadPool.h"
+#include <chrono>
+
+TextureUploadQueue::TextureUploadQueue() : cancelled(std::make_shared<std::atomic<bool>>(false)) {
+}
+
+TextureUploadQueue::~TextureUploadQueue() {
+    cancelled->store(true, std::memory_order_relaxed);
+}
+
+void TextureUploadQueue::Enqueue(const std::string& filename, TextureRole role, bool gamma) {
+    Job job;
+    job.filename = filename;
+    job.gamma = gamma;
+    job.decoding = ThreadPool::Shared().Submit([filename, role, gamma, cancelled = cancelled]() {
+        ImageData image;
+        if (cancelled->load(std::memory_order_relaxed)) {
+            return image;
+        }
+        // A cached texture is found again by its path on upload
+        if (TextureCache::Contains(filename, role, gamma)) {
+            image.path = filename;
+            image.role = role;
+        }
+        else {
+            TextureLoader::Load(filename, role, image);
+        }
+        return image;
+    });
+    jobs.push_back(std::move(job));
+}
+
+void TextureUploadQueue::Enqueue(ImageData image, bool gamma) {
+    Job job;
+    job.filename = image.path;
+    job.gamma = gamma;
+    job.image = std::move(image);
+    jobs.push_back(std::move(job));
+}
+
+std::vector<TextureUploadQueue::Upload> TextureUploadQueue::Process(size_t byteBudget) {
+    std::vector<Upload> uploads;
+    size_t bytes = 0;
+
+    while (!jobs.empty() && (uploads.empty() || bytes < byteBudget)) {
+        Job& job = jobs.front();
+        if (job.decoding.valid()) {
+            if (job.decoding.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                break;
+            }
+            job.image = job.decoding.get();
+        }
+
+        if (!pixelBuffer) {
+            pixelBuffer = GLBuffer::Create();
+        }
+        Upload upload;
+        upload.filename = std::move(job.filename);
+        upload.texture = TextureCache::Acquire(job.image, job.gamma, pixelBuffer.Get());
+        bytes += job.image.GetByteSize();
+        uploads.push_back(std::move(upload));
+        jobs.pop_front();
+    }
+
+    return uploads;
+}
+
+void TextureUploadQueue::Clear() {
+    // Running decodes keep the old flag and finish into futures nobody reads
+    cancelled->store(true, std::memory_order_relaxed);
+    cancelled = std::make_shared<std::atomic<bool>>(false);
+    jobs.clear();
+}
\ No newline at end of file
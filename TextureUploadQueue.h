@@ -0,0 +1,51 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <future>
+#include <memory>
+#include <atomic>
+#include "TextureCache.h"
+
+// Texture pipeline: image files are decoded on the shared thread pool, and the GL thread uploads the
+// results through a pixel buffer object a limited number of bytes per Process call, so a folder of
+// large maps loads on every core without stalling a frame.
+class TextureUploadQueue {
+public:
+    struct Upload {
+        std::string filename;
+        TextureCache::Handle texture;   // null if the image could not be decoded or uploaded
+    };
+
+    TextureUploadQueue();
+    ~TextureUploadQueue();
+
+    TextureUploadQueue(const TextureUploadQueue&) = delete;
+    TextureUploadQueue& operator=(const TextureUploadQueue&) = delete;
+
+    // Starts loading the file for its role on a worker, unless the texture cache already holds it
+    void Enqueue(const std::string& filename, TextureRole role = TextureRole::Color, bool gamma = false);
+    // Queues an image that was loaded elsewhere
+    void Enqueue(ImageData image, bool gamma = false);
+
+    // GL thread: uploads queued images in order until byteBudget is spent (at least one per call) and
+    // returns them; stops early at an image that is still being decoded
+    std::vector<Upload> Process(size_t byteBudget);
+
+    bool IsEmpty() const { return jobs.empty(); }
+    size_t GetPendingCount() const { return jobs.size(); }
+    // Drops every queued image, decodes not started yet are skipped
+    void Clear();
+
+private:
+    struct Job {
+        std::string filename;
+        bool gamma = false;
+        std::future<ImageData> decoding;    // invalid once image holds the result
+        ImageData image;
+    };
+
+    std::deque<Job> jobs;
+    GLBuffer pixelBuffer;
+    std::shared_ptr<std::atomic<bool>> cancelled;
+};
\ No newline at end of file
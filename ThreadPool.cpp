@@ -0,0 +1,134 @@
+#include "ThreadPool.h"
+#include <atomic>
+#include <algorithm>
+#include <exception>
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    threadCount = ResolveThreadCount(threadCount);
+
+    workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; i++) {
+        workers.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCondition.notify_all();
+
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+ThreadPool& ThreadPool::Shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+size_t ThreadPool::ResolveThreadCount(size_t requested) {
+    if (requested > 0) {
+        return requested;
+    }
+    size_t hardwareThreads = std::thread::hardware_concurrency();
+    return hardwareThreads > 0 ? hardwareThreads : 4;
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        tasks.push_back(std::move(task));
+    }
+    queueCondition.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& body, size_t maxConcurrency) {
+    if (count == 0) {
+        return;
+    }
+
+    size_t concurrency = maxConcurrency > 0 ? maxConcurrency : workers.size() + 1;
+    concurrency = std::min(concurrency, count);
+
+    if (concurrency <= 1) {
+        for (size_t i = 0; i < count; i++) {
+            body(i);
+        }
+        return;
+    }
+
+    // Shared with the helper tasks, which may still be queued after the loop has finished
+    struct State {
+        std::function<void(size_t)> body;
+        size_t count = 0;
+        std::atomic<size_t> next{ 0 };
+        std::atomic<size_t> active{ 0 };
+        std::mutex doneMutex;
+        std::condition_variable doneCondition;
+        std::exception_ptr error;
+    };
+
+    auto state = std::make_shared<State>();
+    state->body = body;
+    state->count = count;
+
+    auto run = [](State& s) {
+        size_t index;
+        while ((index = s.next.fetch_add(1)) < s.count) {
+            try {
+                s.body(index);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(s.doneMutex);
+                if (!s.error) {
+                    s.error = std::current_exception();
+                }
+                s.next = s.count;
+            }
+        }
+    };
+
+    for (size_t i = 0; i + 1 < concurrency; i++) {
+        enqueue([state, run]() {
+            state->active++;
+            run(*state);
+            if (--state->active == 0) {
+                std::lock_guard<std::mutex> lock(state->doneMutex);
+                state->doneCondition.notify_all();
+            }
+        });
+    }
+
+    run(*state);
+
+    // Only helpers that actually picked up work are waited for; late starters find nothing left and exit
+    {
+        std::unique_lock<std::mutex> lock(state->doneMutex);
+        state->doneCondition.wait(lock, [&]() { return state->active == 0; });
+    }
+
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
\ No newline at end of file
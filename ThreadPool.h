@@ -0,0 +1,52 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+class ThreadPool {
+public:
+    // threadCount 0 = one worker per hardware thread
+    explicit ThreadPool(size_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    template<typename F>
+    auto Submit(F&& task) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        using Result = std::invoke_result_t<std::decay_t<F>>;
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> future = packaged->get_future();
+        enqueue([packaged]() { (*packaged)(); });
+        return future;
+    }
+
+    // Runs body(0..count-1) across the pool and blocks until every index is done.
+    // The calling thread takes part in the work, so nesting from inside a pool task cannot deadlock.
+    // maxConcurrency 0 = use every worker.
+    void ParallelFor(size_t count, const std::function<void(size_t)>& body, size_t maxConcurrency = 0);
+
+    size_t GetThreadCount() const { return workers.size(); }
+
+    // Process-wide pool shared by the loaders
+    static ThreadPool& Shared();
+
+    // Resolves a user-facing thread count setting (0 = all hardware threads)
+    static size_t ResolveThreadCount(size_t requested);
+
+private:
+    void enqueue(std::function<void()> task);
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    bool stopping = false;
+};
\ No newline at end of file
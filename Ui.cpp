@@ -4,12 +4,23 @@
 #include "imgui_impl_opengl3.h"
 #include "ImGuiFileDialog.h"
 #include "lighting.h"
+#include "NumberParser.h"
+#include "GeometryCache.h"
+#include "GLHandle.h"
+#include "TextureCache.h"
+#include "TextureCompression.h"
+#include "TextureStreamer.h"
+#include "TextureArrays.h"
+#include "MipBuilder.h"
+#include "Objloader.h"
 #include <ctime>
 #include <iostream>
 #include <sstream>
 #include <iomanip>
 #include <deque>
 #include <chrono>
+#include <mutex>
+#include <thread>
 #include <algorithm>  
 #include <vector>     
 #include <cfloat>    
@@ -39,9 +50,24 @@ namespace UI {
     bool textureFolderSelected = false;
     bool reloadModelWithMtl = false;
     bool flipUVCoordinates = false;
+    bool streamObjLoading = false;
+    int objParseMode = 2;
+    int objThreadCount = 0;
+    bool gpuOnlyGeometry = false;
+    bool cancelModelLoading = false;
+    bool pointCloudMode = false;
+    float pointBudgetMillions = 5.0f;
+    float pointSizeScale = 1.0f;
+    bool chunkedStreamingMode = false;
+    float chunkedGpuBudgetMB = 1024.0f;
+    float chunkedCpuBudgetMB = 2048.0f;
+    float chunkedMaxScreenError = 2.0f;
+    bool textureStreaming = true;
+    float textureBudgetMB = 2048.0f;
 
     // Debug console data
     static std::deque<std::string> debugMessages;
+    static std::mutex debugMutex;     // messages also arrive from loader threads
     static bool autoScrollDebug = true;
     static const size_t MAX_DEBUG_MESSAGES = 1000;
 
@@ -77,12 +103,29 @@ namespace UI {
     static int cpuCores = 0;
     static float cpuUsage = 0.0f;
 
+    // Loader benchmark results
+    static NumberParser::BenchmarkResult numberParserBenchmark;
+    static bool numberParserBenchmarkRan = false;
+
     // Rendering stats
     static int drawCalls = 0;
     static int vertices = 0;
     static int triangles = 0;
     static int textures = 0;
 
+    // Point cloud streaming stats
+    static size_t pointCloudVisiblePoints = 0;
+    static size_t pointCloudResidentPoints = 0;
+    static size_t pointCloudResidentNodes = 0;
+    static size_t pointCloudTotalNodes = 0;
+
+    // Chunked model streaming stats
+    static size_t chunkedDrawnNodes = 0;
+    static size_t chunkedDrawnTriangles = 0;
+    static size_t chunkedGpuBytes = 0;
+    static size_t chunkedCpuBytes = 0;
+    static size_t chunkedTotalNodes = 0;
+
     void Init(GLFWwindow* window) {
         IMGUI_CHECKVERSION();
         ImGui::CreateContext();
@@ -199,6 +242,21 @@ namespace UI {
         }
     }
 
+    void UpdatePointCloudStats(size_t visiblePoints, size_t residentPoints, size_t residentNodes, size_t totalNodes) {
+        pointCloudVisiblePoints = visiblePoints;
+        pointCloudResidentPoints = residentPoints;
+        pointCloudResidentNodes = residentNodes;
+        pointCloudTotalNodes = totalNodes;
+    }
+
+    void UpdateChunkedModelStats(size_t drawnNodes, size_t drawnTriangles, size_t gpuBytes, size_t cpuBytes, size_t totalNodes) {
+        chunkedDrawnNodes = drawnNodes;
+        chunkedDrawnTriangles = drawnTriangles;
+        chunkedGpuBytes = gpuBytes;
+        chunkedCpuBytes = cpuBytes;
+        chunkedTotalNodes = totalNodes;
+    }
+
     void AddDebugMessage(const std::string& message) {
         auto now = std::chrono::system_clock::now();
         auto time_t = std::chrono::system_clock::to_time_t(now);
@@ -207,7 +265,7 @@ namespace UI {
 #ifdef _WIN32
         localtime_s(&timeinfo, &time_t);
 #else
-        timeinfo = *std::localtime(&time_t);
+        localtime_r(&time_t, &timeinfo);
 #endif
 
         std::ostringstream oss;
@@ -215,6 +273,7 @@ namespace UI {
             << ":" << std::setw(2) << timeinfo.tm_min
             << ":" << std::setw(2) << timeinfo.tm_sec << "] " << message;
 
+        std::lock_guard<std::mutex> lock(debugMutex);
         debugMessages.push_back(oss.str());
 
         if (debugMessages.size() > MAX_DEBUG_MESSAGES) {
@@ -223,6 +282,7 @@ namespace UI {
     }
 
     void ClearDebugConsole() {
+        std::lock_guard<std::mutex> lock(debugMutex);
         debugMessages.clear();
     }
 
@@ -314,6 +374,76 @@ namespace UI {
             ImGuiFileDialog::Instance()->OpenDialog("ChooseFileDlgKey", "Choose Model File", ".OBJ,.obj,.fbx,.gltf,.glb,.3ds,.dae,.x3d,.ply,.stl");
 
         }
+
+        ImGui::Checkbox("Stream OBJ (live preview while loading)", &streamObjLoading);
+        if (!streamObjLoading) {
+            ImGui::Combo("OBJ parser", &objParseMode, "Buffered\0Memory-mapped\0Parallel\0");
+            if (objParseMode == static_cast<int>(ObjParseMode::Parallel)) {
+                int maxThreads = static_cast<int>((std::max)(std::thread::hardware_concurrency(), 1u));
+                ImGui::SliderInt("Parser threads (0 = all)", &objThreadCount, 0, maxThreads);
+            }
+        }
+        ImGui::Checkbox("Open PLY as point cloud (out-of-core)", &pointCloudMode);
+        if (pointCloudMode) {
+            ImGui::SliderFloat("Point budget (M)", &pointBudgetMillions, 0.5f, 30.0f, "%.1f");
+            ImGui::SliderFloat("Point size", &pointSizeScale, 0.25f, 4.0f, "%.2f");
+        }
+        ImGui::Checkbox("Chunked streaming (large meshes)", &chunkedStreamingMode);
+        if (chunkedStreamingMode) {
+            ImGui::SliderFloat("GPU budget (MB)", &chunkedGpuBudgetMB, 64.0f, 8192.0f, "%.0f");
+            ImGui::SliderFloat("CPU cache (MB)", &chunkedCpuBudgetMB, 64.0f, 16384.0f, "%.0f");
+            ImGui::SliderFloat("Max screen error (px)", &chunkedMaxScreenError, 0.5f, 16.0f, "%.1f");
+        }
+
+        ImGui::Checkbox("GPU-only geometry (free RAM copy after upload)", &gpuOnlyGeometry);
+
+        bool useGeometryCache = GeometryCache::IsEnabled();
+        if (ImGui::Checkbox("Cache processed geometry", &useGeometryCache)) {
+            GeometryCache::SetEnabled(useGeometryCache);
+        }
+
+        bool compressTextures = TextureCompression::IsEnabled();
+        if (ImGui::Checkbox("Compress textures (BC, cached on disk)", &compressTextures)) {
+            TextureCompression::SetEnabled(compressTextures);
+        }
+        if (compressTextures) {
+            bool useBC7 = TextureCompression::IsUsingBC7();
+            if (ImGui::Checkbox("BC7 for colour textures", &useBC7)) {
+                TextureCompression::SetUseBC7(useBC7);
+            }
+        }
+
+        bool cpuMipmaps = MipBuilder::IsEnabled();
+        if (ImGui::Checkbox("Build mipmaps on the CPU (cached)", &cpuMipmaps)) {
+            MipBuilder::SetEnabled(cpuMipmaps);
+        }
+        int mipFilter = static_cast<int>(MipBuilder::GetFilter());
+        if (ImGui::Combo("Mip filter", &mipFilter, "Box\0Kaiser\0")) {
+            MipBuilder::SetFilter(static_cast<MipBuilder::Filter>(mipFilter));
+        }
+        // Powers of two from 512 to 16384, per texture role
+        const char* maxSizeNames = "512\0" "1024\0" "2048\0" "4096\0" "8192\0" "16384\0";
+        const std::pair<const char*, TextureRole> maxSizeRoles[] = {
+            { "Max colour size", TextureRole::Color }, { "Max normal size", TextureRole::Normal }, { "Max mask size", TextureRole::Mask }
+        };
+        for (const auto& [label, role] : maxSizeRoles) {
+            int sizeIndex = 0;
+            while (sizeIndex < 5 && (512 << sizeIndex) < MipBuilder::GetMaxSize(role)) {
+                sizeIndex++;
+            }
+            if (ImGui::Combo(label, &sizeIndex, maxSizeNames)) {
+                MipBuilder::SetMaxSize(role, 512 << sizeIndex);
+            }
+        }
+        ImGui::Checkbox("Stream texture mips (VRAM budget)", &textureStreaming);
+        if (textureStreaming) {
+            ImGui::SliderFloat("Texture budget (MB)", &textureBudgetMB, 256.0f, 8192.0f, "%.0f");
+        }
+
+        bool packTextures = TextureArrays::IsEnabled();
+        if (ImGui::Checkbox("Pack textures into arrays", &packTextures)) {
+            TextureArrays::SetEnabled(packTextures);
+        }
            
 
         if (ImGuiFileDialog::Instance()->Display("ChooseFileDlgKey")) {
@@ -374,6 +504,10 @@ namespace UI {
 
             ImGui::SameLine();
             ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), " %c", loadingChars[loadingFrame]);
+
+            if (ImGui::Button("Cancel Loading", ImVec2(-1, 20))) {
+                cancelModelLoading = true;
+            }
         }
 
         ImGui::Separator();
@@ -591,6 +725,21 @@ namespace UI {
                 ImGui::SameLine(0.0f, ImGui::GetStyle().ItemInnerSpacing.x);
                 ImGui::Text("Memory Usage");
 
+                // Live GL objects, a count that does not drop back after unloading a model is a leak
+                ImGui::Text("GL Buffers: %zu  VAOs: %zu  Textures: %zu",
+                    GLBuffer::LiveCount(), GLVertexArray::LiveCount(), GLTexture::LiveCount());
+
+                TextureCache::Stats textureStats = TextureCache::GetStats();
+                ImGui::Text("Texture Cache: %zu textures, %zu uploads", textureStats.textures, textureStats.uploads);
+                ImGui::Text("Duplicates avoided: %zu decodes, %zu uploads", textureStats.decodesAvoided, textureStats.uploadsAvoided);
+                TextureStreamer::Stats streamStats = TextureStreamer::GetStats();
+                ImGui::Text("Texture VRAM: %.1f MB, %zu block-compressed", (textureStats.gpuBytes + streamStats.residentBytes) / (1024.0 * 1024.0), textureStats.compressed);
+                if (streamStats.textures > 0) {
+                    ImGui::Text("Streamed: %zu textures, %.1f of %.1f MB resident", streamStats.textures,
+                        streamStats.residentBytes / (1024.0 * 1024.0), streamStats.fullBytes / (1024.0 * 1024.0));
+                    ImGui::Text("Loading: %zu  Levels evicted: %zu", streamStats.loading, streamStats.evictedLevels);
+                }
+
                 ImGui::Spacing();
 
                 // System Information
@@ -604,6 +753,61 @@ namespace UI {
 
                 ImGui::Spacing();
 
+                // Loader Benchmarks
+                ImGui::TextColored(ImVec4(0.8f, 0.6f, 1.0f, 1.0f), "Loader Benchmarks");
+                ImGui::Separator();
+
+                if (ImGui::Button("Benchmark Number Parsing", ImVec2(-1, 25))) {
+                    numberParserBenchmark = NumberParser::RunBenchmark();
+                    numberParserBenchmarkRan = true;
+                }
+                if (numberParserBenchmarkRan) {
+                    ImGui::Text("Kernel (%s): %.1f M numbers/s", NumberParser::GetInstructionSet(), numberParserBenchmark.kernelPerSecond / 1e6);
+                    ImGui::Text("from_chars: %.1f M numbers/s", numberParserBenchmark.fromCharsPerSecond / 1e6);
+                    ImGui::Text("sscanf_s: %.1f M numbers/s", numberParserBenchmark.sscanfPerSecond / 1e6);
+                    if (numberParserBenchmark.matchesFromChars && numberParserBenchmark.roundTripExact) {
+                        ImGui::TextColored(ImVec4(0, 1, 0, 1), "Results exact");
+                    }
+                    else {
+                        ImGui::TextColored(ImVec4(1, 0, 0, 1), "Results differ from from_chars");
+                    }
+                }
+
+                if (ImGui::Button("Clear Geometry Cache", ImVec2(-1, 25))) {
+                    size_t removed = GeometryCache::Clear();
+                    AddDebugMessage("Geometry cache cleared (" + std::to_string(removed) + " entries)");
+                }
+
+                if (ImGui::Button("Clear Texture Cache", ImVec2(-1, 25))) {
+                    size_t removed = TextureCompression::Clear();
+                    AddDebugMessage("Texture cache cleared (" + std::to_string(removed) + " entries)");
+                }
+
+                ImGui::Spacing();
+
+                if (pointCloudTotalNodes > 0) {
+                    ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.8f, 1.0f), "Point Cloud Streaming");
+                    ImGui::Separator();
+
+                    ImGui::Text("Visible Points: %.2f M", pointCloudVisiblePoints / 1e6);
+                    ImGui::Text("Resident Points: %.2f M (%.1f MB)", pointCloudResidentPoints / 1e6, pointCloudResidentPoints * 16.0 / (1024.0 * 1024.0));
+                    ImGui::Text("Resident Nodes: %zu / %zu", pointCloudResidentNodes, pointCloudTotalNodes);
+
+                    ImGui::Spacing();
+                }
+
+                if (chunkedTotalNodes > 0) {
+                    ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.8f, 1.0f), "Chunked Mesh Streaming");
+                    ImGui::Separator();
+
+                    ImGui::Text("Drawn Triangles: %.2f M", chunkedDrawnTriangles / 1e6);
+                    ImGui::Text("Drawn Nodes: %zu / %zu", chunkedDrawnNodes, chunkedTotalNodes);
+                    ImGui::Text("GPU Memory: %.1f MB", chunkedGpuBytes / (1024.0 * 1024.0));
+                    ImGui::Text("CPU Cache: %.1f MB", chunkedCpuBytes / (1024.0 * 1024.0));
+
+                    ImGui::Spacing();
+                }
+
                 // Rendering Stats (if model is loaded)
                 if (currentModel) {
                     ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.8f, 1.0f), "Rendering Statistics");
@@ -739,6 +943,7 @@ namespace UI {
 
                 ImGui::BeginChild("DebugScrolling", ImVec2(0, 0), false, ImGuiWindowFlags_HorizontalScrollbar);
 
+                std::lock_guard<std::mutex> lock(debugMutex);
                 for (const auto& message : debugMessages) {
                     ImVec4 color = ImVec4(1.0f, 1.0f, 1.0f, 1.0f);
 
@@ -0,0 +1,56 @@
+#include "VertexCache.h"
+
+namespace {
+    size_t roundUpPowerOfTwo(size_t value) {
+        size_t result = 16;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+}
+
+void VertexCache::Reserve(size_t expectedEntries) {
+    // Keep the load factor under 3/4
+    size_t wanted = roundUpPowerOfTwo(expectedEntries + expectedEntries / 3 + 1);
+    if (wanted > slots.size()) {
+        rehash(wanted);
+    }
+}
+
+void VertexCache::Clear() {
+    for (auto& slot : slots) {
+        slot.value = Empty;
+    }
+    count = 0;
+}
+
+void VertexCache::Release() {
+    std::vector<Slot>().swap(slots);
+    count = 0;
+    mask = 0;
+}
+
+void VertexCache::grow() {
+    rehash(slots.empty() ? 16 : slots.size() * 2);
+}
+
+void VertexCache::rehash(size_t newCapacity) {
+    std::vector<Slot> old;
+    old.swap(slots);
+
+    slots.assign(newCapacity, Slot{ 0, 0, 0, Empty });
+    mask = newCapacity - 1;
+    count = 0;
+
+    for (const auto& entry : old) {
+        if (entry.value != Empty) {
+            size_t slot = hash(entry.position, entry.texCoord, entry.normal) & mask;
+            while (slots[slot].value != Empty) {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = entry;
+            count++;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Open-addressing (linear probing) map from an OBJ (position, texcoord, normal) index triple
+// to a vertex index. Slots are 16 bytes and live in one flat array, so a lookup is a hash and
+// usually a single cache line, with no per-entry allocation.
+class VertexCache {
+public:
+    static constexpr uint32_t Empty = 0xFFFFFFFFu;
+
+    VertexCache() = default;
+    explicit VertexCache(size_t expectedEntries) { Reserve(expectedEntries); }
+
+    // Returns the index already stored for the triple, or stores 'candidate' and returns it.
+    // 'candidate' must not be Empty.
+    uint32_t FindOrInsert(int32_t position, int32_t texCoord, int32_t normal, uint32_t candidate) {
+        if ((count + 1) * 4 > slots.size() * 3) {
+            grow();
+        }
+
+        size_t slot = hash(position, texCoord, normal) & mask;
+        while (true) {
+            Slot& entry = slots[slot];
+            if (entry.value == Empty) {
+                entry.position = position;
+                entry.texCoord = texCoord;
+                entry.normal = normal;
+                entry.value = candidate;
+                count++;
+                return candidate;
+            }
+            if (entry.position == position && entry.texCoord == texCoord && entry.normal == normal) {
+                return entry.value;
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+
+    void Reserve(size_t expectedEntries);
+    void Clear();
+    void Release();
+
+    size_t Size() const { return count; }
+    size_t MemoryUsage() const { return slots.capacity() * sizeof(Slot); }
+
+private:
+    struct Slot {
+        int32_t position;
+        int32_t texCoord;
+        int32_t normal;
+        uint32_t value;
+    };
+
+    static size_t hash(int32_t position, int32_t texCoord, int32_t normal) {
+        uint64_t h = static_cast<uint32_t>(position) * 0x9E3779B97F4A7C15ull;
+        h ^= static_cast<uint32_t>(texCoord) * 0xC2B2AE3D27D4EB4Full;
+        h ^= static_cast<uint32_t>(normal) * 0x165667B19E3779F9ull;
+        return static_cast<size_t>(h ^ (h >> 32));
+    }
+
+    void grow();
+    void rehash(size_t newCapacity);
+
+    std::vector<Slot> slots;
+    size_t count = 0;
+    size_t mask = 0;
+};
\ No newline at end of file
@@ -7,14 +7,21 @@
 #include <sstream>
 #include <thread>
 #include <chrono>
+#include <mutex>
+#include <algorithm>
 #include "render.h"
 #include "window.h"
 #include "ui.h"
 #include "model.h"
+#include "AsyncModelLoader.h"
+#include "PointCloud.h"
+#include "ChunkedModel.h"
 #include "Camera.h"
 #include "Transform.h"
 #include "Grid.h"
 #include "Screenshot.h"
+#include "TextureCompression.h"
+#include "TextureStreamer.h"
 
 #ifdef _WIN32
 #pragma comment(linker, "/SUBSYSTEM:windows /ENTRY:mainCRTStartup")
@@ -22,8 +29,15 @@
 
 // Global objects
 Model* currentModel = nullptr;
+AsyncModelLoader modelLoader;
+PointCloud* currentPointCloud = nullptr;   // PLY opened in point cloud mode, shown instead of currentModel
+bool pointCloudReported = false;            // outcome of the octree build has been shown
+ChunkedModel* currentChunkedModel = nullptr;    // model opened in chunked streaming mode, shown instead of currentModel
+bool chunkedModelReported = false;          // outcome of the chunked file build has been shown
+bool resetTransformOnLoad = true;   // a new file resets the transform, an MTL reload keeps it
 unsigned int shaderProgram;
 unsigned int gridShaderProgram;
+unsigned int pointShaderProgram;
 Camera camera(glm::vec3(0.0f, 2.0f, 5.0f));
 Transform modelTransform;
 Grid* grid;
@@ -36,11 +50,13 @@ float lastFrame = 0.0f;
 int SCR_WIDTH = 1920;
 int SCR_HEIGHT = 1080;
 
-// Custom cout buffer to capture debug messages
+// Custom cout buffer to capture debug messages. Loader threads print too, so every thread
+// collects its own line and whole lines are handed on under a lock.
 class DebugBuffer : public std::streambuf {
 private:
     std::streambuf* original_cout;
-    std::ostringstream buffer;
+    std::mutex outputMutex;
+    static thread_local std::string line;
 
 public:
     DebugBuffer() : original_cout(std::cout.rdbuf()) {
@@ -54,30 +70,38 @@ public:
 protected:
     virtual int overflow(int c) override {
         if (c != EOF) {
-            buffer << static_cast<char>(c);
-            original_cout->sputc(c);
+            line += static_cast<char>(c);
 
             if (c == '\n') {
-                std::string message = buffer.str();
-                if (!message.empty() && message != "\n") {
-                    // Remove the trailing newline
-                    if (message.back() == '\n') {
-                        message.pop_back();
-                    }
+                std::string message;
+                message.swap(line);
+
+                std::lock_guard<std::mutex> lock(outputMutex);
+                original_cout->sputn(message.data(), message.size());
+
+                // Remove the trailing newline
+                message.pop_back();
+                if (!message.empty()) {
                     UI::AddDebugMessage(message);
                 }
-                buffer.str("");
-                buffer.clear();
             }
         }
         return c;
     }
 };
 
+thread_local std::string DebugBuffer::line;
+
 static DebugBuffer debugBuffer;
 
 void handleModelOperations();
 void loadNewModel();
+void startModelLoad(const std::string& path, const std::string& mtlPath);
+void updateModelLoading();
+void updatePointCloudLoading();
+void updateChunkedModelLoading();
+void cancelModelLoad();
+void applyLoadedModelScale();
 std::string detectMtlFile();
 void reloadModelWithMtl();
 void loadTexturesFromFolder();
@@ -85,6 +109,8 @@ void flipModelUVCoordinates();
 void takeScreenshotNow();
 void renderGrid();
 void renderScene();
+void renderPointCloud();
+void renderChunkedModel();
 void cleanup();
 std::string loadShaderFromFile(const std::string& path);
 unsigned int compileShader(const std::string& source, unsigned int type);
@@ -204,6 +230,11 @@ unsigned int createShaderProgram(const std::string& vertexPath, const std::strin
 
 // Model operation handlers
 void handleModelOperations() {
+    if (UI::cancelModelLoading) {
+        cancelModelLoad();
+        UI::cancelModelLoading = false;
+    }
+
     if (UI::modelSelected) {
         loadNewModel();
         UI::modelSelected = false;
@@ -231,29 +262,213 @@ void loadNewModel() {
         currentModel = nullptr;
     }
 
-    try {
-        std::cout << "Loading model: " << UI::selectedModelPath << std::endl;
-        UI::UpdateModelLoadingProgress(0.0f, "Initializing...");
+    delete currentPointCloud;
+    currentPointCloud = nullptr;
+    UI::UpdatePointCloudStats(0, 0, 0, 0);
+
+    delete currentChunkedModel;
+    currentChunkedModel = nullptr;
+    UI::UpdateChunkedModelStats(0, 0, 0, 0, 0);
+
+    std::cout << "Loading model: " << UI::selectedModelPath << std::endl;
+    UI::UpdateModelLoadingProgress(0.0f, "Initializing...");
+
+    // Auto-detect MTL file
+    std::string mtlPath = detectMtlFile();
+
+    resetTransformOnLoad = true;
+    modelTransform.position = glm::vec3(0.0f);
+    modelTransform.rotation = glm::vec3(0.0f);
+    startModelLoad(UI::selectedModelPath, mtlPath);
+}
+
+// Streaming OBJ loads are parsed here on the main thread a slice per frame; everything else is
+// imported on a loader thread and uploaded by updateModelLoading once it is done
+void startModelLoad(const std::string& path, const std::string& mtlPath) {
+    modelLoader.Cancel();
+
+    std::string ext = path.substr(path.find_last_of('.') + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+
+    if (UI::pointCloudMode && ext == "ply") {
+        currentPointCloud = new PointCloud(path);
+        pointCloudReported = false;
+        UI::UpdateModelLoadingProgress(0.01f, "Building point cloud octree...");
+        return;
+    }
+
+    if (UI::chunkedStreamingMode) {
+        currentChunkedModel = new ChunkedModel(path, mtlPath);
+        chunkedModelReported = false;
+        UI::UpdateModelLoadingProgress(0.01f, "Building chunked mesh...");
+        return;
+    }
+
+    if (UI::streamObjLoading && ext == "obj") {
+        try {
+            currentModel = new Model(path, mtlPath, true);
+            applyLoadedModelScale();
+            UI::UpdateModelLoadingProgress(0.01f, "Streaming geometry...");
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Failed to load model: " << e.what() << std::endl;
+            UI::UpdateModelLoadingProgress(1.0f, "Failed!");
+            UI::AddDebugMessage("Model loading failed: " + std::string(e.what()));
+        }
+        return;
+    }
+
+    ObjParseOptions objOptions;
+    objOptions.mode = static_cast<ObjParseMode>(UI::objParseMode);
+    objOptions.threadCount = static_cast<unsigned int>(UI::objThreadCount);
+    modelLoader.Start(path, mtlPath, objOptions);
+    UI::UpdateModelLoadingProgress(0.01f, "Loading model data...");
+}
+
+// Collects a finished background import, then uploads the loading model a slice per frame
+// so the UI keeps its frame rate; the partial model is drawn meanwhile
+void updateModelLoading() {
+    const double frameBudgetMs = 8.0;
+    const size_t textureBytesPerFrame = 32 * 1024 * 1024;
+
+    if (currentPointCloud) {
+        updatePointCloudLoading();
+        return;
+    }
+    if (currentChunkedModel) {
+        updateChunkedModelLoading();
+        return;
+    }
+
+    if (modelLoader.IsBusy()) {
+        try {
+            Model* loaded = modelLoader.Poll();
+            if (!loaded) {
+                UI::UpdateModelLoadingProgress((std::max)(modelLoader.GetProgress(), 0.01f), "Loading model data...");
+                return;
+            }
+
+            delete currentModel;
+            currentModel = loaded;
+            applyLoadedModelScale();
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Failed to load model: " << e.what() << std::endl;
+            UI::UpdateModelLoadingProgress(1.0f, "Failed!");
+            UI::AddDebugMessage("Model loading failed: " + std::string(e.what()));
+            return;
+        }
+    }
+
+    if (!currentModel) {
+        return;
+    }
+    currentModel->SetGeometryResidency(UI::gpuOnlyGeometry ? GeometryResidency::GpuOnly : GeometryResidency::KeepCpuCopy);
+    if (currentModel->IsLoadingTextures()) {
+        currentModel->ContinueTextureLoading(textureBytesPerFrame);
+    }
+    if (!currentModel->IsLoading()) {
+        return;
+    }
 
-        // Auto-detect MTL file
-        std::string mtlPath = detectMtlFile();
+    currentModel->ContinueLoading(frameBudgetMs);
 
-        UI::UpdateModelLoadingProgress(0.2f, "Loading model data...");
-        currentModel = new Model(UI::selectedModelPath, mtlPath);
+    if (currentModel->IsLoading()) {
+        // Keep the auto-size in step with the bounds seen so far
+        applyLoadedModelScale();
+        UI::UpdateModelLoadingProgress(currentModel->GetLoadingProgress(),
+            currentModel->IsStreaming() ? "Streaming geometry..." : "Uploading to GPU...");
+        return;
+    }
 
-        // Auto-size model
-        modelTransform.position = glm::vec3(0.0f);
-        modelTransform.rotation = glm::vec3(0.0f);
+    if (resetTransformOnLoad) {
+        applyLoadedModelScale();
+    }
+    else if (modelTransform.scale.x == 1.0f && modelTransform.scale.y == 1.0f && modelTransform.scale.z == 1.0f) {
         modelTransform.scale = glm::vec3(currentModel->GetRecommendedScale());
+    }
+
+    UI::UpdateModelLoadingProgress(1.0f, "Complete!");
+    std::cout << "Model loaded successfully. Applied scale: " << currentModel->GetRecommendedScale() << std::endl;
+}
 
-        UI::UpdateModelLoadingProgress(1.0f, "Complete!");
-        std::cout << "Model loaded successfully. Applied scale: " << currentModel->GetRecommendedScale() << std::endl;
+// The octree build runs on the point cloud's own thread; node streaming afterwards is driven by renderPointCloud
+void updatePointCloudLoading() {
+    if (currentPointCloud->IsLoading()) {
+        UI::UpdateModelLoadingProgress((std::max)(currentPointCloud->GetLoadingProgress(), 0.01f), "Building point cloud octree...");
+        return;
     }
-    catch (const std::exception& e) {
-        std::cerr << "Failed to load model: " << e.what() << std::endl;
+
+    if (pointCloudReported) {
+        return;
+    }
+    pointCloudReported = true;
+
+    if (currentPointCloud->HasFailed()) {
         UI::UpdateModelLoadingProgress(1.0f, "Failed!");
-        UI::AddDebugMessage("Model loading failed: " + std::string(e.what()));
+        UI::AddDebugMessage("Point cloud loading failed: " + currentPointCloud->GetError());
+        return;
     }
+
+    modelTransform.scale = glm::vec3(currentPointCloud->GetRecommendedScale());
+    UI::UpdateModelLoadingProgress(1.0f, "Complete!");
+    std::cout << "Point cloud ready. Applied scale: " << currentPointCloud->GetRecommendedScale() << std::endl;
+}
+
+// Same for the chunked file build; node streaming afterwards is driven by renderChunkedModel
+void updateChunkedModelLoading() {
+    if (currentChunkedModel->IsLoading()) {
+        UI::UpdateModelLoadingProgress((std::max)(currentChunkedModel->GetLoadingProgress(), 0.01f), "Building chunked mesh...");
+        return;
+    }
+
+    if (chunkedModelReported) {
+        return;
+    }
+    chunkedModelReported = true;
+
+    if (currentChunkedModel->HasFailed()) {
+        UI::UpdateModelLoadingProgress(1.0f, "Failed!");
+        UI::AddDebugMessage("Chunked model loading failed: " + currentChunkedModel->GetError());
+        return;
+    }
+
+    if (resetTransformOnLoad) {
+        modelTransform.scale = glm::vec3(currentChunkedModel->GetRecommendedScale());
+    }
+    UI::UpdateModelLoadingProgress(1.0f, "Complete!");
+    std::cout << "Chunked model ready. Applied scale: " << currentChunkedModel->GetRecommendedScale() << std::endl;
+}
+
+void cancelModelLoad() {
+    modelLoader.Cancel();
+
+    if (currentPointCloud && currentPointCloud->IsLoading()) {
+        delete currentPointCloud;
+        currentPointCloud = nullptr;
+    }
+
+    if (currentChunkedModel && currentChunkedModel->IsLoading()) {
+        delete currentChunkedModel;
+        currentChunkedModel = nullptr;
+    }
+
+    if (currentModel && currentModel->IsLoading()) {
+        delete currentModel;
+        currentModel = nullptr;
+    }
+
+    UI::UpdateModelLoadingProgress(1.0f, "Cancelled");
+    UI::AddDebugMessage("Model loading cancelled");
+}
+
+// Auto-size a freshly selected model
+void applyLoadedModelScale() {
+    if (!resetTransformOnLoad) {
+        return;
+    }
+
+    modelTransform.scale = glm::vec3(currentModel->GetRecommendedScale());
 }
 
 std::string detectMtlFile() {
@@ -276,33 +491,21 @@ std::string detectMtlFile() {
 }
 
 void reloadModelWithMtl() {
-    try {
-        std::cout << "Reloading model with MTL file: " << UI::selectedMtlPath << std::endl;
-        UI::UpdateModelLoadingProgress(0.0f, "Reloading with MTL...");
+    std::cout << "Reloading model with MTL file: " << UI::selectedMtlPath << std::endl;
+    UI::UpdateModelLoadingProgress(0.0f, "Reloading with MTL...");
 
-        delete currentModel;
-        currentModel = new Model(UI::selectedModelPath, UI::selectedMtlPath);
+    delete currentModel;
+    currentModel = nullptr;
 
-        float recommendedScale = currentModel->GetRecommendedScale();
-        if (modelTransform.scale.x == 1.0f && modelTransform.scale.y == 1.0f && modelTransform.scale.z == 1.0f) {
-            modelTransform.scale = glm::vec3(recommendedScale);
-        }
-
-        UI::UpdateModelLoadingProgress(1.0f, "MTL Reload Complete!");
-        std::cout << "Model reloaded with MTL file successfully" << std::endl;
-    }
-    catch (const std::exception& e) {
-        std::cerr << "Failed to reload model with MTL: " << e.what() << std::endl;
-        UI::UpdateModelLoadingProgress(1.0f, "MTL Reload Failed!");
-        UI::AddDebugMessage("MTL reload failed: " + std::string(e.what()));
-    }
+    resetTransformOnLoad = false;
+    startModelLoad(UI::selectedModelPath, UI::selectedMtlPath);
 }
 
 void loadTexturesFromFolder() {
     std::cout << "Loading textures from folder: " << UI::selectedTextureFolder << std::endl;
     currentModel->LoadTexturesFromFolder(UI::selectedTextureFolder);
     UI::textureUpdated = true;
-    UI::AddDebugMessage("Textures loaded from folder: " + UI::selectedTextureFolder);
+    UI::AddDebugMessage("Loading textures from folder: " + UI::selectedTextureFolder);
 }
 
 void flipModelUVCoordinates() {
@@ -338,6 +541,14 @@ void renderGrid() {
 }
 
 void renderScene() {
+    if (currentPointCloud) {
+        renderPointCloud();
+        return;
+    }
+    if (currentChunkedModel) {
+        renderChunkedModel();
+        return;
+    }
     if (!currentModel) return;
 
     glUseProgram(shaderProgram);
@@ -360,18 +571,73 @@ void renderScene() {
     glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
     glUniform3fv(glGetUniformLocation(shaderProgram, "viewPos"), 1, glm::value_ptr(camera.Position));
 
+    currentModel->UpdateTextureStreaming(model, view, projection, SCR_HEIGHT);
+
     Render::UpdateShaderLighting(shaderProgram);
     currentModel->Draw(shaderProgram);
 }
 
+void renderPointCloud() {
+    glm::mat4 model = modelTransform.GetModelMatrix(currentPointCloud->GetModelCenter());
+    glm::mat4 view = camera.GetViewMatrix();
+    glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom),
+        (float)SCR_WIDTH / (float)SCR_HEIGHT,
+        0.1f, 100.0f);
+
+    currentPointCloud->SetPointBudget(static_cast<size_t>(UI::pointBudgetMillions * 1000000.0f));
+    currentPointCloud->Update(model, view, projection, SCR_HEIGHT);
+    UI::UpdatePointCloudStats(currentPointCloud->GetVisiblePointCount(), currentPointCloud->GetResidentPointCount(),
+        currentPointCloud->GetResidentNodeCount(), currentPointCloud->GetNodeCount());
+
+    glUseProgram(pointShaderProgram);
+    glUniformMatrix4fv(glGetUniformLocation(pointShaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(glGetUniformLocation(pointShaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    glUniformMatrix4fv(glGetUniformLocation(pointShaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+    glUniform1f(glGetUniformLocation(pointShaderProgram, "viewportHeight"), static_cast<float>(SCR_HEIGHT));
+    glUniform1f(glGetUniformLocation(pointShaderProgram, "pointScale"), UI::pointSizeScale);
+    currentPointCloud->Draw(pointShaderProgram);
+}
+
+void renderChunkedModel() {
+    glm::mat4 model = modelTransform.GetModelMatrix(currentChunkedModel->GetModelCenter());
+    glm::mat4 view = camera.GetViewMatrix();
+    glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom),
+        (float)SCR_WIDTH / (float)SCR_HEIGHT,
+        0.1f, 100.0f);
+
+    currentChunkedModel->SetGpuBudget(static_cast<size_t>(UI::chunkedGpuBudgetMB * 1024.0f * 1024.0f));
+    currentChunkedModel->SetCpuBudget(static_cast<size_t>(UI::chunkedCpuBudgetMB * 1024.0f * 1024.0f));
+    currentChunkedModel->SetMaxScreenError(UI::chunkedMaxScreenError);
+    currentChunkedModel->Update(model, view, projection, SCR_HEIGHT);
+    UI::UpdateChunkedModelStats(currentChunkedModel->GetDrawnNodeCount(), currentChunkedModel->GetDrawnTriangleCount(),
+        currentChunkedModel->GetGpuBytes(), currentChunkedModel->GetCpuBytes(), currentChunkedModel->GetNodeCount());
+
+    glUseProgram(shaderProgram);
+    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+    glUniform3fv(glGetUniformLocation(shaderProgram, "viewPos"), 1, glm::value_ptr(camera.Position));
+
+    Render::UpdateShaderLighting(shaderProgram);
+    currentChunkedModel->Draw(shaderProgram);
+}
+
 void cleanup() {
     std::cout << "Shutting down engine..." << std::endl;
 
+    modelLoader.Shutdown();
+
     if (currentModel) {
         delete currentModel;
         currentModel = nullptr;
     }
 
+    delete currentPointCloud;
+    currentPointCloud = nullptr;
+
+    delete currentChunkedModel;
+    currentChunkedModel = nullptr;
+
     if (grid) {
         delete grid;
         grid = nullptr;
@@ -387,6 +653,11 @@ void cleanup() {
         gridShaderProgram = 0;
     }
 
+    if (pointShaderProgram != 0) {
+        glDeleteProgram(pointShaderProgram);
+        pointShaderProgram = 0;
+    }
+
     UI::Shutdown();
     Window::Shutdown();
 
@@ -406,15 +677,18 @@ int main() {
     Window::GetWindowSize(SCR_WIDTH, SCR_HEIGHT);
 
     UI::Init(window);
+    TextureCompression::DetectSupport();
 
     glEnable(GL_DEPTH_TEST);
+    glEnable(GL_PROGRAM_POINT_SIZE);
 
     std::cout << "Creating shader programs..." << std::endl;
 
     shaderProgram = createShaderProgram("shaders/vertex_shader.glsl", "shaders/fragment_shader.glsl");
     gridShaderProgram = createShaderProgram("shaders/grid_vertex.glsl", "shaders/grid_fragment.glsl");
+    pointShaderProgram = createShaderProgram("shaders/point_vertex.glsl", "shaders/point_fragment.glsl");
 
-    if (shaderProgram == 0 || gridShaderProgram == 0) {
+    if (shaderProgram == 0 || gridShaderProgram == 0 || pointShaderProgram == 0) {
         std::cerr << "Failed to create shader programs!" << std::endl;
         cleanup();
         return -1;
@@ -441,6 +715,8 @@ int main() {
 
         handleModelOperations();
 
+        updateModelLoading();
+
         if (UI::takeScreenshot) {
             takeScreenshotNow();
             UI::takeScreenshot = false;
@@ -450,6 +726,11 @@ int main() {
         renderGrid();
         renderScene();
 
+        // The scene has asked for the texture levels it needs, stream them for the next frames
+        TextureStreamer::SetEnabled(UI::textureStreaming);
+        TextureStreamer::SetBudget(static_cast<size_t>(UI::textureBudgetMB * 1024.0f * 1024.0f));
+        TextureStreamer::Update();
+
         UI::BeginFrame();
         UI::RenderUI(modelTransform, currentModel);
         UI::EndFrame();
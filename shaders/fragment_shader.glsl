@@ -11,6 +11,24 @@ struct Material {
     sampler2D texture_roughness1;
     sampler2D texture_metallic1;
     sampler2D texture_ao1;
+
+    // The same slots packed into texture arrays; a layer of -1 samples the 2D texture instead
+    sampler2DArray array_diffuse;
+    sampler2DArray array_specular;
+    sampler2DArray array_normal;
+    sampler2DArray array_height;
+    sampler2DArray array_emission;
+    sampler2DArray array_roughness;
+    sampler2DArray array_metallic;
+    sampler2DArray array_ao;
+    int layer_diffuse;
+    int layer_specular;
+    int layer_normal;
+    int layer_height;
+    int layer_emission;
+    int layer_roughness;
+    int layer_metallic;
+    int layer_ao;
     
     // Texture availability flags
     bool hasDiffuse;
@@ -90,16 +108,17 @@ vec3 CalcDirLight(DirectionalLight light, vec3 normal, vec3 viewDir, vec3 albedo
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo, vec3 specularColor, float roughness, float metallic, float ao);
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo, vec3 specularColor, float roughness, float metallic, float ao);
 vec3 getNormalFromMap();
+vec4 sampleSlot(sampler2D single, sampler2DArray array, int layer);
 
 void main()
 {    
     // Sample textures
-    vec3 albedo = material.hasDiffuse ? texture(material.texture_diffuse1, TexCoords).rgb : material.diffuse;
-    vec3 specularColor = material.hasSpecular ? texture(material.texture_specular1, TexCoords).rgb : material.specular;
-    vec3 emission = material.hasEmission ? texture(material.texture_emission1, TexCoords).rgb : material.emission;
-    float roughness = material.hasRoughness ? texture(material.texture_roughness1, TexCoords).r : material.roughness;
-    float metallic = material.hasMetallic ? texture(material.texture_metallic1, TexCoords).r : material.metallic;
-    float ao = material.hasAO ? texture(material.texture_ao1, TexCoords).r : 1.0;
+    vec3 albedo = material.hasDiffuse ? sampleSlot(material.texture_diffuse1, material.array_diffuse, material.layer_diffuse).rgb : material.diffuse;
+    vec3 specularColor = material.hasSpecular ? sampleSlot(material.texture_specular1, material.array_specular, material.layer_specular).rgb : material.specular;
+    vec3 emission = material.hasEmission ? sampleSlot(material.texture_emission1, material.array_emission, material.layer_emission).rgb : material.emission;
+    float roughness = material.hasRoughness ? sampleSlot(material.texture_roughness1, material.array_roughness, material.layer_roughness).r : material.roughness;
+    float metallic = material.hasMetallic ? sampleSlot(material.texture_metallic1, material.array_metallic, material.layer_metallic).r : material.metallic;
+    float ao = material.hasAO ? sampleSlot(material.texture_ao1, material.array_ao, material.layer_ao).r : 1.0;
     
     // Ensure we have reasonable values
     if (length(albedo) < 0.01) {
@@ -153,10 +172,17 @@ void main()
 
 vec3 getNormalFromMap()
 {
-    vec3 tangentNormal = texture(material.texture_normal1, TexCoords).xyz * 2.0 - 1.0;
+    // Z is rebuilt from X and Y, which is all a BC5 normal map keeps
+    vec2 xy = sampleSlot(material.texture_normal1, material.array_normal, material.layer_normal).rg * 2.0 - 1.0;
+    vec3 tangentNormal = vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
     return normalize(TBN * tangentNormal);
 }
 
+vec4 sampleSlot(sampler2D single, sampler2DArray array, int layer)
+{
+    return layer >= 0 ? texture(array, vec3(TexCoords, float(layer))) : texture(single, TexCoords);
+}
+
 // Calculates the color when using a directional light.
 vec3 CalcDirLight(DirectionalLight light, vec3 normal, vec3 viewDir, vec3 albedo, vec3 specularColor, float roughness, float metallic, float ao)
 {
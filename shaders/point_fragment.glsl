@@ -0,0 +1,14 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 PointColor;
+
+void main()
+{
+    // Round points
+    vec2 offset = gl_PointCoord * 2.0 - 1.0;
+    if (dot(offset, offset) > 1.0) {
+        discard;
+    }
+    FragColor = vec4(PointColor, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec4 aColor;
+
+out vec3 PointColor;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+uniform float viewportHeight;
+uniform float spacing;      // distance between the node's points, model units
+uniform float pointScale;
+uniform bool hasColor;
+uniform vec2 heightRange;   // model-space y range, colors clouds without colors
+
+void main()
+{
+    vec4 viewPos = view * model * vec4(aPos, 1.0);
+    gl_Position = projection * viewPos;
+
+    // Cover the gap to the neighbouring points: spacing in world units projected to pixels
+    float worldSpacing = spacing * length(model[0].xyz);
+    float pixels = worldSpacing * projection[1][1] * viewportHeight * 0.5 / max(-viewPos.z, 0.0001);
+    gl_PointSize = clamp(pixels * pointScale, 1.0, 64.0);
+
+    if (hasColor) {
+        PointColor = aColor.rgb;
+    }
+    else {
+        float height = clamp((aPos.y - heightRange.x) / max(heightRange.y - heightRange.x, 0.0001), 0.0, 1.0);
+        PointColor = mix(vec3(0.2, 0.4, 0.9), vec3(0.95, 0.85, 0.4), height);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,165 @@
+// Regression test: a Mesh built from FastObjLoader::TakeMeshData takes over the loader's vertex and
+// index buffers instead of copying them. operator new is replaced to count the allocations made while
+// the Mesh is constructed; GL calls go to no-op functions, so no context is needed.
+#include <glad/glad.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include "Objloader.h"
+
+// The engine compiles stb_image's implementation in Model.cpp, which this test does not link
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+namespace {
+    std::atomic<bool> counting{ false };
+    std::atomic<size_t> allocationCount{ 0 };
+    std::atomic<size_t> largestAllocation{ 0 };
+
+    void* allocate(size_t size) {
+        if (counting) {
+            allocationCount++;
+            size_t largest = largestAllocation;
+            while (size > largest && !largestAllocation.compare_exchange_weak(largest, size)) {
+            }
+        }
+        void* p = std::malloc(size ? size : 1);
+        if (!p) {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+
+    const int GRID_SIZE = 128;
+
+    GLuint nextName = 1;
+
+    void APIENTRY genNames(GLsizei n, GLuint* names) {
+        for (GLsizei i = 0; i < n; i++) {
+            names[i] = nextName++;
+        }
+    }
+    void APIENTRY deleteNames(GLsizei, const GLuint*) {}
+    void APIENTRY bindName(GLuint) {}
+    void APIENTRY bindTarget(GLenum, GLuint) {}
+    void APIENTRY bufferData(GLenum, GLsizeiptr, const void*, GLenum) {}
+    void APIENTRY enableAttribute(GLuint) {}
+    void APIENTRY attributePointer(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*) {}
+
+    void stubGl() {
+        glad_glGenBuffers = genNames;
+        glad_glGenVertexArrays = genNames;
+        glad_glDeleteBuffers = deleteNames;
+        glad_glDeleteVertexArrays = deleteNames;
+        glad_glBindVertexArray = bindName;
+        glad_glBindBuffer = bindTarget;
+        glad_glBufferData = bufferData;
+        glad_glEnableVertexAttribArray = enableAttribute;
+        glad_glVertexAttribPointer = attributePointer;
+    }
+
+    // A GRID_SIZE x GRID_SIZE quad grid with normals and UVs, large enough that a copied buffer stands out
+    bool writeGrid(const std::filesystem::path& path) {
+        std::ofstream file(path);
+        if (!file.is_open()) {
+            return false;
+        }
+        for (int y = 0; y <= GRID_SIZE; y++) {
+            for (int x = 0; x <= GRID_SIZE; x++) {
+                file << "v " << x << " 0 " << y << "\n";
+                file << "vt " << float(x) / GRID_SIZE << " " << float(y) / GRID_SIZE << "\n";
+            }
+        }
+        file << "vn 0 1 0\n";
+        for (int y = 0; y < GRID_SIZE; y++) {
+            for (int x = 0; x < GRID_SIZE; x++) {
+                int a = y * (GRID_SIZE + 1) + x + 1;
+                int b = a + 1;
+                int c = a + GRID_SIZE + 1;
+                int d = c + 1;
+                file << "f " << a << "/" << a << "/1 " << c << "/" << c << "/1 " << d << "/" << d << "/1 " << b << "/" << b << "/1\n";
+            }
+        }
+        return file.good();
+    }
+}
+
+void* operator new(size_t size) {
+    return allocate(size);
+}
+void* operator new[](size_t size) {
+    return allocate(size);
+}
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+void operator delete[](void* p, size_t) noexcept {
+    std::free(p);
+}
+
+int main() {
+    stubGl();
+
+    std::filesystem::path objPath = std::filesystem::temp_directory_path() / "mesh_allocation_test.obj";
+    if (!writeGrid(objPath)) {
+        std::cerr << "FAIL: could not write " << objPath.string() << std::endl;
+        return 1;
+    }
+
+    FastObjLoader loader;
+    bool parsed = loader.Parse(objPath.string());
+    std::filesystem::remove(objPath);
+    if (!parsed) {
+        std::cerr << "FAIL: could not parse the test OBJ" << std::endl;
+        return 1;
+    }
+
+    std::vector<MeshData> meshData = loader.TakeMeshData();
+    if (meshData.size() != 1) {
+        std::cerr << "FAIL: expected 1 mesh, got " << meshData.size() << std::endl;
+        return 1;
+    }
+
+    MeshData& data = meshData[0];
+    const Vertex* vertexData = data.vertices.data();
+    const unsigned int* indexData = data.indices.data();
+    size_t vertexCount = data.vertices.size();
+    size_t indexCount = data.indices.size();
+    size_t smallestBuffer = (std::min)(vertexCount * sizeof(Vertex), indexCount * sizeof(unsigned int));
+
+    counting = true;
+    Mesh mesh(std::move(data.vertices), std::move(data.indices), std::vector<Texture>(), std::move(data.materialProps));
+    counting = false;
+
+    bool passed = true;
+    if (mesh.vertices.data() != vertexData || mesh.vertices.size() != vertexCount) {
+        std::cerr << "FAIL: the vertex buffer was copied instead of moved" << std::endl;
+        passed = false;
+    }
+    if (mesh.indices.data() != indexData || mesh.indices.size() != indexCount) {
+        std::cerr << "FAIL: the index buffer was copied instead of moved" << std::endl;
+        passed = false;
+    }
+    if (largestAllocation >= smallestBuffer) {
+        std::cerr << "FAIL: constructing the mesh allocated " << largestAllocation << " bytes at once, geometry is "
+            << vertexCount * sizeof(Vertex) << " + " << indexCount * sizeof(unsigned int) << " bytes" << std::endl;
+        passed = false;
+    }
+
+    if (!passed) {
+        return 1;
+    }
+    std::cout << "PASS: " << vertexCount << " vertices and " << indexCount << " indices moved into the mesh, "
+        << allocationCount << " small allocations" << std::endl;
+    return 0;
+}
\ No newline at end of file
@@ -21,6 +21,8 @@ namespace UI {
     // Stats functions
     void UpdateStats(float deltaTime);
     void UpdateModelLoadingProgress(float progress, const std::string& stage = "");
+    void UpdatePointCloudStats(size_t visiblePoints, size_t residentPoints, size_t residentNodes, size_t totalNodes);
+    void UpdateChunkedModelStats(size_t drawnNodes, size_t drawnTriangles, size_t gpuBytes, size_t cpuBytes, size_t totalNodes);
 
     // Expose variables for external access
     extern std::string selectedModelPath;
@@ -35,4 +37,18 @@ namespace UI {
     extern bool textureFolderSelected;
     extern bool reloadModelWithMtl;
     extern bool flipUVCoordinates; 
+    extern bool streamObjLoading;
+    extern int objParseMode;
+    extern int objThreadCount;
+    extern bool gpuOnlyGeometry;
+    extern bool cancelModelLoading;
+    extern bool pointCloudMode;
+    extern float pointBudgetMillions;
+    extern float pointSizeScale;
+    extern bool chunkedStreamingMode;
+    extern float chunkedGpuBudgetMB;
+    extern float chunkedCpuBudgetMB;
+    extern float chunkedMaxScreenError;
+    extern bool textureStreaming;
+    extern float textureBudgetMB;
 }
\ No newline at end of file